@@ -1,9 +1,19 @@
+import crypto from "crypto";
 import { v4 as uuidv4 } from "uuid";
 import { DeviceRepository, ScheduleRepository } from "../models/Models.js";
 import { mqttPublish } from "../utils/mqttPublish.js";
-import { addSecondsToTime, timeToMinutes } from "../utils/timeUtilities.js";
+import {
+  addSecondsToTime,
+  normalizeRecurrence,
+  recurrenceOf,
+  schedulesOverlap,
+} from "../utils/timeUtilities.js";
 import { device_Type, SCHEDULE_PENDING_STATUS } from "../utils/constants.js";
 
+// Devices that announced the compact wire format (DEVICE_HELLO) get their
+// schedule commands in it; everyone else keeps JSON
+const wireFormatOf = async (org_id, device_id) =>
+  (await DeviceRepository.getById({ org_id, device_id }))?.wire_format;
 
 // ✅ CREATE schedule
 export const createSchedule = async (req, res) => {
@@ -37,15 +47,20 @@ export const createSchedule = async (req, res) => {
         message: "Valve is not connected to pump!",
       });
       }
-    // Validate time
-    if (start_time > end_time) {
+    // Validate time; an end at or before the start runs past midnight
+    if (start_time === end_time) {
       return res.status(400).json({
         success: false,
-        message: "Start time must be earlier than end time!",
+        message: "Start and end time must differ!",
       });
     }
-    const newStart =timeToMinutes(start_time)
-    const newEnd = timeToMinutes(end_time)
+    let normalizedRecurrence;
+    try {
+      normalizedRecurrence = normalizeRecurrence(recurrence);
+    } catch (err) {
+      return res.status(400).json({ success: false, message: err.message });
+    }
+    const candidate = { start_time, end_time, recurrence: normalizedRecurrence };
     // 🔍 Check for overlapping schedules
     const existingSchdeules = await ScheduleRepository.getByField("org_id",org_id);
     console.log("Existing Sch:org: ",existingSchdeules);
@@ -55,13 +70,7 @@ export const createSchedule = async (req, res) => {
         return (block_id=== schedule.block_id && device_id===schedule.device_id)
     })
     console.log("Filter sch: ",fileterSchedules)
-    const conflicts = fileterSchedules.filter((schedule)=>{
-        const existingStart = timeToMinutes(schedule?.start_time);
-        const existingEnd = timeToMinutes(schedule?.end_time)
-       
-        console.log("Confilet check :ex end ",existingEnd,"ex st: ",existingStart,"new s: ",newStart,"new e: ",newEnd)
-        return (newStart===existingStart && newEnd===existingEnd) || (existingEnd >= newStart && newStart >= existingStart ) || (existingEnd >= newEnd && newEnd >= existingStart );
-    })
+    const conflicts = fileterSchedules.filter((schedule)=> schedulesOverlap(schedule, candidate))
     console.log("Confilt: ",conflicts)
     if (conflicts.length > 0) {
       return res.status(409).json({
@@ -85,7 +94,7 @@ export const createSchedule = async (req, res) => {
       start_time,
       p_start_time,
       end_time,
-      recurrence,
+      recurrence: normalizedRecurrence,
       schedule_status:SCHEDULE_PENDING_STATUS.CREATING,
       pump_ack:false,
       valve_ack:false,
@@ -98,6 +107,7 @@ export const createSchedule = async (req, res) => {
       created_by,
       safety_offset: safety_offset || { pre: 30, post: 30 },
       created_at: new Date().toISOString(),
+      updated_at: new Date().toISOString(),
     });
 
     // 🚀 Publish to MQTT for acknowledgement
@@ -111,8 +121,8 @@ export const createSchedule = async (req, res) => {
         timestamp: new Date().toISOString(),
     }
     console.log("Mqtt ack payload: ",payload)
-    await mqttPublish(valve_topic, payload);
-    await mqttPublish(pump_topic,payload);
+    await mqttPublish(valve_topic, payload, device.wire_format);
+    await mqttPublish(pump_topic,payload, await wireFormatOf(org_id, device.parent_id));
     // const schedules = await ScheduleRepository.getByField("org_id",org_id);
     return res.status(200).json({ success: true, 
         message:"Schedule created",
@@ -126,7 +136,7 @@ export const createSchedule = async (req, res) => {
 // ✅ UPDATE schedule
 export const updateSchedule = async (req, res) => {
   try {
-    const { schedule_id,org_id,block_id,device_type ,device_id ,start_time,end_time} = req.body;
+    const { schedule_id,org_id,block_id,device_type ,device_id ,start_time,end_time,recurrence} = req.body;
       if (!schedule_id || !org_id || !block_id || !device_type || !device_id || !start_time || !end_time) {
       return res.status(400).json({ success: false, message: "Missing required fields!" });
     }
@@ -144,31 +154,36 @@ export const updateSchedule = async (req, res) => {
         message: "Valve is not connected to pump!",
       });
       }
-    // Validate time
-    if (start_time > end_time) {
+    // Validate time; an end at or before the start runs past midnight
+    if (start_time === end_time) {
       return res.status(400).json({
         success: false,
-        message: "Start time must be earlier than end time!",
+        message: "Start and end time must differ!",
       });
     }
-    const newStart =timeToMinutes(start_time)
-    const newEnd = timeToMinutes(end_time)
     // 🔍 Check for overlapping schedules
     const existingSchdeules = await ScheduleRepository.getByField("org_id",org_id);
     console.log("Existing Sch:org: ",existingSchdeules);
 
+    // Without a new recurrence the schedule keeps the one it has
+    let normalizedRecurrence;
+    try {
+      normalizedRecurrence = recurrence === undefined
+        ? recurrenceOf(existingSchdeules.find((schedule) => schedule.schedule_id === schedule_id))
+        : normalizeRecurrence(recurrence);
+    } catch (err) {
+      return res.status(400).json({ success: false, message: err.message });
+    }
+    const candidate = { start_time, end_time, recurrence: normalizedRecurrence };
+
      const fileterSchedules = existingSchdeules.filter((schedule)=>{
         
         return (block_id=== schedule.block_id && device_id===schedule.device_id)
     })
     console.log("Filter sch: ",fileterSchedules)
-    const conflicts = fileterSchedules.filter((schedule)=>{
-        const existingStart = timeToMinutes(schedule?.start_time);
-        const existingEnd = timeToMinutes(schedule?.end_time)
-        console.log("shc: ",schedule.schedule_id,schedule_id,schedule.schedule_id!=schedule_id)
-        console.log("Confilet check :ex end ",existingEnd,"ex st: ",existingStart,"new s: ",newStart,"new e: ",newEnd)
-        return ((schedule.schedule_id!==schedule_id) && ((existingEnd >= newStart && newStart >= existingStart ) || (existingEnd >= newEnd && newEnd >= existingStart )));
-    })
+    const conflicts = fileterSchedules.filter(
+      (schedule) => schedule.schedule_id !== schedule_id && schedulesOverlap(schedule, candidate)
+    )
     console.log("Confilt: ",conflicts)
     if (conflicts.length > 0) {
       return res.status(409).json({
@@ -183,10 +198,12 @@ export const updateSchedule = async (req, res) => {
     console.log("body: ",req.body)
     const updated = await ScheduleRepository.update({schedule_id,org_id},{
       start_time,end_time,
+      recurrence: normalizedRecurrence,
       pump_ack:false,
       valve_ack:false,
       p_start_time,
-      schedule_status:SCHEDULE_PENDING_STATUS.UPDATING
+      schedule_status:SCHEDULE_PENDING_STATUS.UPDATING,
+      updated_at: new Date().toISOString()
 
     });
      // 🚀 Publish to MQTT for acknowledgement
@@ -201,8 +218,8 @@ export const updateSchedule = async (req, res) => {
     }
     console.log("Mqtt ack payload: ",payload)
     console.log("UPDATE SCH: ",updated)
-    await mqttPublish(valve_topic, payload);
-    await mqttPublish(pump_topic,payload);
+    await mqttPublish(valve_topic, payload, device.wire_format);
+    await mqttPublish(pump_topic,payload, await wireFormatOf(org_id, device.parent_id));
     // const schedules = await ScheduleRep
     return res.status(200).json({ success: true,message:"Schedule Updated", schedule:updated });
   } catch (error) {
@@ -235,7 +252,8 @@ export const deleteSchedule = async (req,res  ) => {
     const deleting_request = await ScheduleRepository.update({schedule_id,org_id},{
       pump_ack:false,
       valve_ack:false,
-      schedule_status:SCHEDULE_PENDING_STATUS.DELETING
+      schedule_status:SCHEDULE_PENDING_STATUS.DELETING,
+      updated_at: new Date().toISOString()
 
     });
 
@@ -254,8 +272,8 @@ export const deleteSchedule = async (req,res  ) => {
         timestamp: new Date().toISOString(),
     }
     console.log("Mqtt ack payload: ",payload)
-    await mqttPublish(valve_topic, payload);
-    await mqttPublish(pump_topic,payload);
+    await mqttPublish(valve_topic, payload, await wireFormatOf(org_id, schedule.device_id));
+    await mqttPublish(pump_topic,payload, await wireFormatOf(org_id, schedule.acknowledge.pump_id));
 
     // const result = await ScheduleRepository.remove({schedule_id,org_id});
     // console.log("Del sch: ",JSON.stringify(result));
@@ -301,3 +319,85 @@ export const getScheduleById = async (req, res) => {
   }
 };
 
+// Epoch ms of a stored timestamp, 0 if missing or unreadable. The API
+// writes toISOString() ("...00.123Z"); the IoT handlers have written UTC
+// without a zone ("...00.123400", or no fraction at all), which Date.parse
+// would otherwise read as local time.
+const timestampMs = (ts) => {
+  if (!ts) return 0;
+  const zoned = /(Z|[+-]\d\d:?\d\d)$/i.test(ts) ? ts : `${ts}Z`;
+  return Date.parse(zoned) || 0;
+};
+
+// Latest change to a schedule, either from the API or from a device ACK,
+// in epoch ms
+const scheduleModifiedAt = (schedule) =>
+  Math.max(
+    timestampMs(schedule.updated_at),
+    timestampMs(schedule.last_ack_time),
+    timestampMs(schedule.created_at)
+  );
+
+// Version of a device's schedule set; changes on any create/update/ack/delete
+const scheduleSetVersion = (schedules) => {
+  const hash = crypto.createHash("sha1");
+  [...schedules]
+    .sort((a, b) => (a.schedule_id < b.schedule_id ? -1 : 1))
+    .forEach((schedule) => {
+      hash.update(
+        `${schedule.schedule_id}|${scheduleModifiedAt(schedule)}|${schedule.schedule_status}|${schedule.pump_ack}|${schedule.valve_ack};`
+      );
+    });
+  return hash.digest("hex").slice(0, 16);
+};
+
+// ✅ GET schedules for a single device, with version check and delta sync
+export const getScheduleByDeviceId = async (req, res) => {
+  try {
+    const { org_id, device_id, since } = req.body;
+    if (!org_id || !device_id) {
+      return res.status(400).json({
+        success: false,
+        message: "org_id and device_id are required!",
+      });
+    }
+
+    const orgSchedules = await ScheduleRepository.getByField("org_id", org_id);
+    const schedules = orgSchedules.filter(
+      (schedule) => schedule.device_id === device_id || schedule.acknowledge?.pump_id === device_id
+    );
+
+    // Compared as instants, never as strings: the writers disagree on format
+    const sinceMs = timestampMs(since);
+    const version = scheduleSetVersion(schedules);
+    const syncedMs = schedules.reduce(
+      (latest, schedule) => Math.max(latest, scheduleModifiedAt(schedule)),
+      sinceMs
+    );
+    const synced_at = syncedMs ? new Date(syncedMs).toISOString() : "";
+
+    res.set("ETag", `"${version}"`);
+    res.set("X-Synced-At", synced_at);
+    if (req.get("If-None-Match") === `"${version}"`) {
+      return res.status(304).end();
+    }
+
+    // Without `since` the device gets everything; otherwise only what changed.
+    // schedule_ids lists every live schedule so the device can drop deleted ones.
+    const changed = since
+      ? schedules.filter((schedule) => scheduleModifiedAt(schedule) > sinceMs)
+      : schedules;
+
+    return res.status(200).json({
+      success: true,
+      version,
+      synced_at,
+      full: !since,
+      schedules: changed,
+      schedule_ids: schedules.map((schedule) => schedule.schedule_id),
+    });
+  } catch (error) {
+    console.error("Error in getScheduleByDeviceId:", error);
+    return res.status(400).json({ success: false, message: error.message });
+  }
+};
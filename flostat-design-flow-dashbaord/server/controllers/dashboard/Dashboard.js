@@ -51,83 +51,75 @@ export const fcmTest = async (req, res) => {
 };
 
 // ---------------- COMMAND UPDATE ----------------
-export const updateCommandForDeviceState = async (req, res) => {
-  try {
-    const { org_id, device_id, device_type, block_id, status, current_level } = req.body;
-    const email = req.user?.email || req.user?.hardware || "system";
-
-    if (!org_id || !device_type || !device_id) {
-      return res.status(400).json({
-        success: false,
-        message: "Missing params",
-      });
-    }
-
-    let block = block_id || "none";
-    console.log("Device params: ", org_id, device_id);
-
-    // 🧠 Fetch device info
-    const device = await DeviceRepository.getById({ org_id, device_id });
-    console.log("Device found: ");
-    if (!device) {
-      return res.status(400).json({
-        success: false,
-        message: "Device not Found!",
-      });
-    }
- console.log("Device now update: ");
-    // 🧱 Update current level if provided
-    if (current_level !== undefined) {
-      if (!block) {
-        return res.status(404).json({
-          success: false,
-          message: "Block id is required",
-        });
-      }
-
-      await updateDeviceStatus(
-        org_id,
-        device_id,
-        device_type,
-        block,
-        current_level,
-        null,
-        { email, device }
-      );
-    }
-
-    console.log("Device Mode change: ");
-    // ⚙️ Determine mode (default manual)
-
-    let mode = MODE.MANUAL;
-    if (device?.block_id && device.device_type !== device_Type.SUMP) {
-      console.log("Block param: ", device?.block_id, org_id);
-      const blockDetail = await BlockRepository.getById({
-        block_id: device.block_id,
-        org_id,
-      });
-      mode = blockDetail?.mode || MODE.MANUAL;
-    }
+// Shared by the REST route and the DEVICE_STATUS MQTT consumer
+export async function applyDeviceCommand({ org_id, device_id, device_type, block_id, status, current_level }, email) {
+  if (!org_id || !device_type || !device_id) {
+    return { success: false, message: "Missing params" };
+  }
 
-    console.log("Mode of Update: ", mode);
+  let block = block_id || "none";
+  console.log("Device params: ", org_id, device_id);
 
-    // 🧩 Run logic
-    const result = await managementLogicSystem(
+  // 🧠 Fetch device info
+  const device = await DeviceRepository.getById({ org_id, device_id });
+  console.log("Device found: ");
+  if (!device) {
+    return { success: false, message: "Device not Found!" };
+  }
+  console.log("Device now update: ");
+  // 🧱 Update current level if provided
+  if (current_level !== undefined) {
+    await updateDeviceStatus(
       org_id,
       device_id,
       device_type,
       block,
-      status,
-      { email, device, mode }
+      current_level,
+      null,
+      { email, device }
     );
-    const deviceStatusUpdated = await DeviceStatusRepository.getById({org_id,device_id});
+  }
 
-    // ✅ Send final single response
-    return res.status(result.success ? 200 : 400).json({
-      success:result.success,
-      message:result.message,
-      updatedStatus:deviceStatusUpdated
+  console.log("Device Mode change: ");
+  // ⚙️ Determine mode (default manual)
+
+  let mode = MODE.MANUAL;
+  if (device?.block_id && device.device_type !== device_Type.SUMP) {
+    console.log("Block param: ", device?.block_id, org_id);
+    const blockDetail = await BlockRepository.getById({
+      block_id: device.block_id,
+      org_id,
     });
+    mode = blockDetail?.mode || MODE.MANUAL;
+  }
+
+  console.log("Mode of Update: ", mode);
+
+  // 🧩 Run logic
+  const result = await managementLogicSystem(
+    org_id,
+    device_id,
+    device_type,
+    block,
+    status,
+    { email, device, mode }
+  );
+  const deviceStatusUpdated = await DeviceStatusRepository.getById({org_id,device_id});
+
+  return {
+    success:result.success,
+    message:result.message,
+    updatedStatus:deviceStatusUpdated
+  };
+}
+
+export const updateCommandForDeviceState = async (req, res) => {
+  try {
+    const email = req.user?.email || req.user?.hardware || "system";
+    const result = await applyDeviceCommand(req.body, email);
+
+    // ✅ Send final single response
+    return res.status(result.success ? 200 : 400).json(result);
 
   } catch (err) {
     console.error("❌ updateCommandForDeviceState Error:", err);
@@ -1,6 +1,6 @@
 import { DeviceRepository, DeviceStatusRepository, ScheduleRepository } from "../../models/Models.js";
 import { device_Type, MIN_THRESHOLD, MODE, PUMP_STATUS, VALVE_STATUS } from "../../utils/constants.js";
-import { timeToMinutes } from "../../utils/timeUtilities.js";
+import { isScheduleActiveAt } from "../../utils/timeUtilities.js";
 import { updateDeviceStatus } from "./updateDeviceStatus.js";
 
 // ---------------- VALVE LOGIC ----------------
@@ -121,23 +121,10 @@ const checkForConflictingSchedule = async (org_id, device_id) => {
   // console.log("Time curr: ",istFormatter.format(new Date()));
    const now = new Date();
 
-const formattedTime = now.toLocaleTimeString("en-GB", {
-  timeZone: "Asia/Kolkata",
-  hour: "2-digit",
-  minute: "2-digit",
-  hour12: false, // optional: use 24-hour format
-});
-  const currentMinutes = timeToMinutes(formattedTime);
-
-  // console.log("Current Time:", formattedTime);
   // console.log("Filtered Schedules:", filteredSchedules);
 
-  // 4️⃣ Check if current time lies within any schedule’s time range
-  const conflict = filteredSchedules.find((schedule) => {
-    const start = timeToMinutes(schedule.start_time);
-    const end = timeToMinutes(schedule.end_time);
-    return currentMinutes >= start && currentMinutes <= end;
-  });
+  // 4️⃣ Check if any schedule is running now (recurrence and overnight aware)
+  const conflict = filteredSchedules.find((schedule) => isScheduleActiveAt(schedule, now));
 
   // 5️⃣ Return conflicting schedule or false
   if (conflict) {
@@ -0,0 +1,38 @@
+import 'dotenv/config' //  to load the data to `process` variable
+import { applyDeviceCommand } from "./controllers/dashboard/Dashboard.js";
+import { DeviceRepository } from "./models/Models.js";
+import { HARDWARE, WIRE_FORMAT } from "./utils/constants.js";
+import { decodeWireMessage } from "./utils/wireFormat.js";
+
+// AWS IoT rule target for messages that devices publish on
+// flostat/{org_id}/status/{block_id}/{device_type}/{device_id}.
+// DEVICE_STATUS runs the same logic as PUT /api/v1/device/updateDeviceStatus,
+// without the API Gateway hop or a second TLS session on the device.
+// Devices using the compact wire format publish on the same topic + "/mp";
+// that rule hands the raw bytes over base64 encoded.
+export const handler = async (event) => {
+  try {
+    const { type, data } = event?.base64OriginalPayload
+      ? decodeWireMessage(Buffer.from(event.base64OriginalPayload, "base64"))
+      : event || {};
+
+    if (type === "DEVICE_HELLO" && data) {
+      // Remember the wire format so schedule commands are sent in it
+      const wire_format = data.wire === WIRE_FORMAT.MSGPACK ? WIRE_FORMAT.MSGPACK : WIRE_FORMAT.JSON;
+      await DeviceRepository.update({ org_id: data.org_id, device_id: data.device_id }, { wire_format });
+      console.log("DEVICE_HELLO: ", data.device_id, wire_format);
+      return { success: true, message: "Wire format updated" };
+    }
+    if (type !== "DEVICE_STATUS" || !data) {
+      console.log("Unhandled event type: ", type);
+      return { success: false, message: "Event type not handled" };
+    }
+
+    const result = await applyDeviceCommand(data, HARDWARE);
+    console.log("DEVICE_STATUS applied: ", data.device_id, data.status, result.message);
+    return result;
+  } catch (err) {
+    console.error("❌ DEVICE_STATUS Error:", err);
+    return { success: false, message: err.message || "Internal server error" };
+  }
+};
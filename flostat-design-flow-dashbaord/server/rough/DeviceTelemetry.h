@@ -0,0 +1,263 @@
+// DeviceTelemetry.h
+// One-pass DEVICE_UPDATE encoder shared by the sketches that publish device
+// state. Writes straight into a caller-owned buffer (usually on the stack):
+// no String, no heap, and a payload that does not fit is reported instead of
+// truncated.
+//
+//   DeviceTelemetry t = { org_id, device_id, "tank", level, rssiToPercent(WiFi.RSSI()), -1, time(nullptr) };
+//   char buf[320];
+//   size_t len = encodeTelemetryJson(t, buf);        // 0 if it did not fit
+//   uint8_t wire[69];
+//   size_t wlen = encodeTelemetryWire(t, wire);      // compact wire format
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Fields set to -1 (or timestamp 0) are left out of the payload
+struct DeviceTelemetry {
+  const char* org_id;
+  const char* device_id;
+  const char* device_type;  // "tank", "sump", "pump", "valve"
+  int current_level;        // percent
+  int wifi_strength;        // percent, see rssiToPercent()
+  int battery;              // percent
+  time_t timestamp;         // epoch seconds, 0 while the clock is not set
+};
+
+// Epoch seconds before this mean the RTC was never synced
+const time_t TELEMETRY_MIN_VALID_EPOCH = 1700000000;
+
+// RSSI in dBm -> 0..100, the scale the dashboard shows
+inline int rssiToPercent(int rssi) {
+  if (rssi >= -50) return 100;
+  if (rssi <= -100) return 0;
+  return 2 * (rssi + 100);
+}
+
+// Bounded appender; once something does not fit, ok stays false
+struct TelemetryOut {
+  char* buf;
+  size_t cap;
+  size_t len;
+  bool ok;
+
+  void raw(const char* s, size_t n) {
+    if (!ok || len + n >= cap) {  // keep room for the terminator
+      ok = false;
+      return;
+    }
+    memcpy(buf + len, s, n);
+    len += n;
+    buf[len] = '\0';
+  }
+  template <size_t N>
+  void lit(const char (&s)[N]) { raw(s, N - 1); }  // length known at compile time
+  void str(const char* s) {
+    lit("\"");
+    raw(s, strlen(s));
+    lit("\"");
+  }
+  void num(long v) {
+    char tmp[12];
+    int n = snprintf(tmp, sizeof(tmp), "%ld", v);
+    raw(tmp, n);
+  }
+};
+
+inline size_t encodeTelemetryJson(const DeviceTelemetry& t, char* buf, size_t cap) {
+  TelemetryOut o = { buf, cap, 0, cap > 0 };
+  o.lit("{\"type\":\"DEVICE_UPDATE\",\"data\":{\"device_id\":");
+  o.str(t.device_id);
+  o.lit(",\"org_id\":");
+  o.str(t.org_id);
+  o.lit(",\"device_type\":");
+  o.str(t.device_type);
+  if (t.timestamp >= TELEMETRY_MIN_VALID_EPOCH) {
+    struct tm utc;
+    char iso[24];
+    gmtime_r(&t.timestamp, &utc);
+    strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    o.lit(",\"last_updated\":");
+    o.str(iso);
+  }
+  if (t.current_level >= 0) {
+    o.lit(",\"current_level\":");
+    o.num(t.current_level);
+  }
+  if (t.wifi_strength >= 0) {
+    o.lit(",\"wifi_strength\":");
+    o.num(t.wifi_strength);
+  }
+  if (t.battery >= 0) {
+    o.lit(",\"battery\":");
+    o.num(t.battery);
+  }
+  o.lit(",\"source\":\"hardware\",\"updated_by\":\"hardware\"},\"updated_by\":\"hardware\"}");
+  return o.ok ? o.len : 0;
+}
+
+// Buffer size checked at compile time when the array is passed directly
+template <size_t N>
+size_t encodeTelemetryJson(const DeviceTelemetry& t, char (&buf)[N]) {
+  static_assert(N >= 320, "DEVICE_UPDATE JSON needs at least 320 bytes");
+  return encodeTelemetryJson(t, buf, N);
+}
+
+// ---------------------------------------------------------------------------
+// Compact wire format (server/utils/wireFormat.js): {0: 1 (DEVICE_UPDATE),
+// 1: {integer key: value}} with 16 byte binary UUIDs and epoch seconds.
+// ---------------------------------------------------------------------------
+inline bool telemetryPackUuid(const char* s, uint8_t* out) {
+  int nibbles = 0;
+  for (; s && *s && nibbles < 32; s++) {
+    if (*s == '-') continue;
+    uint8_t v;
+    if (*s >= '0' && *s <= '9') v = *s - '0';
+    else if (*s >= 'a' && *s <= 'f') v = *s - 'a' + 10;
+    else if (*s >= 'A' && *s <= 'F') v = *s - 'A' + 10;
+    else return false;
+    if (nibbles % 2 == 0) out[nibbles / 2] = v << 4;
+    else out[nibbles / 2] |= v;
+    nibbles++;
+  }
+  return nibbles == 32 && s && *s == '\0';
+}
+
+inline uint8_t telemetryDeviceTypeId(const char* t) {
+  static const char* const names[] = { "valve", "pump", "tank", "sump" };
+  for (uint8_t i = 0; i < 4; i++)
+    if (strcmp(t, names[i]) == 0) return i + 1;
+  return 0;
+}
+
+inline size_t encodeTelemetryWire(const DeviceTelemetry& t, uint8_t* buf, size_t cap) {
+  // Worst case: 5 header + 2 * 19 ids + 2 type + 4 * 6 numbers
+  if (cap < 69) return 0;
+  uint8_t* p = buf;
+  uint8_t* fields;
+  auto uintField = [&p](uint8_t key, uint32_t v) {
+    *p++ = key;
+    if (v < 0x80) {
+      *p++ = v;
+    } else if (v < 0x100) {
+      *p++ = 0xCC;
+      *p++ = v;
+    } else {
+      *p++ = 0xCE;
+      *p++ = v >> 24;
+      *p++ = v >> 16;
+      *p++ = v >> 8;
+      *p++ = v;
+    }
+  };
+
+  *p++ = 0x82;  // {0: type, 1: data}
+  *p++ = 0;
+  *p++ = 1;     // DEVICE_UPDATE
+  *p++ = 1;
+  fields = p++;
+  uint8_t count = 0;
+
+  uint8_t id[16];
+  if (telemetryPackUuid(t.device_id, id)) {
+    *p++ = 2;   // device_id
+    *p++ = 0xC4;
+    *p++ = 16;
+    memcpy(p, id, 16);
+    p += 16;
+    count++;
+  }
+  if (telemetryPackUuid(t.org_id, id)) {
+    *p++ = 1;   // org_id
+    *p++ = 0xC4;
+    *p++ = 16;
+    memcpy(p, id, 16);
+    p += 16;
+    count++;
+  }
+  uintField(5, telemetryDeviceTypeId(t.device_type));
+  count++;
+  if (t.current_level >= 0) {
+    uintField(12, t.current_level);
+    count++;
+  }
+  if (t.wifi_strength >= 0) {
+    uintField(13, t.wifi_strength);
+    count++;
+  }
+  if (t.battery >= 0) {
+    uintField(14, t.battery);
+    count++;
+  }
+  if (t.timestamp >= TELEMETRY_MIN_VALID_EPOCH) {
+    uintField(16, (uint32_t)t.timestamp);  // last_updated
+    count++;
+  }
+  *fields = 0x80 | count;
+  return p - buf;
+}
+
+template <size_t N>
+size_t encodeTelemetryWire(const DeviceTelemetry& t, uint8_t (&buf)[N]) {
+  static_assert(N >= 69, "DEVICE_UPDATE wire payload needs at least 69 bytes");
+  return encodeTelemetryWire(t, buf, N);
+}
+
+// ---------------------------------------------------------------------------
+// Report-on-change policy. Publish when the level moved by more than
+// `deadband` since the last report, or keeps changing at `rate_per_min` or
+// faster; never more often than min_interval_ms, and at least every
+// max_interval_ms as a heartbeat so the dashboard can tell idle from offline.
+// ---------------------------------------------------------------------------
+struct TelemetryPolicy {
+  uint8_t deadband;          // percent points, changes within it are noise
+  uint8_t rate_per_min;      // percent points per minute, 0 disables
+  uint32_t min_interval_ms;
+  uint32_t max_interval_ms;
+};
+
+// Rate of change is measured over windows of this length; long enough that
+// a 1 % sensor jitter stays well under any useful rate threshold
+const uint32_t TELEMETRY_RATE_WINDOW_MS = 60000;
+
+struct TelemetryGate {
+  TelemetryPolicy policy;
+  int last_level;            // -1 until the first report
+  uint32_t last_publish_ms;
+  int window_level;
+  uint32_t window_start_ms;
+  int rate_per_min;
+
+  explicit TelemetryGate(const TelemetryPolicy& p)
+    : policy(p), last_level(-1), last_publish_ms(0), window_level(-1), window_start_ms(0), rate_per_min(0) {}
+
+  // Feed every level sample; true when this one should be published
+  bool shouldPublish(int level, uint32_t now) {
+    if (window_level < 0) {
+      window_level = level;
+      window_start_ms = now;
+    } else if (now - window_start_ms >= TELEMETRY_RATE_WINDOW_MS) {
+      rate_per_min = (int)((long)(level - window_level) * 60000L / (long)(now - window_start_ms));
+      window_level = level;
+      window_start_ms = now;
+    }
+
+    if (last_level < 0) return true;
+    uint32_t since = now - last_publish_ms;
+    if (since < policy.min_interval_ms) return false;
+    if (since >= policy.max_interval_ms) return true;
+
+    int moved = level > last_level ? level - last_level : last_level - level;
+    if (moved > policy.deadband) return true;
+    int rate = rate_per_min < 0 ? -rate_per_min : rate_per_min;
+    return policy.rate_per_min > 0 && moved > 0 && rate >= policy.rate_per_min;
+  }
+
+  void published(int level, uint32_t now) {
+    last_level = level;
+    last_publish_ms = now;
+  }
+};
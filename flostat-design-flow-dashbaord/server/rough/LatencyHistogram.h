@@ -0,0 +1,74 @@
+// LatencyHistogram.h
+// Fixed-size log-linear latency histogram for hot-path instrumentation.
+// Recording is one count-leading-zeros and two increments: no heap, no
+// floats, cheap enough to wrap every phase of loop().
+//
+// Buckets are exact below 4 us, then every power of two is split into 4
+// linear steps, so a sample is at most 25 % above its bucket's lower bound.
+// The last bucket (99) starts at ~59 s and takes everything longer.
+//
+//   LatencyHistogram h = {};
+//   h.record(us);
+//   h.percentile(99);           // upper bound of the p99 bucket, in us
+//   h.merge(other);             // add another window's samples
+//   latencyBucketLowerUs(i);    // decode a published bucket index
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define LATENCY_SUB_BITS   2
+#define LATENCY_SUB_COUNT  (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS    100
+
+inline uint8_t latencyBucket(uint32_t us) {
+  if (us < LATENCY_SUB_COUNT) return us;
+  uint32_t msb = 31 - __builtin_clz(us);
+  uint32_t i = (msb - LATENCY_SUB_BITS + 1) * LATENCY_SUB_COUNT +
+               ((us >> (msb - LATENCY_SUB_BITS)) & (LATENCY_SUB_COUNT - 1));
+  return i < LATENCY_BUCKETS ? i : LATENCY_BUCKETS - 1;
+}
+
+inline uint32_t latencyBucketLowerUs(uint8_t i) {
+  if (i < LATENCY_SUB_COUNT) return i;
+  uint32_t msb = i / LATENCY_SUB_COUNT + LATENCY_SUB_BITS - 1;
+  return (1UL << msb) + ((uint32_t)(i % LATENCY_SUB_COUNT) << (msb - LATENCY_SUB_BITS));
+}
+
+struct LatencyHistogram {
+  uint32_t counts[LATENCY_BUCKETS];
+  uint32_t n;
+  uint32_t max_us;
+
+  void record(uint32_t us) {
+    counts[latencyBucket(us)]++;
+    n++;
+    if (us > max_us) max_us = us;
+  }
+
+  void reset() { memset(this, 0, sizeof(*this)); }
+
+  // Fold another window back in, e.g. one that could not be published
+  void merge(const LatencyHistogram& o) {
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) counts[i] += o.counts[i];
+    n += o.n;
+    if (o.max_us > max_us) max_us = o.max_us;
+  }
+
+  // Upper bound of the bucket holding the q-th percentile (never above the
+  // recorded max), 0 while empty
+  uint32_t percentile(uint8_t q) const {
+    if (n == 0) return 0;
+    uint32_t target = ((uint64_t)n * q + 99) / 100;
+    if (target == 0) target = 1;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+      seen += counts[i];
+      if (seen < target) continue;
+      if (i + 1 >= LATENCY_BUCKETS) break;
+      uint32_t upper = latencyBucketLowerUs(i + 1) - 1;
+      return upper < max_us ? upper : max_us;
+    }
+    return max_us;
+  }
+};
@@ -0,0 +1,104 @@
+// LatencyHistogramTest.cpp
+// Bucket bounds, percentiles and merge() of LatencyHistogram, then the way
+// new-csd.cpp shares its phase histograms: writers on two threads record
+// under a portMUX while a publisher copies and resets under the same lock
+// and merges a failed window back. No sample may be lost or counted twice.
+#include <Arduino.h>
+
+#include <atomic>
+#include <thread>
+
+#include "HostTest.h"
+#include "LatencyHistogram.h"
+
+#define WRITER_SAMPLES 500000
+
+namespace {
+
+void testBuckets() {
+  for (uint32_t us = 0; us < 70000000; us = us < 64 ? us + 1 : us + us / 7) {
+    uint8_t b = latencyBucket(us);
+    HOST_CHECK_LE(latencyBucketLowerUs(b), us);
+    if (b + 1 < LATENCY_BUCKETS) HOST_CHECK(us < latencyBucketLowerUs(b + 1));
+  }
+}
+
+void testPercentileAndMerge() {
+  LatencyHistogram a = {}, b = {};
+  for (uint32_t i = 1; i <= 100; i++) a.record(i * 10);
+  HOST_CHECK_EQ(a.n, 100);
+  HOST_CHECK_EQ(a.max_us, 1000);
+  HOST_CHECK_GE(a.percentile(50), 500);
+  HOST_CHECK_LE(a.percentile(50), 500 * 5 / 4);
+  HOST_CHECK_EQ(a.percentile(100), 1000);
+
+  b.record(40000);
+  b.merge(a);
+  HOST_CHECK_EQ(b.n, 101);
+  HOST_CHECK_EQ(b.max_us, 40000);
+  HOST_CHECK_EQ(b.percentile(50), a.percentile(50));
+}
+
+LatencyHistogram shared;
+portMUX_TYPE sharedMux = portMUX_INITIALIZER_UNLOCKED;
+std::atomic<int> writersDone{ 0 };
+
+void writer(uint32_t seed) {
+  for (uint32_t i = 0; i < WRITER_SAMPLES; i++) {
+    uint32_t us = (i * 2654435761u + seed) % 200000;
+    portENTER_CRITICAL(&sharedMux);
+    shared.record(us);
+    portEXIT_CRITICAL(&sharedMux);
+    if (i % 512 == 0) std::this_thread::yield();   // let the publisher in
+  }
+  writersDone++;
+}
+
+void testSnapshotAgainstWriters() {
+  shared.reset();
+  std::thread w1(writer, 1), w2(writer, 7);
+
+  // publishDiagnostics(): copy and clear, every other window "fails" and
+  // is merged back
+  uint64_t published = 0;
+  uint32_t windows = 0;
+  bool last = false;
+  while (!last) {
+    last = writersDone.load() == 2;
+    LatencyHistogram h;
+    portENTER_CRITICAL(&sharedMux);
+    h = shared;
+    shared.reset();
+    portEXIT_CRITICAL(&sharedMux);
+
+    uint64_t sum = 0;
+    for (uint32_t c : h.counts) sum += c;
+    HOST_CHECK_EQ(sum, h.n);   // a consistent copy, never mid-record
+
+    if (++windows % 2 == 0 && !last) {
+      portENTER_CRITICAL(&sharedMux);
+      shared.merge(h);
+      portEXIT_CRITICAL(&sharedMux);
+    } else {
+      published += h.n;
+    }
+    std::this_thread::yield();
+  }
+  w1.join();
+  w2.join();
+  published += shared.n;
+
+  printf("%u windows, %llu of %u samples published\n", (unsigned)windows, (unsigned long long)published,
+         2 * WRITER_SAMPLES);
+  HOST_CHECK_EQ(published, 2 * WRITER_SAMPLES);
+}
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  testBuckets();
+  testPercentileAndMerge();
+  testSnapshotAgainstWriters();
+  return hostTestExit();
+}
@@ -0,0 +1,72 @@
+// MqttDispatch.h
+// Single-pass MQTT dispatch for the gateway sketches. A callback looks at
+// PubSubClient's payload buffer in place: plain-text commands are matched
+// without building a String, and JSON messages are parsed once, then
+// switched on their "type" through classifyMessageType().
+//
+//   if (mqttTextCommandIs(payload, length, "ON")) ...        // "ON", " \"ON\"\n"
+//
+//   StaticJsonDocument<MQTT_COMMAND_DOC_SIZE> doc;            // ArduinoJson included first
+//   if (deserializeCommand(doc, payload, length)) return;
+//   switch (classifyMessageType(doc["type"])) { ... }
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+enum MqttMessageType : uint8_t {
+  MSG_UNKNOWN = 0,
+  MSG_DEVICE_UPDATE,
+  MSG_SCHEDULE_CREATED,
+  MSG_SCHEDULE_UPDATE,
+  MSG_SCHEDULE_DELETE
+};
+
+// Length + one distinguishing char pick the candidate, strcmp confirms it
+inline MqttMessageType classifyMessageType(const char* type) {
+  if (!type) return MSG_UNKNOWN;
+  size_t len = strlen(type);
+  if (len == 13) return strcmp(type, "DEVICE_UPDATE") == 0 ? MSG_DEVICE_UPDATE : MSG_UNKNOWN;
+  if (len < 15) return MSG_UNKNOWN;
+
+  switch (type[9]) {
+    case 'C':
+      if (len == 16 && strcmp(type, "SCHEDULE_CREATED") == 0) return MSG_SCHEDULE_CREATED;
+      break;
+    case 'U':
+      if (len == 15 && strcmp(type, "SCHEDULE_UPDATE") == 0) return MSG_SCHEDULE_UPDATE;
+      break;
+    case 'D':
+      if (len == 15 && strcmp(type, "SCHEDULE_DELETE") == 0) return MSG_SCHEDULE_DELETE;
+      break;
+  }
+  return MSG_UNKNOWN;
+}
+
+// Text payload equals word once surrounding whitespace and quotes are
+// dropped, what trim() + replace("\"", "") did for single-word commands
+inline bool mqttTextCommandIs(const uint8_t* payload, unsigned int length, const char* word) {
+  const uint8_t* end = payload + length;
+  while (payload < end && (*payload <= ' ' || *payload == '"')) payload++;
+  while (end > payload && (end[-1] <= ' ' || end[-1] == '"')) end--;
+  size_t n = strlen(word);
+  return (size_t)(end - payload) == n && memcmp(payload, word, n) == 0;
+}
+
+#ifdef ARDUINOJSON_VERSION
+// Room for the filtered fields below, whatever else the message carries
+#define MQTT_COMMAND_DOC_SIZE 256
+
+// {"type":"DEVICE_UPDATE","data":{"status":"ON",...},"updated_by":"user@org"}
+// Only the fields the gateways act on are kept; the rest of the device or
+// schedule record is skipped while parsing. The payload is read as const,
+// so strings are copied into doc and the MQTT buffer may be reused after.
+inline DeserializationError deserializeCommand(JsonDocument& doc, const uint8_t* payload, unsigned int length) {
+  StaticJsonDocument<96> filter;
+  filter["type"] = true;
+  filter["updated_by"] = true;
+  filter["data"]["status"] = true;
+  return deserializeJson(doc, payload, length, DeserializationOption::Filter(filter));
+}
+#endif
@@ -0,0 +1,200 @@
+// MqttDispatchBench.cpp
+// The gateways' MQTT callbacks, old against new, on a mix of the messages
+// they see. Reports messages/sec, allocations per message and the peak heap
+// one message costs:
+//   text    "esp schedule.cpp": String built char by char, trim(),
+//           replace("\""), compared; now mqttTextCommandIs() on the buffer
+//   json    new-csd.cpp: String copy + indexOf("SCHEDULE_CREATED") on the
+//           /hardware topic and a parse per handler; now one filtered parse
+//           and classifyMessageType()
+// The host String grows geometrically where Arduino's reallocs per char, and
+// short strings stay inside std::string, so the legacy allocation counts are
+// a lower bound of what the device pays. The json half needs ArduinoJson.
+#if __has_include(<ArduinoJson.h>)
+#include <ArduinoJson.h>
+#endif
+#include <Arduino.h>
+
+#include "HostHeap.h"
+#include "HostTest.h"
+#include "MqttDispatch.h"
+
+#define BENCH_ROUNDS 200000
+
+namespace {
+
+struct Result {
+  double msgsPerSec;
+  double allocsPerMsg;
+  size_t peakBytes;   // above what was live before the run
+};
+
+template <typename Fn>
+Result measure(int rounds, int perRound, Fn&& fn) {
+  HostHeapStats h0 = hostHeapStats();
+  hostHeapResetPeak();
+  double t0 = hostWallNs();
+  for (int i = 0; i < rounds; i++) fn(i);
+  double ns = hostWallNs() - t0;
+  HostHeapStats h1 = hostHeapStats();
+  double msgs = (double)rounds * perRound;
+  return { msgs / (ns / 1e9), (double)(h1.allocs - h0.allocs) / msgs, h1.peak - h0.current };
+}
+
+void report(const char* name, const Result& r) {
+  printf("  %-8s %12.0f msgs/s  %6.2f allocs/msg  peak +%zu B\n", name, r.msgsPerSec, r.allocsPerMsg, r.peakBytes);
+}
+
+// ---- Plain-text commands ("esp schedule.cpp")
+const char* TEXT_MESSAGES[] = { "ON", "\"OFF\"\n", "  schedule ", "RESTART_NOW_PLEASE" };
+const int TEXT_COUNT = sizeof(TEXT_MESSAGES) / sizeof(TEXT_MESSAGES[0]);
+
+// 1 pump on, 2 pump off, 3 refresh, 0 ignored
+int legacyText(const uint8_t* payload, unsigned int length) {
+  String message;
+  for (unsigned int i = 0; i < length; i++) message += (char)payload[i];
+  message.trim();
+  message.replace("\"", "");
+  if (message == "ON") return 1;
+  if (message == "OFF") return 2;
+  if (message == "schedule") return 3;
+  return 0;
+}
+
+int singlePassText(const uint8_t* payload, unsigned int length) {
+  if (mqttTextCommandIs(payload, length, "ON")) return 1;
+  if (mqttTextCommandIs(payload, length, "OFF")) return 2;
+  if (mqttTextCommandIs(payload, length, "schedule")) return 3;
+  return 0;
+}
+
+void benchText() {
+  for (int m = 0; m < TEXT_COUNT; m++) {
+    const uint8_t* p = (const uint8_t*)TEXT_MESSAGES[m];
+    unsigned int n = strlen(TEXT_MESSAGES[m]);
+    HOST_CHECK_EQ(singlePassText(p, n), legacyText(p, n));
+  }
+
+  int sink = 0;
+  auto run = [&](int (*fn)(const uint8_t*, unsigned int)) {
+    return measure(BENCH_ROUNDS, TEXT_COUNT, [&](int) {
+      for (int m = 0; m < TEXT_COUNT; m++) sink += fn((const uint8_t*)TEXT_MESSAGES[m], strlen(TEXT_MESSAGES[m]));
+    });
+  };
+  Result legacy = run(legacyText);
+  Result now = run(singlePassText);
+  hostKeep(sink);
+
+  printf("text commands\n");
+  report("legacy", legacy);
+  report("single", now);
+  HOST_CHECK_EQ(now.allocsPerMsg, 0);
+  HOST_CHECK_EQ(now.peakBytes, 0);
+  HOST_CHECK_GE(now.msgsPerSec, legacy.msgsPerSec);
+}
+
+// ---- Message types (new-csd.cpp)
+void checkClassify() {
+  HOST_CHECK_EQ(classifyMessageType("DEVICE_UPDATE"), MSG_DEVICE_UPDATE);
+  HOST_CHECK_EQ(classifyMessageType("SCHEDULE_CREATED"), MSG_SCHEDULE_CREATED);
+  HOST_CHECK_EQ(classifyMessageType("SCHEDULE_UPDATE"), MSG_SCHEDULE_UPDATE);
+  HOST_CHECK_EQ(classifyMessageType("SCHEDULE_DELETE"), MSG_SCHEDULE_DELETE);
+  HOST_CHECK_EQ(classifyMessageType("SCHEDULE_UPDATED"), MSG_UNKNOWN);
+  HOST_CHECK_EQ(classifyMessageType("DEVICE_UPDATES"), MSG_UNKNOWN);
+  HOST_CHECK_EQ(classifyMessageType("XXXXXX_UPDATE"), MSG_UNKNOWN);
+  HOST_CHECK_EQ(classifyMessageType(""), MSG_UNKNOWN);
+  HOST_CHECK_EQ(classifyMessageType(nullptr), MSG_UNKNOWN);
+}
+
+#ifdef ARDUINOJSON_VERSION
+struct JsonMessage {
+  bool hardwareTopic;   // arrived on <device>/hardware
+  const char* payload;
+};
+
+const JsonMessage JSON_MESSAGES[] = {
+  { false, "{\"type\":\"DEVICE_UPDATE\",\"data\":{\"device_id\":\"v1\",\"status\":\"ON\",\"name\":\"North valve\","
+           "\"org_id\":\"org-1\",\"block_id\":\"b-3\"},\"updated_by\":\"user@org\"}" },
+  { false, "{\"type\":\"DEVICE_UPDATE\",\"data\":{\"device_id\":\"v1\",\"status\":\"OFF\"},\"updated_by\":\"hardware\"}" },
+  { true, "{\"type\":\"SCHEDULE_CREATED\",\"data\":{\"schedule_id\":\"s-19\",\"device_id\":\"v1\",\"start_time\":"
+          "\"06:00\",\"end_time\":\"06:30\",\"days\":[1,2,3,4,5]},\"updated_by\":\"user@org\"}" },
+  { true, "{\"type\":\"DEVICE_UPDATE\",\"data\":{\"device_id\":\"p1\",\"status\":\"CLOSE\"},\"updated_by\":\"hardware\"}" },
+};
+const int JSON_COUNT = sizeof(JSON_MESSAGES) / sizeof(JSON_MESSAGES[0]);
+
+// 1 command for the bus, 2 schedule event, 0 nothing to do
+int legacyJson(bool hardwareTopic, const uint8_t* payload, unsigned int length) {
+  if (hardwareTopic) {
+    String incomingPayload;
+    for (unsigned int i = 0; i < length; i++) incomingPayload += (char)payload[i];
+    return incomingPayload.indexOf("SCHEDULE_CREATED") != -1 ? 2 : 0;
+  }
+  StaticJsonDocument<96> filter;
+  filter["type"] = true;
+  filter["updated_by"] = true;
+  filter["data"]["status"] = true;
+  StaticJsonDocument<256> doc;
+  if (deserializeJson(doc, payload, length, DeserializationOption::Filter(filter))) return 0;
+  if (strcmp(doc["type"] | "", "DEVICE_UPDATE") != 0) return 0;
+  if (strcmp(doc["updated_by"] | "", "hardware") == 0) return 0;
+  return doc["data"]["status"].is<const char*>() ? 1 : 0;
+}
+
+int singlePassJson(bool hardwareTopic, const uint8_t* payload, unsigned int length) {
+  StaticJsonDocument<MQTT_COMMAND_DOC_SIZE> doc;
+  if (deserializeCommand(doc, payload, length)) return 0;
+  switch (classifyMessageType(doc["type"])) {
+    case MSG_DEVICE_UPDATE:
+      if (hardwareTopic || strcmp(doc["updated_by"] | "", "hardware") == 0) return 0;
+      return doc["data"]["status"].is<const char*>() ? 1 : 0;
+    case MSG_SCHEDULE_CREATED:
+    case MSG_SCHEDULE_UPDATE:
+    case MSG_SCHEDULE_DELETE:
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+void benchJson() {
+  for (int m = 0; m < JSON_COUNT; m++) {
+    const JsonMessage& j = JSON_MESSAGES[m];
+    const uint8_t* p = (const uint8_t*)j.payload;
+    unsigned int n = strlen(j.payload);
+    HOST_CHECK_EQ(singlePassJson(j.hardwareTopic, p, n), legacyJson(j.hardwareTopic, p, n));
+  }
+
+  int sink = 0;
+  auto run = [&](int (*fn)(bool, const uint8_t*, unsigned int)) {
+    return measure(BENCH_ROUNDS / 4, JSON_COUNT, [&](int) {
+      for (int m = 0; m < JSON_COUNT; m++) {
+        const JsonMessage& j = JSON_MESSAGES[m];
+        sink += fn(j.hardwareTopic, (const uint8_t*)j.payload, strlen(j.payload));
+      }
+    });
+  };
+  Result legacy = run(legacyJson);
+  Result now = run(singlePassJson);
+  hostKeep(sink);
+
+  printf("json messages\n");
+  report("legacy", legacy);
+  report("single", now);
+  HOST_CHECK_EQ(now.allocsPerMsg, 0);
+  HOST_CHECK_LE(now.peakBytes, legacy.peakBytes);
+}
+#endif
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  benchText();
+  checkClassify();
+#ifdef ARDUINOJSON_VERSION
+  benchJson();
+#else
+  printf("json messages: ArduinoJson not found, skipped\n");
+#endif
+  return hostTestExit();
+}
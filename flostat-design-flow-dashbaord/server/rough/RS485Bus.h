@@ -0,0 +1,322 @@
+// RS485Bus.h
+// Multi-drop RS485 bus manager shared by the gateway sketches. One gateway
+// drives every field controller on the bus. Each address has its own
+// pending pump/valve slot (the newest command wins), its own retry timer and
+// heartbeat state. service(), called from loop(), round-robins over the
+// nodes: pending actuation first, then heartbeats that are due. Any ACK
+// counts as a heartbeat and any unanswered transaction as a miss, so a busy
+// bus still notices a dead controller. One frame is
+// on the bus at a time and each attempt is a small state machine
+// (DE settle -> TX drain -> wait ACK -> backoff) that never blocks.
+//
+//   const uint8_t addrs[] = { 0x01, 0x02 };
+//   RS485Bus bus;
+//   RS485Serial.begin(4800, SERIAL_8N1, RX, TX);
+//   bus.begin(RS485Serial, RS485_DE_RE, 4800, addrs, 2);
+//   bus.onComplete(rs485Complete);     // optional, (addr, cmd, acked)
+//   bus.send(0x02, CMD_VALVE_ON);
+//   loop(): bus.service();
+//
+// Frames are 6 bytes: AA <addr> <cmd> <arg> <xor of the first four> 55.
+// Controllers answer every frame with AA <addr> A1 <ESP-NOW status> <xor> 55.
+// The ACK carries no sequence number, so it is matched by address only: RX
+// is flushed before each attempt, but an ACK to the previous attempt that
+// arrives later than RS485_ACK_TIMEOUT_MS + RS485_RETRY_GAP_MS is taken
+// for the current one.
+//
+// Logs through FastLog: include RS485BusLog.h and hardware/FastLog.h first
+// (see RS485BusLog.h).
+#pragma once
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "RS485BusLog.h"
+
+#ifndef LOGF
+#error "RS485Bus.h logs through FastLog: include hardware/FastLog.h first, with RS485_LOG_MESSAGES in LOG_MESSAGES"
+#endif
+
+#define CMD_PUMP_ON      0x11
+#define CMD_PUMP_OFF     0x12
+#define CMD_VALVE_ON     0x21
+#define CMD_VALVE_OFF    0x22
+#define CMD_ACK          0xA1
+#define CMD_HEARTBEAT    0x99
+#define CMD_DISCONNECTED 0xDD  // ACK status: the controller lost its ESP-NOW peer
+#define CMD_CONNECTED    0xCC
+
+#ifndef RS485_MAX_NODES
+#define RS485_MAX_NODES          32
+#endif
+#define RS485_MAX_ATTEMPTS       3
+#define RS485_FRAME_LEN          6
+#define RS485_GUARD_US           2000    // DE/RE settle time around TX
+#define RS485_ACK_TIMEOUT_MS     500
+#define RS485_RETRY_GAP_MS       300
+#define RS485_RETRY_INTERVAL_MS  10000   // failed command waits this long before the next round
+#define RS485_HEARTBEAT_MS       20000
+#define RS485_OFFLINE_MISSES     3       // unanswered transactions in a row before a node is marked offline
+
+struct RS485Node {
+  uint8_t addr;
+  uint8_t pumpCmd;                 // pending pump command, 0x00 = none
+  uint8_t valveCmd;                // pending valve command, 0x00 = none
+  unsigned long retryAt;           // failed commands are not resent before this millis()
+  unsigned long lastHeartbeatSent;
+  unsigned long lastAckTime;
+  uint8_t missedHeartbeats;        // unanswered transactions in a row, heartbeat or not
+  uint8_t espNowStatus;            // status byte of the last ACK
+  bool online;
+};
+
+// Called from service() when a transaction ends: acked, or given up after
+// RS485_MAX_ATTEMPTS
+typedef void (*RS485CompleteFn)(uint8_t addr, uint8_t cmd, bool acked);
+
+inline void buildRS485Frame(uint8_t* packet, uint8_t addr, uint8_t cmd) {
+  packet[0] = 0xAA;
+  packet[1] = addr;
+  packet[2] = cmd;
+  packet[3] = 0x00;
+  packet[4] = packet[0] ^ packet[1] ^ packet[2] ^ packet[3]; // CRC
+  packet[5] = 0x55;
+}
+
+class RS485Bus {
+ public:
+  uint32_t totalCommands = 0;   // transactions started
+  uint32_t ackSuccess = 0;      // transactions acked
+
+  void begin(HardwareSerial& serial, int dePin, unsigned long baud, const uint8_t* addrs, size_t count) {
+    serial_ = &serial;
+    dePin_ = dePin;
+    frameTimeUs_ = RS485_FRAME_LEN * 10UL * 1000000UL / baud;
+    pinMode(dePin_, OUTPUT);
+    digitalWrite(dePin_, LOW);  // receive by default
+
+    nodeCount_ = 0;
+    for (size_t i = 0; i < count && nodeCount_ < RS485_MAX_NODES; i++) {
+      RS485Node& n = nodes_[nodeCount_++];
+      memset(&n, 0, sizeof(n));
+      n.addr = addrs[i];
+      n.lastHeartbeatSent = millis() - RS485_HEARTBEAT_MS;  // poll everyone once at boot
+    }
+    state_ = IDLE;
+    LOGF(LOG_RS485_BEGIN, nodeCount_);
+  }
+
+  void onComplete(RS485CompleteFn fn) { onComplete_ = fn; }
+
+  int findNode(uint8_t addr) const {
+    for (int i = 0; i < nodeCount_; i++) {
+      if (nodes_[i].addr == addr) return i;
+    }
+    return -1;
+  }
+
+  uint8_t nodeCount() const { return nodeCount_; }
+  const RS485Node& node(int i) const { return nodes_[i]; }
+  bool idle() const { return state_ == IDLE; }
+
+  // Queue a command for one controller; replaces any older pump/valve command
+  bool send(uint8_t addr, uint8_t cmd) {
+    int idx = findNode(addr);
+    if (idx < 0) {
+      LOGF(LOG_RS485_UNKNOWN_ADDR, addr, cmd);
+      return false;
+    }
+    RS485Node& n = nodes_[idx];
+    if (cmd == CMD_PUMP_ON || cmd == CMD_PUMP_OFF) {
+      n.pumpCmd = cmd;
+      n.retryAt = millis();
+    } else if (cmd == CMD_VALVE_ON || cmd == CMD_VALVE_OFF) {
+      n.valveCmd = cmd;
+      n.retryAt = millis();
+    } else if (cmd == CMD_HEARTBEAT) {
+      n.lastHeartbeatSent = millis() - RS485_HEARTBEAT_MS;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  // Call every loop(); never blocks
+  void service() {
+    switch (state_) {
+      case IDLE:
+        if (!pickNext()) return;
+        totalCommands++;
+        startAttempt();
+        break;
+
+      case TX_SETUP:
+        if (micros() - stateStartUs_ < RS485_GUARD_US) return;
+        serial_->write(txFrame_, RS485_FRAME_LEN);  // goes to the UART FIFO, no flush()
+        stateStartUs_ = micros();
+        state_ = TX_DRAIN;
+        break;
+
+      case TX_DRAIN:
+        if (micros() - stateStartUs_ < frameTimeUs_ + RS485_GUARD_US) return;
+        digitalWrite(dePin_, LOW);
+        stateStartMs_ = millis();
+        state_ = WAIT_ACK;
+        break;
+
+      case WAIT_ACK:
+        if (pollAck()) {
+          complete(true);
+        } else if (millis() - stateStartMs_ >= RS485_ACK_TIMEOUT_MS) {
+          if (current_.attempts >= RS485_MAX_ATTEMPTS) {
+            complete(false);
+          } else {
+            LOGF(LOG_RS485_NO_ACK, current_.seq);
+            stateStartMs_ = millis();
+            state_ = BACKOFF;
+          }
+        }
+        break;
+
+      case BACKOFF:
+        if (millis() - stateStartMs_ >= RS485_RETRY_GAP_MS) startAttempt();
+        break;
+    }
+  }
+
+ private:
+  struct Command {
+    uint8_t node;       // index into nodes_
+    uint8_t cmd;
+    uint8_t seq;        // per-transaction number for the logs; not on the wire
+    uint8_t attempts;
+  };
+
+  enum State : uint8_t {
+    IDLE,
+    TX_SETUP,
+    TX_DRAIN,
+    WAIT_ACK,
+    BACKOFF
+  };
+
+  // Pick the next transaction: pending actuation first, then due heartbeats,
+  // starting after the node served last so no address can starve the others
+  bool pickNext() {
+    unsigned long now = millis();
+    for (int pass = 0; pass < 2; pass++) {
+      for (uint8_t k = 1; k <= nodeCount_; k++) {
+        uint8_t i = (roundRobin_ + k) % nodeCount_;
+        RS485Node& n = nodes_[i];
+        uint8_t cmd = 0x00;
+        if (pass == 0 && (n.pumpCmd || n.valveCmd) && (long)(now - n.retryAt) >= 0) {
+          cmd = n.pumpCmd ? n.pumpCmd : n.valveCmd;
+        } else if (pass == 1 && now - n.lastHeartbeatSent >= RS485_HEARTBEAT_MS) {
+          cmd = CMD_HEARTBEAT;
+          n.lastHeartbeatSent = now;
+        }
+        if (cmd) {
+          roundRobin_ = i;
+          current_.node = i;
+          current_.cmd = cmd;
+          current_.seq = nextSeq_++;
+          if (nextSeq_ == 0) nextSeq_ = 1;
+          current_.attempts = 0;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  void startAttempt() {
+    current_.attempts++;
+
+    // Anything still on the line belongs to an earlier frame
+    while (serial_->available()) serial_->read();
+    rxIdx_ = 0;
+
+    buildRS485Frame(txFrame_, nodes_[current_.node].addr, current_.cmd);
+    digitalWrite(dePin_, HIGH);
+    stateStartUs_ = micros();
+    state_ = TX_SETUP;
+
+    LOGF(LOG_RS485_ATTEMPT, current_.seq, current_.attempts, nodes_[current_.node].addr, current_.cmd);
+  }
+
+  void complete(bool acked) {
+    Command done = current_;
+    RS485Node& n = nodes_[done.node];
+    state_ = IDLE;
+
+    if (acked) {
+      ackSuccess++;
+      if (!n.online) LOGF(LOG_RS485_ONLINE, n.addr);
+      n.online = true;
+      n.missedHeartbeats = 0;
+      n.lastAckTime = millis();
+      n.lastHeartbeatSent = n.lastAckTime;  // it just answered, the next heartbeat can wait
+      // Only clear the slot if no newer command replaced it meanwhile
+      if (n.pumpCmd == done.cmd) n.pumpCmd = 0x00;
+      else if (n.valveCmd == done.cmd) n.valveCmd = 0x00;
+    } else {
+      if (++n.missedHeartbeats >= RS485_OFFLINE_MISSES && n.online) {
+        n.online = false;
+        LOGF(LOG_RS485_OFFLINE, n.addr);
+      }
+      if (done.cmd != CMD_HEARTBEAT) {
+        LOGF(LOG_RS485_CMD_FAILED, n.addr, done.cmd, RS485_RETRY_INTERVAL_MS / 1000);
+        n.retryAt = millis() + RS485_RETRY_INTERVAL_MS;
+      }
+    }
+    if (onComplete_) onComplete_(n.addr, done.cmd, acked);
+  }
+
+  // Non-blocking ACK parser, consumes whatever bytes are available
+  bool pollAck() {
+    while (serial_->available()) {
+      uint8_t b = serial_->read();
+      if (rxIdx_ == 0 && b != 0xAA) continue;
+      rxBuf_[rxIdx_++] = b;
+      if (rxIdx_ < RS485_FRAME_LEN) continue;
+      rxIdx_ = 0;
+
+      uint8_t calc_crc = rxBuf_[0] ^ rxBuf_[1] ^ rxBuf_[2] ^ rxBuf_[3];
+      if (rxBuf_[5] != 0x55 || rxBuf_[2] != CMD_ACK || rxBuf_[4] != calc_crc) {
+        LOGF(LOG_RS485_BAD_ACK);
+        continue;
+      }
+      RS485Node& n = nodes_[current_.node];
+      if (rxBuf_[1] != n.addr) {
+        LOGF(LOG_RS485_WRONG_ADDR, rxBuf_[1], n.addr);
+        continue;
+      }
+      n.espNowStatus = rxBuf_[3];
+      LOGF(LOG_RS485_ACK, current_.seq, n.addr,
+           rxBuf_[3] == CMD_CONNECTED ? "CONNECTED" :
+           rxBuf_[3] == CMD_DISCONNECTED ? "DISCONNECTED" : "unknown status");
+      return true;
+    }
+    return false;
+  }
+
+  HardwareSerial* serial_ = nullptr;
+  int dePin_ = -1;
+  unsigned long frameTimeUs_ = 0;
+  RS485CompleteFn onComplete_ = nullptr;
+
+  RS485Node nodes_[RS485_MAX_NODES];
+  uint8_t nodeCount_ = 0;
+  uint8_t roundRobin_ = 0;
+  uint8_t nextSeq_ = 1;
+
+  State state_ = IDLE;
+  Command current_ = {};
+  uint8_t txFrame_[RS485_FRAME_LEN];
+  uint8_t rxBuf_[RS485_FRAME_LEN];
+  uint8_t rxIdx_ = 0;
+  unsigned long stateStartUs_ = 0;
+  unsigned long stateStartMs_ = 0;
+};
@@ -0,0 +1,192 @@
+// RS485BusBench.cpp
+// RS485Bus against the blocking sendRS485Command() it replaced, on a fake
+// 4800 baud UART with simulated field controllers behind it. Reports
+// commands/sec and the worst time one call kept loop() from running, on a
+// healthy bus and with controllers unplugged. Time is the shim's
+// simulated clock, so a call that waits shows up as a stall no matter how
+// fast the host is; wall time per service() is reported alongside.
+#include <Arduino.h>
+
+#include "HostTest.h"
+#include "RS485BusLog.h"
+#define LOG_MESSAGES(X) RS485_LOG_MESSAGES(X)
+#include "FastLog.h"
+#include "RS485Bus.h"
+
+#define BENCH_BAUD          4800
+#define BENCH_DE_PIN        32
+#define BENCH_SECONDS       120
+#define BENCH_LOOP_US       100    // rest of loop() between two service() calls
+#define NODE_TURNAROUND_US  3000   // controller: last byte in -> first ACK byte out
+
+namespace {
+
+// Controllers on the bus; each ACKs frames for its address while online
+class FakeControllers : public HostUartPeer {
+ public:
+  bool online[256];
+  uint32_t frames = 0;
+
+  FakeControllers() {
+    for (bool& o : online) o = true;
+  }
+
+  void onUartByte(HardwareSerial& from, uint8_t b, int64_t atUs) override {
+    if (len_ == 0 && b != 0xAA) return;
+    rx_[len_++] = b;
+    if (len_ < RS485_FRAME_LEN) return;
+    len_ = 0;
+    if (rx_[5] != 0x55 || rx_[4] != (rx_[0] ^ rx_[1] ^ rx_[2] ^ rx_[3])) return;
+    frames++;
+    if (!online[rx_[1]]) return;
+    uint8_t ack[RS485_FRAME_LEN] = { 0xAA, rx_[1], CMD_ACK, CMD_CONNECTED, 0, 0x55 };
+    ack[4] = ack[0] ^ ack[1] ^ ack[2] ^ ack[3];
+    from.hostReceive(ack, sizeof(ack), atUs + NODE_TURNAROUND_US);
+  }
+
+ private:
+  uint8_t rx_[RS485_FRAME_LEN];
+  int len_ = 0;
+};
+
+struct Result {
+  double commandsPerSec;
+  double worstStallMs;    // simulated time inside one call
+  double worstWallUs;     // host time inside one service()
+};
+
+// ---- RS485Bus: every acked actuation is followed by the opposite one, so
+// the bus never runs dry
+RS485Bus* bus;
+uint32_t actuationsAcked;
+
+void requeue(uint8_t addr, uint8_t cmd, bool acked) {
+  if (cmd == CMD_HEARTBEAT || !acked) return;  // the bus retries a failed one itself
+  actuationsAcked++;
+  bus->send(addr, cmd == CMD_VALVE_ON ? CMD_VALVE_OFF : CMD_VALVE_ON);
+}
+
+Result runBus(int nodes, int offlineNodes) {
+  hostClockReset();
+  HardwareSerial uart(1);
+  FakeControllers controllers;
+  uart.begin(BENCH_BAUD);
+  uart.hostAttach(&controllers);
+
+  uint8_t addrs[RS485_MAX_NODES];
+  for (int i = 0; i < nodes; i++) addrs[i] = i + 1;
+  for (int i = 0; i < offlineNodes; i++) controllers.online[addrs[i]] = false;
+
+  RS485Bus b;
+  bus = &b;
+  actuationsAcked = 0;
+  b.begin(uart, BENCH_DE_PIN, BENCH_BAUD, addrs, nodes);
+  b.onComplete(requeue);
+  for (int i = 0; i < nodes; i++) b.send(addrs[i], CMD_VALVE_ON);
+
+  Result r = {};
+  int64_t endUs = (int64_t)BENCH_SECONDS * 1000000;
+  while (hostClockUs() < endUs) {
+    int64_t simBefore = hostClockUs();
+    double wallBefore = hostWallNs();
+    b.service();
+    double wallUs = (hostWallNs() - wallBefore) / 1000;
+    double stallMs = (hostClockUs() - simBefore) / 1000.0;
+    if (stallMs > r.worstStallMs) r.worstStallMs = stallMs;
+    if (wallUs > r.worstWallUs) r.worstWallUs = wallUs;
+    hostClockAdvanceUs(BENCH_LOOP_US);
+  }
+  r.commandsPerSec = (double)actuationsAcked / BENCH_SECONDS;
+  return r;
+}
+
+// ---- The blocking version from before the bus manager, reduced to the bus
+// handling. The device spins on available() while waiting; here each empty
+// poll lets BENCH_LOOP_US pass instead.
+bool legacyWaitForAck(HardwareSerial& uart) {
+  unsigned long start = millis();
+  uint8_t buffer[8];
+  int idx = 0;
+  while (millis() - start < 5000) {
+    if (!uart.available()) {
+      delayMicroseconds(BENCH_LOOP_US);
+      continue;
+    }
+    uint8_t b = uart.read();
+    if (idx == 0 && b != 0xAA) continue;
+    buffer[idx++] = b;
+    if (idx >= 6) {
+      uint8_t calc_crc = buffer[0] ^ buffer[1] ^ buffer[2] ^ buffer[3];
+      if (buffer[5] == 0x55 && buffer[2] == CMD_ACK && buffer[4] == calc_crc) return true;
+      idx = 0;
+    }
+  }
+  return false;
+}
+
+bool legacySend(HardwareSerial& uart, uint8_t addr, uint8_t cmd) {
+  uint8_t packet[6];
+  buildRS485Frame(packet, addr, cmd);
+  for (int attempt = 1; attempt <= 5; attempt++) {
+    digitalWrite(BENCH_DE_PIN, HIGH);
+    delay(2);
+    uart.write(packet, 6);
+    uart.flush();
+    delay(2);
+    digitalWrite(BENCH_DE_PIN, LOW);
+    if (legacyWaitForAck(uart)) return true;
+    delay(300);
+  }
+  return false;
+}
+
+Result runLegacy(int nodes, int offlineNodes) {
+  hostClockReset();
+  HardwareSerial uart(1);
+  FakeControllers controllers;
+  uart.begin(BENCH_BAUD);
+  uart.hostAttach(&controllers);
+  for (int i = 0; i < offlineNodes; i++) controllers.online[i + 1] = false;
+
+  Result r = {};
+  uint32_t acked = 0;
+  bool on = true;
+  int64_t endUs = (int64_t)BENCH_SECONDS * 1000000;
+  for (int i = 0; hostClockUs() < endUs; i = (i + 1) % nodes) {
+    int64_t simBefore = hostClockUs();
+    acked += legacySend(uart, i + 1, on ? CMD_VALVE_ON : CMD_VALVE_OFF);
+    double stallMs = (hostClockUs() - simBefore) / 1000.0;
+    if (stallMs > r.worstStallMs) r.worstStallMs = stallMs;
+    if (i == nodes - 1) on = !on;
+    hostClockAdvanceUs(BENCH_LOOP_US);
+  }
+  r.commandsPerSec = (double)acked / BENCH_SECONDS;
+  return r;
+}
+
+void report(const char* name, int nodes, int offline, const Result& r) {
+  printf("%-8s nodes=%-3d offline=%d  %7.1f cmd/s  worst stall %9.1f ms", name, nodes, offline, r.commandsPerSec,
+         r.worstStallMs);
+  if (r.worstWallUs > 0) printf("  (%.1f us wall)", r.worstWallUs);
+  printf("\n");
+}
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  const int cases[][2] = { { 1, 0 }, { 8, 0 }, { 8, 1 }, { 32, 0 }, { 32, 4 } };
+  for (const auto& c : cases) {
+    Result legacy = runLegacy(c[0], c[1]);
+    Result now = runBus(c[0], c[1]);
+    report("blocking", c[0], c[1], legacy);
+    report("bus", c[0], c[1], now);
+
+    // service() never waits, and a dead controller costs the others at most
+    // its ACK timeouts, not the whole loop
+    HOST_CHECK_EQ(now.worstStallMs, 0);
+    HOST_CHECK_GE(now.commandsPerSec, 0.9 * legacy.commandsPerSec);
+    if (c[1] == 0) HOST_CHECK_GE(now.commandsPerSec, 25);
+  }
+  return hostTestExit();
+}
@@ -0,0 +1,24 @@
+// RS485BusLog.h
+// RS485Bus log messages (see hardware/FastLog.h). RS485Bus.h logs through
+// LOGF, so a sketch lists these in its own table and includes FastLog.h
+// before the bus:
+//
+//   #include "RS485BusLog.h"
+//   #define LOG_MESSAGES(X) RS485_LOG_MESSAGES(X) X(LOG_SETUP_DONE, ...)
+//   #include "hardware/FastLog.h"
+//   #include "RS485Bus.h"
+//
+// Per-attempt and per-ACK lines are debug level.
+#pragma once
+
+#define RS485_LOG_MESSAGES(X)                                                                   \
+  X(LOG_RS485_BEGIN,          LOG_LEVEL_INFO,  "🔌 RS485 bus: %d node(s)")                      \
+  X(LOG_RS485_UNKNOWN_ADDR,   LOG_LEVEL_WARN,  "⚠ RS485 unknown address %02X, dropping cmd %02X") \
+  X(LOG_RS485_ATTEMPT,        LOG_LEVEL_DEBUG, "📤 RS485 #%u attempt %d: node %02X cmd %02X")  \
+  X(LOG_RS485_NO_ACK,         LOG_LEVEL_DEBUG, "⚠ RS485 #%u: no ACK. Retrying...")             \
+  X(LOG_RS485_ACK,            LOG_LEVEL_DEBUG, "✅ ACK #%u from %02X - ESP-NOW: %s")            \
+  X(LOG_RS485_BAD_ACK,        LOG_LEVEL_WARN,  "⚠ Invalid ACK or CRC mismatch")                \
+  X(LOG_RS485_WRONG_ADDR,     LOG_LEVEL_WARN,  "⚠ ACK from %02X while waiting for %02X")       \
+  X(LOG_RS485_ONLINE,         LOG_LEVEL_INFO,  "🟢 RS485 node %02X online")                     \
+  X(LOG_RS485_OFFLINE,        LOG_LEVEL_WARN,  "🔴 RS485 node %02X offline")                    \
+  X(LOG_RS485_CMD_FAILED,     LOG_LEVEL_WARN,  "❌ Node %02X cmd %02X failed, retrying in %lu s")
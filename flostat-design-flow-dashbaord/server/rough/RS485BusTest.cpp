@@ -0,0 +1,225 @@
+// RS485BusTest.cpp
+// Per-address behaviour of RS485Bus on a fake 4800 baud bus: command slots,
+// round-robin, per-node retry, heartbeats and offline detection.
+#include <Arduino.h>
+
+#include <vector>
+
+#include "HostTest.h"
+#include "RS485BusLog.h"
+#define LOG_MESSAGES(X) RS485_LOG_MESSAGES(X)
+#include "FastLog.h"
+#include "RS485Bus.h"
+
+#define TEST_BAUD    4800
+#define TEST_DE_PIN  32
+#define TEST_LOOP_US 100
+
+namespace {
+
+struct Frame {
+  int64_t atUs;
+  uint8_t addr;
+  uint8_t cmd;
+};
+
+// Records every frame on the bus and ACKs those for online addresses
+class Controllers : public HostUartPeer {
+ public:
+  bool online[256];
+  std::vector<Frame> frames;
+
+  Controllers() {
+    for (bool& o : online) o = true;
+  }
+
+  int count(uint8_t addr, uint8_t cmd) const {
+    int n = 0;
+    for (const Frame& f : frames) n += f.addr == addr && f.cmd == cmd;
+    return n;
+  }
+
+  void onUartByte(HardwareSerial& from, uint8_t b, int64_t atUs) override {
+    if (len_ == 0 && b != 0xAA) return;
+    rx_[len_++] = b;
+    if (len_ < RS485_FRAME_LEN) return;
+    len_ = 0;
+    frames.push_back({ atUs, rx_[1], rx_[2] });
+    if (!online[rx_[1]]) return;
+    uint8_t ack[RS485_FRAME_LEN] = { 0xAA, rx_[1], CMD_ACK, CMD_CONNECTED, 0, 0x55 };
+    ack[4] = ack[0] ^ ack[1] ^ ack[2] ^ ack[3];
+    from.hostReceive(ack, sizeof(ack), atUs + 3000);
+  }
+
+ private:
+  uint8_t rx_[RS485_FRAME_LEN];
+  int len_ = 0;
+};
+
+struct Done {
+  uint8_t addr;
+  uint8_t cmd;
+  bool acked;
+};
+
+std::vector<Done> completions;
+RS485Bus* keepBusy = nullptr;   // set: acked actuations are followed by the opposite one
+
+void recordCompletion(uint8_t addr, uint8_t cmd, bool acked) {
+  completions.push_back({ addr, cmd, acked });
+  if (keepBusy && acked && cmd != CMD_HEARTBEAT) {
+    keepBusy->send(addr, cmd == CMD_VALVE_ON ? CMD_VALVE_OFF : CMD_VALVE_ON);
+  }
+}
+
+struct Fixture {
+  HardwareSerial uart{ 1 };
+  Controllers controllers;
+  RS485Bus bus;
+
+  explicit Fixture(int nodes) {
+    hostClockReset();
+    completions.clear();
+    keepBusy = nullptr;
+    uart.begin(TEST_BAUD);
+    uart.hostAttach(&controllers);
+    uint8_t addrs[RS485_MAX_NODES];
+    for (int i = 0; i < nodes; i++) addrs[i] = i + 1;
+    bus.begin(uart, TEST_DE_PIN, TEST_BAUD, addrs, nodes);
+    bus.onComplete(recordCompletion);
+  }
+
+  void runMs(uint32_t ms) {
+    int64_t end = hostClockUs() + (int64_t)ms * 1000;
+    while (hostClockUs() < end) {
+      bus.service();
+      hostClockAdvanceUs(TEST_LOOP_US);
+    }
+  }
+
+  const RS485Node& node(uint8_t addr) { return bus.node(bus.findNode(addr)); }
+};
+
+// Each attempt: guard, frame, guard, then up to the ACK timeout
+const uint32_t ATTEMPT_MS = 2 + 13 + 2 + RS485_ACK_TIMEOUT_MS;
+
+void testNewestCommandWins() {
+  Fixture f(2);
+  f.runMs(200);                           // boot heartbeats
+  f.controllers.frames.clear();
+  HOST_CHECK(f.bus.send(2, CMD_VALVE_ON));
+  HOST_CHECK(f.bus.send(2, CMD_VALVE_OFF));
+  HOST_CHECK(f.bus.send(2, CMD_PUMP_ON));
+  HOST_CHECK(!f.bus.send(9, CMD_VALVE_ON));   // not on the bus
+  HOST_CHECK(!f.bus.send(2, 0x42));           // not a command
+  f.runMs(500);
+  HOST_CHECK_EQ(f.controllers.count(2, CMD_VALVE_ON), 0);
+  HOST_CHECK_EQ(f.controllers.count(2, CMD_VALVE_OFF), 1);
+  HOST_CHECK_EQ(f.controllers.count(2, CMD_PUMP_ON), 1);
+  HOST_CHECK_EQ(f.node(2).pumpCmd, 0);
+  HOST_CHECK_EQ(f.node(2).valveCmd, 0);
+  HOST_CHECK(f.bus.idle());
+}
+
+void testRoundRobin() {
+  Fixture f(32);
+  f.runMs(2000);                          // boot heartbeats for all 32
+  HOST_CHECK_EQ(f.controllers.frames.size(), 32);
+  f.controllers.frames.clear();
+
+  // Everyone has work: each node is served once before any is served twice
+  for (int a = 1; a <= 32; a++) f.bus.send(a, CMD_VALVE_ON);
+  f.bus.send(5, CMD_PUMP_ON);
+  f.runMs(3000);
+  HOST_CHECK_EQ(f.controllers.frames.size(), 33);
+  std::vector<int> seen(33, 0);
+  for (size_t i = 0; i < 32; i++) seen[f.controllers.frames[i].addr]++;
+  for (int a = 1; a <= 32; a++) HOST_CHECK_EQ(seen[a], 1);
+  HOST_CHECK_EQ(f.controllers.frames[32].addr, 5);
+  HOST_CHECK_EQ(f.bus.totalCommands, 32 + 33);
+  HOST_CHECK_EQ(f.bus.ackSuccess, 32 + 33);
+}
+
+void testRetryIsPerNode() {
+  Fixture f(3);
+  f.runMs(200);
+  f.controllers.frames.clear();
+  completions.clear();
+  f.controllers.online[2] = false;
+  for (int a = 1; a <= 3; a++) f.bus.send(a, CMD_VALVE_ON);
+
+  // Node 2 gives up after its attempts; 1 and 3 are served either way
+  f.runMs(RS485_MAX_ATTEMPTS * ATTEMPT_MS + (RS485_MAX_ATTEMPTS - 1) * RS485_RETRY_GAP_MS + 200);
+  HOST_CHECK_EQ(f.controllers.count(1, CMD_VALVE_ON), 1);
+  HOST_CHECK_EQ(f.controllers.count(3, CMD_VALVE_ON), 1);
+  HOST_CHECK_EQ(f.controllers.count(2, CMD_VALVE_ON), RS485_MAX_ATTEMPTS);
+  HOST_CHECK_EQ(completions.size(), 3);
+  for (const Done& d : completions) HOST_CHECK_EQ(d.acked, d.addr != 2);
+  HOST_CHECK_EQ(f.node(2).valveCmd, CMD_VALVE_ON);   // still pending
+
+  // Node 2 waits out its retry interval while the others keep working
+  f.bus.send(1, CMD_VALVE_OFF);
+  f.runMs(RS485_RETRY_INTERVAL_MS - 2000);
+  HOST_CHECK_EQ(f.controllers.count(2, CMD_VALVE_ON), RS485_MAX_ATTEMPTS);
+  HOST_CHECK_EQ(f.controllers.count(1, CMD_VALVE_OFF), 1);
+
+  f.controllers.online[2] = true;
+  f.runMs(3000);
+  HOST_CHECK_EQ(f.controllers.count(2, CMD_VALVE_ON), RS485_MAX_ATTEMPTS + 1);
+  HOST_CHECK_EQ(f.node(2).valveCmd, 0);
+  HOST_CHECK(completions.back().acked && completions.back().addr == 2);
+}
+
+void testHeartbeatsAndOffline() {
+  Fixture f(2);
+  f.runMs(RS485_HEARTBEAT_MS * 3 + 1000);   // at boot, then every interval
+  HOST_CHECK_EQ(f.controllers.count(1, CMD_HEARTBEAT), 4);
+  HOST_CHECK_EQ(f.controllers.count(2, CMD_HEARTBEAT), 4);
+  HOST_CHECK(f.node(1).online && f.node(2).online);
+
+  // Each miss takes RS485_MAX_ATTEMPTS attempts to call
+  f.controllers.online[2] = false;
+  f.runMs(RS485_HEARTBEAT_MS * (RS485_OFFLINE_MISSES - 1) + 3000);
+  HOST_CHECK_EQ(f.node(2).missedHeartbeats, RS485_OFFLINE_MISSES - 1);
+  HOST_CHECK(f.node(2).online);
+  f.runMs(RS485_HEARTBEAT_MS);
+  HOST_CHECK(!f.node(2).online);
+  HOST_CHECK_EQ(f.node(2).missedHeartbeats, RS485_OFFLINE_MISSES);
+  HOST_CHECK(f.node(1).online);
+
+  f.controllers.online[2] = true;
+  f.runMs(RS485_HEARTBEAT_MS);
+  HOST_CHECK(f.node(2).online);
+  HOST_CHECK_EQ(f.node(2).missedHeartbeats, 0);
+}
+
+// A bus busy with actuation sends no heartbeats, yet a dead node still goes
+// offline from its unanswered commands
+void testOfflineUnderLoad() {
+  Fixture f(2);
+  f.runMs(200);
+  keepBusy = &f.bus;
+  f.bus.send(1, CMD_VALVE_ON);
+  f.runMs(RS485_HEARTBEAT_MS * 2);
+  HOST_CHECK_EQ(f.controllers.count(1, CMD_HEARTBEAT), 1);  // the boot one: ACKs count instead
+  HOST_CHECK(f.node(1).online);
+
+  f.controllers.online[2] = false;
+  f.bus.send(2, CMD_PUMP_ON);
+  f.runMs(RS485_RETRY_INTERVAL_MS * RS485_OFFLINE_MISSES + 5000);
+  HOST_CHECK(!f.node(2).online);
+  HOST_CHECK(f.node(1).online);
+  HOST_CHECK_GE(f.controllers.count(1, CMD_VALVE_ON) + f.controllers.count(1, CMD_VALVE_OFF), 1000);
+}
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  testNewestCommandWins();
+  testRoundRobin();
+  testRetryIsPerNode();
+  testHeartbeatsAndOffline();
+  testOfflineUnderLoad();
+  return hostTestExit();
+}
@@ -0,0 +1,127 @@
+// TelemetryTraceSim.cpp
+// TelemetryGate (DeviceTelemetry.h) replayed over 24 h synthetic tank
+// traces at the sketch's 1 s sample rate, against the fixed 30 s publisher
+// it replaced (2880 messages a day). Reports messages/day, the largest
+// difference between the level the dashboard last got and the real one,
+// and the longest silence. Traces are seeded, so every run sees the same
+// samples.
+#include <Arduino.h>
+
+#include <cmath>
+#include <random>
+
+#include "DeviceTelemetry.h"
+#include "HostTest.h"
+
+#define SIM_SECONDS      86400
+#define FIXED_PERIOD_S   30
+#define SENSOR_JITTER    1       // +- percent points of noise on each sample
+
+namespace {
+
+const TelemetryPolicy POLICY = { 2, 5, 5000, 300000 };   // as schedule.cpp boots
+
+// Level in percent at second s, before sensor noise
+typedef double (*TraceFn)(int s);
+
+double idleTrace(int) { return 63; }
+
+// Two slow drains a day (0.5 %/min), each followed by a refill at 2 %/min
+double drainRefillTrace(int s) {
+  int t = s % (SIM_SECONDS / 2);
+  const int drain = 140 * 60, refill = 35 * 60;
+  if (t < drain) return 90 - 70.0 * t / drain;
+  if (t < drain + refill) return 20 + 70.0 * (t - drain) / refill;
+  return 90;
+}
+
+// Every hour the pump fills at 6 %/min for 5 min, then the tank drains
+double hourlyPumpTrace(int s) {
+  int t = s % 3600;
+  if (t < 300) return 40 + 30.0 * t / 300;
+  return 70 - 30.0 * (t - 300) / 3300;
+}
+
+struct Result {
+  int messages;
+  int worstErr;         // |dashboard level - true level|, percent points
+  int worstSilenceS;    // longest time between two messages
+};
+
+// failEvery > 0 drops every failEvery-th publish, as a broker hiccup would
+Result runGate(TraceFn trace, uint32_t seed, int failEvery) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> noise(-SENSOR_JITTER, SENSOR_JITTER);
+  TelemetryGate gate(POLICY);
+  Result r = {};
+  int shown = -1, lastMsgS = 0, attempts = 0;
+  for (int s = 0; s < SIM_SECONDS; s++) {
+    int truth = (int)lround(trace(s));
+    int level = std::max(0, std::min(100, truth + noise(rng)));
+    uint32_t now = (uint32_t)s * 1000;
+    if (gate.shouldPublish(level, now)) {
+      bool sent = failEvery == 0 || ++attempts % failEvery != 0;
+      if (sent) {
+        gate.published(level, now);
+        r.worstSilenceS = std::max(r.worstSilenceS, s - lastMsgS);
+        lastMsgS = s;
+        shown = level;
+        r.messages++;
+      }
+    }
+    if (shown >= 0) r.worstErr = std::max(r.worstErr, std::abs(shown - truth));
+  }
+  r.worstSilenceS = std::max(r.worstSilenceS, SIM_SECONDS - lastMsgS);
+  return r;
+}
+
+Result runFixed(TraceFn trace, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> noise(-SENSOR_JITTER, SENSOR_JITTER);
+  Result r = {};
+  int shown = -1;
+  for (int s = 0; s < SIM_SECONDS; s++) {
+    int truth = (int)lround(trace(s));
+    int level = std::max(0, std::min(100, truth + noise(rng)));
+    if (s % FIXED_PERIOD_S == 0) {
+      shown = level;
+      r.messages++;
+    }
+    r.worstErr = std::max(r.worstErr, std::abs(shown - truth));
+  }
+  r.worstSilenceS = FIXED_PERIOD_S;
+  return r;
+}
+
+void report(const char* name, const Result& r, int baseline) {
+  printf("  %-10s %5d msgs/day (%+4.0f%%)  worst error %2d %%  longest silence %4d s\n", name, r.messages,
+         100.0 * (r.messages - baseline) / baseline, r.worstErr, r.worstSilenceS);
+}
+
+void run(const char* name, TraceFn trace, uint32_t seed, int maxMessages) {
+  Result fixed = runFixed(trace, seed);
+  Result gated = runGate(trace, seed, 0);
+  Result lossy = runGate(trace, seed, 10);
+  printf("%s\n", name);
+  report("fixed 30s", fixed, fixed.messages);
+  report("gate", gated, fixed.messages);
+  report("gate 10%", lossy, fixed.messages);
+
+  HOST_CHECK_LE(gated.messages, maxMessages);
+  // Within the deadband plus one sample of jitter, however fast it moves
+  HOST_CHECK_LE(gated.worstErr, POLICY.deadband + 2 * SENSOR_JITTER);
+  // The heartbeat holds, and a dropped publish only delays it by a sample
+  HOST_CHECK_LE(gated.worstSilenceS, (int)(POLICY.max_interval_ms / 1000));
+  HOST_CHECK_LE(lossy.worstSilenceS, (int)(POLICY.max_interval_ms / 1000) + 1);
+  HOST_CHECK_LE(lossy.worstErr, POLICY.deadband + 2 * SENSOR_JITTER);
+}
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  run("idle tank", idleTrace, 18, 300);
+  run("drain/refill twice a day", drainRefillTrace, 18, 450);
+  run("hourly 6 %/min pump", hourlyPumpTrace, 18, 1700);   // every 5 s while filling
+  return hostTestExit();
+}
@@ -0,0 +1,158 @@
+// TopicRouter.h
+// Routes command topics  <prefix><block>/<type>/<id>[/<suffix>]  to the
+// index of a device in the caller's table, e.g. with the prefix
+// "flostat/<org>/command/" for a gateway subscribed to ".../command/+/+/+".
+//
+// build() compiles the table once into a flat trie (block -> type -> id).
+// Children of a node are stored contiguously and sorted, so route() is one
+// binary search per level over the topic bytes in place: no heap, no String,
+// O(log n) per level however many devices the gateway serves.
+//
+//   const char* deviceKey(size_t i, int level);   // block, type or id of device i
+//   TopicRouter<32> router;
+//   router.build("flostat/<org>/command/", count, deviceKey);
+//   const char* suffix;
+//   int dev = router.route(topic, &suffix);   // -1 if not ours; suffix is
+//                                             // "" or e.g. "hardware"
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TOPIC_ROUTER_LEVELS 3   // block, device type, device id
+
+template <size_t MaxDevices>
+class TopicRouter {
+  static_assert(MaxDevices > 0 && MaxDevices < 0x7FFF, "TopicRouter size out of range");
+
+ public:
+  typedef const char* (*KeyFn)(size_t device, int level);
+
+  // key(i, level) gives device i's block (0), type (1) and id (2). The strings
+  // must outlive the router (literals, a const table). False if there are
+  // too many devices or one is listed twice. Scratch space is on the stack,
+  // about 14 bytes per device: call it from setup(), not a small task.
+  bool build(const char* prefix, size_t count, KeyFn key) {
+    nodeCount_ = 0;
+    prefix_ = prefix;
+    prefixLen_ = strlen(prefix);
+    if (count > MaxDevices) return false;
+
+    uint16_t order[MaxDevices];
+    for (size_t i = 0; i < count; i++) {
+      // insertion sort by (block, type, id); runs once at startup
+      size_t j = i;
+      while (j > 0 && compareDevices(key, order[j - 1], i) > 0) {
+        order[j] = order[j - 1];
+        j--;
+      }
+      order[j] = i;
+    }
+    for (size_t i = 1; i < count; i++) {
+      if (compareDevices(key, order[i - 1], order[i]) == 0) return false;
+    }
+
+    // Level by level: a node covers the sorted range [lo, hi) of devices
+    // that share its path, and its children are the distinct next segments
+    // in that range, appended together so they stay contiguous and sorted.
+    uint16_t lo[kMaxNodes], hi[kMaxNodes];
+    Node& root = nodes_[nodeCount_++];
+    root = Node();
+    lo[0] = 0;
+    hi[0] = count;
+    size_t levelStart = 0, levelEnd = 1;
+    for (int level = 0; level < TOPIC_ROUTER_LEVELS; level++) {
+      for (size_t n = levelStart; n < levelEnd; n++) {
+        nodes_[n].first = nodeCount_;
+        for (uint16_t i = lo[n]; i < hi[n]; i++) {
+          const char* seg = key(order[i], level);
+          if (i > lo[n] && strcmp(seg, key(order[i - 1], level)) == 0) {
+            hi[nodeCount_ - 1] = i + 1;
+            continue;
+          }
+          Node& c = nodes_[nodeCount_];
+          c = Node();
+          c.seg = seg;
+          c.len = strlen(seg);
+          c.device = level == TOPIC_ROUTER_LEVELS - 1 ? order[i] : -1;
+          lo[nodeCount_] = i;
+          hi[nodeCount_] = i + 1;
+          nodeCount_++;
+        }
+        nodes_[n].count = nodeCount_ - nodes_[n].first;
+      }
+      levelStart = levelEnd;
+      levelEnd = nodeCount_;
+    }
+    return true;
+  }
+
+  // Device index for the topic, -1 if it is not one of ours. On a match
+  // *suffix (optional) points at what follows the device id, without the '/'.
+  int route(const char* topic, const char** suffix) const {
+    if (nodeCount_ == 0 || strncmp(topic, prefix_, prefixLen_) != 0) return -1;
+    const char* p = topic + prefixLen_;
+    const Node* node = &nodes_[0];
+    for (int level = 0; level < TOPIC_ROUTER_LEVELS; level++) {
+      const char* end = strchr(p, '/');
+      size_t len = end ? end - p : strlen(p);
+      node = findChild(*node, p, len);
+      if (!node) return -1;
+      p += len;
+      if (level < TOPIC_ROUTER_LEVELS - 1) {
+        if (*p != '/') return -1;
+        p++;
+      }
+    }
+    if (*p == '/') p++;
+    else if (*p != '\0') return -1;
+    if (suffix) *suffix = p;
+    return node->device;
+  }
+
+  size_t nodeCount() const { return nodeCount_; }
+
+ private:
+  static const size_t kMaxNodes = 1 + TOPIC_ROUTER_LEVELS * MaxDevices;
+
+  struct Node {
+    const char* seg = nullptr;
+    uint16_t len = 0;
+    uint16_t first = 0;      // index of the first child
+    uint16_t count = 0;      // number of children
+    int16_t device = -1;     // leaf only
+  };
+
+  static int compareDevices(KeyFn key, size_t a, size_t b) {
+    for (int level = 0; level < TOPIC_ROUTER_LEVELS; level++) {
+      int c = strcmp(key(a, level), key(b, level));
+      if (c) return c;
+    }
+    return 0;
+  }
+
+  // Same order as strcmp, on a segment that is not NUL terminated
+  static int compareSegment(const Node& n, const char* s, size_t len) {
+    int c = memcmp(n.seg, s, n.len < len ? n.len : len);
+    if (c) return c;
+    return n.len < len ? -1 : n.len > len ? 1 : 0;
+  }
+
+  const Node* findChild(const Node& parent, const char* s, size_t len) const {
+    size_t a = parent.first, b = parent.first + parent.count;
+    while (a < b) {
+      size_t mid = (a + b) / 2;
+      int c = compareSegment(nodes_[mid], s, len);
+      if (c == 0) return &nodes_[mid];
+      if (c < 0) a = mid + 1;
+      else b = mid;
+    }
+    return nullptr;
+  }
+
+  Node nodes_[kMaxNodes];
+  size_t nodeCount_ = 0;
+  const char* prefix_ = "";
+  size_t prefixLen_ = 0;
+};
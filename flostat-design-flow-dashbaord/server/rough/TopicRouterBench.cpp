@@ -0,0 +1,197 @@
+// TopicRouterBench.cpp
+// TopicRouter (TopicRouter.h) against the linear scans it replaced, for a
+// gateway serving 1, 32 and 256 devices. Reports routes/sec and allocations
+// per route:
+//   string  the old callback's way: String(topic), then == against each
+//           device's full topic and its /hardware topic
+//   strcmp  the same scan without the String copy
+//   trie    TopicRouter::route() on the topic bytes
+// Device ids are random UUIDs over 8 blocks and both device types; half the
+// lookups carry the /hardware suffix. Every device must route to its own
+// index with the right suffix, and topics that are not ours must not route.
+#include <Arduino.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HostHeap.h"
+#include "HostTest.h"
+#include "TopicRouter.h"
+
+#define BENCH_MAX_DEVICES 256   // GATEWAY_MAX_DEVICES in new-csd.cpp
+#define BENCH_LOOKUPS     500000
+#define BENCH_BLOCKS      8
+
+namespace {
+
+const char* PREFIX = "flostat/b595d605-fe74-416c-88c0-0e88ed280e56/command/";
+const char* TYPES[] = { "pump", "valve" };
+
+struct Device {
+  std::string block, type, id;
+  std::string topic, hardwareTopic;   // for the scans
+};
+
+std::vector<Device> devices;
+
+const char* deviceKey(size_t i, int level) {
+  const Device& d = devices[i];
+  return level == 0 ? d.block.c_str() : level == 1 ? d.type.c_str() : d.id.c_str();
+}
+
+std::string uuid(std::mt19937& rng) {
+  char buf[37];
+  snprintf(buf, sizeof(buf), "%08x-%04x-%04x-%04x-%04x%08x", (unsigned)rng(), (unsigned)(rng() & 0xFFFF),
+           (unsigned)(rng() & 0xFFFF), (unsigned)(rng() & 0xFFFF), (unsigned)(rng() & 0xFFFF), (unsigned)rng());
+  return buf;
+}
+
+void makeDevices(size_t count, std::mt19937& rng) {
+  std::string blocks[BENCH_BLOCKS];
+  for (std::string& b : blocks) b = uuid(rng);
+  devices.clear();
+  for (size_t i = 0; i < count; i++) {
+    Device d;
+    d.block = blocks[rng() % BENCH_BLOCKS];
+    d.type = TYPES[rng() % 2];
+    d.id = uuid(rng);
+    d.topic = PREFIX + d.block + "/" + d.type + "/" + d.id;
+    d.hardwareTopic = d.topic + "/hardware";
+    devices.push_back(d);
+  }
+}
+
+// ---- The scans: device index, *suffix "" or "hardware"
+int routeString(const char* topic, const char** suffix) {
+  String topicStr = topic;
+  for (size_t i = 0; i < devices.size(); i++) {
+    if (topicStr == devices[i].topic.c_str()) {
+      *suffix = "";
+      return i;
+    }
+    if (topicStr == devices[i].hardwareTopic.c_str()) {
+      *suffix = "hardware";
+      return i;
+    }
+  }
+  return -1;
+}
+
+int routeStrcmp(const char* topic, const char** suffix) {
+  for (size_t i = 0; i < devices.size(); i++) {
+    if (strcmp(topic, devices[i].topic.c_str()) == 0) {
+      *suffix = "";
+      return i;
+    }
+    if (strcmp(topic, devices[i].hardwareTopic.c_str()) == 0) {
+      *suffix = "hardware";
+      return i;
+    }
+  }
+  return -1;
+}
+
+TopicRouter<BENCH_MAX_DEVICES> router;
+
+int routeTrie(const char* topic, const char** suffix) { return router.route(topic, suffix); }
+
+struct Result {
+  double routesPerSec;
+  double allocsPerRoute;
+};
+
+Result measure(int (*route)(const char*, const char**), const std::vector<const char*>& topics) {
+  HostHeapStats h0 = hostHeapStats();
+  int sink = 0;
+  double t0 = hostWallNs();
+  for (int i = 0; i < BENCH_LOOKUPS; i++) {
+    const char* suffix = nullptr;
+    sink += route(topics[i % topics.size()], &suffix);
+  }
+  double ns = hostWallNs() - t0;
+  HostHeapStats h1 = hostHeapStats();
+  hostKeep(sink);
+  return { BENCH_LOOKUPS / (ns / 1e9), (double)(h1.allocs - h0.allocs) / BENCH_LOOKUPS };
+}
+
+void report(const char* name, const Result& r) {
+  printf("    %-7s %12.0f routes/s  %7.1f ns  %5.2f allocs/route\n", name, r.routesPerSec, 1e9 / r.routesPerSec,
+         r.allocsPerRoute);
+}
+
+void checkRoutes() {
+  for (size_t i = 0; i < devices.size(); i++) {
+    const char* suffix = nullptr;
+    HOST_CHECK_EQ(router.route(devices[i].topic.c_str(), &suffix), (int)i);
+    HOST_CHECK(strcmp(suffix, "") == 0);
+    HOST_CHECK_EQ(router.route(devices[i].hardwareTopic.c_str(), &suffix), (int)i);
+    HOST_CHECK(strcmp(suffix, "hardware") == 0);
+  }
+
+  const Device& d = devices.back();
+  std::string otherId = d.id;
+  otherId.back() = otherId.back() == '0' ? '1' : '0';
+  const std::string notOurs[] = {
+    PREFIX + d.block + "/" + d.type + "/" + otherId,                    // unknown id
+    PREFIX + d.block + "/" + d.type + "/" + d.id.substr(0, 20),         // truncated id
+    PREFIX + d.block + "/" + d.type,                                     // no id
+    PREFIX + d.block + "/" + d.type + "/",
+    PREFIX + d.block + "/tank/" + d.id,                                  // unknown type
+    PREFIX + d.block + "/" + d.type + "/" + d.id + "x",                 // id with trailing bytes
+    "flostat/other-org/command/" + d.block + "/" + d.type + "/" + d.id,
+    PREFIX,
+    "",
+  };
+  for (const std::string& t : notOurs) HOST_CHECK_EQ(router.route(t.c_str(), nullptr), -1);
+}
+
+void checkBuild() {
+  // One device listed twice, and one more than fits
+  devices.resize(2);
+  devices[1] = devices[0];
+  HOST_CHECK(!router.build(PREFIX, devices.size(), deviceKey));
+
+  static TopicRouter<1> tiny;
+  HOST_CHECK(!tiny.build(PREFIX, 2, deviceKey));
+  HOST_CHECK(tiny.build(PREFIX, 1, deviceKey));
+  HOST_CHECK_EQ(tiny.route(devices[0].topic.c_str(), nullptr), 0);
+}
+
+void bench(size_t count, std::mt19937& rng) {
+  makeDevices(count, rng);
+  HOST_CHECK(router.build(PREFIX, devices.size(), deviceKey));
+  checkRoutes();
+
+  // Lookups in random order, half of them on /hardware
+  std::vector<const char*> topics;
+  for (int i = 0; i < 4096; i++) {
+    const Device& d = devices[rng() % devices.size()];
+    topics.push_back(rng() % 2 ? d.topic.c_str() : d.hardwareTopic.c_str());
+  }
+  Result string = measure(routeString, topics);
+  Result scan = measure(routeStrcmp, topics);
+  Result trie = measure(routeTrie, topics);
+
+  printf("  %zu device(s), %zu trie nodes\n", count, router.nodeCount());
+  report("string", string);
+  report("strcmp", scan);
+  report("trie", trie);
+
+  HOST_CHECK_EQ(trie.allocsPerRoute, 0);
+  HOST_CHECK_GE(string.allocsPerRoute, 1);
+  if (count >= 32) HOST_CHECK_GE(trie.routesPerSec, scan.routesPerSec);
+}
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  std::mt19937 rng(23);
+  printf("%d lookups per table, half with a /hardware suffix\n", BENCH_LOOKUPS);
+  bench(1, rng);
+  bench(32, rng);
+  bench(256, rng);
+  checkBuild();
+  return hostTestExit();
+}
@@ -13,6 +13,70 @@
 #include <vector>
 #include <HardwareSerial.h>
 #include <esp_task_wdt.h>
+#include "MqttDispatch.h"
+#include "RS485BusLog.h"
+
+// Log level for this build: LOG_LEVEL_DEBUG on the bench, LOG_LEVEL_WARN in
+// the field. Anything above it is compiled out.
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+// Log messages: id, level, format. Arguments are 32-bit words, see
+// hardware/FastLog.h.
+#define LOG_MESSAGES(X) \
+  RS485_LOG_MESSAGES(X) \
+  X(LOG_FETCH_STATE_FAILED,      LOG_LEVEL_WARN,  "❌ Failed to fetch state, HTTP code: %d") \
+  X(LOG_FETCH_STATE_DONE,        LOG_LEVEL_DEBUG, "✅ State response: %u bytes") \
+  X(LOG_FETCH_STATE_PARSE_FAILED, LOG_LEVEL_WARN, "❌ JSON Parse error: %s") \
+  X(LOG_MQTT_MESSAGE,            LOG_LEVEL_DEBUG, "📩 MQTT message: %u bytes") \
+  X(LOG_MQTT_PUMP,               LOG_LEVEL_INFO,  "✅ Pump triggered %s via MQTT") \
+  X(LOG_MQTT_SCHEDULE_REFRESH,   LOG_LEVEL_INFO,  "🔄 Refreshing schedules from MQTT command...") \
+  X(LOG_MQTT_IGNORED,            LOG_LEVEL_DEBUG, "❌ Unknown or ignored MQTT command.") \
+  X(LOG_MQTT_CONNECTING,         LOG_LEVEL_INFO,  "🔌 Attempting MQTT connection...") \
+  X(LOG_MQTT_CONNECTED,          LOG_LEVEL_INFO,  "✅ MQTT connected, subscribed to topics") \
+  X(LOG_MQTT_CONNECT_FAILED,     LOG_LEVEL_WARN,  "❌ MQTT connect failed, rc=%d") \
+  X(LOG_MQTT_REBOOT,             LOG_LEVEL_ERROR, "🚨 Too many MQTT failures. Rebooting...") \
+  X(LOG_WIFI_CONNECTING,         LOG_LEVEL_INFO,  "Connecting to WiFi %s") \
+  X(LOG_WIFI_WAITING,            LOG_LEVEL_DEBUG, "Connecting to WiFi...") \
+  X(LOG_WIFI_RESTART,            LOG_LEVEL_ERROR, "Restarting....") \
+  X(LOG_WIFI_CONNECTED,          LOG_LEVEL_INFO,  "WiFi connected! IP address: %u.%u.%u.%u") \
+  X(LOG_TIME_RESYNC_START,       LOG_LEVEL_INFO,  "🔄 Initiating periodic time re-sync...") \
+  X(LOG_TIME_RESYNC_DONE,        LOG_LEVEL_INFO,  "✅ Time re-synced: %02d:%02d") \
+  X(LOG_TIME_RESYNC_TIMEOUT,     LOG_LEVEL_WARN,  "❌ Time re-sync timed out.") \
+  X(LOG_TIME_SYNCING,            LOG_LEVEL_INFO,  "⏱ Syncing time") \
+  X(LOG_TIME_SYNC_FAILED,        LOG_LEVEL_ERROR, "❌ Failed to sync time") \
+  X(LOG_TIME_SYNCED,             LOG_LEVEL_INFO,  "✅ Time synchronized: %02d:%02d") \
+  X(LOG_CLOUD_QUEUE_FULL,        LOG_LEVEL_WARN,  "⚠ Cloud log queue full, dropped [%s → %s]") \
+  X(LOG_CLOUD_NO_WIFI,           LOG_LEVEL_WARN,  "❌ WiFi not connected! Buffering log.") \
+  X(LOG_CLOUD_POST,              LOG_LEVEL_DEBUG, "🌐 Logging %s state %d to the cloud") \
+  X(LOG_CLOUD_ATTEMPT,           LOG_LEVEL_DEBUG, "📡 Attempt %d...") \
+  X(LOG_CLOUD_DONE,              LOG_LEVEL_INFO,  "✅ Log success in %lu ms (HTTP 200)") \
+  X(LOG_CLOUD_HTTP_FAILED,       LOG_LEVEL_WARN,  "⚠  Attempt %d: HTTP %d") \
+  X(LOG_CLOUD_FAILED,            LOG_LEVEL_WARN,  "🛑 All attempts failed. Buffering log.") \
+  X(LOG_BUFFER_FULL,             LOG_LEVEL_WARN,  "⚠ Log buffer full. Discarding oldest entry.") \
+  X(LOG_BUFFER_APPENDED,         LOG_LEVEL_INFO,  "📦 Buffered log [%s → %s]. Total buffered: %u") \
+  X(LOG_BUFFER_EMPTY,            LOG_LEVEL_DEBUG, "🧺 No offline logs to flush.") \
+  X(LOG_BUFFER_FLUSHING,         LOG_LEVEL_INFO,  "🧹 Flushing %u buffered log(s) (no cloud send)...") \
+  X(LOG_BUFFER_DISCARDED,        LOG_LEVEL_DEBUG, "🗑 Discarding buffered log: [%s → %s]") \
+  X(LOG_BUFFER_CLEARED,          LOG_LEVEL_INFO,  "✅ All buffered logs cleared.") \
+  X(LOG_DIAG_UPTIME,             LOG_LEVEL_INFO,  "🔧 Uptime %lu s | MQTT reconnects: %d | last MQTT msg %lu s ago") \
+  X(LOG_DIAG_RS485,              LOG_LEVEL_INFO,  "📨 RS485 cmds sent: %lu | ACKs received: %lu") \
+  X(LOG_DIAG_NODE,               LOG_LEVEL_INFO,  "   node %02X: %s | last ACK %lus ago | pending P:V %04lX") \
+  X(LOG_DIAG_STATE,              LOG_LEVEL_INFO,  "🚰 Pump: %s | 🚿 Valve: %s") \
+  X(LOG_DIAG_HEAP,               LOG_LEVEL_INFO,  "💡 Heap: %d bytes | MQTT: %s | MQTT State: %d | WiFi RSSI: %d dBm") \
+  X(LOG_DIAG_TEMPERATURE,        LOG_LEVEL_INFO,  "🌡  Chip temperature: %d °C") \
+  X(LOG_SETUP_FETCH,             LOG_LEVEL_INFO,  "🔄 Fetching initial states...") \
+  X(LOG_SETUP_PUMP_RESPONSE,     LOG_LEVEL_DEBUG, "✅ Pump response: %u bytes") \
+  X(LOG_SETUP_PUMP_STATE,        LOG_LEVEL_INFO,  "✅ Parsed pump state: %s") \
+  X(LOG_SETUP_PUMP_SENT,         LOG_LEVEL_INFO,  "✅ Initial pump state update sent") \
+  X(LOG_SETUP_PUMP_SEND_FAILED,  LOG_LEVEL_ERROR, "❌ Failed to send initial pump state, restarting ESP... Code: %d") \
+  X(LOG_SETUP_PUMP_PARSE_FAILED, LOG_LEVEL_WARN,  "❌ Pump JSON parse error: %s") \
+  X(LOG_SETUP_PUMP_FETCH_FAILED, LOG_LEVEL_ERROR, "❌ Failed to fetch pump state, HTTP code: %d") \
+  X(LOG_SETUP_DONE,              LOG_LEVEL_INFO,  "✅ Setup complete.") \
+  X(LOG_WIFI_LOST,               LOG_LEVEL_WARN,  "🔄 WiFi lost. Reconnecting...") \
+  X(LOG_LOW_HEAP,                LOG_LEVEL_ERROR, "⚠ Low heap! Restarting...") \
+  X(LOG_DAILY_RESTART,           LOG_LEVEL_INFO,  "🔁 24h reached. Restarting...")
+#include "hardware/FastLog.h"
+#include "RS485Bus.h"
 
 // =============================================================================
 //  CONFIGURATION
@@ -24,18 +88,9 @@
 #define RS485_BAUDRATE 4800
 HardwareSerial RS485Serial(1);
 
-#define CMD_PUMP_ON   0x11
-#define CMD_PUMP_OFF  0x12
-#define CMD_VALVE_ON  0x21
-#define CMD_VALVE_OFF 0x22
-#define CMD_ACK       0xA1
-#define DEVICE_ADDR   0x01
-#define CMD_HEARTBEAT 0x99
-#define CMD_DISCONNECTED 0xDD  // Custom RS485 code for ESP-NOW disconnection
-#define CMD_CONNECTED 0xCC
+#define DEVICE_ADDR   0x01   // RS485 protocol bytes are in RS485Bus.h
 
 #define WDT_TIMEOUT      30      // Watchdog timeout in seconds
-#define DEBUG_MODE       true    // Set to false to disable logs
 
 #define MAX_RETRIES 30
 #define MAX_SCHEDULES 60
@@ -149,6 +204,11 @@ WKDedM4VfMBMgcBa4+1oAvw1tJna+Txl6KlqS/QV5t7kfExBBSRBQVfxl67suJX6
 WiFiClientSecure secureClient;
 PubSubClient mqttClient(secureClient);
 
+// Field controllers on the RS485 bus, driven by rs485Bus.service() (RS485Bus.h)
+const uint8_t rs485NodeAddrs[] = { DEVICE_ADDR };
+#define RS485_NODE_COUNT (sizeof(rs485NodeAddrs) / sizeof(rs485NodeAddrs[0]))
+RS485Bus rs485Bus;
+
 int VALVE_ID = 1;
 int PUMP_ID = 1;
 
@@ -166,24 +226,25 @@ struct LogEntry {
   bool state;
 };
 
-std::vector<LogEntry> offlineLogBuffer;
+std::vector<LogEntry> offlineLogBuffer;   // only touched by cloudLogTask
+
+// Cloud log worker: state changes are queued and posted by a background task
+#define CLOUD_LOG_QUEUE_LEN  16
+
+struct CloudLogReport {
+  char machine[8];   // "pump" / "valve"
+  bool state;
+};
+
+QueueHandle_t cloudLogQueue;
 
 std::vector<Schedule> valveSchedules;
 std::vector<Schedule> pumpSchedules;
 
 int wifi_retries = 30;
 
-int rs485_totalCommands = 0;
-int rs485_ackSuccess    = 0;
 int mqtt_reconnects     = 0;
 
-// Store last command sent
-uint8_t lastPumpCommand = 0x00;
-uint8_t lastValveCommand = 0x00;
-
-// Store time of last command (for retry timing, optional)
-unsigned long lastPumpCmdTime = 0;
-unsigned long lastValveCmdTime = 0;
 unsigned long lastScheduleCheck = 0;
 unsigned long lastMqttReceived  = 0;
 unsigned long lastMqttConnect   = 0;
@@ -194,8 +255,8 @@ const unsigned long mqttReconnectInterval = 5000;  // 5 seconds
 int mqttFailCount = 0;
 const int maxMqttFailures = 12;  // 12 * 5s = 60s
 
-unsigned long lastHeartbeatTime = 0;
-const unsigned long heartbeatInterval = 20000; // every 20 seconds
+unsigned long lastDiagnosticsTime = 0;
+const unsigned long diagnosticsInterval = 20000; // every 20 seconds
 
 
 // Schedule storage
@@ -274,10 +335,6 @@ const unsigned long TIME_SYNC_TIMEOUT = 10 * 1000;  // 10 seconds timeout
 //     http.end();
 // }
 
-void debugLog(String msg) {
-  if (DEBUG_MODE) Serial.println(msg);
-}
-
 bool timeInRange(String nowStr, String start, String end) {
   return nowStr >= start && nowStr < end;
 }
@@ -365,19 +422,19 @@ bool fetchInitialState(const char* url, bool& state) {
   http.begin(url);
   int httpCode = http.GET();
   if (httpCode != 200) {
-    Serial.println("❌ Failed to fetch: " + String(url));
+    LOGF(LOG_FETCH_STATE_FAILED, httpCode);
     http.end();
     return false;
   }
 
   String payload = http.getString();
-  Serial.println("✅ Response: " + payload);
+  LOGF(LOG_FETCH_STATE_DONE, payload.length());
   http.end();
 
   DynamicJsonDocument doc(512);
   DeserializationError err = deserializeJson(doc, payload);
   if (err) {
-    Serial.println("❌ JSON Parse error");
+    LOGF(LOG_FETCH_STATE_PARSE_FAILED, err.c_str());
     return false;
   }
 
@@ -388,33 +445,30 @@ bool fetchInitialState(const char* url, bool& state) {
 
 
 
+// Commands are single words, matched in PubSubClient's buffer without
+// copying them into a String
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
   
   lastMqttReceived = millis();
-  String message;
-  for (int i = 0; i < length; i++) message += (char)payload[i];
-  message.trim();
-  message.replace("\"", "");
+  LOGF(LOG_MQTT_MESSAGE, length);
 
-  Serial.printf("📩 MQTT [%s] => %s\n", topic, message.c_str());
-
-  if (String(topic) == pump_topic && (message == "ON" || message == "OFF")) {
-    bool pumpCommand = (message == "ON");
+  bool isOn = mqttTextCommandIs(payload, length, "ON");
+  if (strcmp(topic, pump_topic) == 0 && (isOn || mqttTextCommandIs(payload, length, "OFF"))) {
+    bool pumpCommand = isOn;
 
     // 🚫 Don't send to valve via RS485 anymore — just log
-    Serial.printf(pumpCommand ? "✅ Pump triggered ON via MQTT\n" : "⛔ Pump triggered OFF via MQTT\n");
+    LOGF(LOG_MQTT_PUMP, pumpCommand ? "ON" : "OFF");
 
     // ✅ Instead control pump based on valve command
-    sendRS485Command(pumpCommand ? CMD_PUMP_ON : CMD_PUMP_OFF);
+    rs485Bus.send(DEVICE_ADDR, pumpCommand ? CMD_PUMP_ON : CMD_PUMP_OFF);
     pumpIsOn = pumpCommand;
     pumpManuallyOverridden = true;
 
     logDeviceStateToCloud("pump", pumpCommand);
-    Serial.printf(pumpCommand ? "✅ Pump turned ON because valve is ON\n" : "⛔ Pump turned OFF because valve is OFF\n");
   }
 
-  else if (message == "schedule") {
-    Serial.println("🔄 Refreshing schedules from MQTT command...");
+  else if (mqttTextCommandIs(payload, length, "schedule")) {
+    LOGF(LOG_MQTT_SCHEDULE_REFRESH);
 
     fetchFilteredSchedules(valve_schedule_url, "valve_id", "1", valveStart, valveEnd, valveCount);
     valveSchedules.clear();
@@ -424,7 +478,7 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
   }
 
   else {
-    Serial.println("❌ Unknown or ignored MQTT command.");
+    LOGF(LOG_MQTT_IGNORED);
   }
 }
 
@@ -439,21 +493,20 @@ void connectToAWS() {
   secureClient.setCertificate(device_cert);
   secureClient.setPrivateKey(private_key);
 
-  Serial.print("🔌 Attempting MQTT connection... ");
+  LOGF(LOG_MQTT_CONNECTING);
   if (mqttClient.connect(client_id)) {
-    Serial.println("✅ MQTT connected");
     mqttClient.subscribe(valve_topic);
     mqttClient.subscribe(pump_topic);
-    Serial.println("✅ Subscribed to topics");
+    LOGF(LOG_MQTT_CONNECTED);
     lastMqttConnect = millis();
     mqttFailCount = 0;
   } else {
     mqttFailCount++;
-    Serial.print("❌ MQTT connect failed, rc=");
-    Serial.println(mqttClient.state());
+    LOGF(LOG_MQTT_CONNECT_FAILED, mqttClient.state());
 
     if (mqttFailCount >= maxMqttFailures) {
-      Serial.println("🚨 Too many MQTT failures. Rebooting...");
+      LOGF(LOG_MQTT_REBOOT);
+      logFlush();
       delay(1000);
       ESP.restart();
     }
@@ -462,92 +515,23 @@ void connectToAWS() {
 
 
 
-void sendRS485Command(uint8_t cmd) {
-  rs485_totalCommands++;
-  uint8_t packet[6];
-  packet[0] = 0xAA;
-  packet[1] = DEVICE_ADDR;
-  packet[2] = cmd;
-  packet[3] = 0x00;
-  packet[4] = packet[0] ^ packet[1] ^ packet[2] ^ packet[3]; // CRC
-  packet[5] = 0x55;
-
-  const int maxAttempts = 5;
-  bool ack = false;
-
-  for (int attempt = 1; attempt <= maxAttempts; attempt++) {
-     
-      mqttClient.loop();  // ✅ allow MQTT processing
-    
-    digitalWrite(RS485_DE_RE, HIGH);
-    delay(2);
-    RS485Serial.write(packet, 6);
-    RS485Serial.flush();
-    delay(2);
-    digitalWrite(RS485_DE_RE, LOW);
-
-    Serial.printf("📤 RS485 Attempt %d: ", attempt);
-    for (int i = 0; i < 6; i++) {
-      Serial.printf("%02X ", packet[i]);
-    }
-    Serial.println();
-
-    ack = waitForACK();
-    if (ack) {
-    rs485_ackSuccess++;
-    debugLog("✅ RS485 ACK received");
-      Serial.println("✅ ACK received. Command successful.");
-      digitalWrite(2,HIGH);
-      break;
-    } else {
-      debugLog("❌ RS485 ACK NOT received");
-      Serial.println("⚠ No ACK. Retrying...");
-      delay(300);
-      digitalWrite(2, LOW);
-    }
-  }
-
-  if (!ack) {
-    Serial.println("❌ Command failed after retries. Receiver may be disconnected.");
-// Store the failed command for retry
-    if (cmd == CMD_PUMP_ON || cmd == CMD_PUMP_OFF) {
-      lastPumpCommand = cmd;
-      lastPumpCmdTime = millis();
-    } else if (cmd == CMD_VALVE_ON || cmd == CMD_VALVE_OFF) {
-      lastValveCommand = cmd;
-      lastValveCmdTime = millis();
-    }
-  } else {
-    // Clear stored command if ACK received
-    if (cmd == CMD_PUMP_ON || cmd == CMD_PUMP_OFF) {
-      lastPumpCommand = 0x00;
-    } else if (cmd == CMD_VALVE_ON || cmd == CMD_VALVE_OFF) {
-      lastValveCommand = 0x00;
-    }
-  }
-}
 void connectToWiFi() {
   WiFi.begin(ssid, password);
-  Serial.print("Connecting to WiFi");
-  Serial.println("SSID");
-  Serial.println(ssid);
-  Serial.println("PASS");
-  Serial.println(password);
-  
-  
+  LOGF(LOG_WIFI_CONNECTING, ssid);
+
   while (WiFi.status() != WL_CONNECTED) {
     delay(500);
     wifi_retries--;
     if(wifi_retries == 0){
-      Serial.println("Restarting....");
+      LOGF(LOG_WIFI_RESTART);
+      logFlush();
       ESP.restart();
     }
-    Serial.println("Connecting to WiFi...");
+    LOGF(LOG_WIFI_WAITING);
   }
 
-  Serial.println("\nWiFi connected!");
-  Serial.println("IP address: ");
-  Serial.println(WiFi.localIP());
+  IPAddress ip = WiFi.localIP();
+  LOGF(LOG_WIFI_CONNECTED, ip[0], ip[1], ip[2], ip[3]);
 
 
   //   // ⚠ Lock to sender's channel to make ESP-NOW work
@@ -563,7 +547,7 @@ void maintainTimeSync() {
 
   // Trigger new time sync every 6 hours
   if (!timeSyncInProgress && now - lastTimeSync > TIME_RESYNC_INTERVAL) {
-    Serial.println("🔄 Initiating periodic time re-sync...");
+    LOGF(LOG_TIME_RESYNC_START);
     configTime(gmtOffset_sec, daylightOffset_sec, "pool.ntp.org", "time.nist.gov");
     timeSyncInProgress = true;
     timeSyncStart = now;
@@ -574,10 +558,9 @@ void maintainTimeSync() {
     if (getLocalTime(&timeinfo)) {
       lastTimeSync = now;
       timeSyncInProgress = false;
-      Serial.println("✅ Time re-synced successfully.");
-      Serial.printf("🕒 Current time: %02d:%02d\n", timeinfo.tm_hour, timeinfo.tm_min);
+      LOGF(LOG_TIME_RESYNC_DONE, timeinfo.tm_hour, timeinfo.tm_min);
     } else if (now - timeSyncStart > TIME_SYNC_TIMEOUT) {
-      Serial.println("❌ Time re-sync timed out.");
+      LOGF(LOG_TIME_RESYNC_TIMEOUT);
       timeSyncInProgress = false;  // Abort current sync attempt
     }
   }
@@ -586,29 +569,52 @@ void maintainTimeSync() {
 void setupTime() {
   configTime(gmtOffset_sec, daylightOffset_sec, "pool.ntp.org", "time.nist.gov");
 
-  Serial.print("⏱ Syncing time");
+  LOGF(LOG_TIME_SYNCING);
   int retries = 0;
   while (!getLocalTime(&timeinfo) && retries < 10) {
-    Serial.print(".");
     delay(1000);
     retries++;
   }
 
   if (retries == 10) {
-    Serial.println("❌ Failed to sync time");
+    LOGF(LOG_TIME_SYNC_FAILED);
+    logFlush();
     ESP.restart();
   } else {
-    Serial.println("\n✅ Time synchronized");
-    Serial.printf("Current time: %02d:%02d\n", timeinfo.tm_hour, timeinfo.tm_min);
+    LOGF(LOG_TIME_SYNCED, timeinfo.tm_hour, timeinfo.tm_min);
   }
 }
 
+// Never blocks the caller; when the queue is full the oldest report is dropped
 void logDeviceStateToCloud(String machineType, bool state) {
-  // Add MQTT loop processing
-  mqttClient.loop();
+  CloudLogReport r = {};
+  strlcpy(r.machine, machineType.c_str(), sizeof(r.machine));
+  r.state = state;
+  if (xQueueSend(cloudLogQueue, &r, 0) != pdTRUE) {
+    CloudLogReport dropped;
+    xQueueReceive(cloudLogQueue, &dropped, 0);
+    xQueueSend(cloudLogQueue, &r, 0);
+    LOGF(LOG_CLOUD_QUEUE_FULL, strcmp(dropped.machine, "valve") == 0 ? "valve" : "pump", dropped.state ? "ON" : "OFF");
+  }
+}
+
+void cloudLogTask(void* arg) {
+  CloudLogReport r;
+  for (;;) {
+    xQueueReceive(cloudLogQueue, &r, portMAX_DELAY);
+    postDeviceStateToCloud(r.machine, r.state);
+  }
+}
+
+void startCloudLogWorker() {
+  cloudLogQueue = xQueueCreate(CLOUD_LOG_QUEUE_LEN, sizeof(CloudLogReport));
+  xTaskCreatePinnedToCore(cloudLogTask, "cloudLog", 8192, nullptr, 1, nullptr, 0);
+}
 
+// Blocking HTTP report with retries, only runs on cloudLogTask
+void postDeviceStateToCloud(String machineType, bool state) {
   if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("❌ WiFi not connected! Buffering log.");
+    LOGF(LOG_CLOUD_NO_WIFI);
     bufferLog(machineType, state);
     return;
   }
@@ -623,29 +629,27 @@ void logDeviceStateToCloud(String machineType, bool state) {
   url += "&id=1";
   url += "&mode=ESP";
 
-  Serial.println("🌐 Logging state to: " + url);
+  LOGF(LOG_CLOUD_POST, machineType == "valve" ? "valve" : "pump", state);
 
   int responseCode = -1;
   bool success = false;
 
   for (int attempt = 1; attempt <= MAX_HTTP_RETRIES; attempt++) {
-    Serial.printf("📡 Attempt %d...\n", attempt);
+    LOGF(LOG_CLOUD_ATTEMPT, attempt);
 
     http.begin(url);
     http.setTimeout(HTTP_TIMEOUT_MS);
 
-    esp_task_wdt_reset();  // WDT feed before request
     unsigned long start = millis();
     responseCode = http.GET();
     unsigned long end = millis();
-    esp_task_wdt_reset();  // WDT feed after request
 
     if (responseCode == 200) {
-      Serial.printf("✅ Log success in %lu ms (HTTP 200)\n", end - start);
+      LOGF(LOG_CLOUD_DONE, end - start);
       success = true;
       break;
     } else {
-      Serial.printf("⚠  HTTP %d: %s\n", responseCode, http.errorToString(responseCode).c_str());
+      LOGF(LOG_CLOUD_HTTP_FAILED, attempt, responseCode);
     }
 
     http.end();
@@ -653,7 +657,7 @@ void logDeviceStateToCloud(String machineType, bool state) {
   }
 
   if (!success) {
-    Serial.println("🛑 All attempts failed. Buffering log.");
+    LOGF(LOG_CLOUD_FAILED);
     bufferLog(machineType, state);
   }
 
@@ -665,103 +669,46 @@ void logDeviceStateToCloud(String machineType, bool state) {
 
 void bufferLog(String machineType, bool state) {
   if (offlineLogBuffer.size() >= OFFLINE_BUFFER_LIMIT) {
-    Serial.println("⚠ Log buffer full. Discarding oldest entry.");
+    LOGF(LOG_BUFFER_FULL);
     offlineLogBuffer.erase(offlineLogBuffer.begin());  // remove oldest
   }
 
   LogEntry entry = { machineType, state };
   offlineLogBuffer.push_back(entry);
 
-  Serial.printf("📦 Buffered log [%s → %s]. Total buffered: %d\n", 
-                machineType.c_str(), state ? "ON" : "OFF", offlineLogBuffer.size());
+  LOGF(LOG_BUFFER_APPENDED, machineType == "valve" ? "valve" : "pump", state ? "ON" : "OFF", offlineLogBuffer.size());
 }
 
 void flushOfflineLogs() {
   if (offlineLogBuffer.empty()) {
-    Serial.println("🧺 No offline logs to flush.");
+    LOGF(LOG_BUFFER_EMPTY);
     return;
   }
 
-  Serial.printf("🧹 Flushing %d buffered log(s) (no cloud send)...\n", offlineLogBuffer.size());
+  LOGF(LOG_BUFFER_FLUSHING, offlineLogBuffer.size());
 
   for (const auto& entry : offlineLogBuffer) {
-    Serial.printf("🗑 Discarding buffered log: [%s → %s]\n",
-                  entry.machineType.c_str(), entry.state ? "ON" : "OFF");
+    LOGF(LOG_BUFFER_DISCARDED, entry.machineType == "valve" ? "valve" : "pump", entry.state ? "ON" : "OFF");
   }
 
   offlineLogBuffer.clear();
 
-  Serial.println("✅ All buffered logs cleared.");
+  LOGF(LOG_BUFFER_CLEARED);
 }
 
 
-bool waitForACK() {
-    
-    mqttClient.loop();  // ✅ allow MQTT processing
-  
-  unsigned long start = millis();
-  uint8_t buffer[8];
-  int idx = 0;
-
-  while (millis() - start < 5000) {
-    if (RS485Serial.available()) {
-      uint8_t b = RS485Serial.read();
-      if (idx == 0 && b != 0xAA) continue;
-      buffer[idx++] = b;
-       
-       
-      if (idx >= 6 && buffer[5] == 0x55) {
- // 🔍 Print entire buffer
-         Serial.print("📦 ACK Buffer: ");
-        for (int i = 0; i < 6; i++) {
-          Serial.printf("%02X ", buffer[i]);
-        }
-        Serial.println();
-
-        uint8_t crc = buffer[4];
-        uint8_t calc_crc = buffer[0] ^ buffer[1] ^ buffer[2] ^ buffer[3];
-        if (buffer[2] == CMD_ACK && crc == calc_crc) {
-          Serial.println("✅ ACK received");
-          if (buffer[3] == CMD_CONNECTED) {
-            Serial.println("✅ ACK received - ESP-NOW: CONNECTED");
-          } else if (buffer[3] == CMD_DISCONNECTED) {
-            Serial.println("✅ ACK received - ESP-NOW: DISCONNECTED");
-          } else {
-            Serial.println("✅ ACK received - Unknown ESP-NOW status");
-          }
-          return true;
-        }
-        else {
-          Serial.println("⚠ Invalid ACK or CRC mismatch");
-        }
-
-        idx = 0; // 🔄 Reset index after processing
-      }
-      // Reset if over-read
-      if (idx >= 6) idx = 0;
-    }
-  }
-  Serial.println("❌ No ACK received");
-  return false;
-}
-
 void printDiagnostics() {
-  Serial.println("🔧 ===== Diagnostics =====");
-  Serial.printf("⏱  Uptime (s):            %lu\n", millis() / 1000);
-  Serial.printf("📡 MQTT reconnects:       %d\n", mqtt_reconnects);
-  Serial.printf("🕓 Last MQTT msg (s ago): %lu\n", (millis() - lastMqttReceived) / 1000);
-  Serial.printf("📨 RS485 cmds sent:       %d\n", rs485_totalCommands);
-  Serial.printf("✅ RS485 ACKs received:    %d\n", rs485_ackSuccess);
-  Serial.printf("🚰 Pump state:            %s\n", pumpIsOn ? "ON" : "OFF");
-
-  Serial.printf("💡 Heap: %d bytes | MQTT: %s | MQTT State: %d | WiFi RSSI: %d dBm\n",
-                ESP.getFreeHeap(),
-                mqttClient.connected() ? "Connected" : "Disconnected",
-                mqttClient.state(),
-                WiFi.RSSI());
-
-  Serial.printf("🌡  Chip temperature:      %.2f °C\n", temperatureRead());
-  Serial.println("===========================\n");
+  LOGF(LOG_DIAG_UPTIME, millis() / 1000, mqtt_reconnects, (millis() - lastMqttReceived) / 1000);
+  LOGF(LOG_DIAG_RS485, rs485Bus.totalCommands, rs485Bus.ackSuccess);
+  for (int i = 0; i < rs485Bus.nodeCount(); i++) {
+    const RS485Node& n = rs485Bus.node(i);
+    LOGF(LOG_DIAG_NODE, n.addr, n.online ? "online" : "offline",
+         n.lastAckTime ? (millis() - n.lastAckTime) / 1000 : 0, (n.pumpCmd << 8) | n.valveCmd);
+  }
+  LOGF(LOG_DIAG_STATE, pumpIsOn ? "ON" : "OFF", valveIsOn ? "ON" : "OFF");
+  LOGF(LOG_DIAG_HEAP, ESP.getFreeHeap(), mqttClient.connected() ? "Connected" : "Disconnected", mqttClient.state(),
+       WiFi.RSSI());
+  LOGF(LOG_DIAG_TEMPERATURE, (int)temperatureRead());
 
   esp_task_wdt_reset();  // 🐶 Feed the watchdog
 }
@@ -770,25 +717,26 @@ void printDiagnostics() {
 
 void setup() {
   Serial.begin(115200);
+  startLogSink(0);
   WiFi.mode(WIFI_STA);
   connectToWiFi();
 
   RS485Serial.begin(RS485_BAUDRATE, SERIAL_8N1, RS485_RXD, RS485_TXD);
-  pinMode(RS485_DE_RE, OUTPUT);
   pinMode(2, OUTPUT);
   digitalWrite(2, LOW);
-  digitalWrite(RS485_DE_RE, LOW); // Set receiver mode by default
+  rs485Bus.begin(RS485Serial, RS485_DE_RE, RS485_BAUDRATE, rs485NodeAddrs, RS485_NODE_COUNT);
+  startCloudLogWorker();
 
   delay(1000);
   setupTime(); 
-  Serial.println("🔄 Fetching initial states...");
+  LOGF(LOG_SETUP_FETCH);
                   HTTPClient http;
                   http.begin(pump_url);
                   int httpCode = http.GET();
 
                   if (httpCode == 200) {
                     String payload = http.getString();
-                    Serial.println("✅ Pump response: " + payload);
+                    LOGF(LOG_SETUP_PUMP_RESPONSE, payload.length());
 
                     DynamicJsonDocument doc(512);
                     DeserializationError err = deserializeJson(doc, payload);
@@ -797,12 +745,12 @@ void setup() {
                       bool pumpState = (stateStr == "1");
                       if (stateStr == "1"){
         pumpIsOn = true;
-                    sendRS485Command(CMD_PUMP_ON );  
+                    rs485Bus.send(DEVICE_ADDR, CMD_PUMP_ON);
                       }else{
                         pumpIsOn = false;
-                      sendRS485Command(CMD_PUMP_OFF);
+                      rs485Bus.send(DEVICE_ADDR, CMD_PUMP_OFF);
                       }
-                      Serial.printf("✅ Parsed pump state: %s\n", pumpState ? "ON" : "OFF");
+                      LOGF(LOG_SETUP_PUMP_STATE, pumpState ? "ON" : "OFF");
                       
                       String updateUrl = "https://gv6dp7jmaj.execute-api.ap-south-1.amazonaws.com/First/testfunction/";
                       updateUrl += "?org_id=3&service=update&machine=pump&block_id=1";
@@ -812,20 +760,21 @@ void setup() {
                       http.begin(updateUrl);
                       int code = http.GET();
                       if (code == 200) {
-                        Serial.println("✅ Initial pump state update sent");
+                        LOGF(LOG_SETUP_PUMP_SENT);
                       } else {
-                        Serial.print("❌ Failed to send initial pump state, restarting ESP... Code: ");
-                        Serial.println(code);
+                        LOGF(LOG_SETUP_PUMP_SEND_FAILED, code);
+                        logFlush();
                         ESP.restart();
                       }
                       http.end();
                     }
                     
                     else {
-                      Serial.println("❌ Pump JSON parse error");
+                      LOGF(LOG_SETUP_PUMP_PARSE_FAILED, err.c_str());
                     }
                   } else {
-                    Serial.println("❌ Failed to fetch pump state");
+                    LOGF(LOG_SETUP_PUMP_FETCH_FAILED, httpCode);
+                    logFlush();
                     ESP.restart();
                   }
                   http.end();
@@ -849,7 +798,7 @@ esp_task_wdt_config_t wdt_config = {
 esp_task_wdt_init(&wdt_config);
 
   esp_task_wdt_add(NULL);  // Add current thread to WDT
-    Serial.println("✅ Setup complete.");
+    LOGF(LOG_SETUP_DONE);
 
 
 }
@@ -865,14 +814,14 @@ if (millis() - lastTimeSync > 21600000UL) {
 }
 
 if (WiFi.status() != WL_CONNECTED) {
-  Serial.println("🔄 WiFi lost. Reconnecting...");
+  LOGF(LOG_WIFI_LOST);
   WiFi.disconnect();
   WiFi.begin(ssid, password);
 }
 
 if (ESP.getFreeHeap() < 50000) {    // Threshold based on load
-  Serial.println("⚠ Low heap! Restarting...");
-  delay(100);
+  LOGF(LOG_LOW_HEAP);
+  logFlush();
   ESP.restart();
 }
 
@@ -884,42 +833,24 @@ if (ESP.getFreeHeap() < 50000) {    // Threshold based on load
 
   if (WiFi.status() != WL_CONNECTED) ESP.restart();
   mqttClient.loop();
+  rs485Bus.service();  // non-blocking RS485 bus manager
 
-// 💓 Send heartbeat every 20 seconds
-if (millis() - lastHeartbeatTime >= heartbeatInterval) {
-  sendRS485Command(CMD_HEARTBEAT);
-      printDiagnostics();
-  lastHeartbeatTime = millis();
-}
-
-// ⏳ Retry unsent pump/valve command every 10 seconds
-if (lastPumpCommand != 0x00 && millis() - lastPumpCmdTime > 10000) {
-  Serial.println("♻ Retrying last pump command...");
-  sendRS485Command(lastPumpCommand);
-}
-
-if (lastValveCommand != 0x00 && millis() - lastValveCmdTime > 10000) {
-  Serial.println("♻ Retrying last valve command...");
-  sendRS485Command(lastValveCommand);
+// 🔧 Diagnostics every 20 seconds (heartbeats and retries are handled per node by rs485Bus)
+if (millis() - lastDiagnosticsTime >= diagnosticsInterval) {
+  printDiagnostics();
+  lastDiagnosticsTime = millis();
 }
 
 // 🕒 Check schedules every 1 second
   if (millis() - lastScheduleCheck >= scheduleInterval) {
-    Serial.println("Schedule check");
     checkAndTriggerSchedules();
     lastScheduleCheck = millis();
-Serial.println("");
-Serial.println("VALVEON");
-Serial.println(valveIsOn);
-Serial.println("PUMPON");
-Serial.println(pumpIsOn);
-Serial.println("");
 
   }
 
   if (millis() > 86400000UL) {
-  Serial.println("🔁 24h reached. Restarting...");
-  delay(100);
+  LOGF(LOG_DAILY_RESTART);
+  logFlush();
   ESP.restart();
 }
 
@@ -0,0 +1,200 @@
+// ControlJitterTest.cpp
+// Control-task timing while the network falls over, as check1311_2.cpp
+// runs it: ControlPeriod on a "control" task, edges from a one-shot
+// esp_timer, and a "network" task doing what networkTask does during an
+// outage (MQTT reconnects that stall in the handshake, REST calls that run
+// into their timeout, TLS work on the CPU).
+//
+// The same network script is first replayed through a single loop() that
+// also runs the schedule check, the layout before the split; that half runs
+// on the simulated clock and shows what an outage cost the check. The split
+// half runs on threads in real time and must keep periodic wake-ups and
+// edge switching within CONTROL_GATE_US throughout.
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <PubSubClient.h>
+#include <WiFiClientSecure.h>
+#include <esp_timer.h>
+
+#include <atomic>
+
+#include "ControlPeriod.h"
+#include "HostTest.h"
+
+#define CONTROL_PERIOD_MS     50         // as check1311_2.cpp
+#define HTTP_TIMEOUT_MS       2000       // as check1311_2.cpp
+#define MQTT_STALL_MS         3000       // handshake against a dead broker
+#define TLS_CPU_MS            60         // handshake crypto per connect attempt
+#define EDGE_SPACING_US       137000     // not a multiple of the period
+#define HEALTHY_US            1000000LL
+#define RUN_US                5000000LL  // healthy, then an outage until the end
+#define CONTROL_GATE_US       20000      // < half a period, on a shared host CPU
+
+namespace {
+
+const char* API_URL = "https://api.test/schedules";
+
+// TLS handshake work: burns CPU in real time, takes the time when simulated
+void spendCpu(uint32_t ms) {
+  int64_t end = hostClockUs() + ms * 1000LL;
+  if (!hostClockIsRealTime()) {
+    hostClockAdvanceUs(ms * 1000LL);
+    return;
+  }
+  while (hostClockUs() < end) hostKeep(end);
+}
+
+// One networkTask pass. Healthy for HEALTHY_US, then WiFi and the broker
+// are gone: every call runs into its timeout.
+struct NetworkScript {
+  WiFiClientSecure tls;
+  PubSubClient client{ tls };
+  HTTPClient http;
+  bool outage = false;
+  uint32_t passes = 0;
+
+  void step() {
+    if (!outage && hostClockUs() >= HEALTHY_US) {
+      outage = true;
+      hostMqttSetOnline(false);
+      hostMqttSetConnectDelayMs(MQTT_STALL_MS);
+      hostHttpSetOffline(true);
+    }
+    if (!client.connected()) {
+      spendCpu(TLS_CPU_MS);
+      client.connect("valve");
+    }
+    client.loop();
+    http.setTimeout(HTTP_TIMEOUT_MS);
+    if (http.begin(tls, API_URL)) {
+      http.GET();
+      http.end();
+    }
+    passes++;
+  }
+};
+
+void resetNetwork() {
+  hostMqttReset();
+  hostHttpReset();
+  hostHttpRoute(API_URL, [](const HostHttpRequest&) { return HostHttpResponse{ 200, "[]", 40, {} }; });
+}
+
+struct Result {
+  uint32_t worstPeriodLateUs;
+  uint32_t worstEdgeLateUs;
+  uint32_t cycles;
+  uint32_t edges;
+};
+
+// ---- Before the split: network calls and the schedule check share loop()
+Result runSingleLoop() {
+  hostClockReset();
+  resetNetwork();
+  NetworkScript net;
+  Result r = {};
+  int64_t due = CONTROL_PERIOD_MS * 1000LL;
+  int64_t edgeDue = EDGE_SPACING_US;
+  while (hostClockUs() < RUN_US) {
+    net.step();
+    int64_t now = hostClockUs();
+    if (now >= due) {
+      r.worstPeriodLateUs = std::max<uint32_t>(r.worstPeriodLateUs, now - due);
+      r.cycles++;
+      while (due <= now) due += CONTROL_PERIOD_MS * 1000LL;
+    }
+    while (edgeDue <= now) {
+      r.worstEdgeLateUs = std::max<uint32_t>(r.worstEdgeLateUs, now - edgeDue);
+      r.edges++;
+      edgeDue += EDGE_SPACING_US;
+    }
+    delay(10);   // networkTask's vTaskDelay
+  }
+  return r;
+}
+
+// ---- The split, on threads
+ControlPeriod controlPeriod;
+TaskHandle_t controlHandle = nullptr;
+esp_timer_handle_t edgeTimer = nullptr;
+int64_t edgeDueUs = 0;   // control task only
+std::atomic<uint32_t> worstEdgeLateUs{ 0 };
+std::atomic<uint32_t> edges{ 0 };
+std::atomic<uint32_t> networkPasses{ 0 };
+
+void onEdgeTimer(void*) { xTaskNotifyGive(controlHandle); }
+
+void armNextEdge() {
+  edgeDueUs = esp_timer_get_time() + EDGE_SPACING_US;
+  esp_timer_start_once(edgeTimer, EDGE_SPACING_US);
+}
+
+void controlTask(void*) {
+  controlPeriod.begin(CONTROL_PERIOD_MS);
+  armNextEdge();
+  for (;;) {
+    if (!controlPeriod.wait()) continue;
+    uint32_t late = (uint32_t)std::max<int64_t>(0, esp_timer_get_time() - edgeDueUs);
+    if (late > worstEdgeLateUs) worstEdgeLateUs = late;
+    edges++;
+    armNextEdge();
+  }
+}
+
+void networkTask(void*) {
+  NetworkScript net;
+  for (;;) {
+    net.step();
+    networkPasses = net.passes;
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+Result runSplit() {
+  hostClockReset(true);
+  resetNetwork();
+  controlPeriod.resetStats();
+  worstEdgeLateUs = 0;
+  edges = 0;
+  networkPasses = 0;
+
+  esp_timer_create_args_t args = {};
+  args.callback = onEdgeTimer;
+  args.name = "scheduleEdge";
+  esp_timer_create(&args, &edgeTimer);
+  xTaskCreatePinnedToCore(controlTask, "control", 4096, nullptr, 3, &controlHandle, 1);
+  xTaskCreatePinnedToCore(networkTask, "network", 16384, nullptr, 1, nullptr, 0);
+  hostClockWaitUntil(RUN_US, [] { return false; });
+
+  Result r = { controlPeriod.jitterMaxUs, worstEdgeLateUs, controlPeriod.cycles, edges };
+  hostClockReset();   // stops both tasks and the timer
+  return r;
+}
+
+void report(const char* name, const Result& r) {
+  printf("  %-12s %4u cycles  worst wake late %9.1f ms  %3u edges  worst edge late %9.1f ms\n", name,
+         (unsigned)r.cycles, r.worstPeriodLateUs / 1000.0, (unsigned)r.edges, r.worstEdgeLateUs / 1000.0);
+}
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  Result single = runSingleLoop();
+  Result split = runSplit();
+  printf("%.0f s healthy, then %.0f s without WiFi or broker\n", HEALTHY_US / 1e6, (RUN_US - HEALTHY_US) / 1e6);
+  report("single loop", single);
+  report("split tasks", split);
+  printf("  network passes on the split: %u\n", (unsigned)networkPasses.load());
+
+  // The outage held the single loop for whole timeouts
+  HOST_CHECK_GE(single.worstPeriodLateUs, HTTP_TIMEOUT_MS * 1000);
+  // Split: the network task was really stuck in its calls, the control
+  // task was not
+  HOST_CHECK_LE(networkPasses.load(), 10 + HEALTHY_US / 10000);
+  HOST_CHECK_LE(split.worstPeriodLateUs, CONTROL_GATE_US);
+  HOST_CHECK_LE(split.worstEdgeLateUs, CONTROL_GATE_US);
+  HOST_CHECK_GE(split.cycles, RUN_US / (CONTROL_PERIOD_MS * 1000) * 9 / 10);
+  HOST_CHECK_GE(split.edges, RUN_US / EDGE_SPACING_US * 9 / 10);
+  return hostTestExit();
+}
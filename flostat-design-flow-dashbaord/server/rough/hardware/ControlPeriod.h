@@ -0,0 +1,57 @@
+// ControlPeriod.h
+// The control task's wake-up: a fixed period that a task notification (the
+// schedule edge timer) can cut short, plus how late each periodic wake was
+// against its deadline. The network side reads and clears the stats for its
+// jitter report.
+//
+//   ControlPeriod period;
+//   period.begin(50);                      // in the task, before the loop
+//   for (;;) runScheduleCycle(period.wait());
+//   ...
+//   LOGF(..., period.cycles, period.jitterMaxUs);
+//   period.resetStats();
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <stdint.h>
+
+struct ControlPeriod {
+  // Worst lateness of a periodic wake and periodic wakes since resetStats()
+  volatile uint32_t jitterMaxUs = 0;
+  volatile uint32_t cycles = 0;
+
+  void begin(uint32_t periodMs) {
+    periodMs_ = periodMs;
+    period_ = pdMS_TO_TICKS(periodMs);
+    lastWake_ = xTaskGetTickCount();
+    deadlineUs_ = esp_timer_get_time();
+  }
+
+  // Sleeps until the next period unless notified first, so an edge is
+  // switched within microseconds rather than on the next tick. True when
+  // the notification woke it; the period keeps its phase either way.
+  bool wait() {
+    TickType_t elapsed = xTaskGetTickCount() - lastWake_;
+    if (elapsed < period_ && ulTaskNotifyTake(pdTRUE, period_ - elapsed) > 0) return true;
+
+    lastWake_ += period_;
+    deadlineUs_ += periodMs_ * 1000LL;
+    int64_t late = esp_timer_get_time() - deadlineUs_;
+    if (late < 0) late = 0;
+    if ((uint32_t)late > jitterMaxUs) jitterMaxUs = late;
+    cycles++;
+    return false;
+  }
+
+  void resetStats() {
+    cycles = 0;
+    jitterMaxUs = 0;
+  }
+
+ private:
+  uint32_t periodMs_ = 0;
+  TickType_t period_ = 0;
+  TickType_t lastWake_ = 0;
+  int64_t deadlineUs_ = 0;
+};
@@ -0,0 +1,167 @@
+// FastLog.h
+// Leveled logging that stays off the hot path. A call site stores a message
+// id and up to four 32-bit arguments in a RAM ring; a low-priority task
+// formats them and writes Serial later, so a full UART FIFO never stalls the
+// caller. Messages above LOG_LEVEL compile to nothing.
+//
+// The sketch lists its messages (id, level, format) before including this:
+//
+//   #define LOG_MESSAGES(X) X(LOG_TIME_NOW, LOG_LEVEL_DEBUG, "🕒 %02d:%02d")
+//   #include "FastLog.h"
+//   ...
+//   startLogSink(0);                 // drain task on core 0
+//   LOGF(LOG_TIME_NOW, tm.tm_hour, tm.tm_min);
+//   logFlush();                      // before ESP.restart()
+//
+// Arguments are stored as 32-bit words: formats use %d/%u/%ld/%lu/%lx, and %s
+// only for strings that outlive the record (literals, static tables). Do not
+// log from an ISR.
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL        LOG_LEVEL_INFO
+#endif
+#ifndef LOG_RING_LEN
+#define LOG_RING_LEN     128     // records, 24 bytes each
+#endif
+#define LOG_MAX_ARGS     4
+#define LOG_DRAIN_MS     20
+
+enum LogId : uint16_t {
+#define LOG_X_ID(id, level, fmt) id,
+  LOG_MESSAGES(LOG_X_ID)
+#undef LOG_X_ID
+  LOG_ID_COUNT
+};
+
+constexpr uint8_t LOG_ID_LEVELS[] = {
+#define LOG_X_LEVEL(id, level, fmt) level,
+  LOG_MESSAGES(LOG_X_LEVEL)
+#undef LOG_X_LEVEL
+};
+
+// Disabled messages keep an empty slot so their text is not linked in
+static const char* const LOG_ID_FORMATS[] = {
+#define LOG_X_FORMAT(id, level, fmt) (level <= LOG_LEVEL ? fmt : ""),
+  LOG_MESSAGES(LOG_X_FORMAT)
+#undef LOG_X_FORMAT
+};
+
+struct LogRecord {
+  uint32_t ms;
+  uint16_t id;      // LogId
+  uint16_t reserved;
+  uint32_t args[LOG_MAX_ARGS];
+};
+
+// Shared by every task. A push holds the spinlock for a 24 byte copy and
+// never waits on I/O; when the ring is full the record is dropped and counted.
+static LogRecord logRing[LOG_RING_LEN];
+static uint32_t logHead = 0;
+static uint32_t logTail = 0;
+static uint32_t logDropped = 0;
+static portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+
+inline void logPush(LogId id, const uint32_t* args, uint8_t n) {
+  uint32_t ms = millis();
+  portENTER_CRITICAL(&logMux);
+  if (logHead - logTail >= LOG_RING_LEN) {
+    logDropped++;
+    portEXIT_CRITICAL(&logMux);
+    return;
+  }
+  LogRecord& r = logRing[logHead % LOG_RING_LEN];
+  r.ms = ms;
+  r.id = id;
+  for (uint8_t i = 0; i < LOG_MAX_ARGS; i++) r.args[i] = i < n ? args[i] : 0;
+  logHead++;
+  portEXIT_CRITICAL(&logMux);
+}
+
+inline bool logPop(LogRecord& out, uint32_t& dropped) {
+  portENTER_CRITICAL(&logMux);
+  dropped = logDropped;
+  logDropped = 0;
+  bool any = logTail != logHead;
+  if (any) out = logRing[logTail++ % LOG_RING_LEN];
+  portEXIT_CRITICAL(&logMux);
+  return any;
+}
+
+template <typename T>
+inline uint32_t logArg(T v) { return (uint32_t)(uintptr_t)v; }
+
+// Picked at compile time from the message's level, so a disabled message
+// leaves no code at its call site
+template <bool Enabled>
+struct LogEmit {
+  template <typename... A>
+  static void emit(LogId id, A... a) {
+    static_assert(sizeof...(A) <= LOG_MAX_ARGS, "At most 4 log arguments");
+    const uint32_t words[sizeof...(A) + 1] = { logArg(a)..., 0 };
+    logPush(id, words, sizeof...(A));
+  }
+};
+
+template <>
+struct LogEmit<false> {
+  template <typename... A>
+  static void emit(LogId, A...) {}
+};
+
+#define LOGF(id, ...) LogEmit<(LOG_ID_LEVELS[id] <= LOG_LEVEL)>::emit(id, ##__VA_ARGS__)
+
+// Short, stable handle for a UUID in logs: its first 8 hex digits
+inline uint32_t logShortId(const uint8_t* id) {
+  return ((uint32_t)id[0] << 24) | ((uint32_t)id[1] << 16) | ((uint32_t)id[2] << 8) | id[3];
+}
+
+inline uint32_t logShortId(const char* uuid) {
+  uint32_t v = 0;
+  for (int n = 0; uuid && n < 8 && isxdigit((unsigned char)uuid[n]); n++) {
+    v = (v << 4) | (uuid[n] <= '9' ? uuid[n] - '0' : (uuid[n] | 0x20) - 'a' + 10);
+  }
+  return v;
+}
+
+// Formats and writes every queued record
+inline void logDrain() {
+  LogRecord r;
+  uint32_t dropped;
+  while (logPop(r, dropped)) {
+    if (dropped) Serial.printf("⚠️ %lu log record(s) dropped\n", (unsigned long)dropped);
+    Serial.printf("[%lu] ", (unsigned long)r.ms);
+    Serial.printf(LOG_ID_FORMATS[r.id], r.args[0], r.args[1], r.args[2], r.args[3]);
+    Serial.println();
+  }
+  if (dropped) Serial.printf("⚠️ %lu log record(s) dropped\n", (unsigned long)dropped);
+}
+
+// Writes out what is still queued on the caller's task and waits for the
+// UART. Only for paths about to restart the chip, so their last words are
+// not lost with the ring.
+inline void logFlush() {
+  logDrain();
+  Serial.flush();
+}
+
+static void logSinkTask(void* arg) {
+  for (;;) {
+    logDrain();
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+  }
+}
+
+// Lowest priority: the sink only runs when nothing else on its core has work
+inline void startLogSink(BaseType_t core) {
+  xTaskCreatePinnedToCore(logSinkTask, "logSink", 4096, nullptr, tskIDLE_PRIORITY, nullptr, core);
+}
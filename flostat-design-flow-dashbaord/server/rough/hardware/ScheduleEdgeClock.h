@@ -0,0 +1,39 @@
+// ScheduleEdgeClock.h
+// The schedule clock of the control task and the plan for its edge timer.
+// Times are wall clock epoch microseconds. esp_timer is not moved by SNTP
+// corrections, so the timer can fire a little before the wall clock reaches
+// the edge it was armed for; such a wake is taken as the edge itself.
+//
+//   ScheduleEdgeClock edgeClock;
+//   int64_t nowUs = edgeClock.now(wallUs);             // gettimeofday()
+//   int64_t sleepUs = edgeClock.plan(nowUs, index.secondsToNextEdge(nowSec));
+//   esp_timer_start_once(edgeTimer, sleepUs);
+#pragma once
+
+#include <stdint.h>
+
+#define MAX_SCHEDULE_SLEEP_US   (15LL * 60 * 1000000)   // bound drift between NTP syncs
+#define SCHEDULE_EDGE_SLACK_US  5000                    // a wake this close before the edge counts as it
+
+struct ScheduleEdgeClock {
+  int64_t edgeUs = 0;   // the planned edge, 0 when the wake is only the sleep cap
+
+  // The wall clock as the schedules see it
+  int64_t now(int64_t wallUs) const {
+    int64_t early = edgeUs - wallUs;
+    return early > 0 && early <= SCHEDULE_EDGE_SLACK_US ? edgeUs : wallUs;
+  }
+
+  // Plans the edge secondsToEdge after the start of nowUs' second and
+  // returns how long to sleep for it. Longer sleeps are capped and re-planned
+  // from a fresh clock reading.
+  int64_t plan(int64_t nowUs, uint32_t secondsToEdge) {
+    edgeUs = (nowUs / 1000000 + secondsToEdge) * 1000000;
+    int64_t sleepUs = edgeUs - nowUs;
+    if (sleepUs > MAX_SCHEDULE_SLEEP_US) {
+      sleepUs = MAX_SCHEDULE_SLEEP_US;
+      edgeUs = 0;
+    }
+    return sleepUs;
+  }
+};
@@ -0,0 +1,240 @@
+// ScheduleEdgeTest.cpp
+// How close to the second the valve sketch (check1311_2.cpp) switches. The
+// control task's wake-up (ControlPeriod), the one-shot edge timer that
+// notifies it, and the schedule clock and edge plan of ScheduleEdgeClock run
+// as in the sketch, on the simulated clock. The valve runs 06:00:00-06:01:00
+// and the pump, which starts 30 s after it, 06:00:30-06:01:30; both are in
+// the one index the planner reads. Error is the wall time of a switch minus
+// its edge; skew is pump error minus valve error.
+//
+// Each trial boots at a random instant before 06:00 and runs past the last
+// edge, with a random 20-150 us from the timer to the switch. An SNTP step
+// of +-3 ms lands 2 s before the first edge, once with the sync callback
+// (scheduleDirty, re-planned on the next period) and once without. The old
+// loop, a 1 s tick with stalls on "HH:MM" strings, is shown for reference.
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#include <random>
+
+#include "ControlPeriod.h"
+#include "HostTest.h"
+#include "ScheduleEdgeClock.h"
+#include "ScheduleIndex.h"
+
+#define CONTROL_PERIOD_MS        50                          // as check1311_2.cpp
+#define DISPATCH_MIN_US          20
+#define DISPATCH_MAX_US          150
+#define SNTP_STEP_US             3000
+#define TRIALS                   200
+#define DAY_EPOCH                1760659200LL                // a UTC midnight
+
+namespace {
+
+enum Device { VALVE, PUMP, DEVICES };
+
+// Edges of each device in seconds of day: on, off
+const uint32_t EDGES[DEVICES][2] = { { 6 * 3600, 6 * 3600 + 60 }, { 6 * 3600 + 30, 6 * 3600 + 90 } };
+
+enum StepMode { STEP_NONE, STEP_NOTIFIED, STEP_SILENT };
+
+struct Stats {
+  int64_t worstErrUs = 0;    // largest |error| of any switch
+  int64_t worstSkewUs = 0;   // largest |pump error - valve error| at the on edge
+  uint32_t switches = 0;
+  uint32_t wrongSwitches = 0;
+
+  void add(int64_t errUs) {
+    worstErrUs = std::max(worstErrUs, std::abs(errUs));
+    switches++;
+  }
+};
+
+// ---- The sketch's edge path
+ScheduleIndex<DEVICES> scheduleIndex;
+ScheduleEdgeClock scheduleEdgeClock;
+ControlPeriod controlPeriod;
+TaskHandle_t controlHandle = nullptr;
+esp_timer_handle_t edgeTimer = nullptr, sntpTimer = nullptr;
+std::mt19937 rng(25);
+
+int64_t wallAtBootUs = 0;      // gettimeofday() at esp_timer 0
+int64_t wallStepUs = 0;        // what SNTP has stepped since
+int64_t nextScheduleCheckUs = 0;
+bool scheduleDirty = true;
+bool deviceOn[DEVICES];
+int64_t onErrUs[DEVICES];
+StepMode stepMode = STEP_NONE;
+int64_t stepUs = 0;
+Stats* stats = nullptr;
+
+int64_t wallUs() { return wallAtBootUs + esp_timer_get_time() + wallStepUs; }
+
+void onEdgeTimer(void*) { xTaskNotifyGive(controlHandle); }
+
+void onSntpStep(void*) {
+  wallStepUs += stepUs;
+  if (stepMode == STEP_NOTIFIED) scheduleDirty = true;   // onTimeSynced()
+}
+
+int64_t scheduleClockUs() { return scheduleEdgeClock.now(wallUs()); }
+
+uint32_t secondOfDay(int64_t us) { return (uint32_t)((us / 1000000) % SECONDS_PER_DAY); }
+
+void checkAndTriggerSchedules() {
+  int64_t nowUs = scheduleClockUs();
+  uint32_t nowSec = secondOfDay(nowUs);
+  for (int d = 0; d < DEVICES; d++) {
+    bool on = nowSec >= EDGES[d][0] && nowSec < EDGES[d][1];
+    if (on == deviceOn[d]) continue;
+    deviceOn[d] = on;
+    // The relay moves now, whatever the schedule clock rounded to
+    int64_t edgeUs = (DAY_EPOCH + EDGES[d][on ? 0 : 1]) * 1000000;
+    int64_t err = wallUs() - edgeUs;
+    if (std::abs(err) > 1000000) stats->wrongSwitches++;
+    stats->add(err);
+    if (on) onErrUs[d] = err;
+  }
+}
+
+void planNextScheduleEdge() {
+  int64_t nowUs = scheduleClockUs();
+  uint32_t nowSec = secondOfDay(nowUs);
+  int64_t sleepUs = scheduleEdgeClock.plan(nowUs, scheduleIndex.secondsToNextEdge(nowSec));
+  nextScheduleCheckUs = esp_timer_get_time() + sleepUs;
+  esp_timer_stop(edgeTimer);
+  esp_timer_start_once(edgeTimer, sleepUs);
+}
+
+void runScheduleCycle(bool edgeFired) {
+  if (edgeFired) {
+    std::uniform_int_distribution<int> dispatch(DISPATCH_MIN_US, DISPATCH_MAX_US);
+    hostClockAdvanceUs(dispatch(rng));   // esp_timer task -> control task
+  }
+  if (edgeFired || scheduleDirty || esp_timer_get_time() >= nextScheduleCheckUs) {
+    scheduleDirty = false;
+    checkAndTriggerSchedules();
+    planNextScheduleEdge();
+  }
+}
+
+// One boot, from a random instant in 05:59:40-05:59:55 until past 06:01:30
+void runTrial(StepMode mode, Stats& s) {
+  hostClockReset();
+  controlHandle = xTaskGetCurrentTaskHandle();
+  esp_timer_create_args_t args = {};
+  args.callback = onEdgeTimer;
+  args.name = "scheduleEdge";
+  esp_timer_create(&args, &edgeTimer);
+  args.callback = onSntpStep;
+  args.name = "sntp";
+  esp_timer_create(&args, &sntpTimer);
+
+  std::uniform_int_distribution<int64_t> boot(0, 15000000 - 1);
+  wallAtBootUs = (DAY_EPOCH + 6 * 3600 - 20) * 1000000 + boot(rng);
+  wallStepUs = 0;
+  scheduleEdgeClock = ScheduleEdgeClock();
+  scheduleDirty = true;
+  for (int d = 0; d < DEVICES; d++) deviceOn[d] = false;
+  stats = &s;
+  stepMode = mode;
+  stepUs = rng() % 2 ? SNTP_STEP_US : -SNTP_STEP_US;
+  if (mode != STEP_NONE) {
+    int64_t stepWallUs = (DAY_EPOCH + 6 * 3600 - 2) * 1000000;
+    esp_timer_start_once(sntpTimer, stepWallUs - wallUs());
+  }
+
+  int64_t endWallUs = (DAY_EPOCH + 6 * 3600 + 92) * 1000000;
+  controlPeriod.begin(CONTROL_PERIOD_MS);
+  while (wallUs() < endWallUs) runScheduleCycle(controlPeriod.wait());
+
+  for (int d = 0; d < DEVICES; d++) HOST_CHECK(!deviceOn[d]);
+  s.worstSkewUs = std::max(s.worstSkewUs, std::abs(onErrUs[PUMP] - onErrUs[VALVE]));
+  esp_timer_delete(edgeTimer);
+  esp_timer_delete(sntpTimer);
+}
+
+// ---- Before: loop() every second plus up to 750 ms of network stalls,
+// comparing "HH:MM" strings; the pump's :30 edges only matched a minute on
+Stats runOldLoop() {
+  Stats s;
+  std::uniform_int_distribution<int64_t> boot(0, 15000000 - 1), stall(0, 750000);
+  const uint32_t oldEdges[DEVICES][2] = { { 360, 361 }, { 361, 362 } };   // minutes of day
+  for (int t = 0; t < TRIALS; t++) {
+    int64_t now = (DAY_EPOCH + 6 * 3600 - 20) * 1000000 + boot(rng);
+    bool on[DEVICES] = {};
+    int64_t err[DEVICES] = {};
+    while (now < (DAY_EPOCH + 6 * 3600 + 122) * 1000000) {
+      uint32_t minute = secondOfDay(now) / 60;
+      for (int d = 0; d < DEVICES; d++) {
+        bool active = minute >= oldEdges[d][0] && minute < oldEdges[d][1];
+        if (active == on[d]) continue;
+        on[d] = active;
+        int64_t e = now - (DAY_EPOCH + EDGES[d][active ? 0 : 1]) * 1000000;
+        s.add(e);
+        if (active) err[d] = e;
+      }
+      now += 1000000 + stall(rng);
+    }
+    s.worstSkewUs = std::max(s.worstSkewUs, std::abs(err[PUMP] - err[VALVE]));
+  }
+  return s;
+}
+
+// The slack and the sleep cap on their own
+void testEdgeClock() {
+  ScheduleEdgeClock c;
+  int64_t sec = DAY_EPOCH * 1000000;
+  HOST_CHECK_EQ(c.plan(sec + 250000, 10), 9750000);
+  HOST_CHECK_EQ(c.edgeUs, sec + 10000000);
+  HOST_CHECK_EQ(c.now(c.edgeUs - SCHEDULE_EDGE_SLACK_US), c.edgeUs);
+  HOST_CHECK_EQ(c.now(c.edgeUs - SCHEDULE_EDGE_SLACK_US - 1), c.edgeUs - SCHEDULE_EDGE_SLACK_US - 1);
+  HOST_CHECK_EQ(c.now(c.edgeUs + 1), c.edgeUs + 1);
+
+  HOST_CHECK_EQ(c.plan(sec, SECONDS_PER_DAY), MAX_SCHEDULE_SLEEP_US);
+  HOST_CHECK_EQ(c.edgeUs, 0);
+  HOST_CHECK_EQ(c.now(sec + MAX_SCHEDULE_SLEEP_US - 1), sec + MAX_SCHEDULE_SLEEP_US - 1);
+}
+
+void report(const char* name, const Stats& s) {
+  printf("  %-26s %5u switches  worst error %10.3f ms  worst skew %10.3f ms\n", name, (unsigned)s.switches,
+         s.worstErrUs / 1000.0, s.worstSkewUs / 1000.0);
+}
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  scheduleIndex.clear();
+  for (int d = 0; d < DEVICES; d++) scheduleIndex.add(EDGES[d][0], EDGES[d][1]);
+  scheduleIndex.seal();
+  testEdgeClock();
+
+  Stats none, notified, silent;
+  for (int t = 0; t < TRIALS; t++) {
+    runTrial(STEP_NONE, none);
+    runTrial(STEP_NOTIFIED, notified);
+    runTrial(STEP_SILENT, silent);
+  }
+  Stats old = runOldLoop();
+
+  printf("%d boots per case, %d-%d us from timer to switch\n", TRIALS, DISPATCH_MIN_US, DISPATCH_MAX_US);
+  report("old 1 s loop, HH:MM", old);
+  report("edge timer", none);
+  report("edge timer, SNTP step", notified);
+  report("edge timer, silent step", silent);
+
+  for (const Stats* s : { &none, &notified, &silent }) {
+    HOST_CHECK_EQ(s->switches, TRIALS * DEVICES * 2);
+    HOST_CHECK_EQ(s->wrongSwitches, 0);
+  }
+  // Exact to the second: only the dispatch latency remains
+  HOST_CHECK_LE(none.worstErrUs, DISPATCH_MAX_US);
+  HOST_CHECK_LE(none.worstSkewUs, DISPATCH_MAX_US - DISPATCH_MIN_US);
+  HOST_CHECK_LE(notified.worstErrUs, DISPATCH_MAX_US);
+  HOST_CHECK_LE(notified.worstSkewUs, DISPATCH_MAX_US - DISPATCH_MIN_US);
+  // A step nobody told us about costs at most the step
+  HOST_CHECK_LE(silent.worstErrUs, SNTP_STEP_US + DISPATCH_MAX_US);
+  HOST_CHECK_GE(old.worstSkewUs, 29000000);
+  return hostTestExit();
+}
@@ -0,0 +1,103 @@
+// ScheduleIndex.h
+// Second-of-day intervals sorted by start, with a running max of the end
+// second. "Is any schedule on now" is then a binary search over fixed
+// arrays: no String copies and no heap allocations. The firmware rebuilds
+// it from the records that apply today, see expandSchedulesForDay().
+//
+//   ScheduleIndex<2 * MAX_SCHEDULES> index;
+//   index.clear();
+//   index.add(parseTimeToSeconds("06:00"), parseTimeToSeconds("06:30"));
+//   index.seal();                        // after the last add()
+//   index.activeAt(6 * 3600 + 5);        // true
+//   index.secondsToNextEdge(6 * 3600);   // 1800, the end at 06:30
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+
+#define SECONDS_PER_DAY 86400UL
+
+struct ScheduleInterval {
+  uint32_t start_sec;
+  uint32_t end_sec;     // up to SECONDS_PER_DAY
+};
+
+// "HH:MM" or "HH:MM:SS" -> second of day, -1 if malformed
+inline long parseTimeToSeconds(const char* t) {
+  if (t == nullptr) return -1;
+  int h = 0, m = 0, sec = 0, digits = 0;
+  while (*t >= '0' && *t <= '9' && digits < 2) {
+    h = h * 10 + (*t++ - '0');
+    digits++;
+  }
+  if (digits == 0 || *t++ != ':') return -1;
+  if (t[0] < '0' || t[0] > '9' || t[1] < '0' || t[1] > '9') return -1;
+  m = (t[0] - '0') * 10 + (t[1] - '0');
+  t += 2;
+  if (*t == ':') {
+    if (t[1] < '0' || t[1] > '9' || t[2] < '0' || t[2] > '9') return -1;
+    sec = (t[1] - '0') * 10 + (t[2] - '0');
+  }
+  if (h > 23 || m > 59 || sec > 59) return -1;
+  return h * 3600L + m * 60 + sec;
+}
+
+template <int N>
+class ScheduleIndex {
+ public:
+  void clear() { count_ = 0; }
+
+  // [start, end), false if the index is full. Not searchable until seal().
+  bool add(uint32_t start, uint32_t end) {
+    if (count_ >= N) return false;
+    intervals_[count_].start_sec = start;
+    intervals_[count_].end_sec = end;
+    count_++;
+    return true;
+  }
+
+  // Sort by start and build the running max. Only runs when the set or the
+  // day changes.
+  void seal() {
+    std::sort(intervals_, intervals_ + count_,
+              [](const ScheduleInterval& a, const ScheduleInterval& b) { return a.start_sec < b.start_sec; });
+    uint32_t maxEnd = 0;
+    for (int i = 0; i < count_; i++) {
+      if (intervals_[i].end_sec > maxEnd) maxEnd = intervals_[i].end_sec;
+      maxEnd_[i] = maxEnd;
+    }
+  }
+
+  int count() const { return count_; }
+  const ScheduleInterval& operator[](int i) const { return intervals_[i]; }
+
+  // True if any interval covers nowSec (start <= now < end), O(log n)
+  bool activeAt(uint32_t nowSec) const {
+    // last interval whose start <= nowSec
+    int lo = 0, hi = count_;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (intervals_[mid].start_sec <= nowSec) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo > 0 && maxEnd_[lo - 1] > nowSec;
+  }
+
+  // Seconds from nowSec to the next start or end edge, or to midnight,
+  // whichever comes first. O(n), but it runs once per edge, not per tick.
+  uint32_t secondsToNextEdge(uint32_t nowSec) const {
+    uint32_t best = SECONDS_PER_DAY - nowSec;
+    for (int i = 0; i < count_; i++) {
+      uint32_t edges[2] = { intervals_[i].start_sec, intervals_[i].end_sec };
+      for (uint32_t e : edges) {
+        if (e > nowSec && e - nowSec < best) best = e - nowSec;
+      }
+    }
+    return best;
+  }
+
+ private:
+  ScheduleInterval intervals_[N];
+  uint32_t maxEnd_[N];
+  int count_ = 0;
+};
@@ -0,0 +1,131 @@
+// ScheduleIndexBench.cpp
+// The per-tick schedule check, old against new, at the old store size
+// (MAX_SCHEDULES=60) and at 10k synthetic schedules:
+//   legacy  String start/end copied per entry, timeInRange() compares text
+//   index   ScheduleIndex::activeAt(), a binary search over fixed arrays
+// Both must agree on every minute; the index must not allocate and must
+// stay under its per-check gate at 10k.
+#include <Arduino.h>
+
+#include <random>
+#include <vector>
+
+#include "HostHeap.h"
+#include "HostTest.h"
+#include "ScheduleIndex.h"
+
+#define INDEX_CHECK_GATE_NS 1000.0   // per activeAt() at 10k intervals
+
+namespace {
+
+// As hardware/check1311.cpp stored and checked them
+struct LegacySchedule {
+  String start_time;
+  String end_time;
+};
+
+bool timeInRange(String nowStr, String start, String end) {
+  return nowStr >= start && nowStr < end;
+}
+
+bool legacyActive(const std::vector<LegacySchedule>& list, const char* currentTime) {
+  bool match = false;
+  for (size_t i = 0; i < list.size(); i++) {
+    String start = list[i].start_time;
+    String end = list[i].end_time;
+    if (timeInRange(currentTime, start, end)) match = true;
+  }
+  return match;
+}
+
+ScheduleIndex<10000> index;
+
+void formatHhmm(uint32_t sec, char* out) {
+  snprintf(out, 6, "%02u:%02u", (unsigned)(sec / 3600), (unsigned)(sec / 60 % 60));
+}
+
+// Minute-aligned windows of 5 to 60 minutes that end by midnight, the only
+// kind the legacy check handles
+void buildSchedules(int n, std::vector<LegacySchedule>& legacy) {
+  std::mt19937 rng(1311 + n);
+  legacy.clear();
+  index.clear();
+  for (int i = 0; i < n; i++) {
+    uint32_t start = rng() % (24 * 60 - 5) * 60;
+    uint32_t end = std::min<uint32_t>(start + (5 + rng() % 56) * 60, SECONDS_PER_DAY - 60);
+    if (end <= start) end = start + 60;
+    char s[6], e[6];
+    formatHhmm(start, s);
+    formatHhmm(end, e);
+    legacy.push_back({ s, e });
+    index.add(start, end);
+  }
+  index.seal();
+}
+
+void run(int n) {
+  std::vector<LegacySchedule> legacy;
+  double t0 = hostWallNs();
+  buildSchedules(n, legacy);
+  double buildMs = (hostWallNs() - t0) / 1e6;
+
+  // Every minute of the day agrees (the legacy check only sees minutes)
+  int mismatches = 0, active = 0;
+  for (uint32_t sec = 0; sec < SECONDS_PER_DAY; sec += 60) {
+    char now[6];
+    formatHhmm(sec, now);
+    bool a = legacyActive(legacy, now);
+    bool b = index.activeAt(sec);
+    mismatches += a != b;
+    active += b;
+  }
+  HOST_CHECK_EQ(mismatches, 0);
+
+  // Legacy: a sample of minutes, it is slow at 10k
+  const int legacyChecks = n > 1000 ? 200 : 20000;
+  int hits = 0;
+  HostHeapStats h0 = hostHeapStats();
+  t0 = hostWallNs();
+  for (int i = 0; i < legacyChecks; i++) {
+    char now[6];
+    formatHhmm((uint32_t)i * 433 % SECONDS_PER_DAY, now);
+    hits += legacyActive(legacy, now);
+  }
+  double legacyNs = (hostWallNs() - t0) / legacyChecks;
+  uint64_t legacyAllocs = hostHeapStats().allocs - h0.allocs;
+  hostKeep(hits);
+
+  const int indexChecks = 2000000;
+  h0 = hostHeapStats();
+  t0 = hostWallNs();
+  for (int i = 0; i < indexChecks; i++) hits += index.activeAt((uint32_t)i * 433 % SECONDS_PER_DAY);
+  double indexNs = (hostWallNs() - t0) / indexChecks;
+  uint64_t indexAllocs = hostHeapStats().allocs - h0.allocs;
+  hostKeep(hits);
+
+  const int edgeChecks = n > 1000 ? 2000 : 200000;
+  uint32_t edges = 0;
+  t0 = hostWallNs();
+  for (int i = 0; i < edgeChecks; i++) edges += index.secondsToNextEdge((uint32_t)i * 433 % SECONDS_PER_DAY);
+  double edgeNs = (hostWallNs() - t0) / edgeChecks;
+  hostKeep(edges);
+
+  printf("schedules=%-6d active_minutes=%-5d build=%.2f ms\n", n, active, buildMs);
+  printf("  legacy  %12.1f ns/check  %8.2f allocs/check\n", legacyNs, (double)legacyAllocs / legacyChecks);
+  printf("  index   %12.1f ns/check  %8.2f allocs/check  (%.0fx)\n", indexNs, (double)indexAllocs / indexChecks,
+         legacyNs / indexNs);
+  printf("  next edge %10.1f ns/plan\n", edgeNs);
+
+  HOST_CHECK_EQ(indexAllocs, 0);
+  HOST_CHECK_LE(indexNs, legacyNs);
+  if (n > 1000) HOST_CHECK_LE(indexNs, INDEX_CHECK_GATE_NS);
+}
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  run(60);
+  run(10000);
+  return hostTestExit();
+}
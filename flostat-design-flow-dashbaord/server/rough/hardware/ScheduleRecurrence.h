@@ -0,0 +1,106 @@
+// ScheduleRecurrence.h
+// When a schedule applies: a weekday mask, an optional date range and an
+// "every N days" step. One record stands for every day it matches, and the
+// firmware expands it only for the current day, see expandSchedulesForDay().
+//
+// Days are local calendar days counted from 1970-01-01 (day 0, a Thursday),
+// so they fit a uint16_t until 2149 and 0 can mean "no bound".
+//
+//   ScheduleRecurrence r = RECURRENCE_DAILY;
+//   r.weekdays = WEEKDAY_BIT(1) | WEEKDAY_BIT(3);    // Mondays and Wednesdays
+//   r.valid_from = parseDay("2026-11-01");
+//   r.occursOn(dayFromCivil(2026, 11, 4));           // true, a Wednesday
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ScheduleIndex.h"
+
+#define WEEKDAY_BIT(wday)  (1 << (wday))   // tm_wday: 0 = Sunday
+#define WEEKDAYS_ALL       0x7F
+#define RECURRENCE_MAX_EVERY_N_DAYS 366
+
+struct __attribute__((packed)) ScheduleRecurrence {
+  uint8_t weekdays;        // WEEKDAY_BIT mask, never 0
+  uint16_t every_n_days;   // 1 = every matching day, N counts from valid_from
+  uint16_t valid_from;     // first day, 0 = no lower bound
+  uint16_t valid_until;    // last day (inclusive), 0 = no upper bound
+
+  // O(1), no calendar lookups
+  bool occursOn(int32_t day) const {
+    if (day < 0 || !(weekdays & WEEKDAY_BIT((day + 4) % 7))) return false;
+    if (valid_from && day < valid_from) return false;
+    if (valid_until && day > valid_until) return false;
+    return every_n_days <= 1 || (day - valid_from) % every_n_days == 0;
+  }
+};
+
+// What every schedule did before recurrences existed
+const ScheduleRecurrence RECURRENCE_DAILY = { WEEKDAYS_ALL, 1, 0, 0 };
+
+// Days since 1970-01-01 for a proleptic Gregorian date (month 1-12)
+inline int32_t dayFromCivil(int32_t y, uint32_t m, uint32_t d) {
+  y -= m <= 2;
+  int32_t era = (y >= 0 ? y : y - 399) / 400;
+  uint32_t yoe = (uint32_t)(y - era * 400);
+  uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int32_t)doe - 719468;
+}
+
+// Inverse of dayFromCivil
+inline void civilFromDay(int32_t day, int32_t& y, uint32_t& m, uint32_t& d) {
+  day += 719468;
+  int32_t era = (day >= 0 ? day : day - 146096) / 146097;
+  uint32_t doe = (uint32_t)(day - era * 146097);
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = (int32_t)yoe + era * 400 + (m <= 2);
+}
+
+// "YYYY-MM-DD" -> day, -1 if malformed or outside the uint16_t range
+inline int32_t parseDay(const char* s) {
+  if (s == nullptr) return -1;
+  uint32_t v[3] = { 0, 0, 0 };
+  const uint8_t widths[3] = { 4, 2, 2 };
+  for (int f = 0; f < 3; f++) {
+    for (int i = 0; i < widths[f]; i++, s++) {
+      if (*s < '0' || *s > '9') return -1;
+      v[f] = v[f] * 10 + (*s - '0');
+    }
+    if (*s != (f < 2 ? '-' : '\0')) return -1;
+    s++;
+  }
+  if (v[1] < 1 || v[1] > 12 || v[2] < 1 || v[2] > 31) return -1;
+  int32_t day = dayFromCivil(v[0], v[1], v[2]);
+  int32_t y;
+  uint32_t m, d;
+  civilFromDay(day, y, m, d);
+  if (m != v[1] || d != v[2]) return -1;  // e.g. 2026-02-30
+  return day > 0 && day <= 0xFFFF ? day : -1;
+}
+
+// The intervals a start-end window adds to the index for `day`: [start, end)
+// on the days the recurrence matches. A window that runs past midnight is
+// [start, 24:00) on those days and [00:00, end) on the day after, so a
+// night that starts on an excluded day leaves the next morning alone. The
+// caller skips start == end.
+template <int N>
+inline void addWindowForDay(ScheduleIndex<N>& index, uint32_t start, uint32_t end, const ScheduleRecurrence& r,
+                            int32_t day) {
+  bool wraps = end < start;
+  if (r.occursOn(day)) index.add(start, wraps ? SECONDS_PER_DAY : end);
+  if (wraps && r.occursOn(day - 1)) index.add(0, end);
+}
+
+// day -> "YYYY-MM-DD", out must hold 11 chars
+inline void formatDay(int32_t day, char* out) {
+  int32_t y;
+  uint32_t m, d;
+  civilFromDay(day, y, m, d);
+  snprintf(out, 11, "%04u-%02u-%02u", (unsigned)y % 10000, (unsigned)m % 100, (unsigned)d % 100);
+}
@@ -0,0 +1,202 @@
+// ScheduleRecurrenceTest.cpp
+// ScheduleRecurrence.h: parseDay() and the civil day conversions, occursOn()
+// with its weekday mask, date bounds and "every N days" step, and the way
+// expandSchedulesForDay() in check1311_2.cpp puts a window on a day through
+// addWindowForDay(), including the spill of an overnight window into the
+// next morning.
+#include <Arduino.h>
+
+#include "HostTest.h"
+#include "ScheduleIndex.h"
+#include "ScheduleRecurrence.h"
+
+namespace {
+
+const int32_t NOV_01_2026 = 20758;   // a Sunday
+const int32_t FEB_29_2028 = 21243;   // a Tuesday
+const int32_t LAST_DAY = 0xFFFF;     // 2149-06-06
+
+void testCivilDays() {
+  HOST_CHECK_EQ(dayFromCivil(1970, 1, 1), 0);
+  HOST_CHECK_EQ(dayFromCivil(2026, 11, 1), NOV_01_2026);
+  HOST_CHECK_EQ(dayFromCivil(2028, 2, 29), FEB_29_2028);
+  HOST_CHECK_EQ(dayFromCivil(2028, 3, 1), FEB_29_2028 + 1);
+
+  // Every day the wire can carry survives formatDay() -> parseDay()
+  char buf[11];
+  for (int32_t day = 1; day <= LAST_DAY; day++) {
+    int32_t y;
+    uint32_t m, d;
+    civilFromDay(day, y, m, d);
+    HOST_CHECK_EQ(dayFromCivil(y, m, d), day);
+    formatDay(day, buf);
+    HOST_CHECK_EQ(parseDay(buf), day);
+  }
+}
+
+void testParseDay() {
+  HOST_CHECK_EQ(parseDay("2026-11-01"), NOV_01_2026);
+  HOST_CHECK_EQ(parseDay("2028-02-29"), FEB_29_2028);
+  HOST_CHECK_EQ(parseDay("2149-06-06"), LAST_DAY);
+
+  const char* rejected[] = {
+    "2026-02-30", "2026-02-29", "2100-02-29", "2026-04-31",   // no such day
+    "2026-13-01", "2026-00-10", "2026-11-00", "2026-11-32",   // out of range
+    "1970-01-01",                                             // day 0 means "no bound"
+    "2149-06-07",                                             // past uint16_t
+    "2026-1-01", "2026-11-1", "26-11-01", "20261101",         // malformed
+    "2026/11/01", "2026-11-01x", "2026-11-01 ", " 2026-11-01", "2026-1a-01", "",
+  };
+  for (const char* s : rejected) {
+    if (parseDay(s) != -1) printf("  accepted \"%s\"\n", s);
+    HOST_CHECK_EQ(parseDay(s), -1);
+  }
+  HOST_CHECK_EQ(parseDay(nullptr), -1);
+}
+
+void testWeekdays() {
+  // Day 0 was a Thursday
+  ScheduleRecurrence r = RECURRENCE_DAILY;
+  r.weekdays = WEEKDAY_BIT(4);
+  HOST_CHECK(r.occursOn(0));
+  HOST_CHECK(!r.occursOn(1));
+  HOST_CHECK(r.occursOn(7));
+  HOST_CHECK(!r.occursOn(-7));
+
+  r.weekdays = WEEKDAY_BIT(2);   // Tuesdays
+  HOST_CHECK(r.occursOn(FEB_29_2028));
+  HOST_CHECK(!r.occursOn(FEB_29_2028 + 1));
+  HOST_CHECK(r.occursOn(FEB_29_2028 + 7));
+
+  r.weekdays = WEEKDAY_BIT(0) | WEEKDAY_BIT(6);   // weekends
+  int hits = 0;
+  for (int32_t day = NOV_01_2026; day < NOV_01_2026 + 28; day++) hits += r.occursOn(day);
+  HOST_CHECK_EQ(hits, 8);
+
+  for (int32_t day = 0; day < 1000; day++) HOST_CHECK(RECURRENCE_DAILY.occursOn(day));
+}
+
+void testBounds() {
+  ScheduleRecurrence r = RECURRENCE_DAILY;
+  r.valid_from = NOV_01_2026;
+  r.valid_until = NOV_01_2026 + 9;
+  HOST_CHECK(!r.occursOn(r.valid_from - 1));
+  HOST_CHECK(r.occursOn(r.valid_from));
+  HOST_CHECK(r.occursOn(r.valid_until));
+  HOST_CHECK(!r.occursOn(r.valid_until + 1));
+
+  // A single day
+  r.valid_until = r.valid_from;
+  HOST_CHECK(r.occursOn(r.valid_from));
+  HOST_CHECK(!r.occursOn(r.valid_from + 1));
+
+  // Open ends
+  r.valid_until = 0;
+  HOST_CHECK(r.occursOn(LAST_DAY));
+  r.valid_from = 0;
+  r.valid_until = NOV_01_2026;
+  HOST_CHECK(r.occursOn(1));
+  HOST_CHECK(!r.occursOn(NOV_01_2026 + 1));
+}
+
+void testEveryNDays() {
+  // Counted from valid_from, not from day 0 or the week
+  ScheduleRecurrence r = RECURRENCE_DAILY;
+  r.every_n_days = 3;
+  r.valid_from = NOV_01_2026;
+  for (int32_t day = NOV_01_2026; day < NOV_01_2026 + 30; day++) {
+    HOST_CHECK_EQ(r.occursOn(day), (day - NOV_01_2026) % 3 == 0);
+  }
+  HOST_CHECK(!r.occursOn(NOV_01_2026 - 3));   // in step, but before the start
+
+  // And the weekday mask still applies: every other day, Mondays only, lands
+  // on every other Monday
+  r.every_n_days = 2;
+  r.weekdays = WEEKDAY_BIT(1);
+  HOST_CHECK(!r.occursOn(NOV_01_2026 + 1));
+  HOST_CHECK(r.occursOn(NOV_01_2026 + 8));
+  HOST_CHECK(!r.occursOn(NOV_01_2026 + 10));
+  HOST_CHECK(!r.occursOn(NOV_01_2026 + 15));
+  HOST_CHECK(r.occursOn(NOV_01_2026 + 22));
+
+  // Without a start the step counts from day 0
+  r = RECURRENCE_DAILY;
+  r.every_n_days = 2;
+  HOST_CHECK(r.occursOn(NOV_01_2026));
+  HOST_CHECK(!r.occursOn(NOV_01_2026 + 1));
+}
+
+ScheduleIndex<4> index;
+
+void expand(uint32_t start, uint32_t end, const ScheduleRecurrence& r, int32_t day) {
+  index.clear();
+  addWindowForDay(index, start, end, r, day);
+  index.seal();
+}
+
+void testOvernightSpill() {
+  const uint32_t start = 23 * 3600, end = 1 * 3600;
+  const int32_t monday = NOV_01_2026 + 1;
+  ScheduleRecurrence r = RECURRENCE_DAILY;
+  r.weekdays = WEEKDAY_BIT(1);
+
+  // Monday night is [23:00, 24:00)
+  expand(start, end, r, monday);
+  HOST_CHECK_EQ(index.count(), 1);
+  HOST_CHECK(!index.activeAt(0));
+  HOST_CHECK(!index.activeAt(start - 1));
+  HOST_CHECK(index.activeAt(start));
+  HOST_CHECK(index.activeAt(SECONDS_PER_DAY - 1));
+
+  // and [00:00, 01:00) on Tuesday, which is not in the mask itself
+  expand(start, end, r, monday + 1);
+  HOST_CHECK_EQ(index.count(), 1);
+  HOST_CHECK(index.activeAt(0));
+  HOST_CHECK(index.activeAt(end - 1));
+  HOST_CHECK(!index.activeAt(end));
+  HOST_CHECK(!index.activeAt(start));
+
+  // Tuesday night started on an excluded day: nothing on Wednesday, and
+  // nothing on Monday morning from the Sunday before
+  expand(start, end, r, monday + 2);
+  HOST_CHECK_EQ(index.count(), 0);
+  HOST_CHECK(!index.activeAt(0));
+  expand(start, end, r, monday);
+  HOST_CHECK(!index.activeAt(0));
+
+  // The last night of a bounded schedule still ends the next morning
+  r = RECURRENCE_DAILY;
+  r.valid_until = monday;
+  expand(start, end, r, monday + 1);
+  HOST_CHECK(index.activeAt(0));
+  HOST_CHECK(!index.activeAt(start));
+
+  // Every night from Monday on: Tuesday has both halves, the Monday
+  // morning before the first night has none
+  r = RECURRENCE_DAILY;
+  r.valid_from = monday;
+  expand(start, end, r, monday + 1);
+  HOST_CHECK_EQ(index.count(), 2);
+  HOST_CHECK(index.activeAt(0));
+  HOST_CHECK(index.activeAt(start));
+  HOST_CHECK(!index.activeAt(12 * 3600));
+  expand(start, end, r, monday);
+  HOST_CHECK(!index.activeAt(0));
+
+  // A window inside the day never spills
+  expand(6 * 3600, 7 * 3600, RECURRENCE_DAILY, monday);
+  HOST_CHECK_EQ(index.count(), 1);
+  HOST_CHECK(!index.activeAt(0));
+}
+
+}  // namespace
+
+int main() {
+  testCivilDays();
+  testParseDay();
+  testWeekdays();
+  testBounds();
+  testEveryNDays();
+  testOvernightSpill();
+  return hostTestExit();
+}
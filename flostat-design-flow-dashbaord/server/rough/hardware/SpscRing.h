@@ -0,0 +1,57 @@
+// SpscRing.h
+// Wait-free single-producer/single-consumer ring. One task pushes, one other
+// task consumes; neither ever blocks or takes a lock, and a full ring is
+// reported to the producer instead of overwriting.
+//
+//   SpscRing<ScheduleCommand, 16> ring;
+//   ring.push(cmd);                      // producer, false when full
+//   while (ScheduleCommand* c = ring.front()) {
+//     apply(*c);                         // consumer, slot stays reserved...
+//     ring.pop();                        // ...until it is released here
+//   }
+//
+// Because the consumer releases a slot only after it is done with it, the
+// producer seeing empty() also means every pushed item has been fully
+// handled, and whatever the consumer wrote while handling it is visible.
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+ public:
+  // Producer side
+  bool push(const T& item) {
+    uint32_t h = head_.load(std::memory_order_relaxed);
+    if (h - tail_.load(std::memory_order_acquire) == N) return false;
+    slots_[h & (N - 1)] = item;
+    head_.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Producer side: true once the consumer has released everything pushed
+  bool empty() const {
+    return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_relaxed);
+  }
+
+  // Consumer side: oldest item, nullptr when there is none
+  T* front() {
+    uint32_t t = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) == t) return nullptr;
+    return &slots_[t & (N - 1)];
+  }
+
+  // Consumer side: release the item returned by front()
+  void pop() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+ private:
+  T slots_[N];
+  std::atomic<uint32_t> head_{0};  // next slot to write, producer only
+  std::atomic<uint32_t> tail_{0};  // next slot to read, consumer only
+};
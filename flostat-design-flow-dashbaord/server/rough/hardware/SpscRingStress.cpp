@@ -0,0 +1,131 @@
+// SpscRingStress.cpp
+// SpscRing under two real threads, the way check1311_2.cpp uses it: the
+// producer (network task) pushes random upsert/remove commands into a
+// 16-slot ring and retries when it is full; the consumer (control task)
+// applies them to its store. The producer keeps a model of the store, and
+// every SNAPSHOT_EVERY pushes it waits for empty() and compares: empty()
+// must mean every command was applied and its writes are visible. Each
+// command also carries a sequence number and a checksum over its payload,
+// so a reordered or torn slot is caught on the spot.
+#include <Arduino.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+
+#include "HostTest.h"
+#include "SpscRing.h"
+
+#define STRESS_COMMANDS  1000000
+#define SNAPSHOT_EVERY   4096
+#define STORE_IDS        64
+#define RING_LEN         16
+
+namespace {
+
+enum Op : uint8_t { OP_UPSERT, OP_REMOVE };
+
+// Big enough that a slot copy is several words, like a ScheduleCommand
+struct Command {
+  uint32_t seq;
+  uint8_t op;
+  uint8_t id;
+  uint32_t value[8];
+  uint32_t check;
+};
+
+uint32_t checksum(const Command& c) {
+  uint32_t h = c.seq * 2654435761u ^ c.op ^ (c.id << 8);
+  for (uint32_t v : c.value) h = (h ^ v) * 16777619u;
+  return h;
+}
+
+struct Store {
+  bool present[STORE_IDS];
+  uint32_t value[STORE_IDS];
+};
+
+SpscRing<Command, RING_LEN> ring;
+Store consumerStore;                        // consumer only, read by the producer on empty()
+std::atomic<bool> done{ false };
+std::atomic<uint32_t> orderErrors{ 0 };
+std::atomic<uint32_t> tornSlots{ 0 };
+
+void consumer() {
+  uint32_t expect = 0;
+  for (;;) {
+    Command* c = ring.front();
+    if (!c) {
+      if (done.load(std::memory_order_acquire) && ring.empty()) return;
+      std::this_thread::yield();
+      continue;
+    }
+    if (c->seq != expect) orderErrors++;
+    if (c->check != checksum(*c)) tornSlots++;
+    expect = c->seq + 1;
+    if (c->op == OP_UPSERT) {
+      consumerStore.present[c->id] = true;
+      consumerStore.value[c->id] = c->value[0];
+    } else {
+      consumerStore.present[c->id] = false;
+    }
+    ring.pop();
+  }
+}
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  Store model = {};
+  std::mt19937 rng(20);
+  uint64_t fullRetries = 0;
+  uint32_t snapshots = 0, mismatches = 0;
+
+  double t0 = hostWallNs();
+  std::thread c(consumer);
+  for (uint32_t seq = 0; seq < STRESS_COMMANDS; seq++) {
+    Command cmd = {};
+    cmd.seq = seq;
+    cmd.op = rng() % 3 == 0 ? OP_REMOVE : OP_UPSERT;
+    cmd.id = rng() % STORE_IDS;
+    for (uint32_t& v : cmd.value) v = rng();
+    cmd.check = checksum(cmd);
+    while (!ring.push(cmd)) {
+      fullRetries++;
+      std::this_thread::yield();
+    }
+    if (cmd.op == OP_UPSERT) {
+      model.present[cmd.id] = true;
+      model.value[cmd.id] = cmd.value[0];
+    } else {
+      model.present[cmd.id] = false;
+    }
+
+    if ((seq + 1) % SNAPSHOT_EVERY == 0) {
+      while (!ring.empty()) std::this_thread::yield();
+      for (int i = 0; i < STORE_IDS; i++) {
+        bool same = model.present[i] == consumerStore.present[i] &&
+                    (!model.present[i] || model.value[i] == consumerStore.value[i]);
+        mismatches += !same;
+      }
+      snapshots++;
+    }
+  }
+  done.store(true, std::memory_order_release);
+  c.join();
+  double ms = (hostWallNs() - t0) / 1e6;
+
+  printf("%u commands through a %u-slot ring in %.0f ms (%.1f M/s)\n", (unsigned)STRESS_COMMANDS, (unsigned)RING_LEN,
+         ms, STRESS_COMMANDS / ms / 1000);
+  printf("  %u snapshots, %u mismatches, %u ordering errors, %u torn slots, %llu full-ring retries\n",
+         (unsigned)snapshots, (unsigned)mismatches, (unsigned)orderErrors.load(), (unsigned)tornSlots.load(),
+         (unsigned long long)fullRetries);
+
+  HOST_CHECK_EQ(snapshots, STRESS_COMMANDS / SNAPSHOT_EVERY);
+  HOST_CHECK_EQ(mismatches, 0);
+  HOST_CHECK_EQ(orderErrors.load(), 0);
+  HOST_CHECK_EQ(tornSlots.load(), 0);
+  HOST_CHECK(ring.empty());
+  return hostTestExit();
+}
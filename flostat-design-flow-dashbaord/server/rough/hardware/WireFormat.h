@@ -0,0 +1,356 @@
+// WireFormat.h
+// Compact MessagePack encoding of device traffic, shared with
+// server/utils/wireFormat.js: {0: type, 1: data} with integer keys, 16 byte
+// binary UUIDs, schedule times as seconds of day and recurrence dates as
+// days since 1970. WireWriter and WireReader work on caller-owned buffers
+// and never allocate; decodeWireMessage() rebuilds the JSON-shaped document
+// so the handlers keep a single path.
+//
+//   uint8_t msg[96];
+//   WireWriter w(msg, sizeof(msg));
+//   w.begin(WIRE_SCHEDULE_ACK, 2);
+//   w.putKey(WK_SCHEDULE_ID);
+//   w.putUuid(scheduleId);
+//   w.putKey(WK_ACK);
+//   w.putBool(true);
+//   if (w.ok) client.publish(topic, msg, w.len);
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ScheduleIndex.h"
+#include "ScheduleRecurrence.h"
+
+// "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx" -> 16 bytes, false if malformed
+inline bool parseScheduleId(const char* s, uint8_t* id) {
+  if (s == nullptr) return false;
+  int nibbles = 0;
+  for (; *s && nibbles < 32; s++) {
+    if (*s == '-') continue;
+    uint8_t v;
+    if (*s >= '0' && *s <= '9') v = *s - '0';
+    else if (*s >= 'a' && *s <= 'f') v = *s - 'a' + 10;
+    else if (*s >= 'A' && *s <= 'F') v = *s - 'A' + 10;
+    else return false;
+    if (nibbles % 2 == 0) id[nibbles / 2] = v << 4;
+    else id[nibbles / 2] |= v;
+    nibbles++;
+  }
+  return nibbles == 32 && *s == '\0';
+}
+
+// 16 bytes -> canonical lower-case UUID, out must hold 37 chars
+inline void formatScheduleId(const uint8_t* id, char* out) {
+  static const char hex[] = "0123456789abcdef";
+  for (int i = 0; i < 16; i++) {
+    if (i == 4 || i == 6 || i == 8 || i == 10) *out++ = '-';
+    *out++ = hex[id[i] >> 4];
+    *out++ = hex[id[i] & 0x0F];
+  }
+  *out = '\0';
+}
+
+enum WireType : uint8_t {
+  WIRE_DEVICE_UPDATE = 1,
+  WIRE_DEVICE_STATUS,
+  WIRE_DEVICE_HELLO,
+  WIRE_SCHEDULE_ACK,
+  WIRE_SCHEDULE_ACK_UPDATE,
+  WIRE_SCHEDULE_ACK_DELETE,
+  WIRE_SCHEDULE_CREATED,
+  WIRE_SCHEDULE_UPDATE,
+  WIRE_SCHEDULE_DELETE,
+  WIRE_TYPE_COUNT
+};
+
+enum WireKey : uint8_t {
+  WK_ORG_ID = 1,
+  WK_DEVICE_ID,
+  WK_BLOCK_ID,
+  WK_SCHEDULE_ID,
+  WK_DEVICE_TYPE,     // ScheduleDeviceType, 3 = tank, 4 = sump
+  WK_DEVICE_TYPES,
+  WK_STATUS,
+  WK_SCHEDULE_STATUS,
+  WK_START_SEC,       // second of day
+  WK_END_SEC,
+  WK_ACK,
+  WK_CURRENT_LEVEL,
+  WK_WIFI_STRENGTH,
+  WK_BATTERY,
+  WK_WIRE,
+  WK_LAST_UPDATED,    // epoch seconds
+  WK_RECURRENCE,      // [weekdays, every_n_days, valid_from, valid_until], days since 1970, 0 = open
+  WIRE_KEY_COUNT
+};
+
+const char* const WIRE_TYPE_NAMES[WIRE_TYPE_COUNT] = {
+  nullptr, "DEVICE_UPDATE", "DEVICE_STATUS", "DEVICE_HELLO",
+  "SCHEDULE_ACK", "SCHEDULE_ACK_UPDATE", "SCHEDULE_ACK_DELETE",
+  "SCHEDULE_CREATED", "SCHEDULE_UPDATE", "SCHEDULE_DELETE"
+};
+
+// JSON names of the data keys; the decoder rebuilds the JSON-shaped document
+const char* const WIRE_KEY_NAMES[WIRE_KEY_COUNT] = {
+  nullptr, "org_id", "device_id", "block_id", "schedule_id", "device_type",
+  "device_types", "status", "schedule_status", "start_time", "end_time",
+  "ack", "current_level", "wifi_strength", "battery", "wire", "last_updated",
+  "recurrence"
+};
+
+const char* const WIRE_DEVICE_TYPE_NAMES[] = { "", "valve", "pump", "tank", "sump" };
+
+// Appends to a caller-owned buffer; ok drops to false on overflow
+struct WireWriter {
+  uint8_t* buf;
+  size_t cap;
+  size_t len;
+  bool ok;
+
+  WireWriter(uint8_t* b, size_t c) : buf(b), cap(c), len(0), ok(true) {}
+
+  void put(const void* p, size_t n) {
+    if (!ok || len + n > cap) {
+      ok = false;
+      return;
+    }
+    memcpy(buf + len, p, n);
+    len += n;
+  }
+  void putByte(uint8_t b) { put(&b, 1); }
+  void putMap(uint8_t n) { putByte(0x80 | n); }    // n < 16
+  void putArray(uint8_t n) { putByte(0x90 | n); }  // n < 16
+  void putBool(bool v) { putByte(v ? 0xC3 : 0xC2); }
+  void putUint(uint32_t v) {
+    if (v < 0x80) {
+      putByte(v);
+    } else if (v < 0x100) {
+      uint8_t b[2] = { 0xCC, (uint8_t)v };
+      put(b, 2);
+    } else if (v < 0x10000) {
+      uint8_t b[3] = { 0xCD, (uint8_t)(v >> 8), (uint8_t)v };
+      put(b, 3);
+    } else {
+      uint8_t b[5] = { 0xCE, (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+      put(b, 5);
+    }
+  }
+  void putStr(const char* s) {
+    size_t n = strlen(s);
+    if (n < 32) {
+      putByte(0xA0 | n);
+    } else if (n < 0x100) {
+      putByte(0xD9);
+      putByte(n);
+    } else {
+      ok = false;
+      return;
+    }
+    put(s, n);
+  }
+  void putBin(const uint8_t* p, uint8_t n) {
+    putByte(0xC4);
+    putByte(n);
+    put(p, n);
+  }
+  // UUIDs go out as 16 raw bytes; anything else (e.g. "none") as a string
+  void putUuid(const char* s) {
+    uint8_t id[16];
+    if (parseScheduleId(s, id)) putBin(id, 16);
+    else putStr(s);
+  }
+  void putKey(WireKey k) { putByte(k); }
+  // Start of every message: {0: type, 1: {<fields> entries}}
+  void begin(WireType type, uint8_t fields) {
+    putMap(2);
+    putByte(0);
+    putByte(type);
+    putByte(1);
+    putMap(fields);
+  }
+};
+
+// Reads the MessagePack subset WireWriter and the cloud emit
+struct WireReader {
+  const uint8_t* p;
+  const uint8_t* end;
+  bool ok;
+
+  WireReader(const uint8_t* b, size_t n) : p(b), end(b + n), ok(true) {}
+
+  uint8_t getByte() {
+    if (p >= end) {
+      ok = false;
+      return 0;
+    }
+    return *p++;
+  }
+  const uint8_t* take(size_t n) {
+    if ((size_t)(end - p) < n) {
+      ok = false;
+      p = end;
+      return nullptr;
+    }
+    const uint8_t* at = p;
+    p += n;
+    return at;
+  }
+  uint32_t getUint() {
+    uint8_t b = getByte();
+    if (b < 0x80) return b;
+    int n = b == 0xCC ? 1 : b == 0xCD ? 2 : b == 0xCE ? 4 : 0;
+    if (n == 0) {
+      ok = false;
+      return 0;
+    }
+    const uint8_t* v = take(n);
+    uint32_t out = 0;
+    for (int i = 0; v && i < n; i++) out = (out << 8) | v[i];
+    return out;
+  }
+  // String or binary payload; isBin says which
+  const uint8_t* getBytes(size_t& n, bool& isBin) {
+    uint8_t b = getByte();
+    isBin = b == 0xC4;
+    if ((b & 0xE0) == 0xA0) n = b & 0x1F;
+    else if (b == 0xD9 || b == 0xC4) n = getByte();
+    else {
+      ok = false;
+      return nullptr;
+    }
+    return take(n);
+  }
+  int getMap() {
+    uint8_t b = getByte();
+    if ((b & 0xF0) != 0x80) ok = false;
+    return b & 0x0F;
+  }
+  int getArray() {
+    uint8_t b = getByte();
+    if ((b & 0xF0) != 0x90) ok = false;
+    return b & 0x0F;
+  }
+  void skip() {
+    uint8_t b = getByte();
+    if (b < 0x80 || b >= 0xE0 || b == 0xC0 || b == 0xC2 || b == 0xC3) return;
+    if ((b & 0xF0) == 0x80 || (b & 0xF0) == 0x90) {
+      int items = (b & 0x0F) * ((b & 0xF0) == 0x80 ? 2 : 1);
+      for (int i = 0; i < items && ok; i++) skip();
+    } else if ((b & 0xE0) == 0xA0) take(b & 0x1F);
+    else if (b == 0xD9 || b == 0xC4) take(getByte());
+    else if (b == 0xCC) take(1);
+    else if (b == 0xCD) take(2);
+    else if (b == 0xCE) take(4);
+    else ok = false;
+  }
+};
+
+#ifdef ARDUINOJSON_VERSION
+// Rebuild the JSON-shaped {type, data} document from a binary command, so
+// the schedule handlers keep a single code path
+inline bool decodeWireMessage(const uint8_t* payload, size_t length, JsonDocument& doc) {
+  WireReader r(payload, length);
+  JsonObject data = doc.createNestedObject("data");
+  int entries = r.getMap();
+  for (int i = 0; i < entries && r.ok; i++) {
+    uint32_t key = r.getUint();
+    if (key == 0) {
+      uint32_t type = r.getUint();
+      if (type == 0 || type >= WIRE_TYPE_COUNT) return false;
+      doc["type"] = WIRE_TYPE_NAMES[type];
+      continue;
+    }
+    if (key != 1) {
+      r.skip();
+      continue;
+    }
+
+    int fields = r.getMap();
+    for (int f = 0; f < fields && r.ok; f++) {
+      uint32_t k = r.getUint();
+      const char* name = k < WIRE_KEY_COUNT ? WIRE_KEY_NAMES[k] : nullptr;
+      if (!name) {
+        r.skip();
+        continue;
+      }
+      switch (k) {
+        case WK_ORG_ID:
+        case WK_DEVICE_ID:
+        case WK_BLOCK_ID:
+        case WK_SCHEDULE_ID:
+        case WK_STATUS:
+        case WK_SCHEDULE_STATUS:
+        case WK_WIRE: {
+          size_t n;
+          bool isBin;
+          const uint8_t* v = r.getBytes(n, isBin);
+          char text[64];  // char* (not const) so ArduinoJson copies it
+          if (!v) break;
+          if (isBin && n == 16) {
+            formatScheduleId(v, text);
+          } else {
+            size_t c = n < sizeof(text) ? n : sizeof(text) - 1;
+            memcpy(text, v, c);
+            text[c] = '\0';
+          }
+          data[name] = text;
+          break;
+        }
+        case WK_DEVICE_TYPE: {
+          uint32_t t = r.getUint();
+          data[name] = t < 5 ? WIRE_DEVICE_TYPE_NAMES[t] : "";
+          break;
+        }
+        case WK_START_SEC:
+        case WK_END_SEC: {
+          char hhmmss[12];
+          uint32_t sec = r.getUint() % SECONDS_PER_DAY;
+          snprintf(hhmmss, sizeof(hhmmss), "%02u:%02u:%02u", (unsigned)(sec / 3600), (unsigned)(sec / 60 % 60),
+                   (unsigned)(sec % 60));
+          data[name] = hhmmss;
+          break;
+        }
+        case WK_ACK: {
+          uint8_t b = r.getByte();
+          data[name] = b == 0xC3;
+          break;
+        }
+        case WK_RECURRENCE: {
+          if (r.getArray() != 4) {
+            r.ok = false;
+            break;
+          }
+          JsonObject rec = data.createNestedObject(name);
+          rec["weekdays"] = r.getUint();
+          rec["every_n_days"] = r.getUint();
+          const char* bounds[2] = { "valid_from", "valid_until" };
+          for (const char* bound : bounds) {
+            uint32_t day = r.getUint();
+            char date[11];
+            if (day == 0) {
+              rec[bound] = nullptr;
+              continue;
+            }
+            formatDay(day, date);
+            rec[bound] = date;
+          }
+          break;
+        }
+        case WK_CURRENT_LEVEL:
+        case WK_WIFI_STRENGTH:
+        case WK_BATTERY:
+        case WK_LAST_UPDATED:
+          data[name] = r.getUint();
+          break;
+        default:
+          r.skip();
+          break;
+      }
+    }
+  }
+  return r.ok && !doc["type"].isNull() && !doc.overflowed();
+}
+#endif
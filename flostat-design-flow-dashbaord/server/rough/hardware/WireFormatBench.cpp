@@ -0,0 +1,281 @@
+// WireFormatBench.cpp
+// Size and time of the compact wire format (WireFormat.h,
+// DeviceTelemetry.h) against JSON, for the three messages a device sends or
+// gets most:
+//   DEVICE_UPDATE     encodeTelemetryWire() vs encodeTelemetryJson(), and
+//                     the ArduinoJson serializeJson() it replaced
+//   SCHEDULE_ACK      WireWriter vs the snprintf in sendScheduleAck()
+//   SCHEDULE_CREATED  decodeWireMessage() vs deserializeJson() of what the
+//                     Scheduler publishes
+// Each wire message must decode to the same fields as its JSON twin and be
+// at most half its size; wire encoding must not allocate. The ArduinoJson
+// rows need ArduinoJson; without it only the wire walk is timed on decode.
+#if __has_include(<ArduinoJson.h>)
+#include <ArduinoJson.h>
+#endif
+#include <Arduino.h>
+
+#include "DeviceTelemetry.h"
+#include "HostHeap.h"
+#include "HostTest.h"
+#include "WireFormat.h"
+
+#define BENCH_ITERATIONS 200000
+
+namespace {
+
+const char* ORG_ID = "b595d605-fe74-416c-88c0-0e88ed280e56";
+const char* DEVICE_ID = "5ed59de5-6191-4900-9bd3-41a204bdf4f1";
+const char* BLOCK_ID = "816613d0-fc2f-46ed-973b-6ced08798784";
+const char* SCHEDULE_ID = "0c6f7a52-1d7e-4b8a-9f0e-2a4d3c5b6e71";
+
+struct Timing {
+  double ns;
+  double allocs;
+};
+
+template <typename Fn>
+Timing timeIt(int iterations, Fn&& fn) {
+  uint64_t a0 = hostHeapStats().allocs;
+  double t0 = hostWallNs();
+  size_t sink = 0;
+  for (int i = 0; i < iterations; i++) sink += fn(i);
+  double ns = (hostWallNs() - t0) / iterations;
+  hostKeep(sink);
+  return { ns, (double)(hostHeapStats().allocs - a0) / iterations };
+}
+
+void row(const char* name, size_t bytes, const Timing& t) {
+  printf("  %-16s %4zu B  %8.1f ns  %5.2f allocs\n", name, bytes, t.ns, t.allocs);
+}
+
+// ---- DEVICE_UPDATE
+void benchDeviceUpdate() {
+  DeviceTelemetry t = { ORG_ID, DEVICE_ID, "tank", 70, 84, 91, 1792224000 };
+  char json[320];
+  uint8_t wire[69];
+  size_t jsonLen = encodeTelemetryJson(t, json);
+  size_t wireLen = encodeTelemetryWire(t, wire);
+  HOST_CHECK(jsonLen > 0 && wireLen > 0);
+
+  // Read back: the same fields, same values
+  WireReader r(wire, wireLen);
+  HOST_CHECK_EQ(r.getMap(), 2);
+  HOST_CHECK_EQ(r.getUint(), 0);
+  HOST_CHECK_EQ(r.getUint(), WIRE_DEVICE_UPDATE);
+  HOST_CHECK_EQ(r.getUint(), 1);
+  int fields = r.getMap();
+  HOST_CHECK_EQ(fields, 7);
+  for (int f = 0; f < fields && r.ok; f++) {
+    uint32_t k = r.getUint();
+    if (k == WK_DEVICE_ID || k == WK_ORG_ID) {
+      size_t n;
+      bool isBin;
+      const uint8_t* v = r.getBytes(n, isBin);
+      char id[37];
+      HOST_CHECK(v && isBin && n == 16);
+      if (!v || n != 16) break;
+      formatScheduleId(v, id);
+      HOST_CHECK(strcmp(id, k == WK_ORG_ID ? ORG_ID : DEVICE_ID) == 0);
+    } else {
+      uint32_t v = r.getUint();
+      uint32_t want = k == WK_DEVICE_TYPE ? 3 : k == WK_CURRENT_LEVEL ? 70 : k == WK_WIFI_STRENGTH ? 84
+                    : k == WK_BATTERY ? 91 : k == WK_LAST_UPDATED ? 1792224000 : 0xFFFFFFFF;
+      HOST_CHECK_EQ(v, want);
+    }
+  }
+  HOST_CHECK(r.ok && r.p == r.end);
+
+  Timing tj = timeIt(BENCH_ITERATIONS, [&](int i) {
+    t.current_level = i % 101;
+    return encodeTelemetryJson(t, json);
+  });
+  Timing tw = timeIt(BENCH_ITERATIONS, [&](int i) {
+    t.current_level = i % 101;
+    return encodeTelemetryWire(t, wire);
+  });
+
+  printf("DEVICE_UPDATE encode\n");
+  row("json (direct)", jsonLen, tj);
+  row("wire", wireLen, tw);
+#ifdef ARDUINOJSON_VERSION
+  char iso[24];
+  struct tm utc;
+  gmtime_r(&t.timestamp, &utc);
+  strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%SZ", &utc);
+  Timing ta = timeIt(BENCH_ITERATIONS, [&](int i) {
+    StaticJsonDocument<512> doc;
+    doc["type"] = "DEVICE_UPDATE";
+    JsonObject data = doc.createNestedObject("data");
+    data["device_id"] = t.device_id;
+    data["org_id"] = t.org_id;
+    data["device_type"] = t.device_type;
+    data["last_updated"] = iso;
+    data["current_level"] = i % 101;
+    data["wifi_strength"] = t.wifi_strength;
+    data["battery"] = t.battery;
+    data["source"] = "hardware";
+    data["updated_by"] = "hardware";
+    doc["updated_by"] = "hardware";
+    return serializeJson(doc, json, sizeof(json));
+  });
+  row("ArduinoJson", jsonLen, ta);
+#endif
+
+  HOST_CHECK_LE(wireLen * 2, jsonLen);
+  HOST_CHECK_EQ(tw.allocs, 0);
+}
+
+// ---- SCHEDULE_ACK
+size_t encodeAckWire(uint8_t* buf, size_t cap) {
+  WireWriter w(buf, cap);
+  w.begin(WIRE_SCHEDULE_ACK, 5);
+  w.putKey(WK_SCHEDULE_ID);
+  w.putUuid(SCHEDULE_ID);
+  w.putKey(WK_ORG_ID);
+  w.putUuid(ORG_ID);
+  w.putKey(WK_SCHEDULE_STATUS);
+  w.putStr("CREATING");
+  w.putKey(WK_DEVICE_TYPES);
+  w.putArray(2);
+  w.putUint(2);   // pump
+  w.putUint(1);   // valve
+  w.putKey(WK_ACK);
+  w.putBool(true);
+  return w.ok ? w.len : 0;
+}
+
+size_t encodeAckJson(char* buf, size_t cap) {
+  int len = snprintf(buf, cap,
+                     "{\"type\":\"%s\",\"data\":{\"schedule_id\":\"%s\",\"org_id\":\"%s\",\"schedule_status\":\"%s\",\"device_types\":%s,\"ack\":true}}",
+                     WIRE_TYPE_NAMES[WIRE_SCHEDULE_ACK], SCHEDULE_ID, ORG_ID, "CREATING", "[\"pump\",\"valve\"]");
+  return len < (int)cap ? len : 0;
+}
+
+void benchScheduleAck() {
+  char json[256];
+  uint8_t wire[96];
+  size_t jsonLen = encodeAckJson(json, sizeof(json));
+  size_t wireLen = encodeAckWire(wire, sizeof(wire));
+  HOST_CHECK(jsonLen > 0 && wireLen > 0);
+
+  // A short buffer is reported, not overrun
+  uint8_t small[40];
+  HOST_CHECK_EQ(encodeAckWire(small, sizeof(small)), 0);
+
+  Timing tj = timeIt(BENCH_ITERATIONS, [&](int) { return encodeAckJson(json, sizeof(json)); });
+  Timing tw = timeIt(BENCH_ITERATIONS, [&](int) { return encodeAckWire(wire, sizeof(wire)); });
+
+  printf("SCHEDULE_ACK encode\n");
+  row("json (snprintf)", jsonLen, tj);
+  row("wire", wireLen, tw);
+
+  HOST_CHECK_LE(wireLen * 2, jsonLen);
+  HOST_CHECK_EQ(tw.allocs, 0);
+}
+
+// ---- SCHEDULE_CREATED, as controllers/Scheduler.js publishes it
+const char SCHEDULE_CREATED_JSON[] =
+    "{\"type\":\"SCHEDULE_CREATED\",\"data\":{\"schedule_id\":\"0c6f7a52-1d7e-4b8a-9f0e-2a4d3c5b6e71\","
+    "\"org_id\":\"b595d605-fe74-416c-88c0-0e88ed280e56\",\"block_id\":\"816613d0-fc2f-46ed-973b-6ced08798784\","
+    "\"device_type\":\"valve\",\"device_id\":\"5ed59de5-6191-4900-9bd3-41a204bdf4f1\",\"start_time\":\"06:00\","
+    "\"p_start_time\":\"05:59:30\",\"end_time\":\"06:30:15\",\"recurrence\":{\"weekdays\":62,\"every_n_days\":1,"
+    "\"valid_from\":\"2026-11-01\",\"valid_until\":null},\"schedule_status\":\"CREATING\",\"pump_ack\":false,"
+    "\"valve_ack\":false,\"acknowledge\":{\"valve_id\":\"5ed59de5-6191-4900-9bd3-41a204bdf4f1\","
+    "\"pump_id\":\"9a41c6d2-7b3e-4f05-8c1d-e2f3a4b5c6d7\"},\"created_by\":\"user@org\","
+    "\"safety_offset\":{\"pre\":30,\"post\":30}},\"timestamp\":\"2026-10-17T09:12:44.120Z\"}";
+
+// What server/utils/wireFormat.js encodeWireMessage() makes of the above
+size_t encodeScheduleCreatedWire(uint8_t* buf, size_t cap) {
+  WireWriter w(buf, cap);
+  w.begin(WIRE_SCHEDULE_CREATED, 8);
+  w.putKey(WK_SCHEDULE_ID);
+  w.putUuid(SCHEDULE_ID);
+  w.putKey(WK_ORG_ID);
+  w.putUuid(ORG_ID);
+  w.putKey(WK_BLOCK_ID);
+  w.putUuid(BLOCK_ID);
+  w.putKey(WK_DEVICE_TYPE);
+  w.putUint(1);   // valve
+  w.putKey(WK_DEVICE_ID);
+  w.putUuid(DEVICE_ID);
+  w.putKey(WK_START_SEC);
+  w.putUint(6 * 3600);
+  w.putKey(WK_END_SEC);
+  w.putUint(6 * 3600 + 30 * 60 + 15);
+  w.putKey(WK_RECURRENCE);
+  w.putArray(4);
+  w.putUint(62);
+  w.putUint(1);
+  w.putUint(dayFromCivil(2026, 11, 1));
+  w.putUint(0);
+  return w.ok ? w.len : 0;
+}
+
+// Every value checked, nothing built: the floor under any wire decoder
+size_t walkWire(const uint8_t* buf, size_t len) {
+  WireReader r(buf, len);
+  r.skip();
+  return r.ok && r.p == r.end ? len : 0;
+}
+
+void benchScheduleCreated() {
+  uint8_t wire[128];
+  size_t wireLen = encodeScheduleCreatedWire(wire, sizeof(wire));
+  size_t jsonLen = strlen(SCHEDULE_CREATED_JSON);
+  HOST_CHECK(wireLen > 0);
+  HOST_CHECK_EQ(walkWire(wire, wireLen), wireLen);
+  HOST_CHECK_EQ(walkWire(wire, wireLen - 1), 0);   // truncated
+
+  Timing tw = timeIt(BENCH_ITERATIONS, [&](int) { return walkWire(wire, wireLen); });
+
+  printf("SCHEDULE_CREATED decode\n");
+  row("wire (walk)", wireLen, tw);
+#ifdef ARDUINOJSON_VERSION
+  // Same document size as mqttCallback() in check1311_2.cpp
+  DynamicJsonDocument fromJson(2048), fromWire(2048);
+  HOST_CHECK(!deserializeJson(fromJson, (const uint8_t*)SCHEDULE_CREATED_JSON, jsonLen));
+  HOST_CHECK(decodeWireMessage(wire, wireLen, fromWire));
+  HOST_CHECK(strcmp(fromWire["type"] | "", fromJson["type"] | "") == 0);
+  const char* textFields[] = { "schedule_id", "org_id", "block_id", "device_type", "device_id" };
+  for (const char* f : textFields) HOST_CHECK(strcmp(fromWire["data"][f] | "", fromJson["data"][f] | "") == 0);
+  const char* timeFields[] = { "start_time", "end_time" };
+  for (const char* f : timeFields) {
+    HOST_CHECK_EQ(parseTimeToSeconds(fromWire["data"][f] | ""), parseTimeToSeconds(fromJson["data"][f] | ""));
+  }
+  JsonObject rw = fromWire["data"]["recurrence"], rj = fromJson["data"]["recurrence"];
+  HOST_CHECK_EQ(rw["weekdays"].as<int>(), rj["weekdays"].as<int>());
+  HOST_CHECK_EQ(rw["every_n_days"].as<int>(), rj["every_n_days"].as<int>());
+  HOST_CHECK(strcmp(rw["valid_from"] | "", rj["valid_from"] | "") == 0);
+  HOST_CHECK(rw["valid_until"].isNull() && rj["valid_until"].isNull());
+
+  StaticJsonDocument<2048> doc;
+  Timing tj = timeIt(BENCH_ITERATIONS / 10, [&](int) {
+    doc.clear();
+    return deserializeJson(doc, (const uint8_t*)SCHEDULE_CREATED_JSON, jsonLen) ? 0 : jsonLen;
+  });
+  Timing td = timeIt(BENCH_ITERATIONS / 10, [&](int) {
+    doc.clear();
+    return decodeWireMessage(wire, wireLen, doc) ? wireLen : 0;
+  });
+  row("ArduinoJson", jsonLen, tj);
+  row("wire -> doc", wireLen, td);
+  HOST_CHECK_EQ(td.allocs, 0);
+#endif
+
+  HOST_CHECK_LE(wireLen * 2, jsonLen);
+  HOST_CHECK_EQ(tw.allocs, 0);
+}
+
+}  // namespace
+
+int main() {
+  hostConsoleEcho(false);
+  benchDeviceUpdate();
+  benchScheduleAck();
+  benchScheduleCreated();
+#ifndef ARDUINOJSON_VERSION
+  printf("ArduinoJson not found, its rows are skipped\n");
+#endif
+  return hostTestExit();
+}
@@ -6,31 +6,154 @@
 #include <ArduinoJson.h>
 #include <PubSubClient.h>
 #include <time.h>
+#include <sys/time.h>
 #include <vector>
 #include <HardwareSerial.h>
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <esp_sntp.h>
+#include "SpscRing.h"
+#include "ScheduleRecurrence.h"
+#include "ScheduleIndex.h"
+#include "WireFormat.h"
+#include "ControlPeriod.h"
+#include "ScheduleEdgeClock.h"
 // #include <esp_task_wdt.h>
 
 
 // #define WDT_TIMEOUT      30      // Watchdog timeout in seconds
-// #define DEBUG_MODE       true    // Set to false to disable logs
+// Log level for this build: LOG_LEVEL_DEBUG on the bench, LOG_LEVEL_WARN in
+// the field. Anything above it is compiled out.
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+// Log messages: id, level, format. Arguments are 32-bit words, see FastLog.h;
+// UUIDs are logged by logShortId() and schedule times as HHMM.
+#define LOG_MESSAGES(X) \
+  X(LOG_SCHEDULE_MALFORMED,     LOG_LEVEL_WARN,  "⚠️ Ignoring malformed schedule %08lx") \
+  X(LOG_SCHEDULE_STORE_FULL,    LOG_LEVEL_WARN,  "⚠️ Schedule store full, ignoring schedule") \
+  X(LOG_SCHEDULE_ENTRY,         LOG_LEVEL_DEBUG, "⏱ %08lx | Start: %06lu | End: %06lu | Days: %02lx") \
+  X(LOG_SCHEDULE_INVALID,       LOG_LEVEL_WARN,  "⚠️ Skipping invalid schedule %08lx (%06lu - %06lu)") \
+  X(LOG_SCHEDULE_INDEX,         LOG_LEVEL_INFO,  "📇 Schedules for %04ld-%02lu-%02lu: %d interval(s)") \
+  X(LOG_COMMAND_QUEUE_FULL,     LOG_LEVEL_WARN,  "⚠️ Schedule command queue full, resyncing from cloud") \
+  X(LOG_SCHEDULE_TICK,          LOG_LEVEL_DEBUG, "🕒 Current Time: %02d:%02d:%02d") \
+  X(LOG_VALVE_ON,               LOG_LEVEL_INFO,  "✅ Pump turned ON by schedule") \
+  X(LOG_VALVE_OFF,              LOG_LEVEL_INFO,  "⛔ Pump turned OFF (schedule expired)") \
+  X(LOG_VALVE_NO_MATCH,         LOG_LEVEL_DEBUG, "🟡 No valve schedule match, preserving previous state") \
+  X(LOG_NEXT_EDGE,              LOG_LEVEL_DEBUG, "⏭ Next schedule edge in %lu ms (valve %s)") \
+  X(LOG_CONTROL_JITTER,         LOG_LEVEL_INFO,  "⏱ Control: %lu cycles, worst jitter %lu us (WiFi %s, MQTT %s)") \
+  X(LOG_STATUS_QUEUE_FULL,      LOG_LEVEL_WARN,  "⚠️ Status queue full, dropped oldest report") \
+  X(LOG_STATUS_PUBLISH_FAILED,  LOG_LEVEL_WARN,  "❌ DEVICE_STATUS publish failed, will retry") \
+  X(LOG_STATUS_SENT,            LOG_LEVEL_INFO,  "📤 DEVICE_STATUS %s %s") \
+  X(LOG_STATUS_PUT_START,       LOG_LEVEL_DEBUG, "📡 Sending PUT request to update the status") \
+  X(LOG_STATUS_PUT_FAILED,      LOG_LEVEL_WARN,  "❌ Failed to update the status, HTTP code: %d") \
+  X(LOG_STATUS_PUT_DONE,        LOG_LEVEL_INFO,  "✅ Got response in %lu ms (%u bytes)") \
+  X(LOG_SNAPSHOT_OPEN_FAILED,   LOG_LEVEL_ERROR, "❌ Cannot write schedule snapshot") \
+  X(LOG_SNAPSHOT_WRITE_FAILED,  LOG_LEVEL_ERROR, "❌ Schedule snapshot write failed") \
+  X(LOG_SNAPSHOT_SAVED,         LOG_LEVEL_INFO,  "💾 Schedule snapshot saved: %d schedule(s)") \
+  X(LOG_FS_MOUNT_FAILED,        LOG_LEVEL_ERROR, "❌ LittleFS mount failed, schedule snapshot disabled") \
+  X(LOG_SNAPSHOT_NONE,          LOG_LEVEL_INFO,  "💾 No schedule snapshot yet") \
+  X(LOG_SNAPSHOT_INVALID,       LOG_LEVEL_WARN,  "⚠️ Schedule snapshot invalid, waiting for cloud sync") \
+  X(LOG_SNAPSHOT_LOADED,        LOG_LEVEL_INFO,  "💾 Schedule snapshot loaded: %d schedule(s)") \
+  X(LOG_CLOCK_WAITING,          LOG_LEVEL_INFO,  "⏱ Clock not set, waiting for NTP") \
+  X(LOG_CLOCK_READY,            LOG_LEVEL_INFO,  "✅ Time: %02d:%02d:%02d") \
+  X(LOG_TIME_RESYNC_START,      LOG_LEVEL_INFO,  "🔄 Initiating periodic time re-sync...") \
+  X(LOG_TIME_RESYNC_DONE,       LOG_LEVEL_INFO,  "✅ Time re-synced: %02d:%02d") \
+  X(LOG_TIME_RESYNC_TIMEOUT,    LOG_LEVEL_WARN,  "❌ Time re-sync timed out.") \
+  X(LOG_MQTT_CONNECTING,        LOG_LEVEL_INFO,  "Connecting to AWS IoT...") \
+  X(LOG_MQTT_CONNECTED,         LOG_LEVEL_INFO,  "AWS IoT connected!") \
+  X(LOG_MQTT_CONNECT_FAILED,    LOG_LEVEL_WARN,  "AWS IoT connect failed, rc=%d") \
+  X(LOG_MQTT_MESSAGE,           LOG_LEVEL_DEBUG, "📩 MQTT Message Received: %u bytes") \
+  X(LOG_WIRE_DECODE_FAILED,     LOG_LEVEL_WARN,  "Wire decode failed") \
+  X(LOG_JSON_PARSE_FAILED,      LOG_LEVEL_WARN,  "JSON Parse failed: %s") \
+  X(LOG_SCHEDULE_MISSING_DATA,  LOG_LEVEL_WARN,  "Missing data for %s") \
+  X(LOG_SCHEDULE_CREATED,       LOG_LEVEL_INFO,  "✅ Schedule CREATED: %08lx") \
+  X(LOG_SCHEDULE_UPDATED,       LOG_LEVEL_INFO,  "✅ Schedule UPDATE: %08lx") \
+  X(LOG_SCHEDULE_DELETED,       LOG_LEVEL_INFO,  "✅ Schedule DELETE: %08lx") \
+  X(LOG_ACK_TOO_LARGE,          LOG_LEVEL_ERROR, "❌ ACK payload too large") \
+  X(LOG_ACK_SENT,               LOG_LEVEL_INFO,  "📤 Sent %s for %08lx") \
+  X(LOG_FETCH_START,            LOG_LEVEL_INFO,  "📡 Fetching schedules (%s)") \
+  X(LOG_FETCH_UNCHANGED,        LOG_LEVEL_INFO,  "✅ Schedules unchanged since last sync") \
+  X(LOG_FETCH_HTTP_FAILED,      LOG_LEVEL_WARN,  "❌ Failed to fetch schedules, HTTP code: %d") \
+  X(LOG_FETCH_NO_SCHEDULES,     LOG_LEVEL_WARN,  "⚠️ No 'schedules' array found in response.") \
+  X(LOG_FETCH_PARSE_FAILED,     LOG_LEVEL_WARN,  "❌ JSON parse error: %s") \
+  X(LOG_FETCH_SYNCED,           LOG_LEVEL_DEBUG, "✅ Synced Schedule ID: %08lx | Start: %06lu | End: %06lu") \
+  X(LOG_FETCH_NO_IDS,           LOG_LEVEL_WARN,  "⚠️ No 'schedule_ids' array found in response.") \
+  X(LOG_FETCH_IDS_PARSE_FAILED, LOG_LEVEL_WARN,  "❌ JSON parse error in schedule_ids") \
+  X(LOG_FETCH_DONE,             LOG_LEVEL_INFO,  "📋 %s sync: %d changed, valve schedules staged: %d")
+#include "FastLog.h"
 
 #define MAX_RETRIES 30
-#define MAX_SCHEDULES 60
-
-struct Schedule {
-  String start_time;
-  String end_time;
-  String schedule_id;
-  String device_type;
-  String device_id;
+#define MAX_SCHEDULES 256
+
+enum ScheduleDeviceType : uint8_t {
+  SCHEDULE_DEVICE_UNKNOWN = 0,
+  SCHEDULE_DEVICE_VALVE,
+  SCHEDULE_DEVICE_PUMP
+};
+
+// Fixed-size schedule record (32 bytes, no heap). Every stored schedule
+// targets this valve, so the device id is not kept. One record covers every
+// day its recurrence matches.
+struct __attribute__((packed)) Schedule {
+  uint8_t schedule_id[16];  // binary UUID
+  uint32_t start_sec;       // second of day
+  uint32_t end_sec;         // at or before start_sec: runs past midnight
+  uint8_t device_type;      // ScheduleDeviceType
+  ScheduleRecurrence recurrence;
+};
+
+// ---- Schedule store (used by executor)
+// Owned by the control task, which is the only writer. The network task
+// turns MQTT events and cloud syncs into ScheduleCommands; the control task
+// applies them at the top of its cycle. The network task may read the store
+// whenever scheduleCommands is empty, since only it can make it non-empty.
+Schedule valveSchedules[MAX_SCHEDULES];
+int valveScheduleCount = 0;
+
+enum ScheduleOp : uint8_t {
+  SCHEDULE_OP_UPSERT,   // add or replace `schedule`
+  SCHEDULE_OP_REMOVE,   // drop the record with schedule.schedule_id
+  SCHEDULE_OP_REPLACE   // swap in the whole stagedSchedules set
+};
+
+struct ScheduleCommand {
+  uint8_t op;  // ScheduleOp
+  Schedule schedule;
 };
 
-// ---- Vector stores (used by executor)
-std::vector<Schedule> valveSchedules;
+#define SCHEDULE_COMMAND_QUEUE_LEN 16
+
+SpscRing<ScheduleCommand, SCHEDULE_COMMAND_QUEUE_LEN> scheduleCommands;
+
+// A cloud sync is built here and handed over with one SCHEDULE_OP_REPLACE.
+// Left alone by the network task until the command has been applied.
+Schedule stagedSchedules[MAX_SCHEDULES];
+int stagedScheduleCount = 0;
+
+// Set by the control task after applying commands, the network task then
+// persists and prints the new set off the control path
+volatile bool scheduleStoreChanged = false;
+
+// Snapshot of the schedule store in flash, loaded before networking on boot
+#define SCHEDULE_STORE_PATH     "/schedules.bin"
+#define SCHEDULE_STORE_TMP_PATH "/schedules.tmp"
+#define SCHEDULE_STORE_MAGIC    0x48435346UL   // "FSCH"
+#define SCHEDULE_STORE_VERSION  3       // 2: records carry a recurrence, 3: times in seconds
+
+struct __attribute__((packed)) ScheduleStoreHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  char etag[32];        // scheduleVersion the records were synced at
+  char synced_at[32];   // scheduleSyncedAt
+  uint32_t crc;         // CRC32 of the header fields above and the records
+};
 
-// ---- Raw arrays used while parsing HTTP JSON
-String valveStart[MAX_SCHEDULES], valveEnd[MAX_SCHEDULES];
-int valveCount = 0;
+bool scheduleStoreReady = false;
+bool schedulesSynced = false;            // reconciled with the cloud since boot
+unsigned long lastScheduleFetchAttempt = 0;
+const unsigned long SCHEDULE_FETCH_RETRY_MS = 30000;
 
 #define MAX_HTTP_RETRIES 3
 #define HTTP_TIMEOUT_MS 2000
@@ -43,7 +166,6 @@ struct LogEntry {
 
 std::vector<LogEntry> offlineLogBuffer;
 
-unsigned long lastScheduleCheck = 0;
 unsigned long lastMqttReceived = 0;
 unsigned long lastMqttConnect = 0;
 
@@ -56,7 +178,15 @@ const int maxMqttFailures = 12;  // 12 * 5s = 60s
 
 
 bool initial_valve_state = false;
-const unsigned long scheduleInterval = 1000;  // Check every 1 second
+// Schedules only change state at start/end edges: a one-shot esp_timer is
+// armed for the exact microsecond of the next edge and wakes the control
+// task, instead of polling every second
+// Set from the network task, cleared by the control task
+volatile bool scheduleDirty = true;     // schedule set or clock changed, re-plan now
+esp_timer_handle_t scheduleEdgeTimer = nullptr;
+TaskHandle_t controlTaskHandle = nullptr;
+int64_t nextScheduleCheckUs = 0;        // esp_timer_get_time() of the next planned wake
+ScheduleEdgeClock scheduleEdgeClock;    // the edge that wake was planned for
 bool valveScheduleMatched = false;
 bool valveManuallyOverridden = false;
 bool valveIsOn = false;
@@ -68,10 +198,11 @@ bool valveIsOn = false;
 unsigned long lastTimeSync = 0;
 const unsigned long TIME_RESYNC_INTERVAL = 6UL * 60 * 60 * 1000;  // every 6 hours
 
-bool timeInitialized = false;
+volatile bool timeInitialized = false;
 bool timeSyncInProgress = false;
 unsigned long timeSyncStart = 0;
 const unsigned long TIME_SYNC_TIMEOUT = 10 * 1000;  // 10 seconds timeout
+const time_t MIN_VALID_EPOCH = 1700000000;         // anything earlier means the clock was never set
 
 
 // ==========================
@@ -104,8 +235,137 @@ int currentLevel = 10;
 const char* mqtt_server = "a3a6bcyydw1uzn-ats.iot.ap-south-1.amazonaws.com";
 const int mqtt_port = 8883;
 const char* thingName = "esp32_test";
-bool timeInRange(String nowStr, String start, String end) {
-  return nowStr >= start && nowStr < end;
+
+// ==========================
+// Schedule interval index
+// ==========================
+// The records that apply today are expanded into second-of-day intervals
+// (ScheduleIndex.h), so the per-edge check is a binary search with no
+// String copies or heap allocations. Recurrences are only looked at when
+// the index is rebuilt, after a change and once at midnight.
+#define SCHEDULE_INDEX_LEN  (2 * MAX_SCHEDULES)   // today's window + yesterday's spill past midnight
+
+ScheduleIndex<SCHEDULE_INDEX_LEN> scheduleIndex;
+int32_t scheduleIndexDay = -1;   // local day the index was expanded for, -1 = stale
+
+ScheduleDeviceType parseDeviceType(const char* t) {
+  if (t == nullptr) return SCHEDULE_DEVICE_UNKNOWN;
+  if (strcmp(t, "valve") == 0) return SCHEDULE_DEVICE_VALVE;
+  if (strcmp(t, "pump") == 0) return SCHEDULE_DEVICE_PUMP;
+  return SCHEDULE_DEVICE_UNKNOWN;
+}
+
+// {"weekdays":42,"every_n_days":1,"valid_from":"2026-11-01","valid_until":null},
+// as normalised by the cloud. Missing, or a legacy label such as "daily",
+// means every day, which is how those schedules always ran.
+bool parseRecurrence(JsonVariantConst v, ScheduleRecurrence& out) {
+  out = RECURRENCE_DAILY;
+  if (!v.is<JsonObjectConst>()) return true;
+
+  uint32_t weekdays = v["weekdays"] | WEEKDAYS_ALL;
+  uint32_t every = v["every_n_days"] | 1;
+  const char* from = v["valid_from"];
+  const char* until = v["valid_until"];
+  int32_t fromDay = from ? parseDay(from) : 0;
+  int32_t untilDay = until ? parseDay(until) : 0;
+  if (weekdays == 0 || weekdays > WEEKDAYS_ALL || every == 0 || every > RECURRENCE_MAX_EVERY_N_DAYS ||
+      fromDay < 0 || untilDay < 0 || (fromDay && untilDay && untilDay < fromDay)) {
+    return false;
+  }
+  out.weekdays = weekdays;
+  out.every_n_days = every;
+  out.valid_from = fromDay;
+  out.valid_until = untilDay;
+  return true;
+}
+
+// Build a record from the JSON fields, false if the id, a time or the
+// recurrence is malformed
+bool makeSchedule(const char* scheduleId, const char* start, const char* end, const char* deviceType,
+                  JsonVariantConst recurrence, Schedule& out) {
+  long startSec = parseTimeToSeconds(start);
+  long endSec = parseTimeToSeconds(end);
+  if (!parseScheduleId(scheduleId, out.schedule_id) || startSec < 0 || endSec < 0 ||
+      !parseRecurrence(recurrence, out.recurrence)) {
+    LOGF(LOG_SCHEDULE_MALFORMED, logShortId(scheduleId));
+    return false;
+  }
+  out.start_sec = startSec;
+  out.end_sec = endSec;
+  out.device_type = parseDeviceType(deviceType);
+  return true;
+}
+
+int findSchedule(const Schedule* list, int count, const uint8_t* id) {
+  for (int i = 0; i < count; i++) {
+    if (memcmp(list[i].schedule_id, id, sizeof(list[i].schedule_id)) == 0) return i;
+  }
+  return -1;
+}
+
+// Replace the record with the same id or append it, false if the list is full
+bool upsertSchedule(Schedule* list, int& count, const Schedule& sch) {
+  int i = findSchedule(list, count, sch.schedule_id);
+  if (i < 0) {
+    if (count >= MAX_SCHEDULES) {
+      LOGF(LOG_SCHEDULE_STORE_FULL);
+      return false;
+    }
+    i = count++;
+  }
+  list[i] = sch;
+  return true;
+}
+
+// Order does not matter (the index sorts), so the last record fills the gap
+void removeScheduleAt(Schedule* list, int& count, int i) {
+  list[i] = list[--count];
+}
+
+// Second of day as HHMMSS, how schedule times appear in the log
+uint32_t logHhmmss(uint32_t sec) {
+  return sec / 3600 * 10000 + sec / 60 % 60 * 100 + sec % 60;
+}
+
+void printSchedules() {
+  for (int i = 0; i < valveScheduleCount; i++) {
+    const Schedule& sch = valveSchedules[i];
+    LOGF(LOG_SCHEDULE_ENTRY, logShortId(sch.schedule_id), logHhmmss(sch.start_sec), logHhmmss(sch.end_sec),
+         sch.recurrence.weekdays);
+  }
+}
+
+// Call after every change to valveSchedules (fetch/create/update/delete);
+// the next evaluation expands the new set for the current day
+void invalidateScheduleIndex() {
+  scheduleIndexDay = -1;
+  scheduleDirty = true;
+}
+
+// Today's intervals, see addWindowForDay()
+void expandSchedulesForDay(int32_t day) {
+  scheduleIndex.clear();
+  for (int n = 0; n < valveScheduleCount; n++) {
+    const Schedule& sch = valveSchedules[n];
+    if (sch.start_sec == sch.end_sec) {
+      LOGF(LOG_SCHEDULE_INVALID, logShortId(sch.schedule_id), logHhmmss(sch.start_sec), logHhmmss(sch.end_sec));
+      continue;
+    }
+    addWindowForDay(scheduleIndex, sch.start_sec, sch.end_sec, sch.recurrence, day);
+  }
+  scheduleIndex.seal();
+  scheduleIndexDay = day;
+
+  int32_t y;
+  uint32_t m, d;
+  civilFromDay(day, y, m, d);
+  LOGF(LOG_SCHEDULE_INDEX, y, m, d, scheduleIndex.count());
+}
+
+// Expand for the local day of t unless the index already is
+void refreshScheduleIndex(const struct tm& t) {
+  int32_t day = dayFromCivil(t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+  if (day != scheduleIndexDay) expandSchedulesForDay(day);
 }
 
 // Certificates (properly formatted)
@@ -274,98 +534,482 @@ const char* statusTopic = "TOPIC";
 // const char* acc2 = "flostat/58825c71-76ea-4140-8496-693ea1c27818/command/f3804ca6-e5f9-4b50-9ed7-dd66e53114e2/valve/3a2ed442-10a6-46a5-924b-dda349509ef3/hardware";
 const char* acc1 = "flostat/b595d605-fe74-416c-88c0-0e88ed280e56/command/816613d0-fc2f-46ed-973b-6ced08798784/valve/5ed59de5-6191-4900-9bd3-41a204bdf4f1";
 const char* acc2 = "flostat/b595d605-fe74-416c-88c0-0e88ed280e56/command/816613d0-fc2f-46ed-973b-6ced08798784/valve/5ed59de5-6191-4900-9bd3-41a204bdf4f1/hardware";
-
-//  sch_url_ https://us9si083nf.execute-api.ap-south-1.amazonaws.com/api/v1/org/getScheduleByOrgId | org_id
-const char* scheduleAPI = "https://us9si083nf.execute-api.ap-south-1.amazonaws.com/api/v1/org/getScheduleByOrgId";
+// Device state reports (DEVICE_STATUS), consumed by the deviceStatus lambda
+const char* deviceStatusTopic = "flostat/b595d605-fe74-416c-88c0-0e88ed280e56/status/816613d0-fc2f-46ed-973b-6ced08798784/valve/5ed59de5-6191-4900-9bd3-41a204bdf4f1";
+// Same topics for the compact wire format (WIRE_FORMAT_MSGPACK)
+const char* acc1Wire = "flostat/b595d605-fe74-416c-88c0-0e88ed280e56/command/816613d0-fc2f-46ed-973b-6ced08798784/valve/5ed59de5-6191-4900-9bd3-41a204bdf4f1/mp";
+const char* deviceStatusTopicWire = "flostat/b595d605-fe74-416c-88c0-0e88ed280e56/status/816613d0-fc2f-46ed-973b-6ced08798784/valve/5ed59de5-6191-4900-9bd3-41a204bdf4f1/mp";
+
+//  sch_url_ https://us9si083nf.execute-api.ap-south-1.amazonaws.com/api/v1/org/getScheduleByDeviceId | org_id, device_id, since
+const char* scheduleAPI = "https://us9si083nf.execute-api.ap-south-1.amazonaws.com/api/v1/org/getScheduleByDeviceId";
 const char* updateDeviceStatusApi = "https://us9si083nf.execute-api.ap-south-1.amazonaws.com/api/v1/device/updateDeviceStatus";
 // String org_id = "58825c71-76ea-4140-8496-693ea1c27818";
 // String valve_id = "3a2ed442-10a6-46a5-924b-dda349509ef3";
 String org_id = "b595d605-fe74-416c-88c0-0e88ed280e56";
 String valve_id = "5ed59de5-6191-4900-9bd3-41a204bdf4f1";
 String pump_id = "";
+// Last schedule set we synced: ETag from the server and the newest change it covered
+String scheduleVersion = "";
+String scheduleSyncedAt = "";
 WiFiClientSecure espClient;
 PubSubClient client(espClient);
 
+// ==========================
+// API session
+// ==========================
+// All REST calls share one TLS client and HTTPClient. With reuse on, end()
+// leaves the socket open, so the next request to the API Gateway host skips
+// the TLS handshake and costs a single round trip.
+WiFiClientSecure apiClient;
+HTTPClient apiHttp;
+SemaphoreHandle_t apiLock;  // the network task and the status worker both use apiHttp
+
+// stream=true asks for HTTP/1.0 (plain, unchunked body) and closes afterwards
+bool beginApiRequest(const char* url, bool stream) {
+  static bool initialized = false;
+  if (!initialized) {
+    apiClient.setInsecure();  // no CA pinned for the REST API, as before
+    initialized = true;
+  }
+  apiHttp.useHTTP10(stream);
+  apiHttp.setReuse(!stream);
+  return apiHttp.begin(apiClient, url);
+}
+
+// ==========================
+// Compact wire format
+// ==========================
+// Optional MessagePack encoding, shared with server/utils/wireFormat.js:
+// {0: type, 1: data} with integer keys, 16 byte binary UUIDs and
+// second-of-day times. Binary uplink goes to "<topic>/mp". Downlink is told
+// apart by its first byte, since JSON always starts with '{'. DEVICE_HELLO
+// tells the cloud which format to send us. The codec is in WireFormat.h.
+// JSON by default: MessagePack needs the "/mp" IoT rules deployed first.
+#define WIRE_FORMAT_JSON     0
+#define WIRE_FORMAT_MSGPACK  1
+#define WIRE_FORMAT          WIRE_FORMAT_JSON
+
 // ==========================
 // Function declarations
 // ==========================
 void setupTime();
 void connectAWS();
 void mqttCallback(char* topic, byte* payload, unsigned int length);
-void handleScheduleCreatedPayload(String payload);
-void handleScheduleUpdatePayload(String payload);
-void handleScheduleDeletePayload(String payload);
-void sendScheduleAck(String scheduleId, String orgId, String deviceType);
-void sendScheduleUpdateAck(String scheduleId, String orgId, String deviceType);
-void sendScheduleDeleteAck(String scheduleId, String orgId, String deviceType);
+void handleScheduleCreatedPayload(JsonObject data);
+void handleScheduleUpdatePayload(JsonObject data);
+void handleScheduleDeletePayload(JsonObject data);
+void sendScheduleAck(WireType ackType, const String& scheduleId, const String& orgId, const String& scheduleStatus);
+void publishDeviceHello();
 void publishDeviceUpdate();
 void checkAndTriggerSchedules();
-void fetchFilteredSchedules(const char* url, const String& org_id, const String& device_id, int& count);
-void updateDeviceStatus(const char* url, const String& org_id, const String& device_id, const String& device_type, const String& status);
+void planNextScheduleEdge();
+bool fetchFilteredSchedules(const char* url, const String& org_id, const String& device_id, int& count);
+bool updateDeviceStatus(const char* url, const String& org_id, const String& device_id, const String& device_type, const String& status);
+bool pollClockReady();
+
+// ==========================
+// Status report worker
+// ==========================
+// The control path only enqueues state changes. In REST mode a background
+// task PUTs them; in MQTT mode the network task publishes them as
+// DEVICE_STATUS on the already open broker connection. Either way the valve
+// never waits on the cloud.
+#define STATUS_REPORT_REST     0
+#define STATUS_REPORT_MQTT     1
+#define STATUS_REPORT_MODE     STATUS_REPORT_MQTT
+
+#define STATUS_QUEUE_LEN       16
+#define STATUS_REPORT_RETRIES  3
+
+struct StatusReport {
+  uint8_t device_type;  // ScheduleDeviceType
+  bool open;
+};
+
+QueueHandle_t statusQueue;
+
+// Never blocks; when the queue is full the oldest report is dropped
+void enqueueStatusReport(ScheduleDeviceType deviceType, bool open) {
+  StatusReport r = { deviceType, open };
+  if (xQueueSend(statusQueue, &r, 0) != pdTRUE) {
+    StatusReport dropped;
+    xQueueReceive(statusQueue, &dropped, 0);
+    xQueueSend(statusQueue, &r, 0);
+    LOGF(LOG_STATUS_QUEUE_FULL);
+  }
+}
+
+void statusReportTask(void* arg) {
+  StatusReport r;
+  for (;;) {
+    xQueueReceive(statusQueue, &r, portMAX_DELAY);
+    while (WiFi.status() != WL_CONNECTED) vTaskDelay(pdMS_TO_TICKS(1000));
+
+    const char* type = r.device_type == SCHEDULE_DEVICE_PUMP ? "pump" : "valve";
+    const String& id = r.device_type == SCHEDULE_DEVICE_PUMP ? pump_id : valve_id;
+    for (int attempt = 1; attempt <= STATUS_REPORT_RETRIES; attempt++) {
+      xSemaphoreTake(apiLock, portMAX_DELAY);
+      bool ok = updateDeviceStatus(updateDeviceStatusApi, org_id, id, type, r.open ? "OPEN" : "CLOSE");
+      xSemaphoreGive(apiLock);
+      // a newer report supersedes this one, no point retrying it
+      if (ok || uxQueueMessagesWaiting(statusQueue) > 0) break;
+      vTaskDelay(pdMS_TO_TICKS(2000 * attempt));
+    }
+  }
+}
+
+// MQTT mode: publish queued reports from the network task, which owns the PubSubClient.
+// A report is taken off the queue before it is published and put back at
+// the front if the broker refused it, so reports raised while offline are
+// sent after the reconnect. Peek-then-receive would race the control
+// task's drop-oldest and could discard a different, unsent report. If the
+// queue filled up meanwhile, the one put back is the oldest and is dropped.
+void publishStatusReports() {
+  StatusReport r;
+  while (client.connected() && xQueueReceive(statusQueue, &r, 0) == pdTRUE) {
+    const char* type = r.device_type == SCHEDULE_DEVICE_PUMP ? "pump" : "valve";
+    const String& id = r.device_type == SCHEDULE_DEVICE_PUMP ? pump_id : valve_id;
+#if WIRE_FORMAT == WIRE_FORMAT_MSGPACK
+    uint8_t msg[64];
+    WireWriter w(msg, sizeof(msg));
+    w.begin(WIRE_DEVICE_STATUS, 4);
+    w.putKey(WK_ORG_ID);
+    w.putUuid(org_id.c_str());
+    w.putKey(WK_DEVICE_ID);
+    w.putUuid(id.c_str());
+    w.putKey(WK_DEVICE_TYPE);
+    w.putUint(r.device_type);
+    w.putKey(WK_STATUS);
+    w.putStr(r.open ? "OPEN" : "CLOSE");
+    bool sent = w.ok && client.publish(deviceStatusTopicWire, msg, w.len);
+#else
+    char msg[256];
+    snprintf(msg, sizeof(msg),
+             "{\"type\":\"DEVICE_STATUS\",\"data\":{\"org_id\":\"%s\",\"device_id\":\"%s\",\"device_type\":\"%s\",\"status\":\"%s\"}}",
+             org_id.c_str(), id.c_str(), type, r.open ? "OPEN" : "CLOSE");
+    bool sent = client.publish(deviceStatusTopic, msg);
+#endif
+    if (!sent) {
+      if (xQueueSendToFront(statusQueue, &r, 0) != pdTRUE) LOGF(LOG_STATUS_QUEUE_FULL);
+      LOGF(LOG_STATUS_PUBLISH_FAILED);
+      return;
+    }
+    LOGF(LOG_STATUS_SENT, type, r.open ? "OPEN" : "CLOSE");
+  }
+}
+
+void startStatusReporter() {
+  apiLock = xSemaphoreCreateMutex();
+  statusQueue = xQueueCreate(STATUS_QUEUE_LEN, sizeof(StatusReport));
+#if STATUS_REPORT_MODE == STATUS_REPORT_REST
+  xTaskCreatePinnedToCore(statusReportTask, "statusReport", 8192, nullptr, 1, nullptr, 0);
+#endif
+}
+
+// ==========================
+// Schedule snapshot
+// ==========================
+// File layout: ScheduleStoreHeader followed by `count` Schedule records.
+// Written to a temp file and renamed so a reset mid-write keeps the old one.
+uint32_t scheduleStoreCrc(const ScheduleStoreHeader& h, const Schedule* list, int count) {
+  uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&h, offsetof(ScheduleStoreHeader, crc));
+  return esp_rom_crc32_le(crc, (const uint8_t*)list, count * sizeof(Schedule));
+}
+
+void saveScheduleStore() {
+  if (!scheduleStoreReady) return;
+
+  ScheduleStoreHeader h = {};
+  h.magic = SCHEDULE_STORE_MAGIC;
+  h.version = SCHEDULE_STORE_VERSION;
+  h.count = valveScheduleCount;
+  strlcpy(h.etag, scheduleVersion.c_str(), sizeof(h.etag));
+  strlcpy(h.synced_at, scheduleSyncedAt.c_str(), sizeof(h.synced_at));
+  h.crc = scheduleStoreCrc(h, valveSchedules, valveScheduleCount);
+
+  File f = LittleFS.open(SCHEDULE_STORE_TMP_PATH, "w");
+  if (!f) {
+    LOGF(LOG_SNAPSHOT_OPEN_FAILED);
+    return;
+  }
+  size_t bytes = valveScheduleCount * sizeof(Schedule);
+  bool ok = f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+            f.write((const uint8_t*)valveSchedules, bytes) == bytes;
+  f.close();
+  if (!ok || !LittleFS.rename(SCHEDULE_STORE_TMP_PATH, SCHEDULE_STORE_PATH)) {
+    LOGF(LOG_SNAPSHOT_WRITE_FAILED);
+    LittleFS.remove(SCHEDULE_STORE_TMP_PATH);
+    return;
+  }
+  LOGF(LOG_SNAPSHOT_SAVED, valveScheduleCount);
+}
+
+// Restore the last snapshot; a missing, stale or corrupt file leaves the
+// store empty and the cloud fetch fills it
+void loadScheduleStore() {
+  if (!LittleFS.begin(true)) {
+    LOGF(LOG_FS_MOUNT_FAILED);
+    return;
+  }
+  scheduleStoreReady = true;
+
+  File f = LittleFS.open(SCHEDULE_STORE_PATH, "r");
+  if (!f) {
+    LOGF(LOG_SNAPSHOT_NONE);
+    return;
+  }
+  ScheduleStoreHeader h;
+  bool ok = f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+            h.magic == SCHEDULE_STORE_MAGIC && h.version == SCHEDULE_STORE_VERSION &&
+            h.count <= MAX_SCHEDULES &&
+            f.read((uint8_t*)valveSchedules, h.count * sizeof(Schedule)) == h.count * sizeof(Schedule);
+  f.close();
+  if (!ok || h.crc != scheduleStoreCrc(h, valveSchedules, h.count)) {
+    LOGF(LOG_SNAPSHOT_INVALID);
+    valveScheduleCount = 0;
+    return;
+  }
+
+  valveScheduleCount = h.count;
+  h.etag[sizeof(h.etag) - 1] = '\0';
+  h.synced_at[sizeof(h.synced_at) - 1] = '\0';
+  scheduleVersion = h.etag;
+  scheduleSyncedAt = h.synced_at;
+  invalidateScheduleIndex();
+  LOGF(LOG_SNAPSHOT_LOADED, valveScheduleCount);
+  printSchedules();
+}
+
+// ==========================
+// Control and network tasks
+// ==========================
+// Schedule evaluation and the valve output run on core 1. TLS, MQTT, HTTP
+// and NTP run on core 0 next to the WiFi stack, so a stalled handshake or a
+// slow API call can no longer hold back an edge. State reports go to the
+// network side through statusQueue; schedule changes come back as
+// commands on scheduleCommands. Neither side takes a lock.
+#define CONTROL_CORE          1
+#define NETWORK_CORE          0
+#define CONTROL_PERIOD_MS     50
+#define JITTER_REPORT_MS      60000
+
+// Control task wake-up and how late it runs, per report window
+ControlPeriod controlPeriod;
+
+// Network side. If the ring is full the change is dropped and the next
+// cloud sync brings the store back in line.
+bool queueScheduleCommand(ScheduleOp op, const Schedule& schedule) {
+  ScheduleCommand cmd;
+  cmd.op = op;
+  cmd.schedule = schedule;
+  if (scheduleCommands.push(cmd)) return true;
+  LOGF(LOG_COMMAND_QUEUE_FULL);
+  schedulesSynced = false;
+  return false;
+}
+
+// Control side, once per cycle before evaluation: apply every pending
+// command, then rebuild the index once for the whole batch
+void applyScheduleCommands() {
+  bool changed = false;
+  while (ScheduleCommand* cmd = scheduleCommands.front()) {
+    switch (cmd->op) {
+      case SCHEDULE_OP_UPSERT:
+        upsertSchedule(valveSchedules, valveScheduleCount, cmd->schedule);
+        break;
+      case SCHEDULE_OP_REMOVE: {
+        int i = findSchedule(valveSchedules, valveScheduleCount, cmd->schedule.schedule_id);
+        if (i >= 0) removeScheduleAt(valveSchedules, valveScheduleCount, i);
+        break;
+      }
+      case SCHEDULE_OP_REPLACE:
+        memcpy(valveSchedules, stagedSchedules, stagedScheduleCount * sizeof(Schedule));
+        valveScheduleCount = stagedScheduleCount;
+        break;
+    }
+    scheduleCommands.pop();
+    changed = true;
+  }
+  if (!changed) return;
+  invalidateScheduleIndex();  // raises scheduleDirty, evaluated right after
+  scheduleStoreChanged = true;
+}
+
+// Runs in the esp_timer task at the planned edge; the control task does
+// the actual switching
+void onScheduleEdgeTimer(void* arg) {
+  xTaskNotifyGive(controlTaskHandle);
+}
+
+// Apply pending commands, then evaluate if the edge timer fired, the set or
+// the clock changed, or the planned wake has passed without the timer
+void runScheduleCycle(bool edgeFired) {
+  applyScheduleCommands();
+
+  // 🕒 Evaluate schedules only when the next start/end edge is due
+  if (timeInitialized && (edgeFired || scheduleDirty || esp_timer_get_time() >= nextScheduleCheckUs)) {
+    scheduleDirty = false;  // cleared first so a change made meanwhile is not lost
+    checkAndTriggerSchedules();
+    planNextScheduleEdge();
+  }
+}
+
+void controlTask(void* arg) {
+  controlPeriod.begin(CONTROL_PERIOD_MS);
+  for (;;) runScheduleCycle(controlPeriod.wait());
+}
+
+// Worst control wake-up latency over the last window, next to the link state,
+// so stalls can be matched against network outages
+void reportControlJitter() {
+  static unsigned long lastReport = 0;
+  if (millis() - lastReport < JITTER_REPORT_MS) return;
+  lastReport = millis();
+  LOGF(LOG_CONTROL_JITTER, controlPeriod.cycles, controlPeriod.jitterMaxUs,
+       WiFi.status() == WL_CONNECTED ? "up" : "down", client.connected() ? "up" : "down");
+  controlPeriod.resetStats();
+}
+
+void networkTask(void* arg) {
+  for (;;) {
+    unsigned long now = millis();
+    bool online = WiFi.status() == WL_CONNECTED;
+
+    if (online) {
+      // Non-blocking reconnect attempt
+      if (!client.connected() && now - lastMqttReconnectAttempt > mqttReconnectInterval) {
+        lastMqttReconnectAttempt = now;
+        connectAWS();
+      }
+      client.loop();
+#if STATUS_REPORT_MODE == STATUS_REPORT_MQTT
+      publishStatusReports();
+#endif
+
+      // ☁️ Reconcile the snapshot with the cloud once per boot. Waits for
+      // queued commands so the delta starts from the applied store.
+      if (!schedulesSynced && scheduleCommands.empty() && (lastScheduleFetchAttempt == 0 || now - lastScheduleFetchAttempt > SCHEDULE_FETCH_RETRY_MS)) {
+        lastScheduleFetchAttempt = now;
+        xSemaphoreTake(apiLock, portMAX_DELAY);
+        schedulesSynced = fetchFilteredSchedules(scheduleAPI, org_id, valve_id, count);
+        xSemaphoreGive(apiLock);
+      }
+    }
+
+    // The store is quiet while the ring is empty, see valveSchedules
+    if (scheduleStoreChanged && scheduleCommands.empty()) {
+      scheduleStoreChanged = false;
+      saveScheduleStore();
+      printSchedules();
+    }
+
+    pollClockReady();
+    if (millis() - lastTimeSync > 21600000UL) {
+      configTime(19800, 0, "pool.ntp.org", "time.nist.gov");
+      lastTimeSync = millis();
+      scheduleDirty = true;
+    }
+    maintainTimeSync();  // non-blocking NTP time maintenance
+
+    reportControlJitter();
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
 // ==========================
 // Setup
 // ==========================
 void setup() {
   Serial.begin(115200);
-  WiFi.begin(ssid, password);
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(1000);
-    Serial.println("Connecting to WiFi...");
-  }
-  Serial.println("WiFi connected");
+  startLogSink(NETWORK_CORE);
   pinMode(2, OUTPUT);
+
+  // Drive the valve from the flash snapshot before any networking. WiFi,
+  // NTP, the cloud fetch and MQTT all come up in the background on core 0.
+  startStatusReporter();
+  loadScheduleStore();
+  WiFi.begin(ssid, password);
   setupTime();
-  fetchFilteredSchedules(scheduleAPI, org_id, valve_id, count);
-  connectAWS();
+
+  // The control task evaluates on its first cycle (scheduleDirty starts
+  // set) and arms the edge timer from then on
+  const esp_timer_create_args_t edgeTimerArgs = { .callback = onScheduleEdgeTimer, .name = "scheduleEdge" };
+  esp_timer_create(&edgeTimerArgs, &scheduleEdgeTimer);
+  xTaskCreatePinnedToCore(controlTask, "control", 4096, nullptr, 3, &controlTaskHandle, CONTROL_CORE);
+
+  xTaskCreatePinnedToCore(networkTask, "network", 16384, nullptr, 1, nullptr, NETWORK_CORE);
 }
 
 // ==========================
 // Loop
 // ==========================
+// Everything runs in controlTask and networkTask
 void loop() {
-  if (!client.connected()) {
-    connectAWS();
-  }
-  client.loop();
+  vTaskDelete(nullptr);
+}
 
-  unsigned long now = millis();
-  if (millis() - lastTimeSync > 21600000UL) {
-    configTime(19800, 0, "pool.ntp.org", "time.nist.gov");
-    lastTimeSync = millis();
-  }
-  maintainTimeSync();  // non-blocking NTP time maintenance
+// ==========================
+// Next-transition timer
+// ==========================
+// Wall clock in epoch microseconds, as the schedules see it, see
+// ScheduleEdgeClock.h
+int64_t scheduleClockUs() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return scheduleEdgeClock.now((int64_t)tv.tv_sec * 1000000 + tv.tv_usec);
+}
 
-  // 🕒 Check schedules every 1 second
-  if (millis() - lastScheduleCheck >= scheduleInterval) {
-    Serial.println("Schedule check");
-    checkAndTriggerSchedules();
-    lastScheduleCheck = millis();
-    Serial.println("");
-    Serial.println("VALVEON");
-    Serial.println(valveIsOn);
-    Serial.println("");
-  }
+// Local time and second of day of an epoch microsecond
+uint32_t scheduleSecondOfDay(int64_t nowUs, struct tm& timeinfo) {
+  time_t t = nowUs / 1000000;
+  localtime_r(&t, &timeinfo);
+  return timeinfo.tm_hour * 3600 + timeinfo.tm_min * 60 + timeinfo.tm_sec;
+}
+
+// Arm the one-shot timer for the exact start of the next edge second
+void planNextScheduleEdge() {
+  int64_t nowUs = scheduleClockUs();
+  struct tm timeinfo;
+  uint32_t nowSec = scheduleSecondOfDay(nowUs, timeinfo);
+  refreshScheduleIndex(timeinfo);
+
+  int64_t sleepUs = scheduleEdgeClock.plan(nowUs, scheduleIndex.secondsToNextEdge(nowSec));
+  nextScheduleCheckUs = esp_timer_get_time() + sleepUs;
+  esp_timer_stop(scheduleEdgeTimer);  // harmless if it is not running
+  esp_timer_start_once(scheduleEdgeTimer, sleepUs);
+  LOGF(LOG_NEXT_EDGE, (uint32_t)(sleepUs / 1000), valveIsOn ? "ON" : "OFF");
 }
 
 // ==========================
 // Time setup
 // ==========================
+// SNTP also steps the clock on its own between our resyncs; the edge timer
+// then points at the wrong instant, so re-plan against the new clock
+void onTimeSynced(struct timeval* tv) {
+  scheduleDirty = true;
+}
+
+// The RTC keeps the system clock across soft resets and watchdog restarts,
+// so it is often valid at boot. After a power loss SNTP sets it in the
+// background once WiFi is up, and pollClockReady() notices.
 void setupTime() {
+  sntp_set_time_sync_notification_cb(onTimeSynced);
   configTime(gmtOffset_sec, daylightOffset_sec, "pool.ntp.org", "time.nist.gov");
-  Serial.print("⏱ Syncing time");
+  if (!pollClockReady()) LOGF(LOG_CLOCK_WAITING);
+}
+
+bool pollClockReady() {
+  if (timeInitialized) return true;
+  time_t t = time(nullptr);
+  if (t < MIN_VALID_EPOCH) return false;
+
+  timeInitialized = true;
+  lastTimeSync = millis();
+  scheduleDirty = true;
   struct tm timeinfo;
-  int retries = 0;
-  while (!getLocalTime(&timeinfo) && retries < 10) {
-    Serial.print(".");
-    delay(1000);
-    retries++;
-  }
-  if (retries == 10) {
-    Serial.println("❌ Failed to obtain time, restarting...");
-    ESP.restart();
-  }
-  Serial.printf("\n✅ Time: %02d:%02d:%02d\n",
-                timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+  localtime_r(&t, &timeinfo);
+  LOGF(LOG_CLOCK_READY, timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+  return true;
 }
 
 // ==========================
@@ -381,40 +1025,95 @@ void connectAWS() {
   espClient.setCertificate(device_cert);
   espClient.setPrivateKey(private_key);
 
-  while (!client.connected()) {
-    Serial.print("Connecting to AWS IoT...");
+  // One attempt per call; networkTask retries every mqttReconnectInterval
+  if (!client.connected()) {
+    LOGF(LOG_MQTT_CONNECTING);
     if (client.connect(thingName, NULL, NULL, statusTopic, 1, true, "{\"status\":\"ESP32 disconnected\"}")) {
-      Serial.println("connected!");
+      LOGF(LOG_MQTT_CONNECTED);
       client.subscribe(statusTopic);
       client.subscribe(acc1);
       client.subscribe(acc2);
       client.publish(statusTopic, "{\"status\":\"connected with AWS\"}", true);
+      publishDeviceHello();
     } else {
-      Serial.print("failed, rc=");
-      Serial.print(client.state());
-      delay(2000);
+      LOGF(LOG_MQTT_CONNECT_FAILED, client.state());
     }
   }
 }
 
+// Tell the cloud which wire format to use for our schedule commands. Always
+// JSON, so it reaches the cloud whatever the cloud currently expects.
+void publishDeviceHello() {
+  char msg[160];
+  snprintf(msg, sizeof(msg),
+           "{\"type\":\"DEVICE_HELLO\",\"data\":{\"org_id\":\"%s\",\"device_id\":\"%s\",\"wire\":\"%s\"}}",
+           org_id.c_str(), valve_id.c_str(), WIRE_FORMAT == WIRE_FORMAT_MSGPACK ? "msgpack" : "json");
+  client.publish(deviceStatusTopic, msg);
+}
+
 // ==========================
 // MQTT Callback
 // ==========================
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  String incomingPayload;
-  for (unsigned int i = 0; i < length; i++) {
-    incomingPayload += (char)payload[i];
+enum MqttMessageType : uint8_t {
+  MSG_UNKNOWN = 0,
+  MSG_SCHEDULE_CREATED,
+  MSG_SCHEDULE_UPDATE,
+  MSG_SCHEDULE_DELETE
+};
+
+// Length + the char after "SCHEDULE_" pick the candidate, strcmp confirms it
+MqttMessageType classifyMessageType(const char* type) {
+  if (!type) return MSG_UNKNOWN;
+  size_t len = strlen(type);
+  if (len < 15) return MSG_UNKNOWN;
+
+  switch (type[9]) {
+    case 'C':
+      if (len == 16 && strcmp(type, "SCHEDULE_CREATED") == 0) return MSG_SCHEDULE_CREATED;
+      break;
+    case 'U':
+      if (len == 15 && strcmp(type, "SCHEDULE_UPDATE") == 0) return MSG_SCHEDULE_UPDATE;
+      break;
+    case 'D':
+      if (len == 15 && strcmp(type, "SCHEDULE_DELETE") == 0) return MSG_SCHEDULE_DELETE;
+      break;
   }
-  Serial.println("📩 MQTT Message Received:");
-  Serial.println(incomingPayload);
+  return MSG_UNKNOWN;
+}
 
-  if (incomingPayload.indexOf("SCHEDULE_CREATED") != -1) {
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+  LOGF(LOG_MQTT_MESSAGE, length);
 
-    handleScheduleCreatedPayload(incomingPayload);
-  } else if (incomingPayload.indexOf("SCHEDULE_UPDATE") != -1) {
-    handleScheduleUpdatePayload(incomingPayload);
-  } else if (incomingPayload.indexOf("SCHEDULE_DELETE") != -1) {
-    handleScheduleDeletePayload(incomingPayload);
+  // Parse straight from PubSubClient's buffer in a single pass. The input is
+  // passed as const so ArduinoJson copies strings into the document: the
+  // handlers publish ACKs, which reuse (and overwrite) that same buffer.
+  StaticJsonDocument<2048> doc;
+  if (length > 0 && payload[0] != '{') {
+    if (!decodeWireMessage(payload, length, doc)) {
+      LOGF(LOG_WIRE_DECODE_FAILED);
+      return;
+    }
+  } else {
+    DeserializationError error = deserializeJson(doc, (const byte*)payload, length);
+    if (error) {
+      LOGF(LOG_JSON_PARSE_FAILED, error.c_str());
+      return;
+    }
+  }
+
+  JsonObject data = doc["data"];
+  switch (classifyMessageType(doc["type"])) {
+    case MSG_SCHEDULE_CREATED:
+      handleScheduleCreatedPayload(data);
+      break;
+    case MSG_SCHEDULE_UPDATE:
+      handleScheduleUpdatePayload(data);
+      break;
+    case MSG_SCHEDULE_DELETE:
+      handleScheduleDeletePayload(data);
+      break;
+    default:
+      break;
   }
 }
 
@@ -425,7 +1124,7 @@ void maintainTimeSync() {
 
   // Trigger new time sync every 6 hours
   if (!timeSyncInProgress && now - lastTimeSync > TIME_RESYNC_INTERVAL) {
-    Serial.println("🔄 Initiating periodic time re-sync...");
+    LOGF(LOG_TIME_RESYNC_START);
     configTime(gmtOffset_sec, daylightOffset_sec, "pool.ntp.org", "time.nist.gov");
     timeSyncInProgress = true;
     timeSyncStart = now;
@@ -436,10 +1135,10 @@ void maintainTimeSync() {
     if (getLocalTime(&timeinfo)) {
       lastTimeSync = now;
       timeSyncInProgress = false;
-      Serial.println("✅ Time re-synced successfully.");
-      Serial.printf("🕒 Current time: %02d:%02d\n", timeinfo.tm_hour, timeinfo.tm_min);
+      scheduleDirty = true;
+      LOGF(LOG_TIME_RESYNC_DONE, timeinfo.tm_hour, timeinfo.tm_min);
     } else if (now - timeSyncStart > TIME_SYNC_TIMEOUT) {
-      Serial.println("❌ Time re-sync timed out.");
+      LOGF(LOG_TIME_RESYNC_TIMEOUT);
       timeSyncInProgress = false;  // Abort current sync attempt
     }
   }
@@ -526,95 +1225,151 @@ void maintainTimeSync() {
 //   }
 //   http.end();
 // }
-void fetchFilteredSchedules(const char* url, const String& org_id, const String& valve_id, int& count) {
-  HTTPClient http;
-  http.begin(url);
+// True once the stored schedules match the server (200 or 304)
+bool fetchFilteredSchedules(const char* url, const String& org_id, const String& valve_id, int& count) {
+  // no chunked encoding, so the body can be read as a plain stream
+  if (!beginApiRequest(url, true)) return false;
+  HTTPClient& http = apiHttp;
   http.addHeader("Content-Type", "application/json");
+  const char* responseHeaders[] = { "ETag", "X-Synced-At" };
+  http.collectHeaders(responseHeaders, 2);
 
+  // Ask only for this valve's schedules, and only what changed since the
+  // last sync. If our version is still current the server answers 304.
+  bool delta = scheduleSyncedAt.length() > 0;
   DynamicJsonDocument body(256);
   body["org_id"] = org_id;
+  body["device_id"] = valve_id;
+  if (delta) body["since"] = scheduleSyncedAt;
+  if (scheduleVersion.length()) http.addHeader("If-None-Match", scheduleVersion);
   String jsonBody;
   serializeJson(body, jsonBody);
   
-  Serial.printf("📡 Sending POST request to fetch schedules for org %s\n", org_id.c_str());
-  Serial.println(jsonBody);
+  LOGF(LOG_FETCH_START, delta ? "delta" : "full");
 
   int httpCode = http.POST(jsonBody);
+  if (httpCode == 304) {
+    LOGF(LOG_FETCH_UNCHANGED);
+    http.end();
+    return true;
+  }
   if (httpCode != 200) {
-    Serial.printf("❌ Failed to fetch schedules, HTTP code: %d\n", httpCode);
+    LOGF(LOG_FETCH_HTTP_FAILED, httpCode);
     http.end();
-    return;
+    return false;
   }
-
-  String payload = http.getString();
-  Serial.println("✅ Got response:");
-  Serial.println(payload);
-
-  DynamicJsonDocument doc(16384);
-  DeserializationError error = deserializeJson(doc, payload);
-  if (error) {
-    Serial.printf("❌ JSON parse error: %s\n", error.c_str());
+  String newVersion = http.header("ETag");
+  String newSyncedAt = http.header("X-Synced-At");
+
+  // The response is {"success":true,...,"schedules":[{...}],"schedule_ids":["..."]}.
+  // Walk the arrays one element at a time so memory is bounded by a single
+  // schedule, and keep only the fields we use.
+  Stream& stream = http.getStream();
+  if (!stream.find("\"schedules\"") || !stream.find("[")) {
+    LOGF(LOG_FETCH_NO_SCHEDULES);
     http.end();
-    return;
+    return false;
   }
 
-  valveSchedules.clear();
-  JsonArray schedules = doc["schedules"];
-  if (schedules.isNull()) {
-    Serial.println("⚠️ No 'schedules' array found in response.");
-    http.end();
-    return;
+  StaticJsonDocument<192> filter;
+  filter["schedule_id"] = true;
+  filter["start_time"] = true;
+  filter["end_time"] = true;
+  filter["recurrence"] = true;
+  filter["device_id"] = true;
+  filter["device_type"] = true;
+  filter["org_id"] = true;
+  filter["valve_ack"] = true;
+  filter["pump_ack"] = true;
+
+  // A delta starts from what we already hold; a full sync from nothing.
+  // Built in stagedSchedules so a failed sync leaves the live set untouched.
+  // The caller only syncs with scheduleCommands drained, so valveSchedules
+  // is not being written while we copy it.
+  Schedule* fetched = stagedSchedules;
+  int fetchedCount = 0;
+  if (delta) {
+    memcpy(fetched, valveSchedules, valveScheduleCount * sizeof(Schedule));
+    fetchedCount = valveScheduleCount;
   }
 
-  for (JsonObject sched : schedules) {
-    Schedule s;
-    s.schedule_id = sched["schedule_id"].as<String>();
-    s.start_time  = sched["start_time"].as<String>();
-    s.end_time    = sched["end_time"].as<String>();
-    s.device_id   = sched["device_id"].as<String>();
-    s.device_type = sched["device_type"].as<String>();
-    currentOrgId  = sched["org_id"].as<String>();
-    JsonObject ack = sched["acknowledge"];
-    Serial.println("🔍 Schedule JSON:");
-    serializeJson(sched, Serial);
-    Serial.println(); // newline
+  StaticJsonDocument<768> sched;
+  int seen = 0;
+  while (isspace(stream.peek())) stream.read();
+  bool more = stream.peek() != ']';  // "schedules":[]
+  while (more) {
+    DeserializationError error = deserializeJson(sched, stream, DeserializationOption::Filter(filter));
+    if (error) {
+      LOGF(LOG_FETCH_PARSE_FAILED, error.c_str());
+      http.end();
+      return false;
+    }
+    seen++;
+    more = stream.findUntil(",", "]");
+
+    const char* schedule_id = sched["schedule_id"] | "";
+    const char* device_id = sched["device_id"] | "";
+    const char* device_type = sched["device_type"] | "";
     bool valve_ack = sched["valve_ack"].as<bool>();
     bool pump_ack  = sched["pump_ack"].as<bool>();
-    String schedule_status = sched["schedule_status"].as<String>();
-
-    Serial.printf("Schedule ACKs -> valve:%d | pump:%d\n", valve_ack, pump_ack);
-
-    if (s.device_id == valve_id && s.device_type == "valve" && valve_ack && pump_ack) {
-      //   if (!valve_ack) {
-      //   //  send ack for valve
-      //   sendScheduleUpdateAck(s.schedule_id, schedule_status, currentOrgId, s.start_time, s.end_time, "valve");
-      // }
-      // if (!pump_ack) {
-      //   // send ack for pump
-      //   sendScheduleUpdateAck(s.schedule_id, schedule_status, currentOrgId, s.start_time, s.end_time, "pump");
-      // }
-      valveSchedules.push_back(s);
-      Serial.printf("✅ Added Schedule ID: %s | Start: %s | End: %s\n",
-                    s.schedule_id.c_str(), s.start_time.c_str(), s.end_time.c_str());
-    }
 
-    if (valveSchedules.size() >= MAX_SCHEDULES) break;
+    // Changed entries replace our copy; ones no longer fully acked drop out
+    Schedule s;
+    if (!parseScheduleId(schedule_id, s.schedule_id)) continue;
+    int existing = findSchedule(fetched, fetchedCount, s.schedule_id);
+    if (existing >= 0) removeScheduleAt(fetched, fetchedCount, existing);
+    if (valve_id != device_id || strcmp(device_type, "valve") != 0 || !valve_ack || !pump_ack) continue;
+    if (!makeSchedule(schedule_id, sched["start_time"].as<const char*>(), sched["end_time"].as<const char*>(), device_type,
+                      sched["recurrence"], s)) continue;
+    if (!upsertSchedule(fetched, fetchedCount, s)) continue;
+
+    currentOrgId = sched["org_id"].as<String>();
+    LOGF(LOG_FETCH_SYNCED, logShortId(s.schedule_id), logHhmmss(s.start_sec), logHhmmss(s.end_sec));
   }
 
-  Serial.printf("📋 Total valve schedules stored: %d\n", valveSchedules.size());
-  for (const auto& sch : valveSchedules) {
-    Serial.printf("⏱ Start: %s | End: %s\n", sch.start_time.c_str(), sch.end_time.c_str());
+  // Anything we hold that is no longer listed was deleted on the server
+  if (delta) {
+    if (!stream.find("\"schedule_ids\"") || !stream.find("[")) {
+      LOGF(LOG_FETCH_NO_IDS);
+      http.end();
+      return false;
+    }
+    bool live[MAX_SCHEDULES] = { false };
+    StaticJsonDocument<96> id;
+    uint8_t liveId[16];
+    while (isspace(stream.peek())) stream.read();
+    more = stream.peek() != ']';
+    while (more) {
+      if (deserializeJson(id, stream)) {
+        LOGF(LOG_FETCH_IDS_PARSE_FAILED);
+        http.end();
+        return false;
+      }
+      more = stream.findUntil(",", "]");
+      if (!parseScheduleId(id.as<const char*>(), liveId)) continue;
+      int i = findSchedule(fetched, fetchedCount, liveId);
+      if (i >= 0) live[i] = true;
+    }
+    for (int i = fetchedCount - 1; i >= 0; i--) {
+      if (!live[i]) removeScheduleAt(fetched, fetchedCount, i);
+    }
   }
-
   http.end();
+
+  // Handed to the control task; the snapshot is saved once it is applied
+  stagedScheduleCount = fetchedCount;
+  Schedule none = {};
+  if (!queueScheduleCommand(SCHEDULE_OP_REPLACE, none)) return false;
+  scheduleVersion = newVersion;
+  scheduleSyncedAt = newSyncedAt;
+
+  LOGF(LOG_FETCH_DONE, delta ? "Delta" : "Full", seen, fetchedCount);
+  return true;
 }
 
 
-void updateDeviceStatus(const char* url, const String& org_id, const String& device_id, const String& device_type, const String& status) {
-  HTTPClient http;
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("hardware", "true");
+// Blocking PUT, only called from statusReportTask with apiLock held
+bool updateDeviceStatus(const char* url, const String& org_id, const String& device_id, const String& device_type, const String& status) {
   // Create POST body
   DynamicJsonDocument body(256);
   body["org_id"] = org_id;
@@ -623,30 +1378,33 @@ void updateDeviceStatus(const char* url, const String& org_id, const String& dev
   body["status"] = status;
   String jsonBody;
   serializeJson(body, jsonBody);
-  Serial.printf("📡 Sending PUT request to Update the status... %s \n", org_id);
-  Serial.println(jsonBody);
-
-  int httpCode = http.PUT(jsonBody);
+  LOGF(LOG_STATUS_PUT_START);
+
+  HTTPClient& http = apiHttp;
+  unsigned long start = millis();
+  int httpCode = -1;
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if (!beginApiRequest(url, false)) return false;
+    http.addHeader("Content-Type", "application/json");
+    http.addHeader("hardware", "true");
+    httpCode = http.PUT(jsonBody);
+    if (httpCode >= 0) break;
+    // The server may have closed the idle keep-alive socket: reconnect once
+    http.end();
+    apiClient.stop();
+  }
   if (httpCode != 200) {
-    Serial.printf("❌ Failed to  Update the status, HTTP code: %d\n", httpCode);
+    LOGF(LOG_STATUS_PUT_FAILED, httpCode);
     http.end();
-    return;
+    return false;
   }
 
+  // Read the whole body so the connection can be reused
   String payload = http.getString();
   http.end();
 
-  Serial.println("✅ Got response:");
-  Serial.println(payload);
-  DynamicJsonDocument doc(8192);
-  DeserializationError error = deserializeJson(doc, payload);
-  if (error) {
-    Serial.println("❌ JSON parse error");
-    return;
-  }
-
-
-  http.end();
+  LOGF(LOG_STATUS_PUT_DONE, millis() - start, payload.length());
+  return true;
 }
 
 
@@ -654,16 +1412,12 @@ void updateDeviceStatus(const char* url, const String& org_id, const String& dev
 // ==========================
 // Handle Schedule Payloads
 // ==========================
-void handleScheduleCreatedPayload(String payload) {
-  StaticJsonDocument<2048> doc;
-  DeserializationError error = deserializeJson(doc, payload);
-  if (error) {
-    Serial.println("JSON Parse failed for CREATE");
+void handleScheduleCreatedPayload(JsonObject data) {
+  if (data.isNull()) {
+    LOGF(LOG_SCHEDULE_MISSING_DATA, "CREATE");
     return;
   }
 
-  JsonObject data = doc["data"];
-  Serial.println(data);
   currentScheduleId = data["schedule_id"].as<String>();
   // scheduleStatus = data["valve_ack"].as<String>();
   currentOrgId = data["org_id"].as<String>();
@@ -673,32 +1427,21 @@ void handleScheduleCreatedPayload(String payload) {
   endTime = data["end_time"].as<String>();
 
   Schedule schedule;
-  schedule.start_time = startTime;
-  schedule.end_time = endTime;
-  schedule.schedule_id = currentScheduleId;
-  schedule.device_type = currentDeviceType;
-  schedule.device_id = currentDeviceId;
-  valveSchedules.push_back(schedule);
-  //
-  Serial.println("✅ Schedule CREATED: " + currentScheduleId);
-  Serial.println("Print All the schedule: ");
-  for (const auto& sch : valveSchedules) {
-    Serial.printf("⏱ Start: %s | End: %s\n", sch.start_time.c_str(), sch.end_time.c_str());
+  if (makeSchedule(currentScheduleId.c_str(), startTime.c_str(), endTime.c_str(), currentDeviceType.c_str(),
+                   data["recurrence"], schedule)) {
+    queueScheduleCommand(SCHEDULE_OP_UPSERT, schedule);
   }
-  // Now send ACKs using the **same incoming payload**
-  sendScheduleAck(doc, "pump");
-  sendScheduleAck(doc, "valve");
+  //
+  LOGF(LOG_SCHEDULE_CREATED, logShortId(currentScheduleId.c_str()));
+  sendScheduleAck(WIRE_SCHEDULE_ACK, currentScheduleId, currentOrgId, "");
 }
 
 
-void handleScheduleUpdatePayload(String payload) {
-  StaticJsonDocument<2048> doc;
-  DeserializationError error = deserializeJson(doc, payload);
-  if (error) {
-    Serial.println("JSON Parse failed for UPDATE");
+void handleScheduleUpdatePayload(JsonObject data) {
+  if (data.isNull()) {
+    LOGF(LOG_SCHEDULE_MISSING_DATA, "UPDATE");
     return;
   }
-  JsonObject data = doc["data"];
   currentScheduleId = data["schedule_id"].as<String>();
   currentOrgId = data["org_id"].as<String>();
   scheduleStatus = data["schedule_status"].as<String>();
@@ -706,49 +1449,21 @@ void handleScheduleUpdatePayload(String payload) {
   startTime = data["start_time"].as<String>();
   endTime = data["end_time"].as<String>();
   currentDeviceId = data["device_id"].as<String>();
-  Serial.printf(" curr device id: %s",currentDeviceId);
- bool isUpdate = false;
-  // Serial.println("In comming update: "+startTime+ " "+endTime+" "+currentScheduleId);
-  for (int i = 0; i < valveSchedules.size(); ++i) {
-    // Serial.println("i");
-    // Serial.printf("⏱ curr: %s | storeSch: %s | comp %d \n ", currentScheduleId, valveSchedules[i].schedule_id,valveSchedules[i].schedule_id == currentScheduleId);
-    // Serial.printf("valve sch: %s ",valveSchedules[i].schedule_id);
-    // Serial.println("sch id check: "+currentScheduleId+" "+ valveSchedules[i].schedule_id + " eq: "+valveSchedules[i].schedule_id == currentScheduleId);
-
-    if (valveSchedules[i].schedule_id == currentScheduleId) {
-      Serial.println("Update sch");
-      isUpdate = true;
-      valveSchedules[i].start_time = startTime;
-      valveSchedules[i].end_time = endTime;
-    }
-  }
-  if(!isUpdate){
-    Serial.println("Added new Schedule: ");
-     Schedule schedule;
-  schedule.start_time = startTime;
-  schedule.end_time = endTime;
-  schedule.schedule_id = currentScheduleId;
-  schedule.device_type = currentDeviceType;
-  schedule.device_id = currentDeviceId ?currentDeviceId: valve_id;
-  valveSchedules.push_back(schedule);
-  }
-  // Serial.println("✅ Schedule UPDATE: " + currentScheduleId);
-  Serial.println("Print All the schedule: ");
-  for (const auto& sch : valveSchedules) {
-    Serial.printf("⏱ Start: %s |  %s | End: %s\n", sch.schedule_id.c_str(), sch.start_time.c_str(), sch.end_time.c_str());
+  // Replaces the stored times, or adds the schedule if we missed its CREATE
+  Schedule schedule;
+  if (makeSchedule(currentScheduleId.c_str(), startTime.c_str(), endTime.c_str(), currentDeviceType.c_str(),
+                   data["recurrence"], schedule)) {
+    queueScheduleCommand(SCHEDULE_OP_UPSERT, schedule);
   }
-  sendScheduleUpdateAck(currentScheduleId, scheduleStatus, currentOrgId, startTime, endTime, "pump");
-  sendScheduleUpdateAck(currentScheduleId, scheduleStatus, currentOrgId, startTime, endTime, "valve");
+  LOGF(LOG_SCHEDULE_UPDATED, logShortId(currentScheduleId.c_str()));
+  sendScheduleAck(WIRE_SCHEDULE_ACK_UPDATE, currentScheduleId, currentOrgId, scheduleStatus);
 }
 
-void handleScheduleDeletePayload(String payload) {
-  StaticJsonDocument<2048> doc;
-  DeserializationError error = deserializeJson(doc, payload);
-  if (error) {
-    Serial.println("JSON Parse failed for DELETE");
+void handleScheduleDeletePayload(JsonObject data) {
+  if (data.isNull()) {
+    LOGF(LOG_SCHEDULE_MISSING_DATA, "DELETE");
     return;
   }
-  JsonObject data = doc["data"];
   currentScheduleId = data["schedule_id"].as<String>();
   scheduleStatus = data["schedule_status"].as<String>();
   currentOrgId = data["org_id"].as<String>();
@@ -763,77 +1478,76 @@ void handleScheduleDeletePayload(String payload) {
   //   }
   // }
 
-  for (auto it = valveSchedules.begin(); it != valveSchedules.end(); ++it) {
-    Serial.println("sch id check: " + currentScheduleId + " " + it->schedule_id + " eq: " + it->schedule_id == currentScheduleId);
-    if (it->schedule_id == currentScheduleId) {
-      valveSchedules.erase(it);
-      Serial.println("🗑 Schedule removed: ");
-      break;  // stop after removing one
-    }
+  Schedule schedule = {};
+  if (parseScheduleId(currentScheduleId.c_str(), schedule.schedule_id)) {
+    queueScheduleCommand(SCHEDULE_OP_REMOVE, schedule);
   }
 
 
-  Serial.println("✅ Schedule DELETE: " + currentScheduleId);
-  Serial.println("Print All the schedule: ");
-  for (const auto& sch : valveSchedules) {
-    Serial.printf("⏱ Start: %s | End: %s\n", sch.start_time.c_str(), sch.end_time.c_str());
-  }
-  // sendScheduleDeleteAck(currentScheduleId,scheduleStatus, currentOrgId, currentDeviceType);
-  sendScheduleDeleteAck(currentScheduleId, scheduleStatus, currentOrgId, "pump");
-  sendScheduleDeleteAck(currentScheduleId, scheduleStatus, currentOrgId, "valve");
+  LOGF(LOG_SCHEDULE_DELETED, logShortId(currentScheduleId.c_str()));
+  sendScheduleAck(WIRE_SCHEDULE_ACK_DELETE, currentScheduleId, currentOrgId, scheduleStatus);
 }
 
 // ==========================
 // Send ACKs
 // ==========================
-void sendScheduleAck(StaticJsonDocument<2048>& doc, String newDeviceType) {
-  JsonObject data = doc["data"];
-
-  // Modify only what is required:
-  data["device_type"] = newDeviceType;
-  data["ack"] = true;  // Add ACK flag if not present
-
-  // Change the message type
-  doc["type"] = "SCHEDULE_ACK";
-
-  // Serialize updated JSON and publish
-  String ackPayload;
-  serializeJson(doc, ackPayload);
+// One ACK per schedule event, listing every device type this controller
+// acknowledges for, so the backend applies it with a single update
+const char* ackDeviceTypes = "[\"pump\",\"valve\"]";
+
+void sendScheduleAck(WireType ackType, const String& scheduleId, const String& orgId, const String& scheduleStatus) {
+#if WIRE_FORMAT == WIRE_FORMAT_MSGPACK
+  uint8_t ackPayload[96];
+  WireWriter w(ackPayload, sizeof(ackPayload));
+  w.begin(ackType, 5);
+  w.putKey(WK_SCHEDULE_ID);
+  w.putUuid(scheduleId.c_str());
+  w.putKey(WK_ORG_ID);
+  w.putUuid(orgId.c_str());
+  w.putKey(WK_SCHEDULE_STATUS);
+  w.putStr(scheduleStatus.c_str());
+  w.putKey(WK_DEVICE_TYPES);
+  w.putArray(2);
+  w.putUint(SCHEDULE_DEVICE_PUMP);
+  w.putUint(SCHEDULE_DEVICE_VALVE);
+  w.putKey(WK_ACK);
+  w.putBool(true);
+  int len = w.ok ? w.len : -1;
+  const char* topic = acc1Wire;
+#else
+  char ackPayload[256];
+  int len = snprintf(ackPayload, sizeof(ackPayload),
+                     "{\"type\":\"%s\",\"data\":{\"schedule_id\":\"%s\",\"org_id\":\"%s\",\"schedule_status\":\"%s\",\"device_types\":%s,\"ack\":true}}",
+                     WIRE_TYPE_NAMES[ackType], scheduleId.c_str(), orgId.c_str(), scheduleStatus.c_str(), ackDeviceTypes);
+  if (len >= (int)sizeof(ackPayload)) len = -1;
+  const char* topic = acc1;
+#endif
+  if (len < 0) {
+    LOGF(LOG_ACK_TOO_LARGE);
+    return;
+  }
 
-  client.publish(acc1, ackPayload.c_str());
-  Serial.println("📤 Sent ACK for device: " + newDeviceType);
+  client.publish(topic, (const uint8_t*)ackPayload, len, false);
+  LOGF(LOG_ACK_SENT, WIRE_TYPE_NAMES[ackType], logShortId(scheduleId.c_str()));
 }
 
 void checkAndTriggerSchedules() {
-  time_t now = time(nullptr);
   struct tm timeinfo;
-  localtime_r(&now, &timeinfo);
-
-  char currentTime[6];
-  sprintf(currentTime, "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
+  uint32_t nowSec = scheduleSecondOfDay(scheduleClockUs(), timeinfo);
+  refreshScheduleIndex(timeinfo);
 
-  Serial.printf("🕒 Current Time: %s\n", currentTime);
+  LOGF(LOG_SCHEDULE_TICK, timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
 
   // 🚰 Check Valve Schedules
-  bool valveMatchFound = false;
-  for (int i = 0; i < valveSchedules.size(); i++) {
-    String start = valveSchedules[i].start_time;
-    String end = valveSchedules[i].end_time;
-
-    Serial.printf("🔍 Valve Schedule %d - Start: %s | End: %s\n", i + 1, start.c_str(), end.c_str());
-
-    if (timeInRange(currentTime, start, end)) {
-      valveMatchFound = true;
-      if (!valveIsOn) {
-        // sendRS485Command(CMD_PUMP_ON );
-        valveIsOn = true;
-        digitalWrite(2, HIGH);
-        updateDeviceStatus(updateDeviceStatusApi, org_id, valve_id, "valve", "OPEN");
-        valveManuallyOverridden = false;
-        // logDeviceStateToCloud("pump", true);
-        Serial.println("✅ Pump turned ON by schedule");
-      }
-    }
+  bool valveMatchFound = scheduleIndex.activeAt(nowSec);
+  if (valveMatchFound && !valveIsOn) {
+    // sendRS485Command(CMD_PUMP_ON );
+    valveIsOn = true;
+    digitalWrite(2, HIGH);
+    enqueueStatusReport(SCHEDULE_DEVICE_VALVE, true);
+    valveManuallyOverridden = false;
+    // logDeviceStateToCloud("pump", true);
+    LOGF(LOG_VALVE_ON);
   }
 
   if (!valveMatchFound) {
@@ -841,42 +1555,13 @@ void checkAndTriggerSchedules() {
       // sendRS485Command(CMD_PUMP_OFF);
       valveIsOn = false;
       digitalWrite(2, LOW);
-      Serial.println("⛔ Pump turned OFF (schedule expired)");
-      updateDeviceStatus(updateDeviceStatusApi, org_id, valve_id, "valve", "CLOSE");
+      LOGF(LOG_VALVE_OFF);
+      enqueueStatusReport(SCHEDULE_DEVICE_VALVE, false);
       // logDeviceStateToCloud("pump", false);
     } else {
-      Serial.println("🟡 No valve schedule match, preserving previous state");
+      LOGF(LOG_VALVE_NO_MATCH);
     }
   }
 
   valveScheduleMatched = valveMatchFound;
 }
-void sendScheduleUpdateAck(String scheduleId, String scheduleStatus, String orgId, String startTime, String endTime, String deviceType) {
-  StaticJsonDocument<256> ackDoc;
-  ackDoc["type"] = "SCHEDULE_ACK_UPDATE";
-  JsonObject data = ackDoc.createNestedObject("data");
-  data["schedule_id"] = scheduleId;
-  data["schedule_status"] = scheduleStatus;
-  data["org_id"] = orgId;
-  data["start_time"] = startTime;
-  data["end_time"] = endTime;
-  data["device_type"] = deviceType;
-  data["ack"] = true;
-  String ackPayload;
-  serializeJson(ackDoc, ackPayload);
-  client.publish(acc1, ackPayload.c_str());
-}
-
-void sendScheduleDeleteAck(String scheduleId, String scheduleStatus, String orgId, String deviceType) {
-  StaticJsonDocument<256> ackDoc;
-  ackDoc["type"] = "SCHEDULE_ACK_DELETE";
-  JsonObject data = ackDoc.createNestedObject("data");
-  data["schedule_id"] = scheduleId;
-  data["schedule_status"] = scheduleStatus;
-  data["org_id"] = orgId;
-  data["device_type"] = deviceType;
-  data["ack"] = true;
-  String ackPayload;
-  serializeJson(ackDoc, ackPayload);
-  client.publish(acc1, ackPayload.c_str());
-}
@@ -0,0 +1,74 @@
+// Arduino.cpp
+// GPIO record and the ESP object.
+#include "Arduino.h"
+
+#include <mutex>
+
+EspClass ESP;
+
+namespace {
+
+struct PinState {
+  uint8_t mode;
+  uint8_t level;
+  uint32_t writes;
+  int64_t changedAtUs;
+};
+
+std::mutex pinLock;
+PinState pins[HOST_PIN_COUNT];
+bool pinsInitialized = false;
+
+PinState* pinState(uint8_t pin) {
+  if (!pinsInitialized) {
+    for (PinState& p : pins) p = PinState{ 0, LOW, 0, -1 };
+    pinsInitialized = true;
+  }
+  return pin < HOST_PIN_COUNT ? &pins[pin] : nullptr;
+}
+
+}  // namespace
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  std::lock_guard<std::mutex> g(pinLock);
+  if (PinState* p = pinState(pin)) p->mode = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  std::lock_guard<std::mutex> g(pinLock);
+  PinState* p = pinState(pin);
+  if (!p) return;
+  level = level ? HIGH : LOW;
+  if (p->level != level) p->changedAtUs = hostClockUs();
+  p->level = level;
+  p->writes++;
+}
+
+int digitalRead(uint8_t pin) {
+  std::lock_guard<std::mutex> g(pinLock);
+  PinState* p = pinState(pin);
+  return p ? p->level : LOW;
+}
+
+int64_t hostPinChangedAtUs(uint8_t pin) {
+  std::lock_guard<std::mutex> g(pinLock);
+  PinState* p = pinState(pin);
+  return p ? p->changedAtUs : -1;
+}
+
+uint32_t hostPinWrites(uint8_t pin) {
+  std::lock_guard<std::mutex> g(pinLock);
+  PinState* p = pinState(pin);
+  return p ? p->writes : 0;
+}
+
+void hostPinsReset() {
+  std::lock_guard<std::mutex> g(pinLock);
+  pinsInitialized = false;
+}
+
+void EspClass::restart() {
+  fflush(stdout);
+  fprintf(stderr, "ESP.restart() called at %lld us\n", (long long)hostClockUs());
+  exit(EXIT_FAILURE);
+}
@@ -0,0 +1,68 @@
+// Arduino.h (host shim)
+// Just enough of the Arduino-ESP32 core to build the firmware's logic on
+// Linux: time from HostClock, recorded GPIO, the fake UARTs, String,
+// FreeRTOS and ESP. Build with -I host; see CMakeLists.txt.
+#pragma once
+
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+#include "Esp.h"
+#include "HardwareSerial.h"
+#include "HostClock.h"
+#include "Print.h"
+#include "WString.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0x01
+#define OUTPUT  0x03
+#define INPUT_PULLUP 0x05
+
+#define HOST_PIN_COUNT 64
+
+using std::max;
+using std::min;
+
+inline unsigned long millis() { return (unsigned long)(hostClockUs() / 1000); }
+inline unsigned long micros() { return (unsigned long)hostClockUs(); }
+inline void delay(uint32_t ms) { hostSleepUs((int64_t)ms * 1000); }
+inline void delayMicroseconds(uint32_t us) { hostSleepUs(us); }
+inline void yield() {}
+inline float temperatureRead() { return 40.0f; }
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+
+// ---- Host side: what the firmware did to a pin, and when
+int64_t hostPinChangedAtUs(uint8_t pin);   // last level change, -1 if never
+uint32_t hostPinWrites(uint8_t pin);       // digitalWrite() calls
+void hostPinsReset();
+
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
@@ -0,0 +1,16 @@
+// Client.h (host shim)
+// Network clients carry no bytes on the host; PubSubClient and HTTPClient
+// talk to the in-process broker and HTTP stub instead.
+#pragma once
+
+#include "Print.h"
+
+class Client : public Stream {
+ public:
+  size_t write(uint8_t) override { return 1; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  virtual void stop() {}
+  virtual uint8_t connected() { return 1; }
+};
@@ -0,0 +1,20 @@
+// Esp.h (host shim)
+#pragma once
+
+#include <stdint.h>
+#include "HostClock.h"
+#include "HostHeap.h"
+
+class EspClass {
+ public:
+  uint32_t getHeapSize() { return HOST_HEAP_SIZE; }
+  uint32_t getFreeHeap() { return HOST_HEAP_SIZE - hostHeapStats().current; }
+  uint32_t getMinFreeHeap() { return HOST_HEAP_SIZE - hostHeapStats().peak; }
+  uint32_t getCpuFreqMHz() { return 240; }
+  // 240 MHz worth of cycles on the host clock, wrapping like the real one
+  uint32_t getCycleCount() { return (uint32_t)(hostClockUs() * 240); }
+  // Nothing to reboot into: a restart inside a test is a failure
+  [[noreturn]] void restart();
+};
+
+extern EspClass ESP;
@@ -0,0 +1,216 @@
+// FreeRTOS.cpp
+// Tasks, notifications and queues on top of HostClock's wait primitive.
+#include "freertos/FreeRTOS.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+#include "HostClock.h"
+#include "HostInternal.h"
+
+struct HostTask {
+  std::thread thread;
+  const char* name;
+  BaseType_t core;
+  uint32_t notify;   // guarded by hostMutex
+  TaskFunction_t fn;
+  void* arg;
+};
+
+struct HostQueue {
+  size_t length;
+  size_t itemSize;
+  std::deque<std::vector<uint8_t> > items;   // guarded by hostMutex
+};
+
+namespace {
+
+// Arduino runs setup()/loop() on core 1
+HostTask mainTask = { std::thread(), "loopTask", 1, 0, nullptr, nullptr };
+thread_local HostTask* currentTask = nullptr;
+std::vector<HostTask*> tasks;   // started threads, guarded by hostMutex
+
+HostTask* self() { return currentTask ? currentTask : &mainTask; }
+
+void taskMain(HostTask* t) {
+  currentTask = t;
+  hostMarkTaskThread();
+  try {
+    t->fn(t->arg);
+  } catch (const HostTaskExit&) {
+  }
+}
+
+}  // namespace
+
+void hostStopTasks() {
+  std::vector<HostTask*> stopping;
+  {
+    std::lock_guard<std::mutex> g(hostMutex);
+    hostStopping = true;
+    stopping.swap(tasks);
+  }
+  hostCv.notify_all();
+  for (HostTask* t : stopping) {
+    if (t->thread.joinable()) t->thread.join();
+    delete t;
+  }
+  std::lock_guard<std::mutex> g(hostMutex);
+  hostStopping = false;
+  mainTask.notify = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Tasks
+// ---------------------------------------------------------------------------
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t, void* arg, UBaseType_t,
+                                   TaskHandle_t* created, BaseType_t core) {
+  if (!hostClockIsRealTime()) {
+    fprintf(stderr, "host shim: task \"%s\" needs the real-time clock, call hostClockReset(true)\n", name);
+    abort();
+  }
+  HostTask* t = new HostTask{ std::thread(), name, core, 0, fn, arg };
+  {
+    std::lock_guard<std::mutex> g(hostMutex);
+    tasks.push_back(t);
+    if (created) *created = t;
+  }
+  t->thread = std::thread(taskMain, t);
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg, UBaseType_t priority,
+                       TaskHandle_t* created) {
+  return xTaskCreatePinnedToCore(fn, name, stackDepth, arg, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if ((task == nullptr || task == currentTask) && hostOnTaskThread()) throw HostTaskExit();
+  fprintf(stderr, "host shim: vTaskDelete() only ends the calling task\n");
+  abort();
+}
+
+void vTaskDelay(TickType_t ticks) { hostSleepUs((int64_t)ticks * 1000); }
+
+BaseType_t xTaskDelayUntil(TickType_t* previousWake, TickType_t increment) {
+  *previousWake += increment;
+  int64_t wakeUs = (int64_t)*previousWake * 1000;
+  bool late = hostClockUs() >= wakeUs;
+  hostClockWaitUntil(wakeUs, [] { return false; });
+  return late ? pdFALSE : pdTRUE;
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t increment) { xTaskDelayUntil(previousWake, increment); }
+
+TickType_t xTaskGetTickCount() { return (TickType_t)(hostClockUs() / 1000); }
+TaskHandle_t xTaskGetCurrentTaskHandle() { return self(); }
+const char* pcTaskGetName(TaskHandle_t task) { return (task ? task : self())->name; }
+BaseType_t xPortGetCoreID() { return self()->core; }
+
+void taskYIELD() {
+  std::this_thread::yield();
+  std::lock_guard<std::mutex> g(hostMutex);
+  if (hostStopping && hostOnTaskThread()) throw HostTaskExit();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  HostTask* t = self();
+  std::unique_lock<std::mutex> lk(hostMutex);
+  hostWaitLocked(lk, hostTicksDeadline(ticks), [t] { return t->notify > 0; });
+  uint32_t value = t->notify;
+  if (value) t->notify = clearOnExit ? 0 : value - 1;
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> g(hostMutex);
+    task->notify++;
+  }
+  hostCv.notify_all();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+  xTaskNotifyGive(task);
+  if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdTRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Queues
+// ---------------------------------------------------------------------------
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  if (length == 0) return nullptr;
+  return new HostQueue{ length, itemSize, {} };
+}
+
+void vQueueDelete(QueueHandle_t q) { delete q; }
+
+static BaseType_t queueSend(QueueHandle_t q, const void* item, TickType_t ticks, bool front) {
+  std::unique_lock<std::mutex> lk(hostMutex);
+  if (!hostWaitLocked(lk, hostTicksDeadline(ticks), [q] { return q->items.size() < q->length; })) {
+    return errQUEUE_FULL;
+  }
+  std::vector<uint8_t> bytes(q->itemSize);
+  if (q->itemSize) memcpy(bytes.data(), item, q->itemSize);
+  if (front) q->items.push_front(std::move(bytes));
+  else q->items.push_back(std::move(bytes));
+  lk.unlock();
+  hostCv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks) { return queueSend(q, item, ticks, false); }
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void* item, TickType_t ticks) {
+  return queueSend(q, item, ticks, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* higherPriorityTaskWoken) {
+  if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+  return queueSend(q, item, 0, false);
+}
+
+static BaseType_t queueReceive(QueueHandle_t q, void* out, TickType_t ticks, bool remove) {
+  std::unique_lock<std::mutex> lk(hostMutex);
+  if (!hostWaitLocked(lk, hostTicksDeadline(ticks), [q] { return !q->items.empty(); })) return errQUEUE_EMPTY;
+  if (q->itemSize && out) memcpy(out, q->items.front().data(), q->itemSize);
+  if (!remove) return pdTRUE;
+  q->items.pop_front();
+  lk.unlock();
+  hostCv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* out, TickType_t ticks) { return queueReceive(q, out, ticks, true); }
+BaseType_t xQueuePeek(QueueHandle_t q, void* out, TickType_t ticks) { return queueReceive(q, out, ticks, false); }
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> g(hostMutex);
+  return q->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q) {
+  std::lock_guard<std::mutex> g(hostMutex);
+  return q->length - q->items.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t q) {
+  {
+    std::lock_guard<std::mutex> g(hostMutex);
+    q->items.clear();
+  }
+  hostCv.notify_all();
+  return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  SemaphoreHandle_t s = xQueueCreate(1, 0);
+  xQueueSend(s, nullptr, 0);  // a mutex starts out given
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return xQueueCreate(1, 0); }
@@ -0,0 +1,115 @@
+// HTTPClient.cpp
+// Local HTTP stub behind the HTTPClient shim.
+#include "HTTPClient.h"
+
+#include <atomic>
+#include <mutex>
+
+#include "HostClock.h"
+
+namespace {
+
+std::mutex routeLock;
+std::vector<std::pair<std::string, HostHttpHandler> > routes;
+bool offline = false;
+std::atomic<uint32_t> requestCount{0};
+
+}  // namespace
+
+void hostHttpRoute(const char* urlPrefix, HostHttpHandler handler) {
+  std::lock_guard<std::mutex> g(routeLock);
+  routes.push_back({ urlPrefix, handler });
+}
+
+void hostHttpSetOffline(bool off) {
+  std::lock_guard<std::mutex> g(routeLock);
+  offline = off;
+}
+
+void hostHttpReset() {
+  std::lock_guard<std::mutex> g(routeLock);
+  routes.clear();
+  offline = false;
+  requestCount = 0;
+}
+
+uint32_t hostHttpRequestCount() { return requestCount; }
+
+bool HTTPClient::begin(const String& url) {
+  request_ = HostHttpRequest();
+  request_.url = url.str();
+  response_ = HostHttpResponse();
+  stream_.reset("");
+  return !url.isEmpty();
+}
+
+void HTTPClient::end() {
+  request_.headers.clear();
+}
+
+void HTTPClient::collectHeaders(const char* keys[], size_t count) {
+  collect_.assign(keys, keys + count);
+}
+
+String HTTPClient::header(const char* name) {
+  for (const std::string& k : collect_) {
+    if (k != name) continue;
+    auto it = response_.headers.find(k);
+    return it == response_.headers.end() ? String() : String(it->second);
+  }
+  return String();
+}
+
+int HTTPClient::send(const char* method, const std::string& body) {
+  requestCount++;
+  request_.method = method;
+  request_.body = body;
+  response_ = HostHttpResponse();
+  stream_.reset("");
+
+  HostHttpHandler handler;
+  bool down;
+  {
+    std::lock_guard<std::mutex> g(routeLock);
+    down = offline;
+    size_t best = 0;
+    for (auto& r : routes) {
+      if (r.first.size() >= best && request_.url.compare(0, r.first.size(), r.first) == 0) {
+        best = r.first.size();
+        handler = r.second;
+      }
+    }
+  }
+  if (down) {
+    hostSleepUs((int64_t)timeoutMs_ * 1000);
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  if (!handler) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+  HostHttpResponse r = handler(request_);
+  if (r.latency_ms > timeoutMs_) {
+    hostSleepUs((int64_t)timeoutMs_ * 1000);
+    return HTTPC_ERROR_READ_TIMEOUT;
+  }
+  hostSleepUs((int64_t)r.latency_ms * 1000);
+  response_ = r;
+  stream_.reset(response_.body);
+  return response_.code;
+}
+
+String HTTPClient::errorToString(int code) {
+  switch (code) {
+    case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+    case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST: return "connection lost";
+    case HTTPC_ERROR_NO_STREAM: return "no stream";
+    case HTTPC_ERROR_NO_HTTP_SERVER: return "no HTTP server";
+    case HTTPC_ERROR_TOO_LESS_RAM: return "too less ram";
+    case HTTPC_ERROR_ENCODING: return "Transfer-Encoding not supported";
+    case HTTPC_ERROR_STREAM_WRITE: return "Stream write error";
+    case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+    default: return String();
+  }
+}
@@ -0,0 +1,110 @@
+// HTTPClient.h (host shim)
+// HTTPClient against local handlers instead of a socket. A request goes to
+// the handler with the longest matching URL prefix; the handler's latency
+// is spent on the host clock, and anything slower than the client's
+// timeout ends as HTTPC_ERROR_READ_TIMEOUT after exactly that timeout.
+//
+//   hostHttpRoute("https://api/", [](const HostHttpRequest& r) {
+//     return HostHttpResponse{ 200, "{\"state\":\"1\"}", 40 };   // 40 ms
+//   });
+//   hostHttpSetOffline(true);          // every call times out
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "Client.h"
+#include "WString.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_STREAM           (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_ENCODING            (-9)
+#define HTTPC_ERROR_STREAM_WRITE        (-10)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+#define HTTP_CODE_OK            200
+#define HTTP_CODE_NOT_MODIFIED  304
+
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT 5000
+
+struct HostHttpRequest {
+  std::string method;
+  std::string url;
+  std::string body;
+  std::map<std::string, std::string> headers;
+};
+
+struct HostHttpResponse {
+  int code;
+  std::string body;
+  uint32_t latency_ms;
+  std::map<std::string, std::string> headers;
+};
+
+typedef std::function<HostHttpResponse(const HostHttpRequest&)> HostHttpHandler;
+
+void hostHttpRoute(const char* urlPrefix, HostHttpHandler handler);
+// Offline, every request waits out its timeout and fails
+void hostHttpSetOffline(bool offline);
+void hostHttpReset();
+uint32_t hostHttpRequestCount();
+
+// Body of the last response, read like a socket
+class HostHttpStream : public Stream {
+ public:
+  void reset(const std::string& body) {
+    body_ = body;
+    pos_ = 0;
+  }
+  int available() override { return body_.size() - pos_; }
+  int read() override { return pos_ < body_.size() ? (uint8_t)body_[pos_++] : -1; }
+  int peek() override { return pos_ < body_.size() ? (uint8_t)body_[pos_] : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+ private:
+  std::string body_;
+  size_t pos_ = 0;
+};
+
+class HTTPClient {
+ public:
+  bool begin(const String& url);
+  bool begin(Client&, const String& url) { return begin(url); }
+  void end();
+  void setTimeout(uint16_t ms) { timeoutMs_ = ms; }
+  void setConnectTimeout(int32_t) {}
+  void setReuse(bool) {}
+  void useHTTP10(bool) {}
+  void addHeader(const String& name, const String& value) { request_.headers[name.str()] = value.str(); }
+  void collectHeaders(const char* keys[], size_t count);
+  String header(const char* name);
+
+  int GET() { return send("GET", ""); }
+  int POST(const String& body) { return send("POST", body.str()); }
+  int POST(const uint8_t* body, size_t n) { return send("POST", std::string((const char*)body, n)); }
+  int PUT(const String& body) { return send("PUT", body.str()); }
+  int sendRequest(const char* method, const String& body) { return send(method, body.str()); }
+
+  String getString() { return String(response_.body); }
+  int getSize() { return response_.body.size(); }
+  Stream& getStream() { return stream_; }
+  static String errorToString(int code);
+
+ private:
+  int send(const char* method, const std::string& body);
+
+  HostHttpRequest request_;
+  HostHttpResponse response_;
+  HostHttpStream stream_;
+  std::vector<std::string> collect_;
+  uint16_t timeoutMs_ = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+};
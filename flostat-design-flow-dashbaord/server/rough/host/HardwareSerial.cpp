@@ -0,0 +1,80 @@
+// HardwareSerial.cpp
+#include "HardwareSerial.h"
+
+#include <unistd.h>
+#include <atomic>
+
+#include "HostClock.h"
+
+HardwareSerial Serial(0);
+
+static std::atomic<bool> consoleEcho{true};
+
+void hostConsoleEcho(bool on) { consoleEcho = on; }
+
+void hostUartConnect(HardwareSerial& a, HardwareSerial& b) {
+  a.linked_ = &b;
+  b.linked_ = &a;
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t, int8_t, int8_t, bool, unsigned long) {
+  if (baud) byteTimeUs_ = (10 * 1000000LL + baud - 1) / baud;  // start + 8 data + stop
+}
+
+int HardwareSerial::available() {
+  std::lock_guard<std::mutex> g(rxLock_);
+  int64_t now = hostClockUs();
+  int n = 0;
+  for (const RxByte& r : rx_) {
+    if (r.atUs > now) break;
+    n++;
+  }
+  return n;
+}
+
+int HardwareSerial::read() {
+  std::lock_guard<std::mutex> g(rxLock_);
+  if (rx_.empty() || rx_.front().atUs > hostClockUs()) return -1;
+  uint8_t b = rx_.front().b;
+  rx_.pop_front();
+  return b;
+}
+
+int HardwareSerial::peek() {
+  std::lock_guard<std::mutex> g(rxLock_);
+  if (rx_.empty() || rx_.front().atUs > hostClockUs()) return -1;
+  return rx_.front().b;
+}
+
+void HardwareSerial::flush() {
+  int64_t until = txBusyUntilUs_;
+  if (until > hostClockUs()) hostSleepUs(until - hostClockUs());
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t n) {
+  bytesWritten_ += n;
+  if (uart_ == 0 && !peer_ && !linked_) {
+    if (consoleEcho) ::write(1, buf, n);
+    return n;
+  }
+
+  int64_t now = hostClockUs();
+  int64_t at = txBusyUntilUs_ > now ? txBusyUntilUs_ : now;
+  for (size_t i = 0; i < n; i++) {
+    at += byteTimeUs_;
+    if (linked_) linked_->hostReceive(&buf[i], 1, at - linked_->byteTimeUs_);
+    if (peer_) peer_->onUartByte(*this, buf[i], at);
+  }
+  txBusyUntilUs_ = at;
+  return n;
+}
+
+void HardwareSerial::hostReceive(const uint8_t* buf, size_t n, int64_t startUs) {
+  std::lock_guard<std::mutex> g(rxLock_);
+  int64_t at = startUs;
+  if (!rx_.empty() && rx_.back().atUs > at) at = rx_.back().atUs;
+  for (size_t i = 0; i < n; i++) {
+    at += byteTimeUs_;
+    rx_.push_back({ at, buf[i] });
+  }
+}
@@ -0,0 +1,84 @@
+// HardwareSerial.h (host shim)
+// A UART on the host clock. write() returns at once, like filling the
+// device's TX FIFO, and the bytes then leave one by one at the configured
+// baud rate (10 bits per byte for 8N1). Whatever is attached to the far end
+// sees each byte at the moment its stop bit is sent; received bytes only
+// show up in available() once their arrival time has passed.
+//
+//   HardwareSerial a(1), b(2);
+//   hostUartConnect(a, b);             // null-modem loopback
+//   a.begin(4800); b.begin(4800);
+//   a.write(frame, 6);                 // b.available() == 6 after 12.5 ms
+//
+// Serial (UART 0) with nothing attached prints to stdout, which benchmarks
+// turn off with hostConsoleEcho(false).
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include "Print.h"
+
+#define SERIAL_8N1 0x800001c
+
+class HardwareSerial;
+
+// Far end of a fake UART, e.g. a simulated field controller. Called with
+// the shim lock released; it may inject a reply with hostReceive().
+class HostUartPeer {
+ public:
+  virtual ~HostUartPeer() {}
+  virtual void onUartByte(HardwareSerial& from, uint8_t b, int64_t atUs) = 0;
+};
+
+class HardwareSerial : public Stream {
+ public:
+  explicit HardwareSerial(int uartNum) : uart_(uartNum) {}
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1,
+             bool invert = false, unsigned long timeoutMs = 20000UL);
+  void end() {}
+  operator bool() const { return true; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override;   // blocks until the last byte has left the wire
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t n) override;
+  using Print::write;
+
+  // ---- Host side
+  // Microseconds on the wire per byte at the current baud rate
+  int64_t byteTimeUs() const { return byteTimeUs_; }
+  void hostAttach(HostUartPeer* peer) { peer_ = peer; }
+  // Queue bytes that start arriving at startUs, back to back at our baud
+  void hostReceive(const uint8_t* buf, size_t n, int64_t startUs);
+  uint64_t hostBytesWritten() const { return bytesWritten_; }
+
+ private:
+  friend void hostUartConnect(HardwareSerial& a, HardwareSerial& b);
+
+  struct RxByte {
+    int64_t atUs;
+    uint8_t b;
+  };
+
+  int uart_;
+  int64_t byteTimeUs_ = 10 * 1000000 / 115200;
+  int64_t txBusyUntilUs_ = 0;
+  uint64_t bytesWritten_ = 0;
+  HostUartPeer* peer_ = nullptr;
+  HardwareSerial* linked_ = nullptr;
+  std::deque<RxByte> rx_;
+  std::mutex rxLock_;
+};
+
+// Null-modem: what one side writes, the other receives
+void hostUartConnect(HardwareSerial& a, HardwareSerial& b);
+
+// Serial (UART 0) output goes to stdout while this is on (the default)
+void hostConsoleEcho(bool on);
+
+extern HardwareSerial Serial;
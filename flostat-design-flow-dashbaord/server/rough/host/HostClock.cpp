@@ -0,0 +1,221 @@
+// HostClock.cpp
+// Simulated/real clock, the shared wait primitive and esp_timer.
+#include "HostClock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "HostInternal.h"
+#include "esp_timer.h"
+
+std::mutex hostMutex;
+std::condition_variable hostCv;
+bool hostStopping = false;
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void* arg;
+  const char* name;
+  int64_t deadlineUs;
+  int64_t periodUs;   // 0 = one-shot
+  bool active;
+};
+
+namespace {
+
+typedef std::chrono::steady_clock SteadyClock;
+
+bool realTime = false;
+std::atomic<int64_t> simNowUs{0};
+SteadyClock::time_point realEpoch = SteadyClock::now();
+
+std::vector<esp_timer*> timers;   // every created timer, guarded by hostMutex
+std::thread timerThread;          // real time only
+bool timerThreadStop = false;
+
+thread_local bool onTaskThread = false;
+
+SteadyClock::time_point realTimePoint(int64_t us) {
+  return realEpoch + std::chrono::microseconds(us);
+}
+
+// Earliest armed deadline, HOST_FOREVER_US if none; lock held
+int64_t nextTimerDeadline() {
+  int64_t next = HOST_FOREVER_US;
+  for (esp_timer* t : timers) {
+    if (t->active && t->deadlineUs < next) next = t->deadlineUs;
+  }
+  return next;
+}
+
+// Run every timer that is due, earliest first. The lock is dropped around
+// each callback, which may re-arm timers or notify tasks.
+void fireDueTimers(std::unique_lock<std::mutex>& lk) {
+  for (;;) {
+    int64_t now = hostClockUs();
+    esp_timer* due = nullptr;
+    for (esp_timer* t : timers) {
+      if (t->active && t->deadlineUs <= now && (!due || t->deadlineUs < due->deadlineUs)) due = t;
+    }
+    if (!due) return;
+    if (due->periodUs) due->deadlineUs += due->periodUs;
+    else due->active = false;
+    esp_timer_cb_t cb = due->callback;
+    void* arg = due->arg;
+    lk.unlock();
+    cb(arg);
+    lk.lock();
+  }
+}
+
+void timerThreadMain() {
+  std::unique_lock<std::mutex> lk(hostMutex);
+  while (!timerThreadStop) {
+    fireDueTimers(lk);
+    if (timerThreadStop) break;
+    int64_t next = nextTimerDeadline();
+    if (next == HOST_FOREVER_US) hostCv.wait(lk);
+    else hostCv.wait_until(lk, realTimePoint(next));
+  }
+}
+
+}  // namespace
+
+void hostMarkTaskThread() { onTaskThread = true; }
+bool hostOnTaskThread() { return onTaskThread; }
+
+bool hostClockIsRealTime() { return realTime; }
+
+int64_t hostClockUs() {
+  if (!realTime) return simNowUs.load(std::memory_order_relaxed);
+  return std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - realEpoch).count();
+}
+
+void hostClockReset(bool rt) {
+  hostStopTasks();
+  {
+    std::lock_guard<std::mutex> g(hostMutex);
+    timerThreadStop = true;
+  }
+  hostCv.notify_all();
+  if (timerThread.joinable()) timerThread.join();
+
+  std::lock_guard<std::mutex> g(hostMutex);
+  for (esp_timer* t : timers) t->active = false;
+  simNowUs = 0;
+  realEpoch = SteadyClock::now();
+  realTime = rt;
+  timerThreadStop = false;
+  if (realTime) timerThread = std::thread(timerThreadMain);
+}
+
+bool hostWaitLocked(std::unique_lock<std::mutex>& lk, int64_t deadlineUs, const std::function<bool()>& done) {
+  if (!realTime) {
+    for (;;) {
+      fireDueTimers(lk);
+      if (done()) return true;
+      int64_t now = simNowUs;
+      if (now >= deadlineUs) return false;
+      int64_t next = nextTimerDeadline();
+      if (next > deadlineUs) next = deadlineUs;
+      if (next == HOST_FOREVER_US) {
+        fprintf(stderr, "host clock: blocked forever with no timer armed\n");
+        abort();
+      }
+      if (next > now) simNowUs = next;
+    }
+  }
+
+  for (;;) {
+    if (done()) return true;
+    if (hostStopping && onTaskThread) throw HostTaskExit();
+    if (hostClockUs() >= deadlineUs) return false;
+    if (deadlineUs == HOST_FOREVER_US) hostCv.wait(lk);
+    else hostCv.wait_until(lk, realTimePoint(deadlineUs));
+  }
+}
+
+int64_t hostTicksDeadline(uint32_t ticks) {
+  if (ticks == 0xFFFFFFFFUL) return HOST_FOREVER_US;  // portMAX_DELAY
+  return hostClockUs() + (int64_t)ticks * 1000;
+}
+
+bool hostClockWaitUntil(int64_t deadlineUs, const std::function<bool()>& done) {
+  std::unique_lock<std::mutex> lk(hostMutex);
+  return hostWaitLocked(lk, deadlineUs, done);
+}
+
+void hostClockAdvanceUs(int64_t us) {
+  if (realTime) {
+    fprintf(stderr, "host clock: hostClockAdvanceUs() needs the simulated clock\n");
+    abort();
+  }
+  hostClockWaitUntil(hostClockUs() + us, [] { return false; });
+}
+
+void hostSleepUs(int64_t us) {
+  hostClockWaitUntil(hostClockUs() + us, [] { return false; });
+}
+
+void hostClockWake() { hostCv.notify_all(); }
+
+// ---------------------------------------------------------------------------
+// esp_timer
+// ---------------------------------------------------------------------------
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  if (!args || !args->callback || !out) return ESP_ERR_INVALID_ARG;
+  esp_timer* t = new esp_timer{ args->callback, args->arg, args->name, 0, 0, false };
+  std::lock_guard<std::mutex> g(hostMutex);
+  timers.push_back(t);
+  *out = t;
+  return ESP_OK;
+}
+
+static esp_err_t startTimer(esp_timer_handle_t t, uint64_t us, bool periodic) {
+  if (!t) return ESP_ERR_INVALID_ARG;
+  {
+    std::lock_guard<std::mutex> g(hostMutex);
+    if (t->active) return ESP_ERR_INVALID_STATE;
+    t->deadlineUs = hostClockUs() + (int64_t)us;
+    t->periodUs = periodic ? (int64_t)us : 0;
+    t->active = true;
+  }
+  hostCv.notify_all();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t us) { return startTimer(t, us, false); }
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t us) { return startTimer(t, us, true); }
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+  if (!t) return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> g(hostMutex);
+  if (!t->active) return ESP_ERR_INVALID_STATE;
+  t->active = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t) {
+  if (!t) return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> g(hostMutex);
+  if (t->active) return ESP_ERR_INVALID_STATE;
+  for (size_t i = 0; i < timers.size(); i++) {
+    if (timers[i] == t) {
+      timers.erase(timers.begin() + i);
+      break;
+    }
+  }
+  delete t;
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t t) {
+  std::lock_guard<std::mutex> g(hostMutex);
+  return t && t->active;
+}
+
+int64_t esp_timer_get_time() { return hostClockUs(); }
@@ -0,0 +1,42 @@
+// HostClock.h
+// The clock behind the shimmed millis(), micros(), delay(), FreeRTOS ticks
+// and esp_timer on the host build.
+//
+// Simulated (the default): time only moves when something advances it, a
+// test through hostClockAdvanceUs() or the code under test through delay()
+// or a FreeRTOS call that waits with a timeout. Due esp_timers fire inline
+// at their exact deadline, so a run is deterministic and a simulated day
+// takes milliseconds.
+//
+// Real time: steady_clock, delay() sleeps and esp_timers fire from their own
+// thread. Needed as soon as tasks run on threads, since a simulated clock
+// can only have one owner.
+//
+//   hostClockReset();                  // simulated, t = 0
+//   hostClockAdvanceUs(1500);
+//   hostClockReset(true);              // real time for a threaded test
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+// Back to t = 0; stops every task and timer of the previous run first
+void hostClockReset(bool realTime = false);
+bool hostClockIsRealTime();
+
+int64_t hostClockUs();
+
+// Simulated only: move time forward, firing due timers on the way
+void hostClockAdvanceUs(int64_t us);
+
+// Block until done() holds or the clock reaches deadlineUs, whichever is
+// first, and return done(). Simulated, this jumps from timer to timer; it
+// is how the shimmed blocking calls wait on a single thread.
+bool hostClockWaitUntil(int64_t deadlineUs, const std::function<bool()>& done);
+
+// delay(): advances simulated time, sleeps in real time
+void hostSleepUs(int64_t us);
+
+// Real time only: threads blocked in shimmed calls sleep here so that
+// hostStopTasks() can wake them
+void hostClockWake();
@@ -0,0 +1,63 @@
+// HostHeap.cpp
+// Global operator new/delete with a size header in front of each block.
+#include "HostHeap.h"
+
+#include <cstddef>
+#include <stdlib.h>
+#include <cstddef>
+#include <atomic>
+#include <new>
+
+namespace {
+
+std::atomic<size_t> liveBytes{0};
+std::atomic<size_t> peakBytes{0};
+std::atomic<uint64_t> allocCount{0};
+std::atomic<uint64_t> freeCount{0};
+
+// Keeps the block after it aligned for any fundamental type
+const size_t kHeader = alignof(std::max_align_t);
+
+void* countedAlloc(size_t n) {
+  char* p = (char*)malloc(n + kHeader);
+  if (!p) return nullptr;
+  *(size_t*)p = n;
+  size_t now = liveBytes.fetch_add(n, std::memory_order_relaxed) + n;
+  size_t peak = peakBytes.load(std::memory_order_relaxed);
+  while (now > peak && !peakBytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+  }
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  return p + kHeader;
+}
+
+void countedFree(void* ptr) {
+  if (!ptr) return;
+  char* p = (char*)ptr - kHeader;
+  liveBytes.fetch_sub(*(size_t*)p, std::memory_order_relaxed);
+  freeCount.fetch_add(1, std::memory_order_relaxed);
+  free(p);
+}
+
+}  // namespace
+
+HostHeapStats hostHeapStats() {
+  HostHeapStats s = { liveBytes.load(), peakBytes.load(), allocCount.load(), freeCount.load() };
+  return s;
+}
+
+void hostHeapResetPeak() { peakBytes.store(liveBytes.load()); }
+
+void* operator new(size_t n) {
+  void* p = countedAlloc(n);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t n) { return operator new(n); }
+void* operator new(size_t n, const std::nothrow_t&) noexcept { return countedAlloc(n); }
+void* operator new[](size_t n, const std::nothrow_t&) noexcept { return countedAlloc(n); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { countedFree(p); }
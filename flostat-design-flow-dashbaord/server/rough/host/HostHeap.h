@@ -0,0 +1,26 @@
+// HostHeap.h
+// Heap accounting for the host build. Every operator new/delete in the
+// test binary is counted (String, std containers, anything the code under
+// test allocates), so a benchmark can report allocations per call and the
+// peak, and gate on "no heap on this path".
+//
+//   hostHeapResetPeak();
+//   runTheThing();
+//   HostHeapStats s = hostHeapStats();   // s.peak - s.current = transient bytes
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// What ESP.getFreeHeap() subtracts the live bytes from
+#define HOST_HEAP_SIZE (320 * 1024)
+
+struct HostHeapStats {
+  size_t current;    // live bytes
+  size_t peak;       // most live bytes since the last hostHeapResetPeak()
+  uint64_t allocs;   // operator new calls since start
+  uint64_t frees;
+};
+
+HostHeapStats hostHeapStats();
+void hostHeapResetPeak();
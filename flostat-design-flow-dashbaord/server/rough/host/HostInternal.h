@@ -0,0 +1,35 @@
+// HostInternal.h
+// Shared by the shim sources only. Every blocking shim call (task
+// notifications, queues, delay(), esp_timer) waits on one lock and one
+// condition variable, and every state change wakes them all: simple, and
+// far cheaper than anything the code under test does between waits.
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#define HOST_FOREVER_US INT64_MAX
+
+extern std::mutex hostMutex;
+extern std::condition_variable hostCv;
+
+// Thrown out of a blocking call when hostStopTasks() ends the task's thread
+struct HostTaskExit {};
+
+// With lk held: wait until done() (evaluated under the lock) or deadlineUs.
+// Simulated time advances to the next timer instead of sleeping; waiting
+// forever with nothing armed aborts, since nothing could ever wake us.
+bool hostWaitLocked(std::unique_lock<std::mutex>& lk, int64_t deadlineUs, const std::function<bool()>& done);
+
+// hostWaitLocked() deadline for a FreeRTOS timeout in ticks (1 ms)
+int64_t hostTicksDeadline(uint32_t ticks);
+
+// Set while hostStopTasks() winds the task threads down
+extern bool hostStopping;
+void hostMarkTaskThread();
+bool hostOnTaskThread();
+
+// FreeRTOS.cpp: end every task thread and forget the main task's state
+void hostStopTasks();
@@ -0,0 +1,307 @@
+// HostShimTest.cpp
+// The shims behave like the device where the firmware logic depends on it:
+// timing of the clock, timers, UART and blocking calls, MQTT delivery and
+// HTTP timeouts. Every other host test builds on these.
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <PubSubClient.h>
+#include <esp_timer.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+
+static void testSimulatedClock() {
+  hostClockReset();
+  HOST_CHECK_EQ(millis(), 0);
+  delay(1500);
+  HOST_CHECK_EQ(millis(), 1500);
+  delayMicroseconds(250);
+  HOST_CHECK_EQ(micros(), 1500250);
+  HOST_CHECK_EQ(xTaskGetTickCount(), 1500);
+  HOST_CHECK_EQ(ESP.getCycleCount(), (uint32_t)(1500250LL * 240));
+}
+
+static int64_t firedAt[4];
+static int fireCount = 0;
+
+static void recordFire(void*) {
+  if (fireCount < 4) firedAt[fireCount] = esp_timer_get_time();
+  fireCount++;
+}
+
+static void testEspTimer() {
+  hostClockReset();
+  fireCount = 0;
+  esp_timer_handle_t once, periodic;
+  esp_timer_create_args_t args = { recordFire, nullptr, ESP_TIMER_TASK, "t", false };
+  HOST_CHECK_EQ(esp_timer_create(&args, &once), ESP_OK);
+  HOST_CHECK_EQ(esp_timer_create(&args, &periodic), ESP_OK);
+
+  esp_timer_start_once(once, 12345);
+  HOST_CHECK_EQ(esp_timer_start_once(once, 1), ESP_ERR_INVALID_STATE);
+  delay(20);
+  HOST_CHECK_EQ(fireCount, 1);
+  HOST_CHECK_EQ(firedAt[0], 12345);   // at its deadline, not at the end of the delay
+  HOST_CHECK(!esp_timer_is_active(once));
+
+  esp_timer_start_periodic(periodic, 1000);
+  hostClockAdvanceUs(3500);
+  esp_timer_stop(periodic);
+  HOST_CHECK_EQ(fireCount, 4);
+  HOST_CHECK_EQ(firedAt[3], 23000);
+  HOST_CHECK_EQ(esp_timer_stop(periodic), ESP_ERR_INVALID_STATE);
+  esp_timer_delete(once);
+  esp_timer_delete(periodic);
+}
+
+static TaskHandle_t notifyTarget;
+static void notifyMain(void*) { xTaskNotifyGive(notifyTarget); }
+
+static void testBlockingCallsOnSimulatedClock() {
+  hostClockReset();
+  notifyTarget = xTaskGetCurrentTaskHandle();
+  esp_timer_handle_t t;
+  esp_timer_create_args_t args = { notifyMain, nullptr, ESP_TIMER_TASK, "notify", false };
+  esp_timer_create(&args, &t);
+
+  // Woken by the timer at exactly 7.5 ms, well inside the 50 ms timeout
+  esp_timer_start_once(t, 7500);
+  HOST_CHECK_EQ(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50)), 1);
+  HOST_CHECK_EQ(esp_timer_get_time(), 7500);
+
+  // Nothing pending: returns 0 once the timeout has elapsed
+  HOST_CHECK_EQ(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50)), 0);
+  HOST_CHECK_EQ(esp_timer_get_time(), 57500);
+
+  QueueHandle_t q = xQueueCreate(2, sizeof(int));
+  int v = 7, out = 0;
+  HOST_CHECK_EQ(xQueueSend(q, &v, 0), pdTRUE);
+  HOST_CHECK_EQ(xQueueSend(q, &v, 0), pdTRUE);
+  HOST_CHECK_EQ(xQueueSend(q, &v, pdMS_TO_TICKS(5)), errQUEUE_FULL);
+  HOST_CHECK_EQ(millis(), 62);
+  HOST_CHECK_EQ(xQueueReceive(q, &out, 0), pdTRUE);
+  HOST_CHECK_EQ(out, 7);
+  HOST_CHECK_EQ(uxQueueMessagesWaiting(q), 1);
+  vQueueDelete(q);
+
+  SemaphoreHandle_t m = xSemaphoreCreateMutex();
+  HOST_CHECK_EQ(xSemaphoreTake(m, 0), pdTRUE);
+  HOST_CHECK_EQ(xSemaphoreTake(m, 0), pdFALSE);
+  HOST_CHECK_EQ(xSemaphoreGive(m), pdTRUE);
+  vSemaphoreDelete(m);
+  esp_timer_delete(t);
+}
+
+// Answers every 6 byte frame with an ACK, 1 ms after its last byte
+class AckingNode : public HostUartPeer {
+ public:
+  std::vector<uint8_t> rx;
+  void onUartByte(HardwareSerial& from, uint8_t b, int64_t atUs) override {
+    rx.push_back(b);
+    if (rx.size() % 6) return;
+    const uint8_t ack[6] = { 0xAA, rx[rx.size() - 5], 0xA1, 0xCC, 0, 0x55 };
+    from.hostReceive(ack, sizeof(ack), atUs + 1000);
+  }
+};
+
+static void testUart() {
+  hostClockReset();
+  HardwareSerial a(1), b(2);
+  hostUartConnect(a, b);
+  a.begin(4800);
+  b.begin(4800);
+  HOST_CHECK_EQ(a.byteTimeUs(), 2084);
+
+  const uint8_t frame[6] = { 0xAA, 0x01, 0x11, 0x00, 0xBA, 0x55 };
+  HOST_CHECK_EQ(a.write(frame, 6), 6);
+  HOST_CHECK_EQ(micros(), 0);              // write() does not wait for the wire
+  HOST_CHECK_EQ(b.available(), 0);
+  hostClockAdvanceUs(2084);
+  HOST_CHECK_EQ(b.available(), 1);
+  a.flush();                               // the last byte leaves at 6 byte times
+  HOST_CHECK_EQ(micros(), 6 * 2084);
+  HOST_CHECK_EQ(b.available(), 6);
+  uint8_t got[6];
+  HOST_CHECK_EQ(b.readBytes(got, 6), 6);
+  HOST_CHECK(memcmp(got, frame, 6) == 0);
+
+  hostClockReset();
+  HardwareSerial bus(1);
+  AckingNode node;
+  bus.begin(4800);
+  bus.hostAttach(&node);
+  bus.write(frame, 6);
+  hostClockAdvanceUs(6 * 2084 + 1000 + 6 * 2084 - 1);
+  HOST_CHECK_EQ(bus.available(), 5);
+  hostClockAdvanceUs(1);
+  HOST_CHECK_EQ(bus.available(), 6);
+  HOST_CHECK_EQ(bus.read(), 0xAA);
+  HOST_CHECK_EQ(bus.read(), 0x01);
+}
+
+static void testMqtt() {
+  hostClockReset();
+  hostMqttReset();
+  PubSubClient client;
+  std::vector<std::string> got;
+  client.setCallback([&](char* topic, uint8_t* payload, unsigned int length) {
+    got.push_back(std::string(topic) + "=" + std::string((const char*)payload, length));
+  });
+  HOST_CHECK(client.connect("dev"));
+  HOST_CHECK(client.subscribe("flostat/org/command/+/+/+"));
+
+  hostMqttPublish("flostat/org/command/b1/valve/v1", "OPEN");
+  hostMqttPublish("flostat/org/command/b1/valve/v1/hardware", "X");   // one level too deep
+  hostMqttPublish("flostat/org/status/b1", "Y");
+  HOST_CHECK(got.empty());                 // only inside loop()
+  client.loop();
+  HOST_CHECK_EQ(got.size(), 1);
+  HOST_CHECK(got[0] == "flostat/org/command/b1/valve/v1=OPEN");
+  client.loop();
+  HOST_CHECK_EQ(got.size(), 1);
+
+  std::string big(300, 'x');
+  hostMqttPublish("flostat/org/command/b1/valve/v1", big.c_str());
+  client.loop();
+  HOST_CHECK_EQ(got.size(), 1);            // over the 256 byte default buffer
+  client.setBufferSize(1024);
+  hostMqttPublish("flostat/org/command/b1/valve/v1", big.c_str());
+  client.loop();
+  HOST_CHECK_EQ(got.size(), 2);
+
+  int observed = 0;
+  hostMqttSubscribe("flostat/org/ack/#", [&](const char*, const uint8_t*, size_t n) { observed += n; });
+  HOST_CHECK(client.publish("flostat/org/ack/1", "done"));
+  HOST_CHECK_EQ(observed, 4);
+
+  hostMqttSetOnline(false);
+  HOST_CHECK(!client.connected());
+  HOST_CHECK_EQ(client.state(), MQTT_CONNECTION_LOST);
+  HOST_CHECK(!client.publish("flostat/org/ack/1", "lost"));
+  hostMqttSetConnectDelayMs(3000);
+  HOST_CHECK(!client.connect("dev"));
+  HOST_CHECK_EQ(millis(), 3000);           // the failed handshake blocked the caller
+  hostMqttSetOnline(true);
+  HOST_CHECK(client.connect("dev"));
+  hostMqttReset();
+}
+
+static void testHttp() {
+  hostClockReset();
+  hostHttpReset();
+  hostHttpRoute("https://api/", [](const HostHttpRequest& r) {
+    HostHttpResponse res = { 200, "{\"state\":\"1\"}", 40, {} };
+    res.headers["ETag"] = "\"v2\"";
+    if (r.method == "POST") res.body = r.body;
+    return res;
+  });
+  hostHttpRoute("https://api/slow", [](const HostHttpRequest&) { return HostHttpResponse{ 200, "", 9000, {} }; });
+
+  HTTPClient http;
+  const char* keys[] = { "ETag" };
+  http.collectHeaders(keys, 1);
+  HOST_CHECK(http.begin("https://api/state"));
+  HOST_CHECK_EQ(http.GET(), 200);
+  HOST_CHECK_EQ(millis(), 40);
+  HOST_CHECK(http.getString() == "{\"state\":\"1\"}");
+  HOST_CHECK(http.header("ETag") == "\"v2\"");
+  HOST_CHECK_EQ(http.getStream().read(), '{');
+  http.end();
+
+  http.begin("https://api/echo");
+  HOST_CHECK_EQ(http.POST("abc"), 200);
+  HOST_CHECK(http.getString() == "abc");
+
+  http.begin("https://api/slow/x");        // longest prefix wins
+  http.setTimeout(2000);
+  HOST_CHECK_EQ(http.GET(), HTTPC_ERROR_READ_TIMEOUT);
+  HOST_CHECK_EQ(millis(), 80 + 2000);
+
+  http.begin("https://elsewhere/");
+  HOST_CHECK_EQ(http.GET(), HTTPC_ERROR_CONNECTION_REFUSED);
+  hostHttpSetOffline(true);
+  http.begin("https://api/state");
+  HOST_CHECK_EQ(http.GET(), HTTPC_ERROR_CONNECTION_REFUSED);
+  HOST_CHECK_EQ(millis(), 80 + 2000 + 2000);
+  HOST_CHECK_EQ(hostHttpRequestCount(), 5);
+  hostHttpReset();
+}
+
+static void testHeapAndPins() {
+  hostClockReset();
+  HostHeapStats before = hostHeapStats();
+  {
+    String s;
+    for (int i = 0; i < 64; i++) s += 'x';
+    HOST_CHECK(s.indexOf("xx") == 0);
+  }
+  HostHeapStats after = hostHeapStats();
+  HOST_CHECK_GE(after.allocs - before.allocs, 1);
+  HOST_CHECK_EQ(after.current, before.current);
+  HOST_CHECK_LE(ESP.getFreeHeap(), HOST_HEAP_SIZE);
+
+  hostPinsReset();
+  pinMode(2, OUTPUT);
+  HOST_CHECK_EQ(hostPinChangedAtUs(2), -1);
+  delay(3);
+  digitalWrite(2, HIGH);
+  digitalWrite(2, HIGH);
+  HOST_CHECK_EQ(hostPinChangedAtUs(2), 3000);
+  HOST_CHECK_EQ(hostPinWrites(2), 2);
+  HOST_CHECK_EQ(digitalRead(2), HIGH);
+}
+
+// ---- Real time: tasks on threads
+static QueueHandle_t handoff;
+static TaskHandle_t consumerHandle;
+static std::atomic<int> consumed{0};
+static std::atomic<int> consumerCore{-1};
+
+static void producerTask(void*) {
+  for (int i = 1; i <= 100; i++) xQueueSend(handoff, &i, portMAX_DELAY);
+  xTaskNotifyGive(consumerHandle);
+  for (;;) vTaskDelay(pdMS_TO_TICKS(1000));
+}
+
+static void consumerTask(void*) {
+  consumerCore = xPortGetCoreID();
+  int sum = 0, v;
+  while (sum < 5050) {
+    if (xQueueReceive(handoff, &v, portMAX_DELAY)) sum += v;
+  }
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  consumed = sum;
+  for (;;) vTaskDelay(pdMS_TO_TICKS(1000));  // ended by hostClockReset()
+}
+
+static void testTasks() {
+  hostClockReset(true);
+  handoff = xQueueCreate(4, sizeof(int));
+  xTaskCreatePinnedToCore(consumerTask, "consumer", 4096, nullptr, 2, &consumerHandle, 1);
+  xTaskCreatePinnedToCore(producerTask, "producer", 4096, nullptr, 1, nullptr, 0);
+  HOST_CHECK(hostClockWaitUntil(hostClockUs() + 5000000, [] { return consumed.load() != 0; }));
+  HOST_CHECK_EQ(consumed.load(), 5050);
+  HOST_CHECK_EQ(consumerCore.load(), 1);
+
+  unsigned long t0 = millis();
+  delay(20);
+  HOST_CHECK_GE(millis() - t0, 20);
+  hostClockReset();                       // stops both tasks
+  vQueueDelete(handoff);
+}
+
+int main() {
+  hostConsoleEcho(false);
+  testSimulatedClock();
+  testEspTimer();
+  testBlockingCallsOnSimulatedClock();
+  testUart();
+  testMqtt();
+  testHttp();
+  testHeapAndPins();
+  testTasks();
+  return hostTestExit();
+}
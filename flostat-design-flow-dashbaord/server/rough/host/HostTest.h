@@ -0,0 +1,58 @@
+// HostTest.h
+// Checks and timing for the host tests and benchmarks. No framework: a
+// failed check prints where it failed, the run continues, and
+// hostTestExit() turns any failure into a non-zero exit for ctest.
+//
+//   HOST_CHECK(ring.empty());
+//   HOST_CHECK_LE(worstStallUs, 2000);     // regression gate
+//   return hostTestExit();
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+#include "HostClock.h"
+#include "freertos/FreeRTOS.h"
+
+inline int hostTestFailures = 0;
+
+#define HOST_CHECK(cond)                                                 \
+  do {                                                                   \
+    if (!(cond)) {                                                       \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      hostTestFailures++;                                                \
+    }                                                                    \
+  } while (0)
+
+#define HOST_CHECK_CMP(a, op, b)                                                              \
+  do {                                                                                        \
+    double va_ = (double)(a), vb_ = (double)(b);                                              \
+    if (!(va_ op vb_)) {                                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s %s %s (%g vs %g)\n", __FILE__, __LINE__, #a, #op, #b, va_, vb_); \
+      hostTestFailures++;                                                                     \
+    }                                                                                         \
+  } while (0)
+
+#define HOST_CHECK_EQ(a, b) HOST_CHECK_CMP(a, ==, b)
+#define HOST_CHECK_LE(a, b) HOST_CHECK_CMP(a, <=, b)
+#define HOST_CHECK_GE(a, b) HOST_CHECK_CMP(a, >=, b)
+
+// Host wall time for benchmarks, independent of the shimmed clock
+inline double hostWallNs() {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Keeps a benchmark's result alive without the optimizer noticing
+template <typename T>
+inline void hostKeep(const T& v) {
+  asm volatile("" : : "g"(&v) : "memory");
+}
+
+inline int hostTestExit() {
+  hostClockReset();  // joins the task and timer threads
+  if (hostTestFailures) fprintf(stderr, "%d check(s) failed\n", hostTestFailures);
+  fflush(stdout);
+  return hostTestFailures ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+// PubSubClient.cpp
+// In-process broker behind the PubSubClient shim.
+#include "PubSubClient.h"
+
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+
+#include "HostClock.h"
+
+class HostMqttBroker {
+ public:
+  static HostMqttBroker& get() {
+    static HostMqttBroker broker;
+    return broker;
+  }
+
+  std::mutex lock;
+  std::vector<PubSubClient*> clients;
+  std::vector<std::pair<std::string, HostMqttObserver> > observers;
+  bool online = true;
+  uint32_t connectDelayMs = 0;
+
+  // Lock held. Fixed header + topic length + topic + payload, as
+  // PubSubClient checks against its buffer
+  static size_t packetSize(const std::string& topic, size_t length) { return 5 + 2 + topic.size() + length; }
+
+  void route(const char* topic, const uint8_t* payload, size_t length) {
+    std::vector<HostMqttObserver> matched;
+    {
+      std::lock_guard<std::mutex> g(lock);
+      if (!online) return;
+      for (PubSubClient* c : clients) {
+        if (!c->connected_) continue;
+        for (const std::string& f : c->filters_) {
+          if (!hostMqttTopicMatches(f.c_str(), topic)) continue;
+          c->inbox_.push_back({ topic, std::string((const char*)payload, length) });
+          break;
+        }
+      }
+      for (auto& o : observers) {
+        if (hostMqttTopicMatches(o.first.c_str(), topic)) matched.push_back(o.second);
+      }
+    }
+    for (auto& fn : matched) fn(topic, payload, length);
+  }
+
+  // Lock held
+  void dropAll() {
+    for (PubSubClient* c : clients) {
+      if (c->connected_) drop(c);
+    }
+  }
+
+  void clearInboxes() {
+    for (PubSubClient* c : clients) c->inbox_.clear();
+  }
+
+  void drop(PubSubClient* c) {
+    c->connected_ = false;
+    c->state_ = MQTT_CONNECTION_LOST;
+    c->filters_.clear();
+    c->inbox_.clear();
+  }
+};
+
+bool hostMqttTopicMatches(const char* filter, const char* topic) {
+  while (*filter) {
+    if (*filter == '#') return true;
+    if (*filter == '+') {
+      while (*topic && *topic != '/') topic++;
+      filter++;
+      continue;
+    }
+    if (*filter != *topic) return false;
+    filter++;
+    topic++;
+  }
+  return *topic == '\0';
+}
+
+void hostMqttPublish(const char* topic, const uint8_t* payload, size_t length) {
+  HostMqttBroker::get().route(topic, payload, length);
+}
+
+void hostMqttPublish(const char* topic, const char* payload) {
+  hostMqttPublish(topic, (const uint8_t*)payload, strlen(payload));
+}
+
+void hostMqttSubscribe(const char* filter, HostMqttObserver observer) {
+  HostMqttBroker& b = HostMqttBroker::get();
+  std::lock_guard<std::mutex> g(b.lock);
+  b.observers.push_back({ filter, observer });
+}
+
+void hostMqttSetOnline(bool online) {
+  HostMqttBroker& b = HostMqttBroker::get();
+  std::lock_guard<std::mutex> g(b.lock);
+  b.online = online;
+  if (!online) b.dropAll();
+}
+
+void hostMqttSetConnectDelayMs(uint32_t ms) {
+  HostMqttBroker& b = HostMqttBroker::get();
+  std::lock_guard<std::mutex> g(b.lock);
+  b.connectDelayMs = ms;
+}
+
+void hostMqttReset() {
+  HostMqttBroker& b = HostMqttBroker::get();
+  std::lock_guard<std::mutex> g(b.lock);
+  b.observers.clear();
+  b.online = true;
+  b.connectDelayMs = 0;
+  b.clearInboxes();
+}
+
+// ---------------------------------------------------------------------------
+// PubSubClient
+// ---------------------------------------------------------------------------
+PubSubClient::~PubSubClient() {
+  HostMqttBroker& b = HostMqttBroker::get();
+  std::lock_guard<std::mutex> g(b.lock);
+  b.clients.erase(std::remove(b.clients.begin(), b.clients.end(), this), b.clients.end());
+}
+
+PubSubClient& PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
+  callback_ = callback;
+  return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size) {
+  if (size == 0) return false;
+  buffer_.assign(size, 0);
+  return true;
+}
+
+bool PubSubClient::connect(const char* id) {
+  HostMqttBroker& b = HostMqttBroker::get();
+  uint32_t delayMs;
+  {
+    std::lock_guard<std::mutex> g(b.lock);
+    delayMs = b.connectDelayMs;
+  }
+  // The handshake blocks the caller, as it does on the device
+  if (delayMs) hostSleepUs((int64_t)delayMs * 1000);
+
+  std::lock_guard<std::mutex> g(b.lock);
+  if (!b.online) {
+    connected_ = false;
+    state_ = MQTT_CONNECT_FAILED;
+    return false;
+  }
+  if (std::find(b.clients.begin(), b.clients.end(), this) == b.clients.end()) b.clients.push_back(this);
+  connected_ = true;
+  state_ = MQTT_CONNECTED;
+  return true;
+}
+
+bool PubSubClient::connect(const char* id, const char*, const char*) { return connect(id); }
+
+bool PubSubClient::connect(const char* id, const char*, uint8_t, bool, const char*) { return connect(id); }
+
+void PubSubClient::disconnect() {
+  HostMqttBroker& b = HostMqttBroker::get();
+  std::lock_guard<std::mutex> g(b.lock);
+  b.drop(this);
+  state_ = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::connected() {
+  std::lock_guard<std::mutex> g(HostMqttBroker::get().lock);
+  return connected_;
+}
+
+int PubSubClient::state() {
+  std::lock_guard<std::mutex> g(HostMqttBroker::get().lock);
+  return state_;
+}
+
+bool PubSubClient::subscribe(const char* filter, uint8_t) {
+  std::lock_guard<std::mutex> g(HostMqttBroker::get().lock);
+  if (!connected_) return false;
+  filters_.push_back(filter);
+  return true;
+}
+
+bool PubSubClient::unsubscribe(const char* filter) {
+  std::lock_guard<std::mutex> g(HostMqttBroker::get().lock);
+  if (!connected_) return false;
+  filters_.erase(std::remove(filters_.begin(), filters_.end(), std::string(filter)), filters_.end());
+  return true;
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload, bool retained) {
+  return publish(topic, (const uint8_t*)payload, strlen(payload), retained);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length, bool) {
+  {
+    std::lock_guard<std::mutex> g(HostMqttBroker::get().lock);
+    if (!connected_ || HostMqttBroker::packetSize(topic, length) > buffer_.size()) return false;
+  }
+  HostMqttBroker::get().route(topic, payload, length);
+  return true;
+}
+
+// One message per call, like PubSubClient reading one packet per loop()
+bool PubSubClient::loop() {
+  for (;;) {
+    Message m;
+    {
+      std::lock_guard<std::mutex> g(HostMqttBroker::get().lock);
+      if (!connected_) return false;
+      if (inbox_.empty()) return true;
+      m = std::move(inbox_.front());
+      inbox_.pop_front();
+      // Too big for our buffer: PubSubClient drops it without a callback
+      if (HostMqttBroker::packetSize(m.topic, m.payload.size()) > buffer_.size()) continue;
+    }
+    if (!callback_) continue;
+    // Topic and payload share the one buffer, as in PubSubClient
+    size_t tlen = m.topic.size();
+    memcpy(buffer_.data(), m.topic.c_str(), tlen + 1);
+    uint8_t* payload = buffer_.data() + tlen + 1;
+    memcpy(payload, m.payload.data(), m.payload.size());
+    callback_((char*)buffer_.data(), payload, m.payload.size());
+    return true;
+  }
+}
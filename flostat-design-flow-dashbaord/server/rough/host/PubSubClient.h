@@ -0,0 +1,87 @@
+// PubSubClient.h (host shim)
+// PubSubClient against an in-process broker. A publish is routed to every
+// subscriber whose filter matches (+ and # wildcards); a client only sees
+// its messages inside loop(), through its callback and its own buffer, as
+// on the device. The test side can publish, watch what devices publish and
+// take the broker down.
+//
+//   hostMqttSubscribe("flostat/+/status/#", [](const char* t, const uint8_t* p, size_t n) { ... });
+//   hostMqttPublish("flostat/org/command/b/valve/v", "{...}");
+//   hostMqttSetOnline(false);          // drops every connection
+//   hostMqttSetConnectDelayMs(3000);   // a stalled TLS handshake
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Client.h"
+
+#define MQTT_CONNECTION_TIMEOUT      -4
+#define MQTT_CONNECTION_LOST         -3
+#define MQTT_CONNECT_FAILED          -2
+#define MQTT_DISCONNECTED            -1
+#define MQTT_CONNECTED               0
+#define MQTT_CONNECT_UNAVAILABLE     3
+
+#define MQTT_MAX_PACKET_SIZE 256
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient {
+ public:
+  PubSubClient() {}
+  explicit PubSubClient(Client&) {}
+  ~PubSubClient();
+
+  PubSubClient& setServer(const char*, uint16_t) { return *this; }
+  PubSubClient& setClient(Client&) { return *this; }
+  PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+  PubSubClient& setKeepAlive(uint16_t) { return *this; }
+  PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+  bool setBufferSize(uint16_t size);
+  uint16_t getBufferSize() const { return buffer_.size(); }
+
+  bool connect(const char* id);
+  bool connect(const char* id, const char* user, const char* pass);
+  bool connect(const char* id, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage);
+  void disconnect();
+  bool connected();
+  int state();
+
+  bool subscribe(const char* filter, uint8_t qos = 0);
+  bool unsubscribe(const char* filter);
+  bool publish(const char* topic, const char* payload, bool retained = false);
+  bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained = false);
+  bool loop();
+
+ private:
+  friend class HostMqttBroker;
+
+  struct Message {
+    std::string topic;
+    std::string payload;
+  };
+
+  std::function<void(char*, uint8_t*, unsigned int)> callback_;
+  std::vector<uint8_t> buffer_ = std::vector<uint8_t>(MQTT_MAX_PACKET_SIZE);
+  std::vector<std::string> filters_;
+  std::deque<Message> inbox_;
+  bool connected_ = false;
+  int state_ = MQTT_DISCONNECTED;
+};
+
+// ---- Test side
+typedef std::function<void(const char* topic, const uint8_t* payload, size_t length)> HostMqttObserver;
+
+void hostMqttPublish(const char* topic, const uint8_t* payload, size_t length);
+void hostMqttPublish(const char* topic, const char* payload);
+// Observers run synchronously inside the publishing call
+void hostMqttSubscribe(const char* filter, HostMqttObserver observer);
+void hostMqttSetOnline(bool online);
+void hostMqttSetConnectDelayMs(uint32_t ms);
+// Drops observers, queued messages and the online/delay settings
+void hostMqttReset();
+bool hostMqttTopicMatches(const char* filter, const char* topic);
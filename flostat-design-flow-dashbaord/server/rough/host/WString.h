@@ -0,0 +1,131 @@
+// WString.h (host shim)
+// Arduino String over std::string. It allocates through operator new, so
+// HostHeap counts it the way the device heap would feel it.
+#pragma once
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <utility>
+
+class String {
+ public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  explicit String(char c) : s_(1, c) {}
+  explicit String(int v) : s_(std::to_string(v)) {}
+  explicit String(unsigned int v) : s_(std::to_string(v)) {}
+  explicit String(long v) : s_(std::to_string(v)) {}
+  explicit String(unsigned long v) : s_(std::to_string(v)) {}
+  explicit String(long long v) : s_(std::to_string(v)) {}
+  explicit String(unsigned long long v) : s_(std::to_string(v)) {}
+  explicit String(double v, unsigned int decimals = 2) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    s_ = buf;
+  }
+
+  unsigned int length() const { return s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  const char* c_str() const { return s_.c_str(); }
+  bool reserve(unsigned int n) {
+    s_.reserve(n);
+    return true;
+  }
+
+  char charAt(unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  char& operator[](unsigned int i) { return s_[i]; }
+
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o) { if (o) s_ += o; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  String& operator+=(int v) { s_ += std::to_string(v); return *this; }
+  String& operator+=(unsigned int v) { s_ += std::to_string(v); return *this; }
+  String& operator+=(long v) { s_ += std::to_string(v); return *this; }
+  String& operator+=(unsigned long v) { s_ += std::to_string(v); return *this; }
+  bool concat(const String& o) { s_ += o.s_; return true; }
+  bool concat(const char* o) { if (o) s_ += o; return true; }
+  bool concat(const char* o, unsigned int n) { s_.append(o, n); return true; }
+  bool concat(char c) { s_ += c; return true; }
+
+  bool equals(const String& o) const { return s_ == o.s_; }
+  bool equals(const char* o) const { return s_ == (o ? o : ""); }
+  bool equalsIgnoreCase(const String& o) const { return strcasecmp(c_str(), o.c_str()) == 0; }
+  bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+  bool endsWith(const String& p) const {
+    return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+  }
+  int compareTo(const String& o) const { return s_.compare(o.s_); }
+
+  int indexOf(char c, unsigned int from = 0) const { return found(s_.find(c, from)); }
+  int indexOf(const char* p, unsigned int from = 0) const { return found(s_.find(p, from)); }
+  int indexOf(const String& p, unsigned int from = 0) const { return found(s_.find(p.s_, from)); }
+  int lastIndexOf(char c) const { return found(s_.rfind(c)); }
+
+  String substring(unsigned int from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= s_.size()) return String();
+    return String(s_.substr(from, to - from));
+  }
+
+  void trim() {
+    size_t b = s_.find_first_not_of(" \t\r\n\f\v");
+    if (b == std::string::npos) {
+      s_.clear();
+      return;
+    }
+    size_t e = s_.find_last_not_of(" \t\r\n\f\v");
+    s_ = s_.substr(b, e - b + 1);
+  }
+  void replace(const String& from, const String& to) {
+    if (from.s_.empty()) return;
+    for (size_t at = s_.find(from.s_); at != std::string::npos; at = s_.find(from.s_, at + to.s_.size())) {
+      s_.replace(at, from.s_.size(), to.s_);
+    }
+  }
+  void replace(char from, char to) {
+    for (char& c : s_) if (c == from) c = to;
+  }
+  void remove(unsigned int at, unsigned int n = (unsigned int)-1) {
+    if (at < s_.size()) s_.erase(at, n);
+  }
+  void toLowerCase() {
+    for (char& c : s_) c = tolower((unsigned char)c);
+  }
+  void toUpperCase() {
+    for (char& c : s_) c = toupper((unsigned char)c);
+  }
+
+  long toInt() const { return atol(s_.c_str()); }
+  float toFloat() const { return (float)atof(s_.c_str()); }
+  double toDouble() const { return atof(s_.c_str()); }
+
+  const std::string& str() const { return s_; }
+
+ private:
+  static int found(size_t at) { return at == std::string::npos ? -1 : (int)at; }
+  std::string s_;
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, char b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, int b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, unsigned long b) { String r(a); r += b; return r; }
+
+inline bool operator==(const String& a, const String& b) { return a.str() == b.str(); }
+inline bool operator==(const String& a, const char* b) { return a.equals(b); }
+inline bool operator==(const char* a, const String& b) { return b.equals(a); }
+inline bool operator!=(const String& a, const String& b) { return !(a == b); }
+inline bool operator!=(const String& a, const char* b) { return !(a == b); }
+inline bool operator<(const String& a, const String& b) { return a.str() < b.str(); }
+inline bool operator>(const String& a, const String& b) { return a.str() > b.str(); }
+inline bool operator<=(const String& a, const String& b) { return a.str() <= b.str(); }
+inline bool operator>=(const String& a, const String& b) { return a.str() >= b.str(); }
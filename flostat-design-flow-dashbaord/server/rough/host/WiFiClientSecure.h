@@ -0,0 +1,14 @@
+// WiFiClientSecure.h (host shim)
+#pragma once
+
+#include "Client.h"
+
+class WiFiClient : public Client {};
+
+class WiFiClientSecure : public WiFiClient {
+ public:
+  void setCACert(const char*) {}
+  void setCertificate(const char*) {}
+  void setPrivateKey(const char*) {}
+  void setInsecure() {}
+};
@@ -0,0 +1,97 @@
+// freertos/FreeRTOS.h (host shim)
+// The FreeRTOS subset the sketches use. Tasks are std::threads (so they
+// need the real-time clock, see HostClock.h), a tick is 1 ms like the
+// Arduino-ESP32 default, and every wait goes through the host clock, so
+// single-threaded code that blocks with a timeout also runs on the
+// simulated clock. Cores are only recorded; both "cores" share the host's.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define errQUEUE_FULL       0
+#define errQUEUE_EMPTY      0
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFUL)
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define portNUM_PROCESSORS  2
+#define tskIDLE_PRIORITY    0
+#define tskNO_AFFINITY      0x7FFFFFFF
+
+// ---- Critical sections: a spinlock, interrupts do not exist here
+struct portMUX_TYPE {
+  std::atomic<int> owner{0};
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+inline void hostMuxTake(portMUX_TYPE* m) {
+  while (m->owner.exchange(1, std::memory_order_acquire)) std::this_thread::yield();
+}
+inline void hostMuxGive(portMUX_TYPE* m) { m->owner.store(0, std::memory_order_release); }
+
+#define portENTER_CRITICAL(m)      hostMuxTake(m)
+#define portEXIT_CRITICAL(m)       hostMuxGive(m)
+#define portENTER_CRITICAL_ISR(m)  hostMuxTake(m)
+#define portEXIT_CRITICAL_ISR(m)   hostMuxGive(m)
+#define taskENTER_CRITICAL(m)      hostMuxTake(m)
+#define taskEXIT_CRITICAL(m)       hostMuxGive(m)
+#define portYIELD_FROM_ISR(...)    ((void)0)
+
+// ---- Tasks
+typedef struct HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                       UBaseType_t priority, TaskHandle_t* created);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t increment);
+BaseType_t xTaskDelayUntil(TickType_t* previousWake, TickType_t increment);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+const char* pcTaskGetName(TaskHandle_t task);
+BaseType_t xPortGetCoreID();
+void taskYIELD();
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken);
+
+// ---- Queues and semaphores (a semaphore is a queue of empty items)
+typedef struct HostQueue* QueueHandle_t;
+typedef QueueHandle_t SemaphoreHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t q);
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks);
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void* item, TickType_t ticks);
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* higherPriorityTaskWoken);
+BaseType_t xQueueReceive(QueueHandle_t q, void* out, TickType_t ticks);
+BaseType_t xQueuePeek(QueueHandle_t q, void* out, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q);
+BaseType_t xQueueReset(QueueHandle_t q);
+#define xQueueSendToBack xQueueSend
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+#define xSemaphoreTake(s, ticks)  xQueueReceive((s), nullptr, (ticks))
+#define xSemaphoreGive(s)         xQueueSend((s), nullptr, 0)
+#define vSemaphoreDelete(s)       vQueueDelete(s)
+
+// Ends every task thread (each leaves at its next blocking call) and joins
+// them; hostClockReset() does this first
+void hostStopTasks();
@@ -0,0 +1,4 @@
+// freertos/semphr.h (host shim), everything is declared in FreeRTOS.h
+#pragma once
+
+#include "FreeRTOS.h"
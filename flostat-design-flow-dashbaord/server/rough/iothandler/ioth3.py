@@ -33,112 +33,208 @@ def log_to_dynamodb(data):
     return log_id
 
 
+# Compact wire format (see server/utils/wireFormat.js). Devices that use it
+# publish on their topic + "/mp" and the IoT rule passes the bytes through as
+# base64OriginalPayload. Messages are MessagePack maps {0: type, 1: data} with
+# integer keys, 16 byte binary UUIDs and second-of-day times.
+WIRE_TYPES = {
+    1: "DEVICE_UPDATE", 2: "DEVICE_STATUS", 3: "DEVICE_HELLO",
+    4: "SCHEDULE_ACK", 5: "SCHEDULE_ACK_UPDATE", 6: "SCHEDULE_ACK_DELETE",
+    7: "SCHEDULE_CREATED", 8: "SCHEDULE_UPDATE", 9: "SCHEDULE_DELETE",
+}
+WIRE_DEVICE_TYPES = {1: "valve", 2: "pump", 3: "tank", 4: "sump"}
+WIRE_FIELDS = {
+    1: ("org_id", "uuid"), 2: ("device_id", "uuid"), 3: ("block_id", "uuid"),
+    4: ("schedule_id", "uuid"), 5: ("device_type", "device_type"),
+    6: ("device_types", "device_types"), 7: ("status", None),
+    8: ("schedule_status", None), 9: ("start_time", "seconds"),
+    10: ("end_time", "seconds"), 11: ("ack", None), 12: ("current_level", None),
+    13: ("wifi_strength", None), 14: ("battery", None), 15: ("wire", None),
+    16: ("last_updated", "epoch"),
+}
+
+
+def read_msgpack(buf, pos=0):
+    """Decode the MessagePack subset the devices emit. Returns (value, next_pos)."""
+    b = buf[pos]
+    pos += 1
+    if b < 0x80:
+        return b, pos
+    if b >= 0xe0:
+        return b - 0x100, pos
+    if b & 0xf0 in (0x80, 0x90):
+        n = b & 0x0f
+        if b & 0xf0 == 0x90:
+            out = []
+            for _ in range(n):
+                v, pos = read_msgpack(buf, pos)
+                out.append(v)
+            return out, pos
+        out = {}
+        for _ in range(n):
+            k, pos = read_msgpack(buf, pos)
+            out[k], pos = read_msgpack(buf, pos)
+        return out, pos
+    if b & 0xe0 == 0xa0:
+        n = b & 0x1f
+        return buf[pos:pos + n].decode("utf-8"), pos + n
+    if b == 0xc0:
+        return None, pos
+    if b in (0xc2, 0xc3):
+        return b == 0xc3, pos
+    if b == 0xcc:
+        return buf[pos], pos + 1
+    if b == 0xcd:
+        return int.from_bytes(buf[pos:pos + 2], "big"), pos + 2
+    if b == 0xce:
+        return int.from_bytes(buf[pos:pos + 4], "big"), pos + 4
+    if b in (0xc4, 0xd9):
+        n = buf[pos]
+        raw = buf[pos + 1:pos + 1 + n]
+        return (bytes(raw) if b == 0xc4 else raw.decode("utf-8")), pos + 1 + n
+    raise ValueError(f"Unsupported wire byte 0x{b:02x}")
+
+
+def decode_wire_message(buf):
+    """Turn a wire message back into the JSON event shape {type, data}."""
+    msg, _ = read_msgpack(buf)
+    if not isinstance(msg, dict) or msg.get(0) not in WIRE_TYPES:
+        raise ValueError("Invalid wire message")
+
+    data = {}
+    for key, value in (msg.get(1) or {}).items():
+        if key not in WIRE_FIELDS:
+            continue
+        name, kind = WIRE_FIELDS[key]
+        if kind == "uuid" and isinstance(value, bytes):
+            value = str(uuid.UUID(bytes=value))
+        elif kind == "device_type":
+            value = WIRE_DEVICE_TYPES.get(value)
+        elif kind == "device_types":
+            value = [WIRE_DEVICE_TYPES.get(t) for t in value]
+        elif kind == "seconds":
+            hhmm = f"{value // 3600:02d}:{value // 60 % 60:02d}"
+            value = f"{hhmm}:{value % 60:02d}" if value % 60 else hhmm
+        elif kind == "epoch":
+            value = datetime.datetime.utcfromtimestamp(value).isoformat() + "Z"
+        data[name] = value
+    return {"type": WIRE_TYPES[msg[0]], "data": data}
+
+
+ACK_FIELDS = {"pump": "pump_ack", "valve": "valve_ack"}
+
+
+def ack_fields(data):
+    """Ack fields covered by an ACK: a combined one lists device_types, older
+    firmware sends one ACK per device_type."""
+    device_types = data.get("device_types")
+    if device_types is None:
+        device_types = [data.get("device_type")] if data.get("device_type") else []
+    if not device_types:
+        raise ValueError("Missing required field: device_type or device_types")
+    fields = []
+    for device_type in device_types:
+        if device_type not in ACK_FIELDS:
+            raise ValueError(f"Invalid device_type: {device_type}")
+        fields.append(ACK_FIELDS[device_type])
+    return fields
+
+
+def all_acked(fields, attributes=None):
+    """True once every device has acknowledged, either in this ACK or earlier."""
+    acked = set(fields)
+    if attributes:
+        acked.update(f for f in ACK_FIELDS.values() if attributes.get(f))
+    return acked >= set(ACK_FIELDS.values())
+
+
+def update_acks(org_id, schedule_id, fields, ack, schedule_status=None):
+    """Set the ack fields (and optionally the schedule status) in one update."""
+    sets = [f"#{f} = :ack" for f in fields] + ["#last_ack_time = :ts"]
+    names = {f"#{f}": f for f in fields}
+    names["#last_ack_time"] = "last_ack_time"
+    # Same format as the API's toISOString(), which the delta sync compares against
+    values = {":ack": ack, ":ts": datetime.datetime.utcnow().isoformat(timespec="milliseconds") + "Z"}
+    if schedule_status is not None:
+        sets.append("#status = :status")
+        names["#status"] = "schedule_status"
+        values[":status"] = schedule_status
+
+    response = table.update_item(
+        Key={"org_id": org_id, "schedule_id": schedule_id},
+        UpdateExpression="SET " + ", ".join(sets),
+        ExpressionAttributeNames=names,
+        ExpressionAttributeValues=values,
+        ReturnValues="ALL_NEW"
+    )
+    return response.get("Attributes", {})
+
+
+def set_schedule_status(org_id, schedule_id, schedule_status):
+    return table.update_item(
+        Key={"org_id": org_id, "schedule_id": schedule_id},
+        UpdateExpression="SET #status = :status",
+        ExpressionAttributeNames={"#status": "schedule_status"},
+        ExpressionAttributeValues={":status": schedule_status},
+        ReturnValues="ALL_NEW"
+    )
+
+
 def handle_schedule_ack(data):
     """Handle schedule creation acknowledgment."""
     org_id = data.get("org_id")
     schedule_id = data.get("schedule_id")
-    device_type = data.get("device_type")
     ack = data.get("ack")
-    schedule_status = data.get("schedule_status")
 
-    if not org_id or not schedule_id or not device_type or ack is None:
-        raise ValueError("Missing required fields: org_id, schedule_id, device_type, or ack")
+    if not org_id or not schedule_id or ack is None:
+        raise ValueError("Missing required fields: org_id, schedule_id, or ack")
+    fields = ack_fields(data)
 
-    if device_type == "pump":
-        ack_field = "pump_ack"
-    elif device_type == "valve":
-        ack_field = "valve_ack"
+    # A combined ACK from every device marks the schedule CREATED in the same write
+    if ack and all_acked(fields):
+        attributes = update_acks(org_id, schedule_id, fields, ack, "CREATED")
     else:
-        raise ValueError(f"Invalid device_type: {device_type}")
-
-    # Update specific ack field
-    update_expr = f"SET #{ack_field} = :ack, #last_ack_time = :ts"
-    expr_attr_names = {
-        f"#{ack_field}": ack_field,
-        "#last_ack_time": "last_ack_time"
-    }
-    expr_attr_values = {
-        ":ack": ack,
-        ":ts": datetime.datetime.utcnow().isoformat()
-    }
-
-    # Perform partial update
-    response = table.update_item(
-        Key={
-            "org_id": org_id,
-            "schedule_id": schedule_id
-        },
-        UpdateExpression=update_expr,
-        ExpressionAttributeNames=expr_attr_names,
-        ExpressionAttributeValues=expr_attr_values,
-        ReturnValues="ALL_NEW"
-    )
-
-    # Check both acks — if both True, set status to CREATED
-    attributes = response.get("Attributes", {})
-    print("ATT: ",str(attributes))
-    if attributes.get("pump_ack") and attributes.get("valve_ack"):
-        res2 =table.update_item(
-            Key={"org_id": org_id, "schedule_id": schedule_id},
-            UpdateExpression="SET #status = :status",
-            ExpressionAttributeNames={"#status": "schedule_status"},
-            ExpressionAttributeValues={":status": "CREATED"}
-        )
+        attributes = update_acks(org_id, schedule_id, fields, ack)
+        # Check both acks — if both True, set status to CREATED
+        if attributes.get("pump_ack") and attributes.get("valve_ack"):
+            set_schedule_status(org_id, schedule_id, "CREATED")
     log_to_dynamodb(attributes)
 
     return {
         "statusCode": 200,
         "body": json.dumps({
-            "message": f"Creation ACK updated for {device_type}",
-            "updated": response.get("Attributes", {})
+            "message": f"Creation ACK updated for {', '.join(fields)}",
+            "updated": attributes
         }, cls=DecimalEncoder)
     }
+
+
 def handle_schedule_update_ack(data):
     """Handle schedule update acknowledgment."""
     org_id = data.get("org_id")
     schedule_id = data.get("schedule_id")
-    device_type = data.get("device_type")
     ack = data.get("ack")
     schedule_status = data.get("schedule_status")
 
-    if not org_id or not schedule_id or not device_type or ack is None:
+    if not org_id or not schedule_id or ack is None:
         raise ValueError("Missing required fields")
+    fields = ack_fields(data)
 
-    ack_field = "pump_ack" if device_type == "pump" else "valve_ack"
-
-    # Update the device ACK
-    response = table.update_item(
-        Key={"org_id": org_id, "schedule_id": schedule_id},
-        UpdateExpression=f"SET #{ack_field} = :ack, #last_ack_time = :ts, #status = :status",
-        ExpressionAttributeNames={
-            f"#{ack_field}": ack_field,
-            "#last_ack_time": "last_ack_time",
-            "#status": "schedule_status"
-        },
-        ExpressionAttributeValues={
-            ":ack": ack,
-            ":ts": datetime.datetime.utcnow().isoformat(),
-            ":status": schedule_status
-        },
-        ReturnValues="ALL_NEW"
-    )
-
-    attributes = response.get("Attributes", {})
-    # When both ack true → mark schedule_status as UPDATED
-    if attributes.get("pump_ack") and attributes.get("valve_ack"):
-        res2 = table.update_item(
-            Key={"org_id": org_id, "schedule_id": schedule_id},
-            UpdateExpression="SET #status = :status",
-            ExpressionAttributeNames={"#status": "schedule_status"},
-            ExpressionAttributeValues={":status": "UPDATED"}
-        )
-        log_to_dynamodb(res2.get("Attributes", {}))
+    if ack and all_acked(fields):
+        attributes = update_acks(org_id, schedule_id, fields, ack, "UPDATED")
+        log_to_dynamodb(attributes)
+    else:
+        attributes = update_acks(org_id, schedule_id, fields, ack, schedule_status)
+        # When both ack true → mark schedule_status as UPDATED
+        if attributes.get("pump_ack") and attributes.get("valve_ack"):
+            res2 = set_schedule_status(org_id, schedule_id, "UPDATED")
+            log_to_dynamodb(res2.get("Attributes", {}))
 
     return {
         "statusCode": 200,
         "body": json.dumps({
-            "message": f"Update ACK processed for {device_type}",
-            "updated": response.get("Attributes", {})
+            "message": f"Update ACK processed for {', '.join(fields)}",
+            "updated": attributes
         }, cls=DecimalEncoder)
     }
 
@@ -147,42 +243,31 @@ def handle_schedule_delete_ack(data):
     """Handle schedule delete acknowledgment."""
     org_id = data.get("org_id")
     schedule_id = data.get("schedule_id")
-    device_type = data.get("device_type")
     ack = data.get("ack")
     schedule_status = data.get("schedule_status")
 
-    if not org_id or not schedule_id or not device_type or ack is None:
+    if not org_id or not schedule_id or ack is None:
         raise ValueError("Missing required fields")
+    fields = ack_fields(data)
 
-    ack_field = "pump_ack" if device_type == "pump" else "valve_ack"
-
-    # Mark delete ack
-    response = table.update_item(
-        Key={"org_id": org_id, "schedule_id": schedule_id},
-        UpdateExpression=f"SET #{ack_field} = :ack, #last_ack_time = :ts, #status = :status",
-        ExpressionAttributeNames={
-            f"#{ack_field}": ack_field,
-            "#last_ack_time": "last_ack_time",
-            "#status": "schedule_status"
-        },
-        ExpressionAttributeValues={
-            ":ack": ack,
-            ":ts": datetime.datetime.utcnow().isoformat(),
-            ":status": schedule_status
-        },
-        ReturnValues="ALL_NEW"
-    )
-
-    attributes = response.get("Attributes", {})
-
-    # ✅ If both acks true → delete schedule
-    if attributes.get("pump_ack") and attributes.get("valve_ack"):
-        res2 = table.delete_item(Key={"org_id": org_id, "schedule_id": schedule_id})
-        log_to_dynamodb(res2.get("Attributes", {}))
+    # ✅ Every device acknowledged in this one message → delete straight away
+    if ack and all_acked(fields):
+        res = table.delete_item(
+            Key={"org_id": org_id, "schedule_id": schedule_id},
+            ReturnValues="ALL_OLD"
+        )
+        attributes = res.get("Attributes", {})
+        log_to_dynamodb(attributes)
         message = f"Schedule {schedule_id} deleted (both ACKs received)"
-
     else:
-        message = f"Delete ACK received for {device_type}, waiting for other device"
+        attributes = update_acks(org_id, schedule_id, fields, ack, schedule_status)
+        # ✅ If both acks true → delete schedule
+        if attributes.get("pump_ack") and attributes.get("valve_ack"):
+            res2 = table.delete_item(Key={"org_id": org_id, "schedule_id": schedule_id})
+            log_to_dynamodb(res2.get("Attributes", {}))
+            message = f"Schedule {schedule_id} deleted (both ACKs received)"
+        else:
+            message = f"Delete ACK received for {', '.join(fields)}, waiting for other device"
 
     return {
         "statusCode": 200,
@@ -192,6 +277,43 @@ def handle_schedule_delete_ack(data):
         }, cls=DecimalEncoder)
     }
 
+def handle_log_batch(data):
+    """Store a batch of journaled device state logs in one DynamoDB round trip."""
+    org_id = data.get("org_id")
+    logs = data.get("logs")
+
+    if not org_id or not isinstance(logs, list):
+        raise ValueError("Missing required fields: org_id or logs")
+
+    stored = 0
+    with logsTable.batch_writer() as batch:
+        for entry in logs:
+            # Each entry is [epoch_seconds, device_type, state]
+            if not isinstance(entry, list) or len(entry) != 3:
+                continue
+            ts, device_type, state = entry
+            if ts:
+                created_at = datetime.datetime.utcfromtimestamp(int(ts)).isoformat()
+            else:
+                created_at = datetime.datetime.utcnow().isoformat()
+            batch.put_item(Item={
+                "uuid": str(uuid.uuid4()),
+                "org_id": org_id,
+                "block_id": data.get("block_id"),
+                "device_id": data.get("id"),
+                "device_type": device_type,
+                "status": "ON" if state else "OFF",
+                "mode": "ESP",
+                "created_at": created_at,
+                "updated_at": datetime.datetime.utcnow().isoformat()
+            })
+            stored += 1
+
+    return {
+        "statusCode": 200,
+        "body": json.dumps({"message": f"Stored {stored} log(s)"})
+    }
+
 def lambda_handler(event, context):
     """Main Lambda entry point"""
     logger.info("Received event: %s", json.dumps(event, cls=DecimalEncoder))
@@ -200,8 +322,12 @@ def lambda_handler(event, context):
         # If event comes from IoT Rule, decode payload
         if "base64OriginalPayload" in event:
             import base64
-            payload = base64.b64decode(event["base64OriginalPayload"]).decode("utf-8")
-            event = json.loads(payload)
+            payload = base64.b64decode(event["base64OriginalPayload"])
+            # JSON always starts with '{'; anything else is the compact wire format
+            if payload[:1] == b"{":
+                event = json.loads(payload.decode("utf-8"))
+            else:
+                event = decode_wire_message(payload)
 
         action_type = event.get("type")
         data = event.get("data", {})
@@ -215,6 +341,9 @@ def lambda_handler(event, context):
         elif action_type == "SCHEDULE_ACK_DELETE":
             print("delete schedule")
             return handle_schedule_delete_ack(data)
+        elif action_type == "LOG_BATCH":
+            logger.info("Handling LOG_BATCH event")
+            return handle_log_batch(data)
         else:
             logger.info("Unhandled event type: %s", action_type)
             return {
@@ -13,6 +13,73 @@
 #include <vector>
 #include <HardwareSerial.h>
 #include <esp_task_wdt.h>
+#include <LittleFS.h>
+#include "LatencyHistogram.h"
+#include "TopicRouter.h"
+#include "MqttDispatch.h"
+#include "RS485BusLog.h"
+
+// Log level for this build: LOG_LEVEL_DEBUG on the bench, LOG_LEVEL_WARN in
+// the field. Anything above it is compiled out.
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+// Log messages: id, level, format. Arguments are 32-bit words, see
+// hardware/FastLog.h; device UUIDs are logged by logShortId().
+#define LOG_MESSAGES(X) \
+  RS485_LOG_MESSAGES(X) \
+  X(LOG_FETCH_STATE_FAILED,      LOG_LEVEL_WARN,  "❌ Failed to fetch state, HTTP code: %d") \
+  X(LOG_FETCH_STATE_DONE,        LOG_LEVEL_DEBUG, "✅ State response: %u bytes") \
+  X(LOG_FETCH_STATE_PARSE_FAILED, LOG_LEVEL_WARN, "❌ JSON Parse error: %s") \
+  X(LOG_MQTT_UNROUTED,           LOG_LEVEL_DEBUG, "📭 No device for topic (%lu unrouted)") \
+  X(LOG_COMMAND_PARSE_FAILED,    LOG_LEVEL_WARN,  "❌ Command JSON parse error: %s") \
+  X(LOG_MQTT_CONNECTING,         LOG_LEVEL_INFO,  "🔌 Attempting MQTT connection...") \
+  X(LOG_MQTT_CONNECTED,          LOG_LEVEL_INFO,  "✅ MQTT connected, subscribed to topics") \
+  X(LOG_MQTT_CONNECT_FAILED,     LOG_LEVEL_WARN,  "❌ MQTT connect failed, rc=%d") \
+  X(LOG_MQTT_REBOOT,             LOG_LEVEL_ERROR, "🚨 Too many MQTT failures. Rebooting...") \
+  X(LOG_ROUTER_BUILD_FAILED,     LOG_LEVEL_ERROR, "❌ Device table too large or has duplicates, commands will not be routed") \
+  X(LOG_ROUTER_NO_NODE,          LOG_LEVEL_WARN,  "⚠ %s %08lx: RS485 address %02X is not on the bus") \
+  X(LOG_ROUTER_READY,            LOG_LEVEL_INFO,  "🧭 Routing commands for %u device(s)") \
+  X(LOG_DEVICE_COMMAND,          LOG_LEVEL_INFO,  "📩 %s %08lx -> RS485 cmd %02X") \
+  X(LOG_WIFI_CONNECTING,         LOG_LEVEL_INFO,  "Connecting to WiFi %s") \
+  X(LOG_WIFI_WAITING,            LOG_LEVEL_DEBUG, "Connecting to WiFi...") \
+  X(LOG_WIFI_RESTART,            LOG_LEVEL_ERROR, "Restarting....") \
+  X(LOG_WIFI_CONNECTED,          LOG_LEVEL_INFO,  "WiFi connected! IP address: %u.%u.%u.%u") \
+  X(LOG_TIME_RESYNC_START,       LOG_LEVEL_INFO,  "🔄 Initiating periodic time re-sync...") \
+  X(LOG_TIME_RESYNC_DONE,        LOG_LEVEL_INFO,  "✅ Time re-synced: %02d:%02d") \
+  X(LOG_TIME_RESYNC_TIMEOUT,     LOG_LEVEL_WARN,  "❌ Time re-sync timed out.") \
+  X(LOG_TIME_SYNCING,            LOG_LEVEL_INFO,  "⏱ Syncing time") \
+  X(LOG_TIME_SYNC_FAILED,        LOG_LEVEL_ERROR, "❌ Failed to sync time") \
+  X(LOG_TIME_SYNCED,             LOG_LEVEL_INFO,  "✅ Time synchronized: %02d:%02d") \
+  X(LOG_CLOUD_NO_WIFI,           LOG_LEVEL_WARN,  "❌ WiFi not connected! Buffering log.") \
+  X(LOG_CLOUD_POST,              LOG_LEVEL_DEBUG, "🌐 Logging %s state %d to the cloud") \
+  X(LOG_CLOUD_ATTEMPT,           LOG_LEVEL_DEBUG, "📡 Attempt %d...") \
+  X(LOG_CLOUD_DONE,              LOG_LEVEL_INFO,  "✅ Log success in %lu ms (HTTP 200)") \
+  X(LOG_CLOUD_HTTP_FAILED,       LOG_LEVEL_WARN,  "⚠  Attempt %d: HTTP %d") \
+  X(LOG_CLOUD_FAILED,            LOG_LEVEL_WARN,  "🛑 All attempts failed. Buffering log.") \
+  X(LOG_JOURNAL_MOUNT_FAILED,    LOG_LEVEL_ERROR, "❌ LittleFS mount failed, offline journal disabled") \
+  X(LOG_JOURNAL_LOADED,          LOG_LEVEL_INFO,  "📒 Offline journal loaded: %u record(s) pending") \
+  X(LOG_JOURNAL_CREATE_FAILED,   LOG_LEVEL_ERROR, "❌ Cannot create offline journal") \
+  X(LOG_JOURNAL_CREATED,         LOG_LEVEL_INFO,  "📒 Offline journal created") \
+  X(LOG_JOURNAL_FULL,            LOG_LEVEL_WARN,  "⚠ Journal full. Overwriting oldest entry.") \
+  X(LOG_JOURNAL_APPENDED,        LOG_LEVEL_INFO,  "📦 Journaled log [%s → %s]. Total pending: %u") \
+  X(LOG_JOURNAL_PUBLISH_FAILED,  LOG_LEVEL_WARN,  "⚠ Journal batch publish failed, will retry") \
+  X(LOG_JOURNAL_UPLOADED,        LOG_LEVEL_INFO,  "📤 Uploaded %u journaled log(s), %u pending") \
+  X(LOG_DIAG_PUBLISH_INCOMPLETE, LOG_LEVEL_WARN,  "⚠ Diagnostics publish incomplete, will retry") \
+  X(LOG_DIAG_UPTIME,             LOG_LEVEL_INFO,  "🔧 Uptime %lu s | MQTT reconnects: %d | last MQTT msg %lu s ago") \
+  X(LOG_DIAG_ROUTING,            LOG_LEVEL_INFO,  "🧭 MQTT routed: %lu | unrouted: %lu | schedule events skipped: %lu") \
+  X(LOG_DIAG_RS485,              LOG_LEVEL_INFO,  "📨 RS485 cmds sent: %lu | ACKs received: %lu") \
+  X(LOG_DIAG_NODE,               LOG_LEVEL_INFO,  "   node %02X: %s | last ACK %lus ago | pending P:V %04lX") \
+  X(LOG_DIAG_DEVICE,             LOG_LEVEL_INFO,  "   %s %08lx: %lu cmd(s) | last %lus ago") \
+  X(LOG_DIAG_STATE,              LOG_LEVEL_INFO,  "🚰 Pump: %s | 🚿 Valve: %s") \
+  X(LOG_DIAG_HEAP,               LOG_LEVEL_INFO,  "💡 Heap: %d bytes | MQTT: %s | MQTT State: %d | WiFi RSSI: %d dBm") \
+  X(LOG_DIAG_TEMPERATURE,        LOG_LEVEL_INFO,  "🌡  Chip temperature: %d °C") \
+  X(LOG_DIAG_PHASE,              LOG_LEVEL_INFO,  "⏱  %-8s p50=%lu us p99=%lu us max=%lu us") \
+  X(LOG_SETUP_FETCH,             LOG_LEVEL_INFO,  "🔄 Fetching initial states...") \
+  X(LOG_SETUP_DONE,              LOG_LEVEL_INFO,  "✅ Setup complete.") \
+  X(LOG_WIFI_LOST,               LOG_LEVEL_WARN,  "🔄 WiFi lost. Reconnecting...") \
+  X(LOG_DAILY_RESTART,           LOG_LEVEL_INFO,  "🔁 24h reached. Restarting...")
+#include "hardware/FastLog.h"
+#include "RS485Bus.h"
 
 // =============================================================================
 //  CONFIGURATION
@@ -24,18 +91,9 @@
 #define RS485_BAUDRATE 4800
 HardwareSerial RS485Serial(1);
 
-#define CMD_PUMP_ON   0x11
-#define CMD_PUMP_OFF  0x12
-#define CMD_VALVE_ON  0x21
-#define CMD_VALVE_OFF 0x22
-#define CMD_ACK       0xA1
-#define DEVICE_ADDR   0x01
-#define CMD_HEARTBEAT 0x99
-#define CMD_DISCONNECTED 0xDD  // Custom RS485 code for ESP-NOW disconnection
-#define CMD_CONNECTED 0xCC
+#define DEVICE_ADDR   0x01   // RS485 protocol bytes are in RS485Bus.h
 
 #define WDT_TIMEOUT      30      // Watchdog timeout in seconds
-#define DEBUG_MODE       true    // Set to false to disable logs
 
 #define MAX_RETRIES 30
 #define MAX_SCHEDULES 60
@@ -55,10 +113,31 @@ const int mqtt_port = 8883;  // TLS port
 
 // MQTT Topics
 const char* publish_topic = "flostat/3/valve/1/state";
-const char* valve_topic = "flostat/3/commands/valve/1";
-const char* pump_topic = "flostat/3/commands/pump/1";
+const char* log_batch_topic = "flostat/3/logs/batch";
+const char* diagnostics_topic = "flostat/3/diagnostics";
+// Device commands arrive on flostat/<org>/command/<block>/<device_type>/<device_id>,
+// schedule commands on the same topic + /hardware. The gateway subscribes to
+// the whole org and routes each message to one of gatewayDevices[].
+const char* command_topic_prefix = "flostat/b595d605-fe74-416c-88c0-0e88ed280e56/command/";
+const char* command_topic_filter = "flostat/b595d605-fe74-416c-88c0-0e88ed280e56/command/+/+/+";
+const char* schedule_topic_filter = "flostat/b595d605-fe74-416c-88c0-0e88ed280e56/command/+/+/+/hardware";
 const char* client_id = "espnow-gateway";
 
+// Devices served by this gateway and the RS485 controller that drives each
+#define GATEWAY_MAX_DEVICES 256
+
+struct GatewayDevice {
+  const char* block_id;
+  const char* device_type;   // "pump" or "valve", as in the topic
+  const char* device_id;
+  uint8_t rs485_addr;
+};
+
+const GatewayDevice gatewayDevices[] = {
+  { "816613d0-fc2f-46ed-973b-6ced08798784", "valve", "5ed59de5-6191-4900-9bd3-41a204bdf4f1", DEVICE_ADDR },
+};
+#define GATEWAY_DEVICE_COUNT (sizeof(gatewayDevices) / sizeof(gatewayDevices[0]))
+
 const char* valve_schedule_url = "https://gv6dp7jmaj.execute-api.ap-south-1.amazonaws.com/First/testfunction/?org_id=3&service=fetch_schedules&machine=valve&id=1";
 const char* pump_schedule_url  = "https://gv6dp7jmaj.execute-api.ap-south-1.amazonaws.com/First/testfunction/?org_id=3&service=fetch_schedules&machine=pump&id=1";
 
@@ -149,61 +228,122 @@ WKDedM4VfMBMgcBa4+1oAvw1tJna+Txl6KlqS/QV5t7kfExBBSRBQVfxl67suJX6
 WiFiClientSecure secureClient;
 PubSubClient mqttClient(secureClient);
 
+// Field controllers on the RS485 bus, driven by rs485Bus.service() (RS485Bus.h)
+const uint8_t rs485NodeAddrs[] = { DEVICE_ADDR };
+#define RS485_NODE_COUNT (sizeof(rs485NodeAddrs) / sizeof(rs485NodeAddrs[0]))
+RS485Bus rs485Bus;
+
+// Shared HTTPS session for every REST call, kept alive between requests
+WiFiClientSecure apiClient;
+HTTPClient apiHttp;
+
 int VALVE_ID = 1;
 int PUMP_ID = 1;
 
-struct Schedule {
-  String start_time;
-  String end_time;
-};
-
 #define MAX_HTTP_RETRIES     3
 #define HTTP_TIMEOUT_MS      2000
-#define OFFLINE_BUFFER_LIMIT 10
 
-struct LogEntry {
-  String machineType;
-  bool state;
+// Offline journal: fixed ring of compact records in flash, survives restarts
+#define JOURNAL_PATH         "/journal.bin"
+#define JOURNAL_MAGIC        0x4A4C5346UL   // "FSLJ"
+#define JOURNAL_VERSION      1
+#define JOURNAL_CAPACITY     2048           // records (8 bytes each, 16 KB)
+#define JOURNAL_BATCH_SIZE   40             // records per MQTT upload
+#define JOURNAL_FLUSH_INTERVAL_MS 5000
+
+enum JournalMachine : uint8_t {
+  JOURNAL_PUMP  = 0,
+  JOURNAL_VALVE = 1
 };
 
-std::vector<LogEntry> offlineLogBuffer;
+struct __attribute__((packed)) JournalRecord {
+  uint32_t timestamp;   // epoch seconds, 0 if the clock was not set yet
+  uint8_t machine;      // JournalMachine
+  uint8_t state;
+  uint16_t reserved;
+};
 
-std::vector<Schedule> valveSchedules;
-std::vector<Schedule> pumpSchedules;
+struct __attribute__((packed)) JournalHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t capacity;
+  uint32_t head;        // slot of the oldest record
+  uint32_t count;
+};
+
+JournalHeader journal;
+bool journalReady = false;
+SemaphoreHandle_t journalLock;   // loop() flushes, the cloud log worker appends
+unsigned long lastJournalFlush = 0;
+
+// Cloud log worker: state changes are queued and posted by a background task
+#define CLOUD_LOG_QUEUE_LEN  16
+
+struct CloudLogReport {
+  uint8_t machine;   // JournalMachine
+  uint8_t state;
+};
+
+QueueHandle_t cloudLogQueue;
 
 int wifi_retries = 30;
 
-int rs485_totalCommands = 0;
-int rs485_ackSuccess    = 0;
 int mqtt_reconnects     = 0;
 
-// Store last command sent
-uint8_t lastPumpCommand = 0x00;
-uint8_t lastValveCommand = 0x00;
-
-// Store time of last command (for retry timing, optional)
-unsigned long lastPumpCmdTime = 0;
-unsigned long lastValveCmdTime = 0;
 unsigned long lastScheduleCheck = 0;
 unsigned long lastMqttReceived  = 0;
 unsigned long lastMqttConnect   = 0;
 
+// Per-device command state, same order as gatewayDevices[]
+struct GatewayDeviceState {
+  bool isPump;
+  uint32_t commands;             // commands forwarded to the RS485 bus
+  unsigned long lastCommandMs;
+};
+
+TopicRouter<GATEWAY_MAX_DEVICES> commandRouter;
+GatewayDeviceState gatewayDeviceStates[GATEWAY_DEVICE_COUNT];
+uint32_t mqttRouted = 0;
+uint32_t mqttUnrouted = 0;
+uint32_t mqttSchedulesIgnored = 0;   // schedule events, handled by the controllers
+
 unsigned long lastMqttReconnectAttempt = 0;
 const unsigned long mqttReconnectInterval = 5000;  // 5 seconds
 
 int mqttFailCount = 0;
 const int maxMqttFailures = 12;  // 12 * 5s = 60s
 
-unsigned long lastHeartbeatTime = 0;
-const unsigned long heartbeatInterval = 20000; // every 20 seconds
+unsigned long lastDiagnosticsTime = 0;
+const unsigned long diagnosticsInterval = 20000; // every 20 seconds
 
+// Loop-phase latency histograms, published every DIAG_PUBLISH_INTERVAL_MS
+#define DIAG_PUBLISH_INTERVAL_MS  300000UL     // 5 minutes
+#define PHASE_CYCLES_MAX_MS       10000        // longer phases are timed with millis()
 
-// Schedule storage
-String valveStart[MAX_SCHEDULES], valveEnd[MAX_SCHEDULES];
-int valveCount = 0;
+enum LoopPhase : uint8_t {
+  PHASE_MQTT,       // broker reconnect and mqttClient.loop(), incl. callbacks
+  PHASE_JOURNAL,    // offline journal batch: flash reads and the MQTT publish
+  PHASE_RS485,      // rs485Bus.service()
+  PHASE_HTTP,       // one REST request on the cloud log worker
+  PHASE_NTP,        // time maintenance
+  PHASE_COUNT
+};
+
+const char* const loopPhaseNames[PHASE_COUNT] = { "mqtt", "journal", "rs485", "http", "ntp" };
+
+// PHASE_HTTP is recorded on cloudLogTask (core 0), the rest by loop() (core 1),
+// and publishDiagnostics() resets them from loop(); every access holds phaseMux
+LatencyHistogram phaseHistograms[PHASE_COUNT];
+portMUX_TYPE phaseMux = portMUX_INITIALIZER_UNLOCKED;
+unsigned long phaseWindowStart = 0;
+unsigned long lastDiagPublish = 0;
+uint32_t cyclesPerUs = 240;
+
+struct PhaseTimer {
+  uint32_t cycles;
+  unsigned long ms;
+};
 
-String pumpStart[MAX_SCHEDULES], pumpEnd[MAX_SCHEDULES];
-int pumpCount = 0;
 
 
 bool initial_valve_state = false;
@@ -236,32 +376,56 @@ bool timeSyncInProgress = false;
 unsigned long timeSyncStart = 0;
 const unsigned long TIME_SYNC_TIMEOUT = 10 * 1000;  // 10 seconds timeout
 
-void debugLog(String msg) {
-  if (DEBUG_MODE) Serial.println(msg);
+// Cycle counter for resolution; it wraps after ~17 s at 240 MHz, so phases
+// longer than PHASE_CYCLES_MAX_MS fall back to millis()
+PhaseTimer phaseStart() {
+  PhaseTimer t = { ESP.getCycleCount(), millis() };
+  return t;
+}
+
+void phaseEnd(LoopPhase phase, const PhaseTimer& t) {
+  unsigned long ms = millis() - t.ms;
+  uint32_t us = ms < PHASE_CYCLES_MAX_MS ? (ESP.getCycleCount() - t.cycles) / cyclesPerUs : ms * 1000UL;
+  portENTER_CRITICAL(&phaseMux);
+  phaseHistograms[phase].record(us);
+  portEXIT_CRITICAL(&phaseMux);
 }
 
 bool timeInRange(String nowStr, String start, String end) {
   return nowStr >= start && nowStr < end;
 
 
+// Starts a request on the shared session. With reuse on, end() leaves the
+// socket open, so the next call to the API Gateway skips the TLS handshake.
+bool beginApiRequest(const String& url) {
+  static bool initialized = false;
+  if (!initialized) {
+    apiClient.setInsecure();  // no CA pinned for the REST API, as before
+    apiHttp.setReuse(true);
+    initialized = true;
+  }
+  apiHttp.setTimeout(HTTP_TIMEOUT_MS);
+  return apiHttp.begin(apiClient, url);
+}
+
 bool fetchInitialState(const char* url, bool& state) {
-  HTTPClient http;
-  http.begin(url);
+  if (!beginApiRequest(url)) return false;
+  HTTPClient& http = apiHttp;
   int httpCode = http.GET();
   if (httpCode != 200) {
-    Serial.println("❌ Failed to fetch: " + String(url));
+    LOGF(LOG_FETCH_STATE_FAILED, httpCode);
     http.end();
     return false;
   }
 
   String payload = http.getString();
-  Serial.println("✅ Response: " + payload);
+  LOGF(LOG_FETCH_STATE_DONE, payload.length());
   http.end();
 
   DynamicJsonDocument doc(512);
   DeserializationError err = deserializeJson(doc, payload);
   if (err) {
-    Serial.println("❌ JSON Parse error");
+    LOGF(LOG_FETCH_STATE_PARSE_FAILED, err.c_str());
     return false;
   }
 
@@ -271,20 +435,40 @@ bool fetchInitialState(const char* url, bool& state) {
 }
 
 
+// One parse per message, straight from PubSubClient's buffer, then a switch
+// on the type. Schedules run on the field controllers, not on the gateway:
+// schedule events only reach it through the /hardware wildcard and are
+// counted, not handled.
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  String incomingPayload;
-  for (unsigned int i = 0; i < length; i++) {
-    incomingPayload += (char)payload[i];
+  lastMqttReceived = millis();
+  const char* suffix = "";
+  int dev = commandRouter.route(topic, &suffix);
+  if (dev < 0) {
+    mqttUnrouted++;
+    LOGF(LOG_MQTT_UNROUTED, mqttUnrouted);
+    return;
   }
+  mqttRouted++;
 
-  Serial.println("📩 MQTT Message Received:");
-  Serial.println(incomingPayload);
+  StaticJsonDocument<MQTT_COMMAND_DOC_SIZE> doc;
+  DeserializationError err = deserializeCommand(doc, payload, length);
+  if (err) {
+    LOGF(LOG_COMMAND_PARSE_FAILED, err.c_str());
+    return;
+  }
 
-  // If payload contains a schedule creation event
-  if (incomingPayload.indexOf("SCHEDULE_CREATED") != -1) {
-    handleScheduleCreatedPayload(incomingPayload);
+  switch (classifyMessageType(doc["type"])) {
+    case MSG_DEVICE_UPDATE:
+      if (suffix[0] == '\0') handleDeviceCommand(dev, doc);
+      break;
+    case MSG_SCHEDULE_CREATED:
+    case MSG_SCHEDULE_UPDATE:
+    case MSG_SCHEDULE_DELETE:
+      mqttSchedulesIgnored++;
+      break;
+    default:
+      break;
   }
-  // You can keep your other conditions here (for pump/valve control)
 }
 
 
@@ -292,26 +476,26 @@ void connectToAWS() {
   mqttClient.setKeepAlive(60);
   mqttClient.setServer(mqtt_server, mqtt_port);
   mqttClient.setCallback(mqttCallback);
+  mqttClient.setBufferSize(2048);  // room for a journal batch
 
   secureClient.setCACert(root_ca);
   secureClient.setCertificate(device_cert);
   secureClient.setPrivateKey(private_key);
 
-  Serial.print("🔌 Attempting MQTT connection... ");
+  LOGF(LOG_MQTT_CONNECTING);
   if (mqttClient.connect(client_id)) {
-    Serial.println("✅ MQTT connected");
-    mqttClient.subscribe(valve_topic);
-    mqttClient.subscribe(pump_topic);
-    Serial.println("✅ Subscribed to topics");
+    mqttClient.subscribe(command_topic_filter);
+    mqttClient.subscribe(schedule_topic_filter);
+    LOGF(LOG_MQTT_CONNECTED);
     lastMqttConnect = millis();
     mqttFailCount = 0;
   } else {
     mqttFailCount++;
-    Serial.print("❌ MQTT connect failed, rc=");
-    Serial.println(mqttClient.state());
+    LOGF(LOG_MQTT_CONNECT_FAILED, mqttClient.state());
 
     if (mqttFailCount >= maxMqttFailures) {
-      Serial.println("🚨 Too many MQTT failures. Rebooting...");
+      LOGF(LOG_MQTT_REBOOT);
+      logFlush();
       delay(1000);
       ESP.restart();
     }
@@ -320,92 +504,87 @@ void connectToAWS() {
 
 
 
-void sendRS485Command(uint8_t cmd) {
-  rs485_totalCommands++;
-  uint8_t packet[6];
-  packet[0] = 0xAA;
-  packet[1] = DEVICE_ADDR;
-  packet[2] = cmd;
-  packet[3] = 0x00;
-  packet[4] = packet[0] ^ packet[1] ^ packet[2] ^ packet[3]; // CRC
-  packet[5] = 0x55;
-
-  const int maxAttempts = 5;
-  bool ack = false;
-
-  for (int attempt = 1; attempt <= maxAttempts; attempt++) {
-     
-      mqttClient.loop();  // ✅ allow MQTT processing
-    
-    digitalWrite(RS485_DE_RE, HIGH);
-    delay(2);
-    RS485Serial.write(packet, 6);
-    RS485Serial.flush();
-    delay(2);
-    digitalWrite(RS485_DE_RE, LOW);
-
-    Serial.printf("📤 RS485 Attempt %d: ", attempt);
-    for (int i = 0; i < 6; i++) {
-      Serial.printf("%02X ", packet[i]);
-    }
-    Serial.println();
-
-    ack = waitForACK();
-    if (ack) {
-    rs485_ackSuccess++;
-    debugLog("✅ RS485 ACK received");
-      Serial.println("✅ ACK received. Command successful.");
-      digitalWrite(2,HIGH);
-      break;
-    } else {
-      debugLog("❌ RS485 ACK NOT received");
-      Serial.println("⚠ No ACK. Retrying...");
-      delay(300);
-      digitalWrite(2, LOW);
+// =============================================================================
+//  COMMAND ROUTING (one gateway, many devices)
+// =============================================================================
+// Every command topic of the org arrives here through the wildcard
+// subscriptions. The router is compiled from gatewayDevices[] once at boot;
+// a lookup is a few binary searches on the topic bytes, with no String built,
+// so it stays flat whether the gateway serves one device or a few hundred.
+
+const char* gatewayDeviceKey(size_t i, int level) {
+  const GatewayDevice& d = gatewayDevices[i];
+  return level == 0 ? d.block_id : level == 1 ? d.device_type : d.device_id;
+}
+
+void initCommandRouter() {
+  if (!commandRouter.build(command_topic_prefix, GATEWAY_DEVICE_COUNT, gatewayDeviceKey)) {
+    LOGF(LOG_ROUTER_BUILD_FAILED);
+    return;
+  }
+  for (size_t i = 0; i < GATEWAY_DEVICE_COUNT; i++) {
+    const GatewayDevice& d = gatewayDevices[i];
+    memset(&gatewayDeviceStates[i], 0, sizeof(GatewayDeviceState));
+    gatewayDeviceStates[i].isPump = strcmp(d.device_type, "pump") == 0;
+    if (rs485Bus.findNode(d.rs485_addr) < 0) {
+      LOGF(LOG_ROUTER_NO_NODE, d.device_type, logShortId(d.device_id), d.rs485_addr);
     }
   }
+  LOGF(LOG_ROUTER_READY, GATEWAY_DEVICE_COUNT);
+}
 
-  if (!ack) {
-    Serial.println("❌ Command failed after retries. Receiver may be disconnected.");
-// Store the failed command for retry
-    if (cmd == CMD_PUMP_ON || cmd == CMD_PUMP_OFF) {
-      lastPumpCommand = cmd;
-      lastPumpCmdTime = millis();
-    } else if (cmd == CMD_VALVE_ON || cmd == CMD_VALVE_OFF) {
-      lastValveCommand = cmd;
-      lastValveCmdTime = millis();
-    }
-  } else {
-    // Clear stored command if ACK received
-    if (cmd == CMD_PUMP_ON || cmd == CMD_PUMP_OFF) {
-      lastPumpCommand = 0x00;
-    } else if (cmd == CMD_VALVE_ON || cmd == CMD_VALVE_OFF) {
-      lastValveCommand = 0x00;
-    }
+// {"type":"DEVICE_UPDATE","data":{"status":"ON",...},"updated_by":"user@org"},
+// already parsed by mqttCallback()
+void handleDeviceCommand(int dev, const JsonDocument& doc) {
+  // Status the controllers reported themselves comes back tagged "hardware";
+  // forwarding it would only echo the same state to the bus
+  if (strcmp(doc["updated_by"] | "", "hardware") == 0) return;
+
+  const GatewayDevice& d = gatewayDevices[dev];
+  GatewayDeviceState& st = gatewayDeviceStates[dev];
+  const char* status = doc["data"]["status"] | "";
+  uint8_t cmd;
+  if (st.isPump && strcmp(status, "ON") == 0) cmd = CMD_PUMP_ON;
+  else if (st.isPump && strcmp(status, "OFF") == 0) cmd = CMD_PUMP_OFF;
+  else if (!st.isPump && strcmp(status, "OPEN") == 0) cmd = CMD_VALVE_ON;
+  else if (!st.isPump && strcmp(status, "CLOSE") == 0) cmd = CMD_VALVE_OFF;
+  else return;
+
+  LOGF(LOG_DEVICE_COMMAND, d.device_type, logShortId(d.device_id), cmd);
+  if (rs485Bus.send(d.rs485_addr, cmd)) {
+    st.commands++;
+    st.lastCommandMs = millis();
   }
 }
+// RS485 completion: the state a controller acknowledged goes to the cloud
+// log. Heartbeats and commands that were never acked are not reported.
+void onRS485Complete(uint8_t addr, uint8_t cmd, bool acked) {
+  if (!acked) return;
+  switch (cmd) {
+    case CMD_PUMP_ON:   logDeviceStateToCloud("pump", true); break;
+    case CMD_PUMP_OFF:  logDeviceStateToCloud("pump", false); break;
+    case CMD_VALVE_ON:  logDeviceStateToCloud("valve", true); break;
+    case CMD_VALVE_OFF: logDeviceStateToCloud("valve", false); break;
+  }
+}
+
 void connectToWiFi() {
   WiFi.begin(ssid, password);
-  Serial.print("Connecting to WiFi");
-  Serial.println("SSID");
-  Serial.println(ssid);
-  Serial.println("PASS");
-  Serial.println(password);
-  
-  
+  LOGF(LOG_WIFI_CONNECTING, ssid);
+
   while (WiFi.status() != WL_CONNECTED) {
     delay(500);
     wifi_retries--;
     if(wifi_retries == 0){
-      Serial.println("Restarting....");
+      LOGF(LOG_WIFI_RESTART);
+      logFlush();
       ESP.restart();
     }
-    Serial.println("Connecting to WiFi...");
+    LOGF(LOG_WIFI_WAITING);
   }
 
-  Serial.println("\nWiFi connected!");
-  Serial.println("IP address: ");
-  Serial.println(WiFi.localIP());
+  IPAddress ip = WiFi.localIP();
+  LOGF(LOG_WIFI_CONNECTED, ip[0], ip[1], ip[2], ip[3]);
 
 
 void maintainTimeSync() {
@@ -415,7 +594,7 @@ void maintainTimeSync() {
 
   // Trigger new time sync every 6 hours
   if (!timeSyncInProgress && now - lastTimeSync > TIME_RESYNC_INTERVAL) {
-    Serial.println("🔄 Initiating periodic time re-sync...");
+    LOGF(LOG_TIME_RESYNC_START);
     configTime(gmtOffset_sec, daylightOffset_sec, "pool.ntp.org", "time.nist.gov");
     timeSyncInProgress = true;
     timeSyncStart = now;
@@ -426,10 +605,9 @@ void maintainTimeSync() {
     if (getLocalTime(&timeinfo)) {
       lastTimeSync = now;
       timeSyncInProgress = false;
-      Serial.println("✅ Time re-synced successfully.");
-      Serial.printf("🕒 Current time: %02d:%02d\n", timeinfo.tm_hour, timeinfo.tm_min);
+      LOGF(LOG_TIME_RESYNC_DONE, timeinfo.tm_hour, timeinfo.tm_min);
     } else if (now - timeSyncStart > TIME_SYNC_TIMEOUT) {
-      Serial.println("❌ Time re-sync timed out.");
+      LOGF(LOG_TIME_RESYNC_TIMEOUT);
       timeSyncInProgress = false;  // Abort current sync attempt
     }
   }
@@ -438,34 +616,57 @@ void maintainTimeSync() {
 void setupTime() {
   configTime(gmtOffset_sec, daylightOffset_sec, "pool.ntp.org", "time.nist.gov");
 
-  Serial.print("⏱ Syncing time");
+  LOGF(LOG_TIME_SYNCING);
   int retries = 0;
   while (!getLocalTime(&timeinfo) && retries < 10) {
-    Serial.print(".");
     delay(1000);
     retries++;
   }
 
   if (retries == 10) {
-    Serial.println("❌ Failed to sync time");
+    LOGF(LOG_TIME_SYNC_FAILED);
+    logFlush();
     ESP.restart();
   } else {
-    Serial.println("\n✅ Time synchronized");
-    Serial.printf("Current time: %02d:%02d\n", timeinfo.tm_hour, timeinfo.tm_min);
+    LOGF(LOG_TIME_SYNCED, timeinfo.tm_hour, timeinfo.tm_min);
   }
 }
 
+// Never blocks the caller. When the queue is full the oldest report goes to
+// the offline journal instead of being lost.
 void logDeviceStateToCloud(String machineType, bool state) {
-  // Add MQTT loop processing
-  mqttClient.loop();
+  CloudLogReport r = { (uint8_t)(machineType == "valve" ? JOURNAL_VALVE : JOURNAL_PUMP), (uint8_t)state };
+  if (xQueueSend(cloudLogQueue, &r, 0) != pdTRUE) {
+    CloudLogReport oldest;
+    if (xQueueReceive(cloudLogQueue, &oldest, 0) == pdTRUE) {
+      bufferLog(oldest.machine == JOURNAL_VALVE ? "valve" : "pump", oldest.state);
+    }
+    xQueueSend(cloudLogQueue, &r, 0);
+  }
+}
 
+void cloudLogTask(void* arg) {
+  CloudLogReport r;
+  for (;;) {
+    xQueueReceive(cloudLogQueue, &r, portMAX_DELAY);
+    postDeviceStateToCloud(r.machine == JOURNAL_VALVE ? "valve" : "pump", r.state);
+  }
+}
+
+void startCloudLogWorker() {
+  cloudLogQueue = xQueueCreate(CLOUD_LOG_QUEUE_LEN, sizeof(CloudLogReport));
+  xTaskCreatePinnedToCore(cloudLogTask, "cloudLog", 8192, nullptr, 1, nullptr, 0);
+}
+
+// Blocking HTTP report with retries, only runs on cloudLogTask
+void postDeviceStateToCloud(String machineType, bool state) {
   if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("❌ WiFi not connected! Buffering log.");
+    LOGF(LOG_CLOUD_NO_WIFI);
     bufferLog(machineType, state);
     return;
   }
 
-  HTTPClient http;
+  HTTPClient& http = apiHttp;
   String url = "https://gv6dp7jmaj.execute-api.ap-south-1.amazonaws.com/First/testfunction/";
   url += "?org_id=3";
   url += "&service=update";
@@ -475,95 +676,247 @@ void logDeviceStateToCloud(String machineType, bool state) {
   url += "&id=1";
   url += "&mode=ESP";
 
-  Serial.println("🌐 Logging state to: " + url);
+  LOGF(LOG_CLOUD_POST, machineType == "valve" ? "valve" : "pump", state);
 
   int responseCode = -1;
   bool success = false;
 
   for (int attempt = 1; attempt <= MAX_HTTP_RETRIES; attempt++) {
-    Serial.printf("📡 Attempt %d...\n", attempt);
+    LOGF(LOG_CLOUD_ATTEMPT, attempt);
 
-    http.begin(url);
-    http.setTimeout(HTTP_TIMEOUT_MS);
+    if (!beginApiRequest(url)) break;
 
-    esp_task_wdt_reset();  // WDT feed before request
+    PhaseTimer t = phaseStart();
     unsigned long start = millis();
     responseCode = http.GET();
     unsigned long end = millis();
-    esp_task_wdt_reset();  // WDT feed after request
+    phaseEnd(PHASE_HTTP, t);
 
     if (responseCode == 200) {
-      Serial.printf("✅ Log success in %lu ms (HTTP 200)\n", end - start);
+      http.getString();  // drain the body so the connection can be reused
+      http.end();
+      LOGF(LOG_CLOUD_DONE, end - start);
       success = true;
       break;
     } else {
-      Serial.printf("⚠  HTTP %d: %s\n", responseCode, http.errorToString(responseCode).c_str());
+      LOGF(LOG_CLOUD_HTTP_FAILED, attempt, responseCode);
     }
 
     http.end();
+    // A transport error may be a stale keep-alive socket: retry on a fresh one
+    if (responseCode < 0) apiClient.stop();
     delay(300);  // Short delay before retry
   }
 
   if (!success) {
-    Serial.println("🛑 All attempts failed. Buffering log.");
+    LOGF(LOG_CLOUD_FAILED);
     bufferLog(machineType, state);
   }
+  // The journal is drained from loop() every JOURNAL_FLUSH_INTERVAL_MS
+}
 
-  // Try flushing any offline logs if success now
-  if (success && !offlineLogBuffer.empty()) {
-    flushOfflineLogs();
+// =============================================================================
+//  OFFLINE TELEMETRY JOURNAL
+// =============================================================================
+bool journalWriteHeader(File& f) {
+  f.seek(0);
+  return f.write((const uint8_t*)&journal, sizeof(journal)) == sizeof(journal);
+}
+
+void journalBegin() {
+  journalLock = xSemaphoreCreateMutex();
+  if (!LittleFS.begin(true)) {
+    LOGF(LOG_JOURNAL_MOUNT_FAILED);
+    return;
+  }
+
+  File f = LittleFS.open(JOURNAL_PATH, "r");
+  if (f && f.read((uint8_t*)&journal, sizeof(journal)) == sizeof(journal) &&
+      journal.magic == JOURNAL_MAGIC && journal.version == JOURNAL_VERSION &&
+      journal.capacity == JOURNAL_CAPACITY && journal.head < JOURNAL_CAPACITY &&
+      journal.count <= JOURNAL_CAPACITY) {
+    f.close();
+    journalReady = true;
+    LOGF(LOG_JOURNAL_LOADED, journal.count);
+    return;
   }
+  if (f) f.close();
+
+  // Missing or from another layout: start a fresh, fully sized file
+  journal = { JOURNAL_MAGIC, JOURNAL_VERSION, JOURNAL_CAPACITY, 0, 0 };
+  f = LittleFS.open(JOURNAL_PATH, "w");
+  if (!f) {
+    LOGF(LOG_JOURNAL_CREATE_FAILED);
+    return;
+  }
+  journalWriteHeader(f);
+  JournalRecord empty = {};
+  for (int i = 0; i < JOURNAL_CAPACITY; i++) {
+    f.write((const uint8_t*)&empty, sizeof(empty));
+  }
+  f.close();
+  journalReady = true;
+  LOGF(LOG_JOURNAL_CREATED);
 }
 
+// O(1): overwrite the oldest record when full
 void bufferLog(String machineType, bool state) {
-  if (offlineLogBuffer.size() >= OFFLINE_BUFFER_LIMIT) {
-    Serial.println("⚠ Log buffer full. Discarding oldest entry.");
-    offlineLogBuffer.erase(offlineLogBuffer.begin());  // remove oldest
-  }
+  if (!journalReady) return;
+
+  JournalRecord rec = {};
+  time_t nowEpoch = time(nullptr);
+  rec.timestamp = nowEpoch > 1600000000 ? (uint32_t)nowEpoch : 0;
+  rec.machine = machineType == "valve" ? JOURNAL_VALVE : JOURNAL_PUMP;
+  rec.state = state ? 1 : 0;
 
-  LogEntry entry = { machineType, state };
-  offlineLogBuffer.push_back(entry);
+  xSemaphoreTake(journalLock, portMAX_DELAY);
 
-  Serial.printf("📦 Buffered log [%s → %s]. Total buffered: %d\n", 
-                machineType.c_str(), state ? "ON" : "OFF", offlineLogBuffer.size());
+  uint32_t slot = (journal.head + journal.count) % JOURNAL_CAPACITY;
+  if (journal.count >= JOURNAL_CAPACITY) {
+    journal.head = (journal.head + 1) % JOURNAL_CAPACITY;
+    LOGF(LOG_JOURNAL_FULL);
+  } else {
+    journal.count++;
+  }
+
+  File f = LittleFS.open(JOURNAL_PATH, "r+");
+  if (!f) {
+    xSemaphoreGive(journalLock);
+    return;
+  }
+  f.seek(sizeof(JournalHeader) + slot * sizeof(JournalRecord));
+  f.write((const uint8_t*)&rec, sizeof(rec));
+  journalWriteHeader(f);
+  f.close();
+  uint32_t pending = journal.count;
+  xSemaphoreGive(journalLock);
+
+  LOGF(LOG_JOURNAL_APPENDED, rec.machine == JOURNAL_VALVE ? "valve" : "pump", state ? "ON" : "OFF", pending);
 }
 
+// Drain one batch per call as a single MQTT message; records are only
+// dropped from the journal once the publish succeeded
 void flushOfflineLogs() {
-  if (offlineLogBuffer.empty()) {
-    Serial.println("🧺 No offline logs to flush.");
+  if (!journalReady || !mqttClient.connected()) return;
+
+  // Hold the lock for the whole batch so an append cannot land mid-upload
+  xSemaphoreTake(journalLock, portMAX_DELAY);
+  if (journal.count == 0) {
+    xSemaphoreGive(journalLock);
     return;
   }
 
-  Serial.printf("🧹 Flushing %d buffered log(s) (no cloud send)...\n", offlineLogBuffer.size());
+  JournalRecord batch[JOURNAL_BATCH_SIZE];
+  uint32_t n = journal.count < JOURNAL_BATCH_SIZE ? journal.count : JOURNAL_BATCH_SIZE;
 
-  for (const auto& entry : offlineLogBuffer) {
-    Serial.printf("🗑 Discarding buffered log: [%s → %s]\n",
-                  entry.machineType.c_str(), entry.state ? "ON" : "OFF");
+  File f = LittleFS.open(JOURNAL_PATH, "r+");
+  if (!f) {
+    xSemaphoreGive(journalLock);
+    return;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t slot = (journal.head + i) % JOURNAL_CAPACITY;
+    f.seek(sizeof(JournalHeader) + slot * sizeof(JournalRecord));
+    f.read((uint8_t*)&batch[i], sizeof(JournalRecord));
+  }
+
+  // {"type":"LOG_BATCH","data":{"org_id":"3","block_id":"1","id":"1","logs":[[ts,"pump",1],...]}}
+  static char payload[96 + JOURNAL_BATCH_SIZE * 24];
+  int len = snprintf(payload, sizeof(payload),
+                     "{\"type\":\"LOG_BATCH\",\"data\":{\"org_id\":\"3\",\"block_id\":\"1\",\"id\":\"1\",\"logs\":[");
+  for (uint32_t i = 0; i < n; i++) {
+    len += snprintf(payload + len, sizeof(payload) - len, "%s[%lu,\"%s\",%u]",
+                    i ? "," : "", (unsigned long)batch[i].timestamp,
+                    batch[i].machine == JOURNAL_VALVE ? "valve" : "pump", batch[i].state);
+  }
+  len += snprintf(payload + len, sizeof(payload) - len, "]}}");
+
+  if (!mqttClient.publish(log_batch_topic, (const uint8_t*)payload, len, false)) {
+    LOGF(LOG_JOURNAL_PUBLISH_FAILED);
+    f.close();
+    xSemaphoreGive(journalLock);
+    return;
   }
 
-  offlineLogBuffer.clear();
+  journal.head = (journal.head + n) % JOURNAL_CAPACITY;
+  journal.count -= n;
+  journalWriteHeader(f);
+  f.close();
+  xSemaphoreGive(journalLock);
+  LOGF(LOG_JOURNAL_UPLOADED, n, journal.count);
+}
+
 
-  Serial.println("✅ All buffered logs cleared.");
+// One message per phase keeps each well under the MQTT buffer:
+// {"type":"LOOP_HISTOGRAM","data":{"org_id":"3","id":"1","phase":"rs485","window_s":300,
+//  "n":5321,"max_us":2140,"b":[bucket,count,...]}}
+// Buckets are LatencyHistogram indices, see latencyBucketLowerUs()
+bool publishPhaseHistogram(LoopPhase phase, const LatencyHistogram& h, unsigned long windowSec) {
+  static char payload[160 + LATENCY_BUCKETS * 14];
+  int len = snprintf(payload, sizeof(payload),
+                     "{\"type\":\"LOOP_HISTOGRAM\",\"data\":{\"org_id\":\"3\",\"id\":\"1\",\"phase\":\"%s\","
+                     "\"window_s\":%lu,\"n\":%lu,\"max_us\":%lu,\"b\":[",
+                     loopPhaseNames[phase], windowSec, (unsigned long)h.n, (unsigned long)h.max_us);
+  bool first = true;
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    if (!h.counts[i]) continue;
+    len += snprintf(payload + len, sizeof(payload) - len, "%s%u,%lu", first ? "" : ",", i, (unsigned long)h.counts[i]);
+    first = false;
+  }
+  len += snprintf(payload + len, sizeof(payload) - len, "]}}");
+  return mqttClient.publish(diagnostics_topic, (const uint8_t*)payload, len, false);
 }
 
+// Publish and restart the window; phases that fail keep accumulating. Each
+// histogram is copied and cleared under phaseMux, then published from the
+// copy, so the lock is held for a 408 byte copy and never across MQTT.
+void publishDiagnostics() {
+  if (!mqttClient.connected()) return;
+  unsigned long windowSec = (millis() - phaseWindowStart) / 1000;
+  bool all = true;
+  for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+    LatencyHistogram h;
+    portENTER_CRITICAL(&phaseMux);
+    h = phaseHistograms[p];
+    phaseHistograms[p].reset();
+    portEXIT_CRITICAL(&phaseMux);
+    if (h.n == 0) continue;
+    if (publishPhaseHistogram((LoopPhase)p, h, windowSec)) continue;
+    portENTER_CRITICAL(&phaseMux);
+    phaseHistograms[p].merge(h);
+    portEXIT_CRITICAL(&phaseMux);
+    all = false;
+  }
+  if (all) phaseWindowStart = millis();
+  else LOGF(LOG_DIAG_PUBLISH_INCOMPLETE);
+}
 
 void printDiagnostics() {
-  Serial.println("🔧 ===== Diagnostics =====");
-  Serial.printf("⏱  Uptime (s):            %lu\n", millis() / 1000);
-  Serial.printf("📡 MQTT reconnects:       %d\n", mqtt_reconnects);
-  Serial.printf("🕓 Last MQTT msg (s ago): %lu\n", (millis() - lastMqttReceived) / 1000);
-  Serial.printf("📨 RS485 cmds sent:       %d\n", rs485_totalCommands);
-  Serial.printf("✅ RS485 ACKs received:    %d\n", rs485_ackSuccess);
-  Serial.printf("🚰 Pump state:            %s\n", pumpIsOn ? "ON" : "OFF");
-
-  Serial.printf("💡 Heap: %d bytes | MQTT: %s | MQTT State: %d | WiFi RSSI: %d dBm\n",
-                ESP.getFreeHeap(),
-                mqttClient.connected() ? "Connected" : "Disconnected",
-                mqttClient.state(),
-                WiFi.RSSI());
-
-  Serial.printf("🌡  Chip temperature:      %.2f °C\n", temperatureRead());
-  Serial.println("===========================\n");
+  LOGF(LOG_DIAG_UPTIME, millis() / 1000, mqtt_reconnects, (millis() - lastMqttReceived) / 1000);
+  LOGF(LOG_DIAG_ROUTING, mqttRouted, mqttUnrouted, mqttSchedulesIgnored);
+  LOGF(LOG_DIAG_RS485, rs485Bus.totalCommands, rs485Bus.ackSuccess);
+  for (int i = 0; i < rs485Bus.nodeCount(); i++) {
+    const RS485Node& n = rs485Bus.node(i);
+    LOGF(LOG_DIAG_NODE, n.addr, n.online ? "online" : "offline",
+         n.lastAckTime ? (millis() - n.lastAckTime) / 1000 : 0, (n.pumpCmd << 8) | n.valveCmd);
+  }
+  for (size_t i = 0; i < GATEWAY_DEVICE_COUNT; i++) {
+    const GatewayDeviceState& st = gatewayDeviceStates[i];
+    if (st.commands == 0) continue;
+    LOGF(LOG_DIAG_DEVICE, gatewayDevices[i].device_type, logShortId(gatewayDevices[i].device_id), st.commands,
+         (millis() - st.lastCommandMs) / 1000);
+  }
+  LOGF(LOG_DIAG_STATE, pumpIsOn ? "ON" : "OFF", valveIsOn ? "ON" : "OFF");
+  LOGF(LOG_DIAG_HEAP, ESP.getFreeHeap(), mqttClient.connected() ? "Connected" : "Disconnected", mqttClient.state(),
+       WiFi.RSSI());
+  LOGF(LOG_DIAG_TEMPERATURE, (int)temperatureRead());
+  for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+    LatencyHistogram h;
+    portENTER_CRITICAL(&phaseMux);
+    h = phaseHistograms[p];
+    portEXIT_CRITICAL(&phaseMux);
+    LOGF(LOG_DIAG_PHASE, loopPhaseNames[p], h.percentile(50), h.percentile(99), h.max_us);
+  }
 
   esp_task_wdt_reset();  // 🐶 Feed the watchdog
 }
@@ -572,18 +925,23 @@ void printDiagnostics() {
 
 void setup() {
   Serial.begin(115200);
+  startLogSink(0);
+  cyclesPerUs = getCpuFreqMHz();
   WiFi.mode(WIFI_STA);
   connectToWiFi();
 
   RS485Serial.begin(RS485_BAUDRATE, SERIAL_8N1, RS485_RXD, RS485_TXD);
-  pinMode(RS485_DE_RE, OUTPUT);
   pinMode(2, OUTPUT);
   digitalWrite(2, LOW);
-  digitalWrite(RS485_DE_RE, LOW); // Set receiver mode by default
+  rs485Bus.begin(RS485Serial, RS485_DE_RE, RS485_BAUDRATE, rs485NodeAddrs, RS485_NODE_COUNT);
+  initCommandRouter();
+  journalBegin();
+  startCloudLogWorker();
+  rs485Bus.onComplete(onRS485Complete);   // after the worker: it reports to cloudLogQueue
 
   delay(1000);
   setupTime(); 
-  Serial.println("🔄 Fetching initial states...");
+  LOGF(LOG_SETUP_FETCH);
 
   
   connectToAWS();
@@ -604,7 +962,7 @@ esp_task_wdt_config_t wdt_config = {
 esp_task_wdt_init(&wdt_config);
 
   esp_task_wdt_add(NULL);  // Add current thread to WDT
-    Serial.println("✅ Setup complete.");
+    LOGF(LOG_SETUP_DONE);
 
 
 }
@@ -612,26 +970,23 @@ esp_task_wdt_init(&wdt_config);
 void loop() {
     esp_task_wdt_reset(); // Feed the watchdog
 
+  PhaseTimer t = phaseStart();
   maintainTimeSync();  // non-blocking NTP time maintenance
     unsigned long now = millis();
 if (millis() - lastTimeSync > 21600000UL) {
   configTime(19800, 0, "pool.ntp.org", "time.nist.gov");
   lastTimeSync = millis();
 }
+  phaseEnd(PHASE_NTP, t);
 
 if (WiFi.status() != WL_CONNECTED) {
-  Serial.println("🔄 WiFi lost. Reconnecting...");
+  LOGF(LOG_WIFI_LOST);
   WiFi.disconnect();
   WiFi.begin(ssid, password);
 }
 
-if (ESP.getFreeHeap() < 50000) {    // Threshold based on load
-  Serial.println("⚠ Low heap! Restarting...");
-  delay(100);
-  ESP.restart();
-}
-
  // Non-blocking reconnect attempt
+  t = phaseStart();
   if (!mqttClient.connected() && now - lastMqttReconnectAttempt > mqttReconnectInterval) {
     lastMqttReconnectAttempt = now;
     connectToAWS();
@@ -639,42 +994,37 @@ if (ESP.getFreeHeap() < 50000) {    // Threshold based on load
 
   if (WiFi.status() != WL_CONNECTED) ESP.restart();
   mqttClient.loop();
-
-// 💓 Send heartbeat every 20 seconds
-if (millis() - lastHeartbeatTime >= heartbeatInterval) {
-  sendRS485Command(CMD_HEARTBEAT);
-      printDiagnostics();
-  lastHeartbeatTime = millis();
+  phaseEnd(PHASE_MQTT, t);
+
+  t = phaseStart();
+  rs485Bus.service();  // non-blocking RS485 bus manager
+  phaseEnd(PHASE_RS485, t);
+
+// 📒 Drain the offline journal in batches while MQTT is up
+if (millis() - lastJournalFlush >= JOURNAL_FLUSH_INTERVAL_MS) {
+  t = phaseStart();
+  flushOfflineLogs();
+  phaseEnd(PHASE_JOURNAL, t);
+  lastJournalFlush = millis();
 }
 
-// ⏳ Retry unsent pump/valve command every 10 seconds
-if (lastPumpCommand != 0x00 && millis() - lastPumpCmdTime > 10000) {
-  Serial.println("♻ Retrying last pump command...");
-  sendRS485Command(lastPumpCommand);
+// 🔧 Diagnostics every 20 seconds (heartbeats and retries are handled per node by rs485Bus)
+if (millis() - lastDiagnosticsTime >= diagnosticsInterval) {
+  printDiagnostics();
+  lastDiagnosticsTime = millis();
 }
 
-if (lastValveCommand != 0x00 && millis() - lastValveCmdTime > 10000) {
-  Serial.println("♻ Retrying last valve command...");
-  sendRS485Command(lastValveCommand);
+// 📊 Loop-phase histograms to the cloud
+if (millis() - lastDiagPublish >= DIAG_PUBLISH_INTERVAL_MS) {
+  publishDiagnostics();
+  lastDiagPublish = millis();
 }
 
-// 🕒 Check schedules every 1 second
-//   if (millis() - lastScheduleCheck >= scheduleInterval) {
-//     Serial.println("Schedule check");
-//     // checkAndTriggerSchedules();
-//     lastScheduleCheck = millis();
-Serial.println("");
-Serial.println("VALVEON");
-Serial.println(valveIsOn);
-Serial.println("PUMPON");
-Serial.println(pumpIsOn);
-Serial.println("");
-
   }
 
   if (millis() > 86400000UL) {
-  Serial.println("🔁 24h reached. Restarting...");
-  delay(100);
+  LOGF(LOG_DAILY_RESTART);
+  logFlush();
   ESP.restart();
 }
 
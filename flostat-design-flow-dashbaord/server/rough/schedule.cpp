@@ -6,6 +6,10 @@
 
 #include <time.h>
 
+#include <ArduinoJson.h>
+
+#include "DeviceTelemetry.h"
+
 
 
 // WiFi credentials
@@ -22,9 +26,15 @@ const int daylightOffset_sec = 0;
 
 
 
-const unsigned long PUBLISH_INTERVAL_MS = 30000;
+// The level is sampled every second and published on change (see
+
+// TelemetryGate); the policy can be retuned at runtime on configTopic
+
+const unsigned long SAMPLE_INTERVAL_MS = 1000;
 
-unsigned long lastPublish = 0;
+unsigned long lastSample = 0;
+
+TelemetryGate telemetryGate(TelemetryPolicy{ 2, 5, 5000, 300000 });
 
 int currentLevel = 10;  // starting level
 
@@ -208,6 +218,34 @@ const char* statusTopic = "TOPIC";
 
 
 
+// Compact wire format (see server/utils/wireFormat.js): a MessagePack map
+
+// {0: type, 1: data} with integer keys and 16 byte binary UUIDs, published
+
+// on statusTopic + "/mp" in place of the JSON DEVICE_UPDATE. JSON by
+
+// default: MessagePack needs the "/mp" IoT rule deployed first.
+
+#define WIRE_FORMAT_JSON     0
+
+#define WIRE_FORMAT_MSGPACK  1
+
+#define WIRE_FORMAT          WIRE_FORMAT_JSON
+
+const char* statusTopicWire = "TOPIC/mp";
+
+const char* configTopic = "TOPIC/config";
+
+const char* org_id = "eb507b9c-2059-4e70-8f33-251d08e8e030";
+
+const char* device_id = "4f0bb69a-da8a-418d-82d7-fa59fbbfceec";
+
+// ADC pin reading the battery through a 1:2 divider, -1 on mains power
+
+#define BATTERY_ADC_PIN -1
+
+
+
 WiFiClientSecure espClient;
 
 PubSubClient client(espClient);
@@ -288,6 +326,8 @@ void connectAWS() {
 
       client.subscribe(statusTopic);
 
+      client.subscribe(configTopic);
+
       client.publish(statusTopic, "{\"status\":\"connected with AWS\"}", true);
 
     } else {
@@ -312,6 +352,41 @@ void connectAWS() {
 
 // -----------------------------------------------------------------------------
 
+// {"deadband":2,"rate_per_min":5,"min_interval_s":5,"max_interval_s":300},
+
+// keys left out keep their current value
+
+void applyTelemetryConfig(const byte* payload, unsigned int length) {
+
+  StaticJsonDocument<256> doc;
+
+  if (deserializeJson(doc, payload, length)) {
+
+    Serial.println("❌ Invalid telemetry config");
+
+    return;
+
+  }
+
+  TelemetryPolicy& p = telemetryGate.policy;
+
+  p.deadband = doc["deadband"] | p.deadband;
+
+  p.rate_per_min = doc["rate_per_min"] | p.rate_per_min;
+
+  p.min_interval_ms = (doc["min_interval_s"] | p.min_interval_ms / 1000) * 1000UL;
+
+  p.max_interval_ms = (doc["max_interval_s"] | p.max_interval_ms / 1000) * 1000UL;
+
+  if (p.max_interval_ms < p.min_interval_ms) p.max_interval_ms = p.min_interval_ms;
+
+  Serial.printf("⚙️ Telemetry: deadband=%u%% rate=%u%%/min min=%lus max=%lus\n",
+
+                p.deadband, p.rate_per_min, (unsigned long)(p.min_interval_ms / 1000), (unsigned long)(p.max_interval_ms / 1000));
+
+}
+
+
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
 
   String msg;
@@ -322,6 +397,8 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
 
   Serial.printf("📩 MQTT [%s] => %s\n", topic, msg.c_str());
 
+  if (strcmp(topic, configTopic) == 0) applyTelemetryConfig(payload, length);
+
 }
 
 
@@ -370,11 +447,17 @@ void loop() {
 
   unsigned long now = millis();
 
-  if ((now - lastPublish) >= PUBLISH_INTERVAL_MS || now < lastPublish) {
+  if (now - lastSample >= SAMPLE_INTERVAL_MS) {
+
+    lastSample = now;
 
-    lastPublish = now;
+    currentLevel = readTankLevel();
 
-    publishDeviceUpdate();
+    if (telemetryGate.shouldPublish(currentLevel, now) && publishDeviceUpdate()) {
+
+      telemetryGate.published(currentLevel, now);
+
+    }
 
   }
 
@@ -404,52 +487,70 @@ void loop() {
 
 
 
-void publishDeviceUpdate() {
+// Li-ion 3.3 V .. 4.2 V -> 0..100, -1 when there is no battery to report
+
+int readBatteryPercent() {
+
+#if BATTERY_ADC_PIN >= 0
+
+  uint32_t mv = analogReadMilliVolts(BATTERY_ADC_PIN) * 2;
+
+  if (mv <= 3300) return 0;
 
-  currentLevel += 10;
+  if (mv >= 4200) return 100;
 
-  if (currentLevel > 100) currentLevel = 0;
+  return (mv - 3300) / 9;
 
+#else
 
+  return -1;
 
-  // Build payload dynamically
+#endif
 
-  String payload = "{";
+}
+
+
+// Simulated sensor: +10 % every 30 s, back to 0 after 100
+
+int readTankLevel() {
+
+  return (10 + (millis() / 30000) * 10) % 110;
+
+}
 
-  payload += "\"type\":\"DEVICE_UPDATE\",";
+bool publishDeviceUpdate() {
 
-  payload += "\"data\":{";
 
-  payload += "\"last_updated\":\"2025-10-03T14:48:17.872Z\",";
 
-  payload += "\"device_id\":\"4f0bb69a-da8a-418d-82d7-fa59fbbfceec\",";
+  DeviceTelemetry t = { org_id, device_id, "tank", currentLevel,
 
-  payload += "\"device_type\":\"tank\",";
+                        rssiToPercent(WiFi.RSSI()), readBatteryPercent(), time(nullptr) };
 
-  payload += "\"wifi_strength\":65,";
+#if WIRE_FORMAT == WIRE_FORMAT_MSGPACK
 
-  payload += "\"battery\":85,";
+  uint8_t payload[69];
 
-  payload += "\"source\":\"hardware\",";
+  size_t len = encodeTelemetryWire(t, payload);
 
-  payload += "\"org_id\":\"eb507b9c-2059-4e70-8f33-251d08e8e030\",";
+  const char* topic = statusTopicWire;
 
-  payload += "\"current_level\":" + String(currentLevel) + ",";
+#else
 
-  payload += "\"updated_by\":\"hardware\"";
+  char payload[320];
 
-  payload += "},";
+  size_t len = encodeTelemetryJson(t, payload);
 
-  payload += "\"updated_by\":\"hardware\"";
+  const char* topic = statusTopic;
 
-  payload += "}";
+#endif
 
+  bool ok = len > 0 && client.publish(topic, (const uint8_t*)payload, len, false);
 
+  Serial.printf("📤 Publish DEVICE_UPDATE (current_level=%d, %u bytes) -> %s [%s]\n",
 
-  bool ok = client.publish(statusTopic, payload.c_str(), false);
+                currentLevel, (unsigned)len, topic, ok ? "OK" : "FAIL");
 
-  Serial.printf("📤 Publish DEVICE_UPDATE (current_level=%d) -> %s [%s]\n",
+  return ok;
 
-                currentLevel, statusTopic, ok ? "OK" : "FAIL");
 
 }
\ No newline at end of file
@@ -2,7 +2,7 @@ import { Router } from "express";
 import { createOrg, deleteOrg, getAllUsersForOrg, getOrgTopics, getSingleOrg, updateOrg, updateOrgThreshold } from "../controllers/Org.js";
 import { IsController, IsRoot, verifyAuth } from "../middlewares/auth.js";
 import { getLogs } from "../controllers/Logs.js";
-import { createSchedule, deleteSchedule, getScheduleById, getScheduleByOrgId, updateSchedule } from "../controllers/Scheduler.js";
+import { createSchedule, deleteSchedule, getScheduleByDeviceId, getScheduleById, getScheduleByOrgId, updateSchedule } from "../controllers/Scheduler.js";
 
 const router = Router();
 
@@ -32,6 +32,8 @@ router.delete("/deleteSchedule",verifyAuth,IsController,deleteSchedule)//c
 router.post("/getScheduleById",getScheduleById)
 // getScheduleByOrgId
 router.post("/getScheduleByOrgId",getScheduleByOrgId)
+// getScheduleByDeviceId
+router.post("/getScheduleByDeviceId",getScheduleByDeviceId)
 
 
 export default router;
\ No newline at end of file
@@ -60,6 +60,8 @@ export const USER_DEVICE = {
     
 }
 export const HARDWARE = "hardware";
+// Devices run their schedules on local time here (IST, +05:30 on the firmware)
+export const SCHEDULE_TIMEZONE = "Asia/Kolkata";
 export const LEVEL = {
     HIGH:"HIGH",
     LOW:"LOW"
@@ -73,4 +75,8 @@ export const QUREY_STATUS = {
 export const USER_TYPE = {
     CUSTOMER:"customer",
     FLOSTAT:"flostat"
-}
\ No newline at end of file
+}
+export const WIRE_FORMAT = {
+    JSON:"json",
+    MSGPACK:"msgpack"
+}
@@ -1,4 +1,6 @@
 import AWS from "aws-sdk";
+import { WIRE_FORMAT } from "./constants.js";
+import { encodeWireMessage } from "./wireFormat.js";
 
 // Configure AWS region (optional if using default)
 AWS.config.update({ region: process.env.AWS_REGION || "ap-south-1" });
@@ -7,9 +9,10 @@ AWS.config.update({ region: process.env.AWS_REGION || "ap-south-1" });
  * Publish a message to AWS IoT Core
  * @param {string} topic - The MQTT topic
  * @param {object} payload - The message payload
+ * @param {string} [format] - WIRE_FORMAT the receiving device accepts, JSON by default
  * @returns {Promise<object>} - Success/failure
  */
-export async function mqttPublish(topic, payload) {
+export async function mqttPublish(topic, payload, format = WIRE_FORMAT.JSON) {
   try {
     if (!topic) throw new Error("Topic is required");
     if (!payload) throw new Error("Payload is required");
@@ -24,7 +27,7 @@ export async function mqttPublish(topic, payload) {
   
     await iotData.publish({
       topic,
-      payload: JSON.stringify(payload),
+      payload: format === WIRE_FORMAT.MSGPACK ? encodeWireMessage(payload) : JSON.stringify(payload),
       qos: 0
     }).promise();
 
@@ -1,14 +1,19 @@
+import { SCHEDULE_TIMEZONE } from "./constants.js";
+
 export function timeToMinutes(timeString) {
   const [hours, minutes] = timeString.split(":").map(Number);
   return hours * 60 + minutes;
 }
 
-export function addSecondsToTime(timeString, secondsToAdd) {
-  // Split HH:mm into hours and minutes
-  const [hours, minutes] = timeString.split(":").map(Number);
+// "HH:mm" or "HH:mm:ss" -> second of the day, as the devices evaluate it
+export function timeToSeconds(timeString) {
+  const [hours, minutes, seconds = 0] = timeString.split(":").map(Number);
+  return hours * 3600 + minutes * 60 + seconds;
+}
 
-  // Convert to total seconds
-  let totalSeconds = hours * 3600 + minutes * 60 + secondsToAdd;
+export function addSecondsToTime(timeString, secondsToAdd) {
+  // Convert HH:mm[:ss] to total seconds
+  let totalSeconds = timeToSeconds(timeString) + secondsToAdd;
 
   // Compute new hours, minutes, seconds
   const newHours = Math.floor(totalSeconds / 3600) % 24;
@@ -20,3 +25,152 @@ export function addSecondsToTime(timeString, secondsToAdd) {
 }
 
 
+
+// ---------------- Recurrence ----------------
+// A schedule's recurrence, as stored and as evaluated on the devices:
+//   { weekdays, every_n_days, valid_from, valid_until }
+// weekdays is a bit mask (bit 0 = Sunday, as Date.getDay()), every_n_days
+// counts from valid_from, and the dates are "YYYY-MM-DD" (inclusive) or
+// null. A window whose end_time is not after its start_time runs past
+// midnight into the next day.
+const SECONDS_PER_DAY = 86400;
+const SECONDS_PER_WEEK = 7 * SECONDS_PER_DAY;
+const DAY_MS = 86400000;
+export const ALL_WEEKDAYS = 0x7f;
+const MAX_EVERY_N_DAYS = 366;
+const DATE_RE = /^\d{4}-\d{2}-\d{2}$/;
+
+const DAILY = { weekdays: ALL_WEEKDAYS, every_n_days: 1, valid_from: null, valid_until: null };
+
+// "YYYY-MM-DD" of `date` in `timeZone`
+export function localDate(date = new Date(), timeZone = SCHEDULE_TIMEZONE) {
+  return new Intl.DateTimeFormat("en-CA", { timeZone }).format(date);
+}
+
+// "YYYY-MM-DD" -> days since 1970-01-01, NaN if it is not a real date
+export function dateToDay(date) {
+  if (!DATE_RE.test(date)) return NaN;
+  const ms = Date.parse(`${date}T00:00:00Z`);
+  if (Number.isNaN(ms) || new Date(ms).toISOString().slice(0, 10) !== date) return NaN;
+  return ms / DAY_MS;
+}
+
+const weekdayOf = (day) => (day + 4) % 7; // 1970-01-01 was a Thursday
+
+/**
+ * Normalise a recurrence from the API into the stored form.
+ * Accepts the dashboard's "daily", "weekly" (on today's weekday) and
+ * "none" (today only) shorthands. Throws with a user-facing message.
+ * @param {string|object|undefined} recurrence
+ * @param {string} today "YYYY-MM-DD" in SCHEDULE_TIMEZONE
+ */
+export function normalizeRecurrence(recurrence, today = localDate()) {
+  if (recurrence === undefined || recurrence === null || recurrence === "daily") return { ...DAILY };
+  if (recurrence === "weekly") return { ...DAILY, weekdays: 1 << weekdayOf(dateToDay(today)) };
+  if (recurrence === "none" || recurrence === "once") return { ...DAILY, valid_from: today, valid_until: today };
+  if (typeof recurrence !== "object" || Array.isArray(recurrence)) {
+    throw new Error(`Unknown recurrence "${recurrence}"`);
+  }
+
+  let weekdays = recurrence.weekdays ?? ALL_WEEKDAYS;
+  if (Array.isArray(weekdays)) {
+    if (!weekdays.every((d) => Number.isInteger(d) && d >= 0 && d <= 6)) {
+      throw new Error("weekdays must be numbers from 0 (Sunday) to 6 (Saturday)");
+    }
+    weekdays = weekdays.reduce((mask, d) => mask | (1 << d), 0);
+  }
+  if (!Number.isInteger(weekdays) || weekdays < 1 || weekdays > ALL_WEEKDAYS) {
+    throw new Error("weekdays must select at least one day");
+  }
+
+  const every_n_days = recurrence.every_n_days ?? 1;
+  if (!Number.isInteger(every_n_days) || every_n_days < 1 || every_n_days > MAX_EVERY_N_DAYS) {
+    throw new Error(`every_n_days must be between 1 and ${MAX_EVERY_N_DAYS}`);
+  }
+
+  const valid_until = recurrence.valid_until || null;
+  // "every N days" needs a first day to count from
+  const valid_from = recurrence.valid_from || (every_n_days > 1 ? today : null);
+  for (const date of [valid_from, valid_until]) {
+    if (date !== null && Number.isNaN(dateToDay(date))) throw new Error(`Invalid date "${date}"`);
+  }
+  if (valid_from && valid_until && valid_until < valid_from) {
+    throw new Error("valid_until must not be before valid_from");
+  }
+  return { weekdays, every_n_days, valid_from, valid_until };
+}
+
+// Stored schedules from before recurrences existed (no field, or a label)
+// run every day on the devices
+export const recurrenceOf = (schedule) =>
+  schedule?.recurrence && typeof schedule.recurrence === "object" ? schedule.recurrence : DAILY;
+
+const occursOn = (recurrence, day) => {
+  const from = recurrence.valid_from ? dateToDay(recurrence.valid_from) : 0;
+  const until = recurrence.valid_until ? dateToDay(recurrence.valid_until) : Infinity;
+  return (
+    (recurrence.weekdays & (1 << weekdayOf(day))) !== 0 &&
+    day >= from &&
+    day <= until &&
+    (recurrence.every_n_days <= 1 || (day - from) % recurrence.every_n_days === 0)
+  );
+};
+
+// Same rule as the firmware: on today's occurrence from start_time, or
+// before end_time on the morning after an occurrence that runs past midnight
+export function isScheduleActiveAt(schedule, date = new Date()) {
+  const day = dateToDay(localDate(date));
+  const now = timeToSeconds(
+    date.toLocaleTimeString("en-GB", {
+      timeZone: SCHEDULE_TIMEZONE, hour: "2-digit", minute: "2-digit", second: "2-digit", hour12: false,
+    })
+  );
+  const start = timeToSeconds(schedule.start_time);
+  const end = timeToSeconds(schedule.end_time);
+  const recurrence = recurrenceOf(schedule);
+  if (end > start) return now >= start && now < end && occursOn(recurrence, day);
+  return (now >= start && occursOn(recurrence, day)) || (now < end && occursOn(recurrence, day - 1));
+}
+
+// Second-of-week ranges a schedule can run in; a window past Saturday
+// midnight continues on Sunday
+const weekRanges = (schedule) => {
+  const start = timeToSeconds(schedule.start_time);
+  let end = timeToSeconds(schedule.end_time);
+  if (end <= start) end += SECONDS_PER_DAY;
+  const { weekdays } = recurrenceOf(schedule);
+  const ranges = [];
+  for (let d = 0; d < 7; d++) {
+    if (!(weekdays & (1 << d))) continue;
+    const s = d * SECONDS_PER_DAY + start;
+    const e = d * SECONDS_PER_DAY + end;
+    ranges.push([s, e]);
+    if (e > SECONDS_PER_WEEK) ranges.push([s - SECONDS_PER_WEEK, e - SECONDS_PER_WEEK]);
+  }
+  return ranges;
+};
+
+// Day range a schedule can run on, one day past valid_until for a window
+// that runs past midnight
+const dayRange = (schedule) => {
+  const { valid_from, valid_until } = recurrenceOf(schedule);
+  const spill = timeToSeconds(schedule.end_time) <= timeToSeconds(schedule.start_time) ? 1 : 0;
+  return [
+    valid_from ? dateToDay(valid_from) : -Infinity,
+    valid_until ? dateToDay(valid_until) + spill : Infinity,
+  ];
+};
+
+/**
+ * Whether two schedules of one device can ever be on at the same time.
+ * Conservative: every_n_days is ignored, so alternating schedules on the
+ * same weekdays still count as overlapping. Touching windows overlap, as
+ * they always have here.
+ */
+export function schedulesOverlap(a, b) {
+  const [aFrom, aUntil] = dayRange(a);
+  const [bFrom, bUntil] = dayRange(b);
+  if (aUntil < bFrom || bUntil < aFrom) return false;
+  const bRanges = weekRanges(b);
+  return weekRanges(a).some(([as, ae]) => bRanges.some(([bs, be]) => as <= be && bs <= ae));
+}
@@ -0,0 +1,112 @@
+// normalizeRecurrence() and schedulesOverlap(), the recurrence rules the
+// API applies before a schedule reaches the devices. Run with `npm test`.
+import { test } from "node:test";
+import assert from "node:assert/strict";
+
+import { ALL_WEEKDAYS, normalizeRecurrence, schedulesOverlap } from "./timeUtilities.js";
+
+const SUNDAY = "2026-11-01";
+const MONDAY = "2026-11-02";
+const bit = (weekday) => 1 << weekday;
+
+const schedule = (start_time, end_time, recurrence) => ({ start_time, end_time, recurrence });
+
+test("normalizeRecurrence: shorthands", () => {
+  const daily = { weekdays: ALL_WEEKDAYS, every_n_days: 1, valid_from: null, valid_until: null };
+  assert.deepEqual(normalizeRecurrence(undefined, SUNDAY), daily);
+  assert.deepEqual(normalizeRecurrence(null, SUNDAY), daily);
+  assert.deepEqual(normalizeRecurrence("daily", SUNDAY), daily);
+  assert.deepEqual(normalizeRecurrence("weekly", SUNDAY), { ...daily, weekdays: bit(0) });
+  assert.deepEqual(normalizeRecurrence("weekly", MONDAY), { ...daily, weekdays: bit(1) });
+  assert.deepEqual(normalizeRecurrence("weekly", "2028-02-29"), { ...daily, weekdays: bit(2) });
+  for (const once of ["none", "once"]) {
+    assert.deepEqual(normalizeRecurrence(once, MONDAY), { ...daily, valid_from: MONDAY, valid_until: MONDAY });
+  }
+  // The stored default is a copy, not the shared constant
+  normalizeRecurrence("daily", SUNDAY).weekdays = 0;
+  assert.equal(normalizeRecurrence("daily", SUNDAY).weekdays, ALL_WEEKDAYS);
+});
+
+test("normalizeRecurrence: weekdays", () => {
+  assert.equal(normalizeRecurrence({ weekdays: [1, 3] }, SUNDAY).weekdays, bit(1) | bit(3));
+  assert.equal(normalizeRecurrence({ weekdays: [0, 0, 6] }, SUNDAY).weekdays, bit(0) | bit(6));
+  assert.equal(normalizeRecurrence({ weekdays: 0x41 }, SUNDAY).weekdays, 0x41);
+  assert.equal(normalizeRecurrence({}, SUNDAY).weekdays, ALL_WEEKDAYS);
+  for (const weekdays of [[], 0, 0x80, -1, 1.5, "1", [7], [-1], [1.5], ["1"]]) {
+    assert.throws(() => normalizeRecurrence({ weekdays }, SUNDAY), Error, `weekdays ${JSON.stringify(weekdays)}`);
+  }
+});
+
+test("normalizeRecurrence: every_n_days counts from valid_from", () => {
+  const r = normalizeRecurrence({ every_n_days: 3 }, SUNDAY);
+  assert.equal(r.every_n_days, 3);
+  assert.equal(r.valid_from, SUNDAY);
+  assert.equal(normalizeRecurrence({ every_n_days: 3, valid_from: MONDAY }, SUNDAY).valid_from, MONDAY);
+  assert.equal(normalizeRecurrence({ every_n_days: 1 }, SUNDAY).valid_from, null);
+  assert.equal(normalizeRecurrence({ every_n_days: 366 }, SUNDAY).every_n_days, 366);
+  for (const every_n_days of [0, -2, 367, 1.5, "2"]) {
+    assert.throws(() => normalizeRecurrence({ every_n_days }, SUNDAY), /every_n_days/);
+  }
+});
+
+test("normalizeRecurrence: date bounds", () => {
+  const r = normalizeRecurrence({ valid_from: SUNDAY, valid_until: SUNDAY }, MONDAY);
+  assert.equal(r.valid_from, SUNDAY);
+  assert.equal(r.valid_until, SUNDAY);
+  assert.equal(normalizeRecurrence({ valid_until: "2028-02-29" }, SUNDAY).valid_until, "2028-02-29");
+  for (const date of ["2026-02-30", "2026-02-29", "2026-13-01", "2026-11-1", "2026/11/01", "tomorrow"]) {
+    assert.throws(() => normalizeRecurrence({ valid_from: date }, SUNDAY), /Invalid date/);
+    assert.throws(() => normalizeRecurrence({ valid_until: date }, SUNDAY), /Invalid date/);
+  }
+  assert.throws(() => normalizeRecurrence({ valid_from: MONDAY, valid_until: SUNDAY }, SUNDAY), /valid_until/);
+});
+
+test("normalizeRecurrence: unknown forms", () => {
+  for (const recurrence of ["monthly", "", 7, true, [1, 2]]) {
+    assert.throws(() => normalizeRecurrence(recurrence, SUNDAY), Error, JSON.stringify(recurrence));
+  }
+});
+
+test("schedulesOverlap: same days", () => {
+  const daily = normalizeRecurrence("daily", SUNDAY);
+  assert.ok(schedulesOverlap(schedule("06:00", "07:00", daily), schedule("06:30", "08:00", daily)));
+  assert.ok(!schedulesOverlap(schedule("06:00", "07:00", daily), schedule("07:30", "08:00", daily)));
+  // Touching windows overlap
+  assert.ok(schedulesOverlap(schedule("06:00", "07:00", daily), schedule("07:00", "08:00", daily)));
+  // Schedules from before recurrences run every day
+  assert.ok(schedulesOverlap(schedule("06:00", "07:00"), schedule("06:30", "06:45", daily)));
+});
+
+test("schedulesOverlap: weekdays", () => {
+  const mondays = { weekdays: bit(1) };
+  const tuesdays = { weekdays: bit(2) };
+  const r = (rec) => normalizeRecurrence(rec, SUNDAY);
+  assert.ok(!schedulesOverlap(schedule("06:00", "07:00", r(mondays)), schedule("06:00", "07:00", r(tuesdays))));
+  assert.ok(schedulesOverlap(schedule("06:00", "07:00", r(mondays)), schedule("06:00", "07:00", r({ weekdays: [1, 2] }))));
+
+  // A Monday night runs into Tuesday morning, not into Monday morning
+  assert.ok(schedulesOverlap(schedule("23:00", "01:00", r(mondays)), schedule("00:30", "02:00", r(tuesdays))));
+  assert.ok(!schedulesOverlap(schedule("23:00", "01:00", r(mondays)), schedule("00:30", "02:00", r(mondays))));
+  // Saturday night continues on Sunday
+  const saturdays = r({ weekdays: [6] });
+  const sundays = r({ weekdays: [0] });
+  assert.ok(schedulesOverlap(schedule("23:00", "01:00", saturdays), schedule("00:30", "02:00", sundays)));
+  assert.ok(schedulesOverlap(schedule("00:30", "02:00", sundays), schedule("23:00", "01:00", saturdays)));
+});
+
+test("schedulesOverlap: date ranges", () => {
+  const r = (rec) => normalizeRecurrence(rec, SUNDAY);
+  const november = r({ valid_from: "2026-11-01", valid_until: "2026-11-30" });
+  const december = r({ valid_from: "2026-12-01", valid_until: "2026-12-31" });
+  assert.ok(!schedulesOverlap(schedule("06:00", "07:00", november), schedule("06:00", "07:00", december)));
+  assert.ok(schedulesOverlap(schedule("06:00", "07:00", november), schedule("06:00", "07:00", r("daily"))));
+  // The last November night ends on the morning of December 1
+  assert.ok(schedulesOverlap(schedule("23:00", "01:00", november), schedule("00:30", "02:00", december)));
+  assert.ok(!schedulesOverlap(schedule("22:00", "23:00", november), schedule("00:30", "02:00", december)));
+});
+
+test("schedulesOverlap: every_n_days is ignored", () => {
+  const odd = normalizeRecurrence({ every_n_days: 2, valid_from: SUNDAY }, SUNDAY);
+  const even = normalizeRecurrence({ every_n_days: 2, valid_from: MONDAY }, SUNDAY);
+  assert.ok(schedulesOverlap(schedule("06:00", "07:00", odd), schedule("06:00", "07:00", even)));
+});
@@ -0,0 +1,269 @@
+// Compact binary wire format for device traffic, an alternative to JSON for
+// devices that announce it (DEVICE_HELLO with wire = "msgpack").
+//
+// A message is a MessagePack map { 0: type, 1: data }. The type and the data
+// keys are small integers, UUIDs travel as 16 byte binaries, schedule
+// times as seconds of the day and a recurrence as
+// [weekdays, every_n_days, valid_from, valid_until] with the dates as days
+// since 1970-01-01 (0 = no bound). Must stay in sync with the firmware
+// (rough/hardware/WireFormat.h) and rough/iothandler/ioth3.py.
+
+export const WIRE_TYPES = {
+  DEVICE_UPDATE: 1,
+  DEVICE_STATUS: 2,
+  DEVICE_HELLO: 3,
+  SCHEDULE_ACK: 4,
+  SCHEDULE_ACK_UPDATE: 5,
+  SCHEDULE_ACK_DELETE: 6,
+  SCHEDULE_CREATED: 7,
+  SCHEDULE_UPDATE: 8,
+  SCHEDULE_DELETE: 9,
+};
+
+const WIRE_DEVICE_TYPES = { valve: 1, pump: 2, tank: 3, sump: 4 };
+
+// field name -> [key, kind]
+const WIRE_FIELDS = {
+  org_id: [1, "uuid"],
+  device_id: [2, "uuid"],
+  block_id: [3, "uuid"],
+  schedule_id: [4, "uuid"],
+  device_type: [5, "device_type"],
+  device_types: [6, "device_types"],
+  status: [7, "str"],
+  schedule_status: [8, "str"],
+  start_time: [9, "seconds"],
+  end_time: [10, "seconds"],
+  ack: [11, "bool"],
+  current_level: [12, "uint"],
+  wifi_strength: [13, "uint"],
+  battery: [14, "uint"],
+  wire: [15, "str"],
+  last_updated: [16, "epoch"],
+  recurrence: [17, "recurrence"],
+};
+
+const KEY_TYPE = 0;
+const KEY_DATA = 1;
+
+const invert = (obj) =>
+  Object.fromEntries(Object.entries(obj).map(([k, v]) => [v, k]));
+const TYPE_NAMES = invert(WIRE_TYPES);
+const DEVICE_TYPE_NAMES = invert(WIRE_DEVICE_TYPES);
+const FIELDS_BY_KEY = Object.fromEntries(
+  Object.entries(WIRE_FIELDS).map(([name, [key, kind]]) => [key, [name, kind]])
+);
+
+const UUID_RE = /^[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}$/i;
+
+// ---------------- MessagePack subset ----------------
+class Writer {
+  constructor() {
+    this.bytes = [];
+  }
+  uint(v) {
+    if (v < 0x80) this.bytes.push(v);
+    else if (v < 0x100) this.bytes.push(0xcc, v);
+    else if (v < 0x10000) this.bytes.push(0xcd, v >> 8, v & 0xff);
+    else this.bytes.push(0xce, (v >>> 24) & 0xff, (v >> 16) & 0xff, (v >> 8) & 0xff, v & 0xff);
+  }
+  bool(v) {
+    this.bytes.push(v ? 0xc3 : 0xc2);
+  }
+  str(s) {
+    const b = Buffer.from(String(s), "utf8");
+    if (b.length < 32) this.bytes.push(0xa0 | b.length);
+    else if (b.length < 0x100) this.bytes.push(0xd9, b.length);
+    else throw new Error("Wire string too long");
+    this.bytes.push(...b);
+  }
+  bin(b) {
+    if (b.length >= 0x100) throw new Error("Wire binary too long");
+    this.bytes.push(0xc4, b.length, ...b);
+  }
+  array(n) {
+    if (n >= 16) throw new Error("Wire array too long");
+    this.bytes.push(0x90 | n);
+  }
+  map(n) {
+    if (n >= 16) throw new Error("Wire map too long");
+    this.bytes.push(0x80 | n);
+  }
+  toBuffer() {
+    return Buffer.from(this.bytes);
+  }
+}
+
+class Reader {
+  constructor(buf) {
+    this.buf = buf;
+    this.pos = 0;
+  }
+  byte() {
+    if (this.pos >= this.buf.length) throw new Error("Truncated wire message");
+    return this.buf[this.pos++];
+  }
+  take(n) {
+    if (this.pos + n > this.buf.length) throw new Error("Truncated wire message");
+    const out = this.buf.subarray(this.pos, this.pos + n);
+    this.pos += n;
+    return out;
+  }
+  value() {
+    const b = this.byte();
+    if (b < 0x80) return b;
+    if (b >= 0xe0) return b - 0x100;
+    if ((b & 0xf0) === 0x80) return this.mapBody(b & 0x0f);
+    if ((b & 0xf0) === 0x90) return this.arrayBody(b & 0x0f);
+    if ((b & 0xe0) === 0xa0) return this.take(b & 0x1f).toString("utf8");
+    switch (b) {
+      case 0xc0: return null;
+      case 0xc2: return false;
+      case 0xc3: return true;
+      case 0xc4: return Buffer.from(this.take(this.byte()));
+      case 0xcc: return this.byte();
+      case 0xcd: return this.take(2).readUInt16BE(0);
+      case 0xce: return this.take(4).readUInt32BE(0);
+      case 0xd9: return this.take(this.byte()).toString("utf8");
+      default: throw new Error(`Unsupported wire byte 0x${b.toString(16)}`);
+    }
+  }
+  mapBody(n) {
+    const out = new Map();
+    for (let i = 0; i < n; i++) {
+      const k = this.value();
+      out.set(k, this.value());
+    }
+    return out;
+  }
+  arrayBody(n) {
+    const out = [];
+    for (let i = 0; i < n; i++) out.push(this.value());
+    return out;
+  }
+}
+
+// ---------------- Field conversion ----------------
+const toSeconds = (t) => {
+  const [h, m, s = 0] = String(t).split(":").map(Number);
+  return h * 3600 + m * 60 + s;
+};
+// "HH:mm" unless the time has seconds, so whole-minute times read as before
+const fromSeconds = (v) => {
+  const pad = (n) => String(n).padStart(2, "0");
+  const hhmm = `${pad(Math.floor(v / 3600))}:${pad(Math.floor(v / 60) % 60)}`;
+  return v % 60 ? `${hhmm}:${pad(v % 60)}` : hhmm;
+};
+
+const toDay = (date) => (date ? Date.parse(`${date}T00:00:00Z`) / 86400000 : 0);
+const fromDay = (day) => (day ? new Date(day * 86400000).toISOString().slice(0, 10) : null);
+
+const writeField = (w, kind, value) => {
+  switch (kind) {
+    case "uuid":
+      if (UUID_RE.test(value)) w.bin(Buffer.from(value.replace(/-/g, ""), "hex"));
+      else w.str(value); // e.g. block_id "none"
+      break;
+    case "device_type":
+      w.uint(WIRE_DEVICE_TYPES[value] || 0);
+      break;
+    case "device_types":
+      w.array(value.length);
+      value.forEach((t) => w.uint(WIRE_DEVICE_TYPES[t] || 0));
+      break;
+    case "seconds":
+      w.uint(toSeconds(value));
+      break;
+    case "epoch":
+      w.uint(Math.floor(new Date(value).getTime() / 1000));
+      break;
+    case "recurrence":
+      // labels from before recurrences were normalised are daily on devices
+      if (typeof value !== "object") value = {};
+      w.array(4);
+      w.uint(value.weekdays ?? 0x7f);
+      w.uint(value.every_n_days ?? 1);
+      w.uint(toDay(value.valid_from));
+      w.uint(toDay(value.valid_until));
+      break;
+    case "bool":
+      w.bool(value);
+      break;
+    case "uint":
+      w.uint(Number(value));
+      break;
+    default:
+      w.str(value);
+  }
+};
+
+const readField = (kind, value) => {
+  switch (kind) {
+    case "uuid": {
+      if (!Buffer.isBuffer(value)) return value;
+      const h = value.toString("hex");
+      return `${h.slice(0, 8)}-${h.slice(8, 12)}-${h.slice(12, 16)}-${h.slice(16, 20)}-${h.slice(20)}`;
+    }
+    case "device_type":
+      return DEVICE_TYPE_NAMES[value];
+    case "device_types":
+      return value.map((t) => DEVICE_TYPE_NAMES[t]);
+    case "seconds":
+      return fromSeconds(value);
+    case "epoch":
+      return new Date(value * 1000).toISOString();
+    case "recurrence": {
+      const [weekdays, every_n_days, from, until] = value;
+      return { weekdays, every_n_days, valid_from: fromDay(from), valid_until: fromDay(until) };
+    }
+    default:
+      return value;
+  }
+};
+
+/**
+ * Encode a { type, data } message. Fields without a wire key are dropped.
+ * @returns {Buffer}
+ */
+export function encodeWireMessage({ type, data = {} }) {
+  const typeId = WIRE_TYPES[type];
+  if (!typeId) throw new Error(`No wire encoding for ${type}`);
+
+  const fields = Object.entries(data).filter(
+    ([name, value]) => WIRE_FIELDS[name] && value !== undefined && value !== null
+  );
+  const w = new Writer();
+  w.map(2);
+  w.uint(KEY_TYPE);
+  w.uint(typeId);
+  w.uint(KEY_DATA);
+  w.map(fields.length);
+  for (const [name, value] of fields) {
+    const [key, kind] = WIRE_FIELDS[name];
+    w.uint(key);
+    writeField(w, kind, value);
+  }
+  return w.toBuffer();
+}
+
+/**
+ * Decode a wire message back into the JSON shape: { type, data }.
+ * @param {Buffer} buf
+ */
+export function decodeWireMessage(buf) {
+  const msg = new Reader(buf).value();
+  if (!(msg instanceof Map)) throw new Error("Wire message is not a map");
+
+  const type = TYPE_NAMES[msg.get(KEY_TYPE)];
+  if (!type) throw new Error(`Unknown wire type ${msg.get(KEY_TYPE)}`);
+
+  const data = {};
+  const raw = msg.get(KEY_DATA);
+  if (raw instanceof Map) {
+    for (const [key, value] of raw) {
+      const field = FIELDS_BY_KEY[key];
+      if (field) data[field[0]] = readField(field[1], value);
+    }
+  }
+  return { type, data };
+}
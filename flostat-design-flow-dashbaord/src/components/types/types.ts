@@ -83,6 +83,13 @@ export interface UpdateDeviceStatusPayload {
    device_type: string;
 }
 
+export interface ScheduleRecurrence {
+  weekdays: number; // bit mask, bit 0 = Sunday
+  every_n_days: number;
+  valid_from: string | null; // "YYYY-MM-DD", inclusive
+  valid_until: string | null;
+}
+
 export interface Schedule {
 schedule_id?: string;
  org_id?: string;
@@ -94,6 +101,7 @@ schedule_id?: string;
    pump_ack?: boolean;
   valve_ack?: boolean;
   schedule_status?: string;
+  recurrence?: ScheduleRecurrence | string;
   ack?:boolean;
   [key: string]: any;
 }
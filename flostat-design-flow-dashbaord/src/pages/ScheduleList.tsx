@@ -6,7 +6,7 @@ import { getScheduleByOrgId } from "@/lib/operations/scheduleApis";
 import { Card, CardContent, CardHeader } from "@/components/ui/card";
 import { Button } from "@/components/ui/button";
 import { toast } from "sonner";
-import { formatTimeTo12H } from "@/utils/timeUtils";
+import { formatRecurrence, formatTimeTo12H } from "@/utils/timeUtils";
 import {
   RotateCw,
   Edit,
@@ -392,9 +392,7 @@ export default function ScheduleList() {
                     <div className="flex justify-between">
                       <span className="text-soft-muted">Recurrence:</span>
                       <span className="font-medium text-soft capitalize">
-                        {typeof schedule.recurrence === "object"
-                          ? `${schedule.recurrence.type} every ${schedule.recurrence.interval}`
-                          : schedule.recurrence}
+                        {formatRecurrence(schedule.recurrence)}
                       </span>
                     </div>
                   )}
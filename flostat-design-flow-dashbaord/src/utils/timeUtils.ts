@@ -1,3 +1,5 @@
+import { ScheduleRecurrence } from "@/components/types/types";
+
 /**
  * Formats a 24-hour time string to 12-hour format with AM/PM
  * @param time24 - Time string in "HH:mm" or "HH:mm:ss" format
@@ -54,3 +56,31 @@ export const formatTimeTo24H = (time12: string | undefined | null): string => {
         return time12;
     }
 };
+
+const WEEKDAY_NAMES = ["Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"];
+
+/**
+ * Describes a schedule recurrence for display
+ * @param recurrence - { weekdays, every_n_days, valid_from, valid_until } as stored by the
+ *   server (weekdays is a bit mask, bit 0 = Sunday), or a legacy label such as "daily"
+ * @returns e.g. "Mon, Wed · every 2 days · from 2026-11-01"
+ */
+export const formatRecurrence = (recurrence: ScheduleRecurrence | string | undefined | null): string => {
+    if (!recurrence) return "";
+    if (typeof recurrence !== "object") return recurrence;
+
+    const weekdays = recurrence.weekdays ?? 0x7f;
+    const parts = [
+        weekdays === 0x7f ? "Daily" : WEEKDAY_NAMES.filter((_, day) => weekdays & (1 << day)).join(", "),
+    ];
+    if (recurrence.every_n_days && recurrence.every_n_days > 1) {
+        parts.push(`every ${recurrence.every_n_days} days`);
+    }
+    if (recurrence.valid_from && recurrence.valid_from === recurrence.valid_until) {
+        parts.push(`on ${recurrence.valid_from}`);
+    } else {
+        if (recurrence.valid_from) parts.push(`from ${recurrence.valid_from}`);
+        if (recurrence.valid_until) parts.push(`until ${recurrence.valid_until}`);
+    }
+    return parts.join(" · ");
+};